@@ -148,7 +148,7 @@
 #define BUFSIZE (1024*16+1)
 #define MAX_MISALIGNMENT 63
 
-#define ALGOR_NUM       34
+#define ALGOR_NUM       35
 #define SIZE_NUM        6
 #define PRIME_NUM       3
 #define RSA_NUM         7
@@ -224,6 +224,7 @@ static int HMAC_loop(void *args);
 #endif
 #ifndef OPENSSL_NO_SM3
 static int SM3_loop(void *args);
+static int SM3_mb_loop(void *args);
 #endif
 #ifndef OPENSSL_NO_SHA
 static int SHA1_loop(void *args);
@@ -298,7 +299,7 @@ static const char *names[ALGOR_NUM] = {
     "camellia-128 cbc", "camellia-192 cbc", "camellia-256 cbc",
     "evp", "sha256", "sha512", "whirlpool",
     "aes-128 ige", "aes-192 ige", "aes-256 ige", "ghash",
-    "sm3", "sms4 cbc", "zuc", "zuc256"
+    "sm3", "sms4 cbc", "zuc", "zuc256", "sm3 mb"
 };
 
 static double results[ALGOR_NUM][SIZE_NUM];
@@ -485,6 +486,7 @@ OPTIONS speed_options[] = {
 #define D_CBC_SMS4      31
 #define D_ZUC           32
 #define D_ZUC256        33
+#define D_SM3_MB        34
 static OPT_PAIR doit_choices[] = {
 #ifndef OPENSSL_NO_MD2
     {"md2", D_MD2},
@@ -556,6 +558,7 @@ static OPT_PAIR doit_choices[] = {
     {"ghash", D_GHASH},
 #ifndef OPENSSL_NO_SM3
     {"sm3", D_SM3},
+    {"sm3-mb", D_SM3_MB},
 #endif
 #ifndef OPENSSL_NO_SMS4
     {"sms4-cbc", D_CBC_SMS4},
@@ -790,6 +793,26 @@ static int SM3_loop(void *args)
         sm3(buf, lengths[testnum], sm3md);
     return count;
 }
+
+/* SM3_MB_LANES messages of the same length per call */
+static int SM3_mb_loop(void *args)
+{
+    loopargs_t *tempargs = *(loopargs_t **)args;
+    const unsigned char *data[SM3_MB_LANES];
+    size_t datalen[SM3_MB_LANES];
+    unsigned char md[SM3_MB_LANES][SM3_DIGEST_LENGTH];
+    unsigned char *digest[SM3_MB_LANES];
+    int count, i;
+
+    for (i = 0; i < SM3_MB_LANES; i++) {
+        data[i] = tempargs->buf;
+        datalen[i] = lengths[testnum];
+        digest[i] = md[i];
+    }
+    for (count = 0; COND(c[D_SM3_MB][testnum]); count += SM3_MB_LANES)
+        sm3_mb(data, datalen, digest, SM3_MB_LANES);
+    return count;
+}
 #endif
 
 #ifndef OPENSSL_NO_SHA
@@ -2140,6 +2163,7 @@ int speed_main(int argc, char **argv)
     c[D_CBC_SMS4][0] = count;
     c[D_ZUC][0] = count;
     c[D_ZUC256][0] = count;
+    c[D_SM3_MB][0] = count;
 
     for (i = 1; i < SIZE_NUM; i++) {
         long l0, l1;
@@ -2159,6 +2183,7 @@ int speed_main(int argc, char **argv)
         c[D_WHIRLPOOL][i] = c[D_WHIRLPOOL][0] * 4 * l0 / l1;
         c[D_GHASH][i] = c[D_GHASH][0] * 4 * l0 / l1;
         c[D_SM3][i] = c[D_SM3][0] * 4 * l0 / l1;
+        c[D_SM3_MB][i] = c[D_SM3_MB][0] * 4 * l0 / l1;
 
         l0 = (long)lengths[i - 1];
 
@@ -2403,6 +2428,15 @@ int speed_main(int argc, char **argv)
             print_result(D_SM3, testnum, count, d);
         }
     }
+    if (doit[D_SM3_MB]) {
+        for (testnum = 0; testnum < SIZE_NUM; testnum++) {
+            print_message(names[D_SM3_MB], c[D_SM3_MB][testnum], lengths[testnum]);
+            Time_F(START);
+            count = run_benchmark(async_jobs, SM3_mb_loop, loopargs);
+            d = Time_F(STOP);
+            print_result(D_SM3_MB, testnum, count, d);
+        }
+    }
 #endif
 #ifndef OPENSSL_NO_SHA
     if (doit[D_SHA1]) {
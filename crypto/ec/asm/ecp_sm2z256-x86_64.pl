@@ -120,6 +120,12 @@ $code.=<<___;
 .long 3,3,3,3,3,3,3,3
 .LONE_mont:
 .quad 0x0000000000000001, 0x00000000ffffffff, 0x0000000000000000, 0x0000000100000000
+
+# The order of the SM2 P256 group
+.Lord:
+.quad 0x53bbf40939d54123, 0x7203df6b21c6052b, 0xffffffffffffffff, 0xfffffffeffffffff
+.LordK:
+.quad 0x327f9e8872350975
 ___
 
 {
@@ -1477,6 +1483,286 @@ ecp_sm2z256_from_mont:
 ___
 }
 {
+my ($r_ptr,$a_ptr,$b_org,$b_ptr)=("%rdi","%rsi","%rdx","%rbx");
+my ($acc0,$acc1,$acc2,$acc3,$acc4,$acc5,$acc6,$acc7)=map("%r$_",(8..15));
+my ($t0,$t1,$t2)=("%rcx","%rbp","%rsi");
+
+# Montgomery reduction of the 512-bit value in $acc0-$acc7 modulo the
+# group order. Each step folds in m*n, where n[2] = 2^64-1 and
+# n[3] = 2^64-2^32-1, so that the upper half of m*n is computed as
+# m*2^128 - m*2^96 - m with shifts and subtractions instead of mulq.
+sub __ord_reduce {
+my @w=($acc0,$acc1,$acc2,$acc3);
+my $code;
+
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	mov	$w[0], $t0
+	imulq	.LordK(%rip), $t0
+	mov	.Lord+8*1(%rip), %rax
+	mulq	$t0
+	mov	%rax, $t1
+	mov	.Lord+8*0(%rip), %rax
+	mov	%rdx, $t2
+	mulq	$t0
+	add	%rax, $w[0]		# guaranteed to be zero
+	adc	%rdx, $t1
+	adc	\$0, $t2
+	add	$t1, $w[1]
+	adc	$t2, $w[2]
+	adc	\$0, $w[3]
+	adc	\$0, $w[0]
+
+	mov	$t0, %rax
+	mov	$t0, %rdx
+	shl	\$32, %rax
+	shr	\$32, %rdx
+	mov	$t0, $t1
+	neg	$t1
+	mov	\$0, $t2
+	sbb	%rax, $t2
+	sbb	%rdx, $t0
+	add	$t1, $w[2]
+	adc	$t2, $w[3]
+	adc	$t0, $w[0]
+
+___
+	push(@w,shift(@w));
+}
+$code.=<<___;
+	xor	$t1, $t1
+	add	$acc4, $acc0
+	adc	$acc5, $acc1
+	 mov	$acc0, $acc4
+	adc	$acc6, $acc2
+	adc	$acc7, $acc3
+	 mov	$acc1, $acc5
+	adc	\$0, $t1
+
+	sub	.Lord+8*0(%rip), $acc0
+	 mov	$acc2, $acc6
+	sbb	.Lord+8*1(%rip), $acc1
+	sbb	.Lord+8*2(%rip), $acc2
+	 mov	$acc3, $acc7
+	sbb	.Lord+8*3(%rip), $acc3
+	sbb	\$0, $t1
+
+	cmovc	$acc4, $acc0
+	cmovc	$acc5, $acc1
+	mov	$acc0, 8*0($r_ptr)
+	cmovc	$acc6, $acc2
+	mov	$acc1, 8*1($r_ptr)
+	cmovc	$acc7, $acc3
+	mov	$acc2, 8*2($r_ptr)
+	mov	$acc3, 8*3($r_ptr)
+___
+$code;
+}
+
+$code.=<<___;
+################################################################################
+# void ecp_sm2z256_ord_mul_mont(
+#   uint64_t res[4],
+#   uint64_t a[4],
+#   uint64_t b[4]);
+# Montgomery multiplication modulo the group order, res = a * b / 2^256 mod n.
+
+.globl	ecp_sm2z256_ord_mul_mont
+.type	ecp_sm2z256_ord_mul_mont,\@function,3
+.align	32
+ecp_sm2z256_ord_mul_mont:
+	push	%rbp
+	push	%rbx
+	push	%r12
+	push	%r13
+	push	%r14
+	push	%r15
+
+	mov	$b_org, $b_ptr
+___
+my @acc=($acc0,$acc1,$acc2,$acc3,$acc4,$acc5,$acc6,$acc7);
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	########################################################################
+	# Multiply a by b[$i]
+
+	mov	8*$i($b_ptr), $t0
+___
+for (my $j=0; $j<4; $j++) {
+my $k=$i+$j;
+$code.=<<___;
+	mov	8*$j($a_ptr), %rax
+	mulq	$t0
+___
+if ($i==0 && $j==0) {
+$code.=<<___;
+	mov	%rax, $acc[$k]
+___
+} elsif ($i==0) {
+$code.=<<___;
+	add	$t1, %rax
+	adc	\$0, %rdx
+	mov	%rax, $acc[$k]
+___
+} elsif ($j==0) {
+$code.=<<___;
+	add	%rax, $acc[$k]
+	adc	\$0, %rdx
+___
+} else {
+$code.=<<___;
+	add	%rax, $acc[$k]
+	adc	\$0, %rdx
+	add	$t1, $acc[$k]
+	adc	\$0, %rdx
+___
+}
+$code.=<<___ if ($j<3);
+	mov	%rdx, $t1
+___
+$code.=<<___ if ($j==3);
+	mov	%rdx, $acc[$k+1]
+___
+}
+}
+$code.=<<___;
+
+	########################################################################
+	# Reduction
+___
+$code.=&__ord_reduce();
+$code.=<<___;
+
+	pop	%r15
+	pop	%r14
+	pop	%r13
+	pop	%r12
+	pop	%rbx
+	pop	%rbp
+	ret
+.size	ecp_sm2z256_ord_mul_mont,.-ecp_sm2z256_ord_mul_mont
+
+################################################################################
+# void ecp_sm2z256_ord_sqr_mont(
+#   uint64_t res[4],
+#   uint64_t a[4],
+#   uint64_t rep);
+# Squares a modulo the group order rep times in the Montgomery domain,
+# rep must not be zero.
+
+.globl	ecp_sm2z256_ord_sqr_mont
+.type	ecp_sm2z256_ord_sqr_mont,\@function,3
+.align	32
+ecp_sm2z256_ord_sqr_mont:
+	push	%rbp
+	push	%rbx
+	push	%r12
+	push	%r13
+	push	%r14
+	push	%r15
+
+	mov	$b_org, %rbx
+
+.Lord_sqr_loop:
+	mov	8*0($a_ptr), %rax
+	mov	8*1($a_ptr), $acc6
+	mov	8*2($a_ptr), $acc7
+	mov	8*3($a_ptr), $acc0
+
+	mov	%rax, $acc5
+	mulq	$acc6			# a[1]*a[0]
+	mov	%rax, $acc1
+	mov	$acc7, %rax
+	mov	%rdx, $acc2
+
+	mulq	$acc5			# a[0]*a[2]
+	add	%rax, $acc2
+	mov	$acc0, %rax
+	adc	\$0, %rdx
+	mov	%rdx, $acc3
+
+	mulq	$acc5			# a[0]*a[3]
+	add	%rax, $acc3
+	 mov	$acc7, %rax
+	adc	\$0, %rdx
+	mov	%rdx, $acc4
+
+	#################################
+	mulq	$acc6			# a[1]*a[2]
+	add	%rax, $acc3
+	mov	$acc0, %rax
+	adc	\$0, %rdx
+	mov	%rdx, $t1
+
+	mulq	$acc6			# a[1]*a[3]
+	add	%rax, $acc4
+	 mov	$acc0, %rax
+	adc	\$0, %rdx
+	add	$t1, $acc4
+	mov	%rdx, $acc5
+	adc	\$0, $acc5
+
+	#################################
+	mulq	$acc7			# a[2]*a[3]
+	xor	$acc7, $acc7
+	add	%rax, $acc5
+	 mov	8*0($a_ptr), %rax
+	mov	%rdx, $acc6
+	adc	\$0, $acc6
+
+	add	$acc1, $acc1		# acc1:6<<1
+	adc	$acc2, $acc2
+	adc	$acc3, $acc3
+	adc	$acc4, $acc4
+	adc	$acc5, $acc5
+	adc	$acc6, $acc6
+	adc	\$0, $acc7
+
+	mulq	%rax
+	mov	%rax, $acc0
+	mov	8*1($a_ptr), %rax
+	mov	%rdx, $t0
+
+	mulq	%rax
+	add	$t0, $acc1
+	adc	%rax, $acc2
+	mov	8*2($a_ptr), %rax
+	adc	\$0, %rdx
+	mov	%rdx, $t0
+
+	mulq	%rax
+	add	$t0, $acc3
+	adc	%rax, $acc4
+	mov	8*3($a_ptr), %rax
+	adc	\$0, %rdx
+	mov	%rdx, $t0
+
+	mulq	%rax
+	add	$t0, $acc5
+	adc	%rax, $acc6
+	adc	%rdx, $acc7
+
+	##########################################
+	# Reduction
+___
+$code.=&__ord_reduce();
+$code.=<<___;
+
+	mov	$r_ptr, $a_ptr
+	dec	%rbx
+	jnz	.Lord_sqr_loop
+
+	pop	%r15
+	pop	%r14
+	pop	%r13
+	pop	%r12
+	pop	%rbx
+	pop	%rbp
+	ret
+.size	ecp_sm2z256_ord_sqr_mont,.-ecp_sm2z256_ord_sqr_mont
+___
+}
+{
 my ($val,$in_t,$index)=$win64?("%rcx","%rdx","%r8d"):("%rdi","%rsi","%edx");
 my ($ONE,$INDEX,$Ra,$Rb,$Rc,$Rd,$Re,$Rf)=map("%xmm$_",(0..7));
 my ($M0,$T0a,$T0b,$T0c,$T0d,$T0e,$T0f,$TMP0)=map("%xmm$_",(8..15));
@@ -53,9 +53,6 @@ int ec_GF2m_simple_set_compressed_coordinates(const EC_GROUP *group,
     BIGNUM *tmp, *x, *y, *z;
     int ret = 0, z0;
 
-    /* clear error queue */
-    ERR_clear_error();
-
     if (ctx == NULL) {
         ctx = new_ctx = BN_CTX_new();
         if (ctx == NULL)
@@ -91,7 +88,6 @@ int ec_GF2m_simple_set_compressed_coordinates(const EC_GROUP *group,
 
             if (ERR_GET_LIB(err) == ERR_LIB_BN
                 && ERR_GET_REASON(err) == BN_R_NO_SOLUTION) {
-                ERR_clear_error();
                 ECerr(EC_F_EC_GF2M_SIMPLE_SET_COMPRESSED_COORDINATES,
                       EC_R_INVALID_COMPRESSED_POINT);
             } else
@@ -63,10 +63,15 @@ static ERR_STRING_DATA EC_str_functs[] = {
     {ERR_FUNC(EC_F_ECP_NISTZ256_PRE_COMP_NEW), "ecp_nistz256_pre_comp_new"},
     {ERR_FUNC(EC_F_ECP_NISTZ256_WINDOWED_MUL), "ecp_nistz256_windowed_mul"},
     {ERR_FUNC(EC_F_ECP_SM2Z256_GET_AFFINE), "ecp_sm2z256_get_affine"},
+    {ERR_FUNC(EC_F_ECP_SM2Z256_INV_MOD_ORD), "ecp_sm2z256_inv_mod_ord"},
     {ERR_FUNC(EC_F_ECP_SM2Z256_MULT_PRECOMPUTE),
      "ecp_sm2z256_mult_precompute"},
     {ERR_FUNC(EC_F_ECP_SM2Z256_POINTS_MUL), "ecp_sm2z256_points_mul"},
     {ERR_FUNC(EC_F_ECP_SM2Z256_PRE_COMP_NEW), "ecp_sm2z256_pre_comp_new"},
+    {ERR_FUNC(EC_F_ECP_SM2Z256_SM2_VERIFY_BATCH),
+     "ecp_sm2z256_sm2_verify_batch"},
+    {ERR_FUNC(EC_F_ECP_SM2Z256_VERIFY_TABLE_NEW),
+     "ecp_sm2z256_verify_table_new"},
     {ERR_FUNC(EC_F_ECP_SM2Z256_WINDOWED_MUL), "ecp_sm2z256_windowed_mul"},
     {ERR_FUNC(EC_F_ECX_KEY_OP), "ecx_key_op"},
     {ERR_FUNC(EC_F_ECX_PRIV_ENCODE), "ecx_priv_encode"},
@@ -234,7 +239,10 @@ static ERR_STRING_DATA EC_str_functs[] = {
     {ERR_FUNC(EC_F_SM2_GET_PUBLIC_KEY_DATA), "SM2_get_public_key_data"},
     {ERR_FUNC(EC_F_SM2_KAP_COMPUTE_KEY), "SM2_KAP_compute_key"},
     {ERR_FUNC(EC_F_SM2_KAP_CTX_INIT), "SM2_KAP_CTX_init"},
+    {ERR_FUNC(EC_F_SM2_KAP_CTX_SET_POOL), "SM2_KAP_CTX_set_pool"},
     {ERR_FUNC(EC_F_SM2_KAP_FINAL_CHECK), "SM2_KAP_final_check"},
+    {ERR_FUNC(EC_F_SM2_KAP_POOL_NEW), "SM2_KAP_POOL_new"},
+    {ERR_FUNC(EC_F_SM2_KAP_POOL_REFILL), "SM2_KAP_POOL_refill"},
     {ERR_FUNC(EC_F_SM2_KAP_PREPARE), "SM2_KAP_prepare"},
     {0, NULL}
 };
@@ -172,6 +172,9 @@ struct ec_method_st {
     /* custom ECDH operation */
     int (*ecdh_compute_key)(unsigned char **pout, size_t *poutlen,
                             const EC_POINT *pub_key, const EC_KEY *ecdh);
+    /* Inverse modulo order */
+    int (*field_inverse_mod_ord)(const EC_GROUP *, BIGNUM *r,
+                                 const BIGNUM *x, BN_CTX *);
 };
 
 /*
@@ -568,6 +571,8 @@ void ec_GFp_nistp_recode_scalar_bits(unsigned char *sign,
 #endif
 int ec_precompute_mont_data(EC_GROUP *);
 int ec_group_simple_order_bits(const EC_GROUP *group);
+int ec_group_do_inverse_ord(const EC_GROUP *group, BIGNUM *res,
+                            const BIGNUM *x, BN_CTX *ctx);
 
 #ifdef ECP_NISTZ256_ASM
 /** Returns GFp methods using montgomery multiplication, with x86-64 optimized
@@ -578,8 +583,55 @@ const EC_METHOD *EC_GFp_nistz256_method(void);
 #endif
 
 #ifndef OPENSSL_NO_SM2
-# if defined(ECP_NISTZ256_ASM) && BN_BITS2 == 64 && !defined(GMSSL_NO_TURBO)
+/*
+ * sm2p256v1 in Montgomery form on 64-bit limbs, with the field arithmetic
+ * in assembly where ECP_SM2Z256_ASM is defined and in C with a 128-bit
+ * product elsewhere.
+ */
+# if BN_BITS2 == 64 && !defined(GMSSL_NO_TURBO) && \
+     (defined(ECP_SM2Z256_ASM) || \
+      (defined(__SIZEOF_INT128__) && __SIZEOF_INT128__ == 16))
+#  define ECP_SM2Z256
 const EC_METHOD *EC_GFp_sm2z256_method(void);
+
+/*
+ * Fixed size SM2 signature on sm2p256v1, scalars and coordinates are four
+ * little-endian 64-bit words and nothing is allocated.
+ */
+#  define ECP_SM2Z256_SM2
+typedef struct sm2z256_verify_table_st SM2Z256_VERIFY_TABLE;
+int ecp_sm2z256_group_is_sm2p256v1(const EC_GROUP *group);
+int ecp_sm2z256_point_get_affine_words(const EC_POINT *point,
+                                       BN_ULONG x[4], BN_ULONG y[4]);
+int ecp_sm2z256_sm2_sign_precompute(BN_ULONG dinv[4], const BN_ULONG d[4]);
+int ecp_sm2z256_sm2_sign(BN_ULONG r[4], BN_ULONG s[4], const BN_ULONG e[4],
+                         const BN_ULONG k[4], const BN_ULONG dinv[4]);
+int ecp_sm2z256_sm2_presign(BN_ULONG (*x)[4], const BN_ULONG (*k)[4],
+                            size_t num);
+int ecp_sm2z256_sm2_sign_presigned(BN_ULONG r[4], BN_ULONG s[4],
+                                   const BN_ULONG e[4], const BN_ULONG k[4],
+                                   const BN_ULONG x[4],
+                                   const BN_ULONG dinv[4]);
+int ecp_sm2z256_sm2_verify(const BN_ULONG r[4], const BN_ULONG s[4],
+                           const BN_ULONG e[4], const BN_ULONG x[4],
+                           const BN_ULONG y[4]);
+int ecp_sm2z256_sm2_verify_batch(int *ok, size_t num,
+                                 const BN_ULONG (*r)[4],
+                                 const BN_ULONG (*s)[4],
+                                 const BN_ULONG (*e)[4],
+                                 const size_t *key, size_t num_keys,
+                                 const BN_ULONG (*x)[4],
+                                 const BN_ULONG (*y)[4],
+                                 SM2Z256_VERIFY_TABLE *const *tables);
+SM2Z256_VERIFY_TABLE *ecp_sm2z256_verify_table_new(const BN_ULONG x[4],
+                                                   const BN_ULONG y[4]);
+int ecp_sm2z256_verify_table_up_ref(SM2Z256_VERIFY_TABLE *table);
+void ecp_sm2z256_verify_table_free(SM2Z256_VERIFY_TABLE *table);
+int ecp_sm2z256_verify_table_is_for(const SM2Z256_VERIFY_TABLE *table,
+                                    const BN_ULONG x[4], const BN_ULONG y[4]);
+int ecp_sm2z256_sm2_verify_table(const BN_ULONG r[4], const BN_ULONG s[4],
+                                 const BN_ULONG e[4],
+                                 const SM2Z256_VERIFY_TABLE *table);
 # endif
 #endif
 
@@ -89,6 +89,10 @@
 #include "internal/bn_int.h"
 #include "ec_lcl.h"
 
+#ifndef ECP_SM2Z256
+NON_EMPTY_TRANSLATION_UNIT
+#else
+
 #if BN_BITS2 != 64
 # define TOBN(hi,lo)    lo,hi
 #else
@@ -136,6 +140,7 @@ struct sm2z256_pre_comp_st {
     CRYPTO_RWLOCK *lock;
 };
 
+#ifdef ECP_SM2Z256_ASM
 /* Functions implemented in assembly */
 /*
  * Most of below mentioned functions *preserve* the property of inputs
@@ -186,6 +191,14 @@ void ecp_sm2z256_from_mont(BN_ULONG res[P256_LIMBS],
 /* Convert a number to Montgomery domain, by multiplying with 2^512 mod P*/
 void ecp_sm2z256_to_mont(BN_ULONG res[P256_LIMBS],
                          const BN_ULONG in[P256_LIMBS]);
+/* Montgomery mul modulo Order(G): res = a*b*2^-256 mod Order(G) */
+void ecp_sm2z256_ord_mul_mont(BN_ULONG res[P256_LIMBS],
+                              const BN_ULONG a[P256_LIMBS],
+                              const BN_ULONG b[P256_LIMBS]);
+/* Montgomery sqr modulo Order(G), repeated rep times */
+void ecp_sm2z256_ord_sqr_mont(BN_ULONG res[P256_LIMBS],
+                              const BN_ULONG a[P256_LIMBS],
+                              BN_ULONG rep);
 /* Functions that perform constant time access to the precomputed tables */
 void ecp_sm2z256_scatter_w5(P256_POINT *val,
                             const P256_POINT *in_t, int idx);
@@ -195,6 +208,10 @@ void ecp_sm2z256_scatter_w7(P256_POINT_AFFINE *val,
                             const P256_POINT_AFFINE *in_t, int idx);
 void ecp_sm2z256_gather_w7(P256_POINT_AFFINE *val,
                            const P256_POINT_AFFINE *in_t, int idx);
+#elif !defined(ECP_SM2Z256_REFERENCE_IMPLEMENTATION)
+/* Without assembly the point arithmetic below is in C too */
+# define ECP_SM2Z256_REFERENCE_IMPLEMENTATION
+#endif
 
 /* One converted into the Montgomery domain */
 static const BN_ULONG ONE[P256_LIMBS] = {
@@ -205,7 +222,14 @@ static const BN_ULONG ONE[P256_LIMBS] = {
 static SM2Z256_PRE_COMP *ecp_sm2z256_pre_comp_new(const EC_GROUP *group);
 
 /* Precomputed tables for the default generator */
+#ifdef ECP_SM2Z256_ASM
 extern const PRECOMP256_ROW ecp_sm2z256_precomputed[37];
+#else
+# include "ecp_sm2z256_table.c"
+/* the table is declared as words, the rows have the same layout */
+# define ecp_sm2z256_precomputed \
+    ((const PRECOMP256_ROW *)ecp_sm2z256_precomputed)
+#endif
 
 /* Recode window to a signed digit, see ecp_nistputil.c for details */
 static unsigned int _booth_recode_w5(unsigned int in)
@@ -302,6 +326,395 @@ static BN_ULONG is_one(const BIGNUM *z)
     return res;
 }
 
+#ifndef ECP_SM2Z256_ASM
+/*
+ * Portable versions of the assembly functions, on 64-bit limbs with a
+ * 128-bit product. All of them are constant time and keep their inputs and
+ * outputs fully reduced.
+ */
+typedef __uint128_t u128;
+
+/* P = 2^256 - 2^224 - 2^96 + 2^64 - 1 */
+static const BN_ULONG SM2Z256_P[P256_LIMBS] = {
+    TOBN(0xffffffff, 0xffffffff), TOBN(0xffffffff, 0x00000000),
+    TOBN(0xffffffff, 0xffffffff), TOBN(0xfffffffe, 0xffffffff)
+};
+
+/* RR = 2^512 mod P */
+static const BN_ULONG SM2Z256_RR[P256_LIMBS] = {
+    TOBN(0x00000002, 0x00000003), TOBN(0x00000002, 0xffffffff),
+    TOBN(0x00000001, 0x00000001), TOBN(0x00000004, 0x00000002)
+};
+
+/* Order(G) and -Order(G)^-1 mod 2^64 */
+static const BN_ULONG SM2Z256_N[P256_LIMBS] = {
+    TOBN(0x53bbf409, 0x39d54123), TOBN(0x7203df6b, 0x21c6052b),
+    TOBN(0xffffffff, 0xffffffff), TOBN(0xfffffffe, 0xffffffff)
+};
+static const BN_ULONG SM2Z256_N0 = TOBN(0x327f9e88, 0x72350975);
+
+/* r = a + b, returns the carry */
+static BN_ULONG sm2z256_add_words(BN_ULONG r[P256_LIMBS],
+                                  const BN_ULONG a[P256_LIMBS],
+                                  const BN_ULONG b[P256_LIMBS])
+{
+    u128 c = 0;
+    int i;
+
+    for (i = 0; i < P256_LIMBS; i++) {
+        c += (u128)a[i] + b[i];
+        r[i] = (BN_ULONG)c;
+        c >>= 64;
+    }
+    return (BN_ULONG)c;
+}
+
+/* r = a - b, returns the borrow */
+static BN_ULONG sm2z256_sub_words(BN_ULONG r[P256_LIMBS],
+                                  const BN_ULONG a[P256_LIMBS],
+                                  const BN_ULONG b[P256_LIMBS])
+{
+    BN_ULONG borrow = 0;
+    u128 d;
+    int i;
+
+    for (i = 0; i < P256_LIMBS; i++) {
+        d = (u128)a[i] - b[i] - borrow;
+        r[i] = (BN_ULONG)d;
+        borrow = (BN_ULONG)(d >> 64) & 1;
+    }
+    return borrow;
+}
+
+/* res = a - m if that does not borrow or carry is set, a otherwise */
+static void sm2z256_reduce_once(BN_ULONG res[P256_LIMBS],
+                                const BN_ULONG a[P256_LIMBS],
+                                BN_ULONG carry, const BN_ULONG m[P256_LIMBS])
+{
+    BN_ULONG t[P256_LIMBS], borrow, mask;
+    int i;
+
+    borrow = sm2z256_sub_words(t, a, m);
+    mask = 0 - (carry | (borrow ^ 1));
+    for (i = 0; i < P256_LIMBS; i++)
+        res[i] = (t[i] & mask) | (a[i] & ~mask);
+}
+
+/* res = a*b*2^-256 mod m, for a, b < m, used for the order */
+static void sm2z256_mul_mont(BN_ULONG res[P256_LIMBS],
+                             const BN_ULONG a[P256_LIMBS],
+                             const BN_ULONG b[P256_LIMBS],
+                             const BN_ULONG m[P256_LIMBS], BN_ULONG n0)
+{
+    BN_ULONG t[P256_LIMBS + 2] = { 0 };
+    BN_ULONG q;
+    u128 c;
+    int i, j;
+
+    for (i = 0; i < P256_LIMBS; i++) {
+        c = 0;
+        for (j = 0; j < P256_LIMBS; j++) {
+            c += (u128)a[j] * b[i] + t[j];
+            t[j] = (BN_ULONG)c;
+            c >>= 64;
+        }
+        c += t[4];
+        t[4] = (BN_ULONG)c;
+        t[5] = (BN_ULONG)(c >> 64);
+
+        q = t[0] * n0;
+        c = ((u128)q * m[0] + t[0]) >> 64;
+        for (j = 1; j < P256_LIMBS; j++) {
+            c += (u128)q * m[j] + t[j];
+            t[j - 1] = (BN_ULONG)c;
+            c >>= 64;
+        }
+        c += t[4];
+        t[3] = (BN_ULONG)c;
+        t[4] = t[5] + (BN_ULONG)(c >> 64);
+    }
+
+    sm2z256_reduce_once(res, t, t[4], m);
+}
+
+/* t = a*b */
+static void sm2z256_mul_wide(BN_ULONG t[2 * P256_LIMBS],
+                             const BN_ULONG a[P256_LIMBS],
+                             const BN_ULONG b[P256_LIMBS])
+{
+    u128 c;
+    int i, j;
+
+    memset(t, 0, 2 * P256_LIMBS * sizeof(BN_ULONG));
+    for (i = 0; i < P256_LIMBS; i++) {
+        c = 0;
+        for (j = 0; j < P256_LIMBS; j++) {
+            c += (u128)a[j] * b[i] + t[i + j];
+            t[i + j] = (BN_ULONG)c;
+            c >>= 64;
+        }
+        t[i + P256_LIMBS] = (BN_ULONG)c;
+    }
+}
+
+/* t = a*a, the cross products are computed once and doubled */
+static void sm2z256_sqr_wide(BN_ULONG t[2 * P256_LIMBS],
+                             const BN_ULONG a[P256_LIMBS])
+{
+    BN_ULONG t1, t2, t3, t4, t5, t6, t7;
+    u128 c, sq;
+
+    c = (u128)a[0] * a[1];
+    t1 = (BN_ULONG)c;
+    c = (c >> 64) + (u128)a[0] * a[2];
+    t2 = (BN_ULONG)c;
+    c = (c >> 64) + (u128)a[0] * a[3];
+    t3 = (BN_ULONG)c;
+    t4 = (BN_ULONG)(c >> 64);
+
+    c = (u128)a[1] * a[2] + t3;
+    t3 = (BN_ULONG)c;
+    c = (c >> 64) + (u128)a[1] * a[3] + t4;
+    t4 = (BN_ULONG)c;
+    t5 = (BN_ULONG)(c >> 64);
+
+    c = (u128)a[2] * a[3] + t5;
+    t5 = (BN_ULONG)c;
+    t6 = (BN_ULONG)(c >> 64);
+
+    t7 = t6 >> 63;
+    t6 = (t6 << 1) | (t5 >> 63);
+    t5 = (t5 << 1) | (t4 >> 63);
+    t4 = (t4 << 1) | (t3 >> 63);
+    t3 = (t3 << 1) | (t2 >> 63);
+    t2 = (t2 << 1) | (t1 >> 63);
+    t1 = t1 << 1;
+
+    sq = (u128)a[0] * a[0];
+    t[0] = (BN_ULONG)sq;
+    c = (sq >> 64) + t1;
+    t[1] = (BN_ULONG)c;
+    sq = (u128)a[1] * a[1];
+    c = (c >> 64) + (BN_ULONG)sq + t2;
+    t[2] = (BN_ULONG)c;
+    c = (c >> 64) + (sq >> 64) + t3;
+    t[3] = (BN_ULONG)c;
+    sq = (u128)a[2] * a[2];
+    c = (c >> 64) + (BN_ULONG)sq + t4;
+    t[4] = (BN_ULONG)c;
+    c = (c >> 64) + (sq >> 64) + t5;
+    t[5] = (BN_ULONG)c;
+    sq = (u128)a[3] * a[3];
+    c = (c >> 64) + (BN_ULONG)sq + t6;
+    t[6] = (BN_ULONG)c;
+    c = (c >> 64) + (sq >> 64) + t7;
+    t[7] = (BN_ULONG)c;
+}
+
+/*
+ * res = t*2^-256 mod P for t < P*2^256. With -P^-1 = 1 the multiple of P
+ * that clears limb i is q = t[i], and q*P = q*2^256 - q*2^224 - q*2^96 +
+ * q*2^64 - q only takes shifts, so each step adds (q, 0, 0, q) minus
+ * (q*2^32, q*2^32*2^128) to the limbs above i.
+ */
+static void sm2z256_mont_reduce(BN_ULONG res[P256_LIMBS],
+                                BN_ULONG t[2 * P256_LIMBS])
+{
+    BN_ULONG d[P256_LIMBS], q, lo, hi, borrow, carry = 0;
+    u128 c;
+    int i;
+
+    for (i = 0; i < P256_LIMBS; i++) {
+        q = t[i];
+        lo = q << 32;
+        hi = q >> 32;
+
+        /* hi + borrow and lo + borrow cannot wrap */
+        d[0] = q - lo;
+        borrow = q < lo;
+        d[1] = 0 - hi - borrow;
+        borrow = (hi | borrow) != 0;
+        d[2] = 0 - lo - borrow;
+        borrow = (lo | borrow) != 0;
+        d[3] = q - hi - borrow;
+
+        /* the carry out of the last step goes in with d[3] */
+        c = (u128)t[i + 1] + d[0];
+        t[i + 1] = (BN_ULONG)c;
+        c = (c >> 64) + t[i + 2] + d[1];
+        t[i + 2] = (BN_ULONG)c;
+        c = (c >> 64) + t[i + 3] + d[2];
+        t[i + 3] = (BN_ULONG)c;
+        c = (c >> 64) + t[i + 4] + d[3] + carry;
+        t[i + 4] = (BN_ULONG)c;
+        carry = (BN_ULONG)(c >> 64);
+    }
+
+    sm2z256_reduce_once(res, t + P256_LIMBS, carry, SM2Z256_P);
+}
+
+static void ecp_sm2z256_add(BN_ULONG res[P256_LIMBS],
+                            const BN_ULONG a[P256_LIMBS],
+                            const BN_ULONG b[P256_LIMBS])
+{
+    BN_ULONG t[P256_LIMBS], carry;
+
+    carry = sm2z256_add_words(t, a, b);
+    sm2z256_reduce_once(res, t, carry, SM2Z256_P);
+}
+
+static void ecp_sm2z256_mul_by_2(BN_ULONG res[P256_LIMBS],
+                                 const BN_ULONG a[P256_LIMBS])
+{
+    ecp_sm2z256_add(res, a, a);
+}
+
+static void ecp_sm2z256_mul_by_3(BN_ULONG res[P256_LIMBS],
+                                 const BN_ULONG a[P256_LIMBS])
+{
+    BN_ULONG t[P256_LIMBS];
+
+    ecp_sm2z256_add(t, a, a);
+    ecp_sm2z256_add(res, t, a);
+}
+
+static void ecp_sm2z256_div_by_2(BN_ULONG res[P256_LIMBS],
+                                 const BN_ULONG a[P256_LIMBS])
+{
+    BN_ULONG t[P256_LIMBS], p[P256_LIMBS], carry;
+    BN_ULONG mask = 0 - (a[0] & 1);
+    int i;
+
+    /* a + P is even when a is odd */
+    for (i = 0; i < P256_LIMBS; i++)
+        p[i] = SM2Z256_P[i] & mask;
+    carry = sm2z256_add_words(t, a, p);
+    for (i = 0; i < P256_LIMBS - 1; i++)
+        res[i] = (t[i] >> 1) | (t[i + 1] << 63);
+    res[i] = (t[i] >> 1) | (carry << 63);
+}
+
+static void ecp_sm2z256_sub(BN_ULONG res[P256_LIMBS],
+                            const BN_ULONG a[P256_LIMBS],
+                            const BN_ULONG b[P256_LIMBS])
+{
+    BN_ULONG t[P256_LIMBS], p[P256_LIMBS], mask;
+    int i;
+
+    /* add P back if a - b borrowed */
+    mask = 0 - sm2z256_sub_words(t, a, b);
+    for (i = 0; i < P256_LIMBS; i++)
+        p[i] = SM2Z256_P[i] & mask;
+    sm2z256_add_words(res, t, p);
+}
+
+static void ecp_sm2z256_neg(BN_ULONG res[P256_LIMBS],
+                            const BN_ULONG a[P256_LIMBS])
+{
+    static const BN_ULONG zero[P256_LIMBS] = { 0 };
+
+    ecp_sm2z256_sub(res, zero, a);
+}
+
+static void ecp_sm2z256_mul_mont(BN_ULONG res[P256_LIMBS],
+                                 const BN_ULONG a[P256_LIMBS],
+                                 const BN_ULONG b[P256_LIMBS])
+{
+    BN_ULONG t[2 * P256_LIMBS];
+
+    sm2z256_mul_wide(t, a, b);
+    sm2z256_mont_reduce(res, t);
+}
+
+static void ecp_sm2z256_sqr_mont(BN_ULONG res[P256_LIMBS],
+                                 const BN_ULONG a[P256_LIMBS])
+{
+    BN_ULONG t[2 * P256_LIMBS];
+
+    sm2z256_sqr_wide(t, a);
+    sm2z256_mont_reduce(res, t);
+}
+
+static void ecp_sm2z256_from_mont(BN_ULONG res[P256_LIMBS],
+                                  const BN_ULONG in[P256_LIMBS])
+{
+    BN_ULONG t[2 * P256_LIMBS] = { 0 };
+
+    memcpy(t, in, P256_LIMBS * sizeof(BN_ULONG));
+    sm2z256_mont_reduce(res, t);
+}
+
+static void ecp_sm2z256_to_mont(BN_ULONG res[P256_LIMBS],
+                                const BN_ULONG in[P256_LIMBS])
+{
+    ecp_sm2z256_mul_mont(res, in, SM2Z256_RR);
+}
+
+static void ecp_sm2z256_ord_mul_mont(BN_ULONG res[P256_LIMBS],
+                                     const BN_ULONG a[P256_LIMBS],
+                                     const BN_ULONG b[P256_LIMBS])
+{
+    sm2z256_mul_mont(res, a, b, SM2Z256_N, SM2Z256_N0);
+}
+
+static void ecp_sm2z256_ord_sqr_mont(BN_ULONG res[P256_LIMBS],
+                                     const BN_ULONG a[P256_LIMBS],
+                                     BN_ULONG rep)
+{
+    sm2z256_mul_mont(res, a, a, SM2Z256_N, SM2Z256_N0);
+    while (--rep > 0)
+        sm2z256_mul_mont(res, res, res, SM2Z256_N, SM2Z256_N0);
+}
+
+/*
+ * The tables are plain arrays, index idx of a w5 table and index idx - 1
+ * of a w7 table hold multiple idx, gathering 0 gives all zeros.
+ */
+static void ecp_sm2z256_scatter_w5(P256_POINT *val,
+                                   const P256_POINT *in_t, int idx)
+{
+    val[idx - 1] = *in_t;
+}
+
+static void ecp_sm2z256_gather_w5(P256_POINT *val,
+                                  const P256_POINT *in_t, int idx)
+{
+    const BN_ULONG *in = (const BN_ULONG *)in_t;
+    BN_ULONG *out = (BN_ULONG *)val;
+    BN_ULONG mask;
+    size_t i, j;
+
+    memset(val, 0, sizeof(*val));
+    for (i = 0; i < 16; i++, in += 3 * P256_LIMBS) {
+        mask = 0 - is_zero((BN_ULONG)(i + 1) ^ (BN_ULONG)idx);
+        for (j = 0; j < 3 * P256_LIMBS; j++)
+            out[j] |= in[j] & mask;
+    }
+}
+
+static void ecp_sm2z256_scatter_w7(P256_POINT_AFFINE *val,
+                                   const P256_POINT_AFFINE *in_t, int idx)
+{
+    val[idx] = *in_t;
+}
+
+static void ecp_sm2z256_gather_w7(P256_POINT_AFFINE *val,
+                                  const P256_POINT_AFFINE *in_t, int idx)
+{
+    const BN_ULONG *in = (const BN_ULONG *)in_t;
+    BN_ULONG *out = (BN_ULONG *)val;
+    BN_ULONG mask;
+    size_t i, j;
+
+    memset(val, 0, sizeof(*val));
+    for (i = 0; i < 64; i++, in += 2 * P256_LIMBS) {
+        mask = 0 - is_zero((BN_ULONG)(i + 1) ^ (BN_ULONG)idx);
+        for (j = 0; j < 2 * P256_LIMBS; j++)
+            out[j] |= in[j] & mask;
+    }
+}
+#endif
+
 #ifndef ECP_SM2Z256_REFERENCE_IMPLEMENTATION
 // the following functions are not correct in asm
 void ecp_sm2z256_point_double(P256_POINT *r, const P256_POINT *a);
@@ -638,6 +1051,120 @@ __owur static int ecp_sm2z256_bignum_to_field_elem(BN_ULONG out[P256_LIMBS],
     return bn_copy_words(out, in, P256_LIMBS);
 }
 
+/*
+ * ecp_sm2z256_precompute_w5 fills |row| with 1*P .. 16*P for P = temp[0],
+ * temp[1..4] are used as scratch.
+ */
+static void ecp_sm2z256_precompute_w5(P256_POINT row[16], P256_POINT temp[5])
+{
+    /*
+     * row[0] is implicitly (0,0,0) (the point at infinity), therefore it
+     * is not stored. All other values are actually stored with an offset
+     * of -1 in table.
+     */
+
+    ecp_sm2z256_scatter_w5  (row, &temp[0], 1);
+    ecp_sm2z256_point_double(&temp[1], &temp[0]);              /*1+1=2  */
+    ecp_sm2z256_scatter_w5  (row, &temp[1], 2);
+    ecp_sm2z256_point_add   (&temp[2], &temp[1], &temp[0]);    /*2+1=3  */
+    ecp_sm2z256_scatter_w5  (row, &temp[2], 3);
+    ecp_sm2z256_point_double(&temp[1], &temp[1]);              /*2*2=4  */
+    ecp_sm2z256_scatter_w5  (row, &temp[1], 4);
+    ecp_sm2z256_point_double(&temp[2], &temp[2]);              /*2*3=6  */
+    ecp_sm2z256_scatter_w5  (row, &temp[2], 6);
+    ecp_sm2z256_point_add   (&temp[3], &temp[1], &temp[0]);    /*4+1=5  */
+    ecp_sm2z256_scatter_w5  (row, &temp[3], 5);
+    ecp_sm2z256_point_add   (&temp[4], &temp[2], &temp[0]);    /*6+1=7  */
+    ecp_sm2z256_scatter_w5  (row, &temp[4], 7);
+    ecp_sm2z256_point_double(&temp[1], &temp[1]);              /*2*4=8  */
+    ecp_sm2z256_scatter_w5  (row, &temp[1], 8);
+    ecp_sm2z256_point_double(&temp[2], &temp[2]);              /*2*6=12 */
+    ecp_sm2z256_scatter_w5  (row, &temp[2], 12);
+    ecp_sm2z256_point_double(&temp[3], &temp[3]);              /*2*5=10 */
+    ecp_sm2z256_scatter_w5  (row, &temp[3], 10);
+    ecp_sm2z256_point_double(&temp[4], &temp[4]);              /*2*7=14 */
+    ecp_sm2z256_scatter_w5  (row, &temp[4], 14);
+    ecp_sm2z256_point_add   (&temp[2], &temp[2], &temp[0]);    /*12+1=13*/
+    ecp_sm2z256_scatter_w5  (row, &temp[2], 13);
+    ecp_sm2z256_point_add   (&temp[3], &temp[3], &temp[0]);    /*10+1=11*/
+    ecp_sm2z256_scatter_w5  (row, &temp[3], 11);
+    ecp_sm2z256_point_add   (&temp[4], &temp[4], &temp[0]);    /*14+1=15*/
+    ecp_sm2z256_scatter_w5  (row, &temp[4], 15);
+    ecp_sm2z256_point_add   (&temp[2], &temp[1], &temp[0]);    /*8+1=9  */
+    ecp_sm2z256_scatter_w5  (row, &temp[2], 9);
+    ecp_sm2z256_point_double(&temp[1], &temp[1]);              /*2*8=16 */
+    ecp_sm2z256_scatter_w5  (row, &temp[1], 16);
+}
+
+/*
+ * r = sum(scalar[i]*P[i]), scalar[i] is the little-endian |p_str[i]| and
+ * |table[i]| holds the multiples of P[i] from ecp_sm2z256_precompute_w5.
+ */
+static void ecp_sm2z256_windowed_mul_rows(P256_POINT *r,
+                                          unsigned char (*p_str)[33],
+                                          P256_POINT (*table)[16],
+                                          P256_POINT temp[2], size_t num)
+{
+    size_t i;
+    unsigned int idx;
+    const unsigned int window_size = 5;
+    const unsigned int mask = (1 << (window_size + 1)) - 1;
+    unsigned int wvalue;
+
+    idx = 255;
+
+    wvalue = p_str[0][(idx - 1) / 8];
+    wvalue = (wvalue >> ((idx - 1) % 8)) & mask;
+
+    /*
+     * We gather to temp[0], because we know it's position relative
+     * to table
+     */
+    ecp_sm2z256_gather_w5(&temp[0], table[0], _booth_recode_w5(wvalue) >> 1);
+    memcpy(r, &temp[0], sizeof(temp[0]));
+
+    while (idx >= 5) {
+        for (i = (idx == 255 ? 1 : 0); i < num; i++) {
+            unsigned int off = (idx - 1) / 8;
+
+            wvalue = p_str[i][off] | p_str[i][off + 1] << 8;
+            wvalue = (wvalue >> ((idx - 1) % 8)) & mask;
+
+            wvalue = _booth_recode_w5(wvalue);
+
+            ecp_sm2z256_gather_w5(&temp[0], table[i], wvalue >> 1);
+
+            ecp_sm2z256_neg(temp[1].Y, temp[0].Y);
+            copy_conditional(temp[0].Y, temp[1].Y, (wvalue & 1));
+
+            ecp_sm2z256_point_add(r, r, &temp[0]);
+        }
+
+        idx -= window_size;
+
+        ecp_sm2z256_point_double(r, r);
+        ecp_sm2z256_point_double(r, r);
+        ecp_sm2z256_point_double(r, r);
+        ecp_sm2z256_point_double(r, r);
+        ecp_sm2z256_point_double(r, r);
+    }
+
+    /* Final window */
+    for (i = 0; i < num; i++) {
+        wvalue = p_str[i][0];
+        wvalue = (wvalue << 1) & mask;
+
+        wvalue = _booth_recode_w5(wvalue);
+
+        ecp_sm2z256_gather_w5(&temp[0], table[i], wvalue >> 1);
+
+        ecp_sm2z256_neg(temp[1].Y, temp[0].Y);
+        copy_conditional(temp[0].Y, temp[1].Y, wvalue & 1);
+
+        ecp_sm2z256_point_add(r, r, &temp[0]);
+    }
+}
+
 /* r = sum(scalar[i]*point[i]) */
 __owur static int ecp_sm2z256_windowed_mul(const EC_GROUP *group,
                                            P256_POINT *r,
@@ -647,11 +1174,7 @@ __owur static int ecp_sm2z256_windowed_mul(const EC_GROUP *group,
 {
     size_t i;
     int j, ret = 0;
-    unsigned int idx;
     unsigned char (*p_str)[33] = NULL;
-    const unsigned int window_size = 5;
-    const unsigned int mask = (1 << (window_size + 1)) - 1;
-    unsigned int wvalue;
     P256_POINT *temp;           /* place for 5 temporary points */
     const BIGNUM **scalars = NULL;
     P256_POINT (*table)[16] = NULL;
@@ -713,97 +1236,10 @@ __owur static int ecp_sm2z256_windowed_mul(const EC_GROUP *group,
             goto err;
         }
 
-        /*
-         * row[0] is implicitly (0,0,0) (the point at infinity), therefore it
-         * is not stored. All other values are actually stored with an offset
-         * of -1 in table.
-         */
-
-        ecp_sm2z256_scatter_w5  (row, &temp[0], 1);
-        ecp_sm2z256_point_double(&temp[1], &temp[0]);              /*1+1=2  */
-        ecp_sm2z256_scatter_w5  (row, &temp[1], 2);
-        ecp_sm2z256_point_add   (&temp[2], &temp[1], &temp[0]);    /*2+1=3  */
-        ecp_sm2z256_scatter_w5  (row, &temp[2], 3);
-        ecp_sm2z256_point_double(&temp[1], &temp[1]);              /*2*2=4  */
-        ecp_sm2z256_scatter_w5  (row, &temp[1], 4);
-        ecp_sm2z256_point_double(&temp[2], &temp[2]);              /*2*3=6  */
-        ecp_sm2z256_scatter_w5  (row, &temp[2], 6);
-        ecp_sm2z256_point_add   (&temp[3], &temp[1], &temp[0]);    /*4+1=5  */
-        ecp_sm2z256_scatter_w5  (row, &temp[3], 5);
-        ecp_sm2z256_point_add   (&temp[4], &temp[2], &temp[0]);    /*6+1=7  */
-        ecp_sm2z256_scatter_w5  (row, &temp[4], 7);
-        ecp_sm2z256_point_double(&temp[1], &temp[1]);              /*2*4=8  */
-        ecp_sm2z256_scatter_w5  (row, &temp[1], 8);
-        ecp_sm2z256_point_double(&temp[2], &temp[2]);              /*2*6=12 */
-        ecp_sm2z256_scatter_w5  (row, &temp[2], 12);
-        ecp_sm2z256_point_double(&temp[3], &temp[3]);              /*2*5=10 */
-        ecp_sm2z256_scatter_w5  (row, &temp[3], 10);
-        ecp_sm2z256_point_double(&temp[4], &temp[4]);              /*2*7=14 */
-        ecp_sm2z256_scatter_w5  (row, &temp[4], 14);
-        ecp_sm2z256_point_add   (&temp[2], &temp[2], &temp[0]);    /*12+1=13*/
-        ecp_sm2z256_scatter_w5  (row, &temp[2], 13);
-        ecp_sm2z256_point_add   (&temp[3], &temp[3], &temp[0]);    /*10+1=11*/
-        ecp_sm2z256_scatter_w5  (row, &temp[3], 11);
-        ecp_sm2z256_point_add   (&temp[4], &temp[4], &temp[0]);    /*14+1=15*/
-        ecp_sm2z256_scatter_w5  (row, &temp[4], 15);
-        ecp_sm2z256_point_add   (&temp[2], &temp[1], &temp[0]);    /*8+1=9  */
-        ecp_sm2z256_scatter_w5  (row, &temp[2], 9);
-        ecp_sm2z256_point_double(&temp[1], &temp[1]);              /*2*8=16 */
-        ecp_sm2z256_scatter_w5  (row, &temp[1], 16);
-    }
-
-    idx = 255;
-
-    wvalue = p_str[0][(idx - 1) / 8];
-    wvalue = (wvalue >> ((idx - 1) % 8)) & mask;
-
-    /*
-     * We gather to temp[0], because we know it's position relative
-     * to table
-     */
-    ecp_sm2z256_gather_w5(&temp[0], table[0], _booth_recode_w5(wvalue) >> 1);
-    memcpy(r, &temp[0], sizeof(temp[0]));
-
-    while (idx >= 5) {
-        for (i = (idx == 255 ? 1 : 0); i < num; i++) {
-            unsigned int off = (idx - 1) / 8;
-
-            wvalue = p_str[i][off] | p_str[i][off + 1] << 8;
-            wvalue = (wvalue >> ((idx - 1) % 8)) & mask;
-
-            wvalue = _booth_recode_w5(wvalue);
-
-            ecp_sm2z256_gather_w5(&temp[0], table[i], wvalue >> 1);
-
-            ecp_sm2z256_neg(temp[1].Y, temp[0].Y);
-            copy_conditional(temp[0].Y, temp[1].Y, (wvalue & 1));
-
-            ecp_sm2z256_point_add(r, r, &temp[0]);
-        }
-
-        idx -= window_size;
-
-        ecp_sm2z256_point_double(r, r);
-        ecp_sm2z256_point_double(r, r);
-        ecp_sm2z256_point_double(r, r);
-        ecp_sm2z256_point_double(r, r);
-        ecp_sm2z256_point_double(r, r);
+        ecp_sm2z256_precompute_w5(row, temp);
     }
 
-    /* Final window */
-    for (i = 0; i < num; i++) {
-        wvalue = p_str[i][0];
-        wvalue = (wvalue << 1) & mask;
-
-        wvalue = _booth_recode_w5(wvalue);
-
-        ecp_sm2z256_gather_w5(&temp[0], table[i], wvalue >> 1);
-
-        ecp_sm2z256_neg(temp[1].Y, temp[0].Y);
-        copy_conditional(temp[0].Y, temp[1].Y, wvalue & 1);
-
-        ecp_sm2z256_point_add(r, r, &temp[0]);
-    }
+    ecp_sm2z256_windowed_mul_rows(r, p_str, table, temp, num);
 
     ret = 1;
  err:
@@ -1193,14 +1629,86 @@ __owur static int ecp_sm2z256_set_from_affine(EC_POINT *out, const EC_GROUP *gro
     return ret;
 }
 
-/* r = scalar*G + sum(scalars[i]*points[i]) */
-__owur static int ecp_sm2z256_points_mul(const EC_GROUP *group,
-                                         EC_POINT *r,
-                                         const BIGNUM *scalar,
-                                         size_t num,
-                                         const EC_POINT *points[],
-                                         const BIGNUM *scalars[], BN_CTX *ctx)
-{
+/*
+ * r = scalar*G using the table of precomputed multiples of G, |p_str| is the
+ * little-endian scalar.
+ */
+static void ecp_sm2z256_mul_g(P256_POINT *r, const unsigned char p_str[33],
+                              const PRECOMP256_ROW *preComputedTable)
+{
+    unsigned int i, idx = 0;
+    const unsigned int window_size = 7;
+    const unsigned int mask = (1 << (window_size + 1)) - 1;
+    unsigned int wvalue;
+    ALIGN32 union {
+        P256_POINT p;
+        P256_POINT_AFFINE a;
+    } t;
+    BN_ULONG infty;
+
+    /* First window */
+    wvalue = (p_str[0] << 1) & mask;
+    idx += window_size;
+
+    wvalue = _booth_recode_w7(wvalue);
+
+    ecp_sm2z256_gather_w7((P256_POINT_AFFINE *)r, preComputedTable[0],
+                          wvalue >> 1);
+
+    ecp_sm2z256_neg(r->Z, r->Y);
+    copy_conditional(r->Y, r->Z, wvalue & 1);
+
+    /*
+     * Since affine infinity is encoded as (0,0) and
+     * Jacobian ias (,,0), we need to harmonize them
+     * by assigning "one" or zero to Z.
+     */
+    infty = (r->X[0] | r->X[1] | r->X[2] | r->X[3] |
+             r->Y[0] | r->Y[1] | r->Y[2] | r->Y[3]);
+    if (P256_LIMBS == 8)
+        infty |= (r->X[4] | r->X[5] | r->X[6] | r->X[7] |
+                  r->Y[4] | r->Y[5] | r->Y[6] | r->Y[7]);
+
+    infty = 0 - is_zero(infty);
+    infty = ~infty;
+
+    r->Z[0] = ONE[0] & infty;
+    r->Z[1] = ONE[1] & infty;
+    r->Z[2] = ONE[2] & infty;
+    r->Z[3] = ONE[3] & infty;
+    if (P256_LIMBS == 8) {
+        r->Z[4] = ONE[4] & infty;
+        r->Z[5] = ONE[5] & infty;
+        r->Z[6] = ONE[6] & infty;
+        r->Z[7] = ONE[7] & infty;
+    }
+
+    for (i = 1; i < 37; i++) {
+        unsigned int off = (idx - 1) / 8;
+        wvalue = p_str[off] | p_str[off + 1] << 8;
+        wvalue = (wvalue >> ((idx - 1) % 8)) & mask;
+        idx += window_size;
+
+        wvalue = _booth_recode_w7(wvalue);
+
+        ecp_sm2z256_gather_w7(&t.a,
+                              preComputedTable[i], wvalue >> 1);
+
+        ecp_sm2z256_neg(t.p.Z, t.a.Y);
+        copy_conditional(t.a.Y, t.p.Z, wvalue & 1);
+
+        ecp_sm2z256_point_add_affine(r, r, &t.a);
+    }
+}
+
+/* r = scalar*G + sum(scalars[i]*points[i]) */
+__owur static int ecp_sm2z256_points_mul(const EC_GROUP *group,
+                                         EC_POINT *r,
+                                         const BIGNUM *scalar,
+                                         size_t num,
+                                         const EC_POINT *points[],
+                                         const BIGNUM *scalars[], BN_CTX *ctx)
+{
     int i = 0, ret = 0, no_precomp_for_generator = 0, p_is_infinity = 0;
     size_t j;
     unsigned char p_str[33] = { 0 };
@@ -1210,10 +1718,6 @@ __owur static int ecp_sm2z256_points_mul(const EC_GROUP *group,
     BN_CTX *new_ctx = NULL;
     const BIGNUM **new_scalars = NULL;
     const EC_POINT **new_points = NULL;
-    unsigned int idx = 0;
-    const unsigned int window_size = 7;
-    const unsigned int mask = (1 << (window_size + 1)) - 1;
-    unsigned int wvalue;
     ALIGN32 union {
         P256_POINT p;
         P256_POINT_AFFINE a;
@@ -1329,61 +1833,7 @@ printf("%s %d: ECP_SM2Z256_AVX2 defined\n", __FILE__, __LINE__);
             } else
 #endif
             {
-                BN_ULONG infty;
-
-                /* First window */
-                wvalue = (p_str[0] << 1) & mask;
-                idx += window_size;
-
-                wvalue = _booth_recode_w7(wvalue);
-
-                ecp_sm2z256_gather_w7(&p.a, preComputedTable[0],
-                                      wvalue >> 1);
-
-                ecp_sm2z256_neg(p.p.Z, p.p.Y);
-                copy_conditional(p.p.Y, p.p.Z, wvalue & 1);
-
-                /*
-                 * Since affine infinity is encoded as (0,0) and
-                 * Jacobian ias (,,0), we need to harmonize them
-                 * by assigning "one" or zero to Z.
-                 */
-                infty = (p.p.X[0] | p.p.X[1] | p.p.X[2] | p.p.X[3] |
-                         p.p.Y[0] | p.p.Y[1] | p.p.Y[2] | p.p.Y[3]);
-                if (P256_LIMBS == 8)
-                    infty |= (p.p.X[4] | p.p.X[5] | p.p.X[6] | p.p.X[7] |
-                              p.p.Y[4] | p.p.Y[5] | p.p.Y[6] | p.p.Y[7]);
-
-                infty = 0 - is_zero(infty);
-                infty = ~infty;
-
-                p.p.Z[0] = ONE[0] & infty;
-                p.p.Z[1] = ONE[1] & infty;
-                p.p.Z[2] = ONE[2] & infty;
-                p.p.Z[3] = ONE[3] & infty;
-                if (P256_LIMBS == 8) {
-                    p.p.Z[4] = ONE[4] & infty;
-                    p.p.Z[5] = ONE[5] & infty;
-                    p.p.Z[6] = ONE[6] & infty;
-                    p.p.Z[7] = ONE[7] & infty;
-                }
-
-                for (i = 1; i < 37; i++) {
-                    unsigned int off = (idx - 1) / 8;
-                    wvalue = p_str[off] | p_str[off + 1] << 8;
-                    wvalue = (wvalue >> ((idx - 1) % 8)) & mask;
-                    idx += window_size;
-
-                    wvalue = _booth_recode_w7(wvalue);
-
-                    ecp_sm2z256_gather_w7(&t.a,
-                                          preComputedTable[i], wvalue >> 1);
-
-                    ecp_sm2z256_neg(t.p.Z, t.a.Y);
-                    copy_conditional(t.a.Y, t.p.Z, wvalue & 1);
-
-                    ecp_sm2z256_point_add_affine(&p.p, &p.p, &t.a);
-                }
+                ecp_sm2z256_mul_g(&p.p, p_str, preComputedTable);
             }
         } else {
             p_is_infinity = 1;
@@ -1473,6 +1923,21 @@ __owur static int ecp_sm2z256_get_affine(const EC_GROUP *group,
         return 0;
     }
 
+    /* e.g. after EC_POINTs_make_affine(), no inversion needed */
+    if (point->Z_is_one) {
+        if (x != NULL) {
+            ecp_sm2z256_from_mont(x_ret, point_x);
+            if (!bn_set_words(x, x_ret, P256_LIMBS))
+                return 0;
+        }
+        if (y != NULL) {
+            ecp_sm2z256_from_mont(y_ret, point_y);
+            if (!bn_set_words(y, y_ret, P256_LIMBS))
+                return 0;
+        }
+        return 1;
+    }
+
     ecp_sm2z256_mod_inverse(z_inv3, point_z);
     ecp_sm2z256_sqr_mont(z_inv2, z_inv3);
     ecp_sm2z256_mul_mont(x_aff, z_inv2, point_x);
@@ -1561,6 +2026,891 @@ static int ecp_sm2z256_window_have_precompute_mult(const EC_GROUP *group)
     return HAVEPRECOMP(group, sm2z256);
 }
 
+/* Order(G) */
+static const BN_ULONG ORD[P256_LIMBS] = {
+    TOBN(0x53bbf409, 0x39d54123), TOBN(0x7203df6b, 0x21c6052b),
+    TOBN(0xffffffff, 0xffffffff), TOBN(0xfffffffe, 0xffffffff)
+};
+
+/* RR = 2^512 mod Order(G) */
+static const BN_ULONG ORD_RR[P256_LIMBS] = {
+    TOBN(0x901192af, 0x7c114f20), TOBN(0x3464504a, 0xde6fa2fa),
+    TOBN(0x620fc84c, 0x3affe0d4), TOBN(0x1eb5e412, 0xa22b3d3b)
+};
+
+/* r = in^-1 mod Order(G), in constant time */
+static void ecp_sm2z256_ord_inverse(BN_ULONG r[P256_LIMBS],
+                                    const BN_ULONG in[P256_LIMBS])
+{
+    /*
+     * The low 128 bits of Order(G) - 2, 0x7203df6b21c6052b53bbf40939d54121,
+     * scanned with a sliding window of up to 4 bits: each pair is the number
+     * of squarings followed by the index of the odd power to multiply with.
+     */
+    static const struct {
+        unsigned char p, i;
+    } chain[] = {
+        {4, 3}, {3, 0}, {11, 7}, {5, 7}, {4, 5}, {5, 5}, {3, 0}, {7, 3},
+        {5, 1}, {9, 2}, {5, 2}, {5, 6}, {5, 4}, {4, 6}, {4, 6}, {4, 7},
+        {3, 2}, {10, 4}, {5, 3}, {5, 3}, {4, 2}, {4, 2}, {9, 4}, {5, 0}
+    };
+    /* table[i] = x^(2i+1), x2 = x^2 */
+    BN_ULONG table[8][P256_LIMBS];
+    BN_ULONG x2[P256_LIMBS], x6[P256_LIMBS];
+    BN_ULONG x7[P256_LIMBS], x14[P256_LIMBS], x15[P256_LIMBS];
+    BN_ULONG x30[P256_LIMBS], x31[P256_LIMBS], x32[P256_LIMBS];
+    BN_ULONG out[P256_LIMBS], one[P256_LIMBS] = { 1 };
+    int i;
+
+    /* x^1, x^2, x^3, ..., x^15 in the Montgomery domain */
+    ecp_sm2z256_ord_mul_mont(table[0], in, ORD_RR);
+    ecp_sm2z256_ord_sqr_mont(x2, table[0], 1);
+    for (i = 1; i < 8; i++)
+        ecp_sm2z256_ord_mul_mont(table[i], table[i - 1], x2);
+
+    /* xN = x^(2^N - 1), starting from x3 = x^7 = table[3] */
+    ecp_sm2z256_ord_sqr_mont(x6, table[3], 3);
+    ecp_sm2z256_ord_mul_mont(x6, x6, table[3]);
+    ecp_sm2z256_ord_sqr_mont(x7, x6, 1);
+    ecp_sm2z256_ord_mul_mont(x7, x7, table[0]);
+    ecp_sm2z256_ord_sqr_mont(x14, x7, 7);
+    ecp_sm2z256_ord_mul_mont(x14, x14, x7);
+    ecp_sm2z256_ord_sqr_mont(x15, x14, 1);
+    ecp_sm2z256_ord_mul_mont(x15, x15, table[0]);
+    ecp_sm2z256_ord_sqr_mont(x30, x15, 15);
+    ecp_sm2z256_ord_mul_mont(x30, x30, x15);
+    ecp_sm2z256_ord_sqr_mont(x31, x30, 1);
+    ecp_sm2z256_ord_mul_mont(x31, x31, table[0]);
+    ecp_sm2z256_ord_sqr_mont(x32, x31, 1);
+    ecp_sm2z256_ord_mul_mont(x32, x32, table[0]);
+
+    /* The high 128 bits 0xfffffffeffffffffffffffffffffffff */
+    ecp_sm2z256_ord_sqr_mont(out, x31, 33);
+    ecp_sm2z256_ord_mul_mont(out, out, x32);
+    ecp_sm2z256_ord_sqr_mont(out, out, 32);
+    ecp_sm2z256_ord_mul_mont(out, out, x32);
+    ecp_sm2z256_ord_sqr_mont(out, out, 32);
+    ecp_sm2z256_ord_mul_mont(out, out, x32);
+
+    for (i = 0; i < (int)OSSL_NELEM(chain); i++) {
+        ecp_sm2z256_ord_sqr_mont(out, out, chain[i].p);
+        ecp_sm2z256_ord_mul_mont(out, out, table[chain[i].i]);
+    }
+
+    /* out = out * 1, leaving the Montgomery domain */
+    ecp_sm2z256_ord_mul_mont(r, out, one);
+
+    OPENSSL_cleanse(table, sizeof(table));
+    OPENSSL_cleanse(out, sizeof(out));
+}
+
+/*
+ * ecp_sm2z256_inv_mod_ord sets r = x^-1 mod Order(G) in constant time, by
+ * raising x to the power Order(G) - 2 with a fixed addition chain.
+ */
+static int ecp_sm2z256_inv_mod_ord(const EC_GROUP *group, BIGNUM *r,
+                                   const BIGNUM *x, BN_CTX *ctx)
+{
+    BN_ULONG t[P256_LIMBS], out[P256_LIMBS];
+    int ret = 0, started = 0;
+    BN_CTX *new_ctx = NULL;
+
+    if (BN_num_bits(x) > 256 || BN_is_negative(x)) {
+        BIGNUM *tmp;
+
+        if (ctx == NULL && (ctx = new_ctx = BN_CTX_secure_new()) == NULL) {
+            ECerr(EC_F_ECP_SM2Z256_INV_MOD_ORD, ERR_R_MALLOC_FAILURE);
+            return 0;
+        }
+        BN_CTX_start(ctx);
+        started = 1;
+        if ((tmp = BN_CTX_get(ctx)) == NULL
+            || !BN_nnmod(tmp, x, group->order, ctx)) {
+            ECerr(EC_F_ECP_SM2Z256_INV_MOD_ORD, ERR_R_BN_LIB);
+            goto err;
+        }
+        x = tmp;
+    }
+
+    if (!ecp_sm2z256_bignum_to_field_elem(t, x)) {
+        ECerr(EC_F_ECP_SM2Z256_INV_MOD_ORD, EC_R_COORDINATES_OUT_OF_RANGE);
+        goto err;
+    }
+
+    ecp_sm2z256_ord_inverse(out, t);
+
+    if (!bn_set_words(r, out, P256_LIMBS)) {
+        ECerr(EC_F_ECP_SM2Z256_INV_MOD_ORD, ERR_R_BN_LIB);
+        goto err;
+    }
+
+    ret = 1;
+ err:
+    OPENSSL_cleanse(t, sizeof(t));
+    OPENSSL_cleanse(out, sizeof(out));
+    if (started)
+        BN_CTX_end(ctx);
+    BN_CTX_free(new_ctx);
+    return ret;
+}
+
+/*
+ * Word arithmetic modulo Order(G) for the SM2 signature scalars. Inputs
+ * are fully reduced unless stated otherwise.
+ */
+
+/* r = a + b, returns the carry */
+static BN_ULONG ecp_sm2z256_add_words(BN_ULONG r[P256_LIMBS],
+                                      const BN_ULONG a[P256_LIMBS],
+                                      const BN_ULONG b[P256_LIMBS])
+{
+    BN_ULONG t, u, carry = 0;
+    int i;
+
+    for (i = 0; i < P256_LIMBS; i++) {
+        t = a[i] + b[i];
+        u = t < a[i];
+        t += carry;
+        carry = u | (t < carry);
+        r[i] = t;
+    }
+    return carry;
+}
+
+/* r = a - b, returns the borrow */
+static BN_ULONG ecp_sm2z256_sub_words(BN_ULONG r[P256_LIMBS],
+                                      const BN_ULONG a[P256_LIMBS],
+                                      const BN_ULONG b[P256_LIMBS])
+{
+    BN_ULONG t, u, borrow = 0;
+    int i;
+
+    for (i = 0; i < P256_LIMBS; i++) {
+        t = a[i] - b[i];
+        u = a[i] < b[i];
+        r[i] = t - borrow;
+        borrow = u | (t < borrow);
+    }
+    return borrow;
+}
+
+/* r = a mod Order(G) for a < 2*Order(G), i.e. any a < 2^256 */
+static void ecp_sm2z256_ord_reduce(BN_ULONG r[P256_LIMBS],
+                                   const BN_ULONG a[P256_LIMBS],
+                                   BN_ULONG carry)
+{
+    BN_ULONG t[P256_LIMBS];
+    BN_ULONG borrow;
+
+    borrow = ecp_sm2z256_sub_words(t, a, ORD);
+    /* keep a if a < Order(G), i.e. the subtraction borrowed */
+    copy_conditional(t, a, borrow & (carry ^ 1));
+    memcpy(r, t, sizeof(t));
+}
+
+/* r = a + b mod Order(G) */
+static void ecp_sm2z256_ord_add(BN_ULONG r[P256_LIMBS],
+                                const BN_ULONG a[P256_LIMBS],
+                                const BN_ULONG b[P256_LIMBS])
+{
+    BN_ULONG t[P256_LIMBS];
+    BN_ULONG carry;
+
+    carry = ecp_sm2z256_add_words(t, a, b);
+    ecp_sm2z256_ord_reduce(r, t, carry);
+}
+
+/* r = a - b mod Order(G) */
+static void ecp_sm2z256_ord_sub(BN_ULONG r[P256_LIMBS],
+                                const BN_ULONG a[P256_LIMBS],
+                                const BN_ULONG b[P256_LIMBS])
+{
+    BN_ULONG t[P256_LIMBS], n[P256_LIMBS];
+    BN_ULONG borrow;
+    int i;
+
+    borrow = 0 - ecp_sm2z256_sub_words(t, a, b);
+    for (i = 0; i < P256_LIMBS; i++)
+        n[i] = ORD[i] & borrow;
+    ecp_sm2z256_add_words(r, t, n);
+}
+
+static BN_ULONG is_zero_words(const BN_ULONG a[P256_LIMBS])
+{
+    BN_ULONG t = a[0] | a[1] | a[2] | a[3];
+
+    if (P256_LIMBS == 8)
+        t |= a[4] | a[5] | a[6] | a[7];
+    return is_zero(t);
+}
+
+static void ecp_sm2z256_words_to_str(unsigned char p_str[33],
+                                     const BN_ULONG a[P256_LIMBS])
+{
+    int i, j;
+
+    for (i = 0; i < P256_LIMBS; i++)
+        for (j = 0; j < BN_BYTES; j++)
+            p_str[i * BN_BYTES + j] = (unsigned char)(a[i] >> (8 * j));
+    p_str[32] = 0;
+}
+
+/* x = X/Z^2 out of the Montgomery domain, returns zero at infinity */
+static int ecp_sm2z256_affine_x(BN_ULONG x[P256_LIMBS], const P256_POINT *p)
+{
+    BN_ULONG z_inv2[P256_LIMBS];
+    BN_ULONG x_aff[P256_LIMBS];
+
+    if (is_zero_words(p->Z))
+        return 0;
+
+    ecp_sm2z256_mod_inverse(z_inv2, p->Z);
+    ecp_sm2z256_sqr_mont(z_inv2, z_inv2);
+    ecp_sm2z256_mul_mont(x_aff, z_inv2, p->X);
+    ecp_sm2z256_from_mont(x, x_aff);
+    return 1;
+}
+
+/*
+ * ecp_sm2z256_group_is_sm2p256v1 returns one if |group| uses this method
+ * with the standard generator, so that the fixed size SM2 functions below
+ * compute on the same curve.
+ */
+int ecp_sm2z256_group_is_sm2p256v1(const EC_GROUP *group)
+{
+    const EC_POINT *generator = EC_GROUP_get0_generator(group);
+
+    return group->meth == EC_GFp_sm2z256_method()
+        && generator != NULL && ecp_sm2z256_is_affine_G(generator);
+}
+
+/*
+ * ecp_sm2z256_point_get_affine_words sets (x, y) to the affine coordinates
+ * of |point| out of the Montgomery domain.
+ */
+int ecp_sm2z256_point_get_affine_words(const EC_POINT *point,
+                                       BN_ULONG x[P256_LIMBS],
+                                       BN_ULONG y[P256_LIMBS])
+{
+    BN_ULONG z_inv2[P256_LIMBS];
+    BN_ULONG z_inv3[P256_LIMBS];
+    P256_POINT p;
+
+    if (!ecp_sm2z256_bignum_to_field_elem(p.X, point->X) ||
+        !ecp_sm2z256_bignum_to_field_elem(p.Y, point->Y) ||
+        !ecp_sm2z256_bignum_to_field_elem(p.Z, point->Z) ||
+        is_zero_words(p.Z))
+        return 0;
+
+    if (point->Z_is_one) {
+        ecp_sm2z256_from_mont(x, p.X);
+        ecp_sm2z256_from_mont(y, p.Y);
+        return 1;
+    }
+
+    ecp_sm2z256_mod_inverse(z_inv3, p.Z);
+    ecp_sm2z256_sqr_mont(z_inv2, z_inv3);
+    ecp_sm2z256_mul_mont(z_inv3, z_inv3, z_inv2);
+    ecp_sm2z256_mul_mont(p.X, z_inv2, p.X);
+    ecp_sm2z256_mul_mont(p.Y, z_inv3, p.Y);
+    ecp_sm2z256_from_mont(x, p.X);
+    ecp_sm2z256_from_mont(y, p.Y);
+    return 1;
+}
+
+/*
+ * dinv = (1 + d)^-1 mod Order(G), returns zero unless d is in [1, n - 2].
+ */
+int ecp_sm2z256_sm2_sign_precompute(BN_ULONG dinv[P256_LIMBS],
+                                    const BN_ULONG d[P256_LIMBS])
+{
+    BN_ULONG t[P256_LIMBS], u[P256_LIMBS];
+    BN_ULONG one[P256_LIMBS] = { 1 };
+    int ret = 0;
+
+    /* 1 + d does not carry, 1 + d < Order(G), and 1 + d > 1 */
+    if (!ecp_sm2z256_add_words(t, d, one)
+        && ecp_sm2z256_sub_words(u, t, ORD) && !is_zero_words(d)) {
+        ecp_sm2z256_ord_inverse(dinv, t);
+        ret = 1;
+    }
+
+    OPENSSL_cleanse(t, sizeof(t));
+    OPENSSL_cleanse(u, sizeof(u));
+    return ret;
+}
+
+/*
+ * ecp_sm2z256_sm2_sign computes the SM2 signature (r, s) of the digest |e|
+ * with the nonce k in [1, n - 1] and dinv = (1 + d)^-1:
+ *
+ *   (x1, y1) = k*G, r = e + x1, s = dinv * (k + r) - r  (mod n)
+ *
+ * It returns zero if k is out of range, r = 0, r + k = n or s = 0, and the
+ * caller has to retry with a fresh k.
+ */
+int ecp_sm2z256_sm2_sign(BN_ULONG r[P256_LIMBS], BN_ULONG s[P256_LIMBS],
+                         const BN_ULONG e[P256_LIMBS],
+                         const BN_ULONG k[P256_LIMBS],
+                         const BN_ULONG dinv[P256_LIMBS])
+{
+    BN_ULONG kk[1][P256_LIMBS], x[1][P256_LIMBS];
+    int ret;
+
+    memcpy(kk[0], k, sizeof(kk[0]));
+    ret = ecp_sm2z256_sm2_presign(x, (const BN_ULONG (*)[P256_LIMBS])kk, 1)
+        && ecp_sm2z256_sm2_sign_presigned(r, s, e, k, x[0], dinv);
+    OPENSSL_cleanse(kk, sizeof(kk));
+    return ret;
+}
+
+#define SM2Z256_PRESIGN_BATCH  16
+
+/*
+ * ecp_sm2z256_sm2_presign sets x[i] to the x-coordinate of k[i]*G mod n,
+ * the part of a signature that does not depend on the message. The points
+ * of each SM2Z256_PRESIGN_BATCH go to affine coordinates with a single
+ * inversion. Returns zero if any k[i] is not in [1, n - 1].
+ */
+int ecp_sm2z256_sm2_presign(BN_ULONG (*x)[P256_LIMBS],
+                            const BN_ULONG (*k)[P256_LIMBS], size_t num)
+{
+    ALIGN32 P256_POINT p[SM2Z256_PRESIGN_BATCH];
+    BN_ULONG prod[SM2Z256_PRESIGN_BATCH][P256_LIMBS];
+    BN_ULONG inv[P256_LIMBS], u[P256_LIMBS], t[P256_LIMBS];
+    unsigned char p_str[33];
+    size_t i, j, n;
+    int ret = 0;
+
+    for (i = 0; i < num; i++) {
+        if (is_zero_words(k[i]) || !ecp_sm2z256_sub_words(t, k[i], ORD))
+            goto err;
+    }
+
+    for (i = 0; i < num; i += n) {
+        n = num - i < SM2Z256_PRESIGN_BATCH ? num - i : SM2Z256_PRESIGN_BATCH;
+
+        for (j = 0; j < n; j++) {
+            ecp_sm2z256_words_to_str(p_str, k[i + j]);
+            ecp_sm2z256_mul_g(&p[j], p_str, ecp_sm2z256_precomputed);
+            /* k < n, so k*G is not at infinity */
+            if (j == 0)
+                memcpy(prod[0], p[0].Z, sizeof(prod[0]));
+            else
+                ecp_sm2z256_mul_mont(prod[j], prod[j - 1], p[j].Z);
+        }
+
+        ecp_sm2z256_mod_inverse(inv, prod[n - 1]);
+        for (j = n; j-- > 0;) {
+            if (j > 0) {
+                ecp_sm2z256_mul_mont(u, inv, prod[j - 1]);
+                ecp_sm2z256_mul_mont(inv, inv, p[j].Z);
+            } else {
+                memcpy(u, inv, sizeof(u));
+            }
+            ecp_sm2z256_sqr_mont(u, u);
+            ecp_sm2z256_mul_mont(t, p[j].X, u);
+            ecp_sm2z256_from_mont(x[i + j], t);
+            ecp_sm2z256_ord_reduce(x[i + j], x[i + j], 0);
+        }
+    }
+
+    ret = 1;
+ err:
+    OPENSSL_cleanse(p_str, sizeof(p_str));
+    OPENSSL_cleanse(p, sizeof(p));
+    OPENSSL_cleanse(prod, sizeof(prod));
+    OPENSSL_cleanse(inv, sizeof(inv));
+    OPENSSL_cleanse(u, sizeof(u));
+    OPENSSL_cleanse(t, sizeof(t));
+    return ret;
+}
+
+/*
+ * ecp_sm2z256_sm2_sign_presigned finishes the signature of |e| for a nonce
+ * k with x = (k*G).x mod n from ecp_sm2z256_sm2_presign:
+ *
+ *   r = e + x, s = dinv * (k + r) - r  (mod n)
+ *
+ * It returns zero if r = 0, r + k = n or s = 0.
+ */
+int ecp_sm2z256_sm2_sign_presigned(BN_ULONG r[P256_LIMBS],
+                                   BN_ULONG s[P256_LIMBS],
+                                   const BN_ULONG e[P256_LIMBS],
+                                   const BN_ULONG k[P256_LIMBS],
+                                   const BN_ULONG x[P256_LIMBS],
+                                   const BN_ULONG dinv[P256_LIMBS])
+{
+    BN_ULONG t[P256_LIMBS];
+    int ret = 0;
+
+    ecp_sm2z256_ord_reduce(t, e, 0);
+    ecp_sm2z256_ord_add(r, t, x);
+    ecp_sm2z256_ord_add(t, r, k);
+    if (is_zero_words(r) || is_zero_words(t))
+        goto err;
+
+    ecp_sm2z256_ord_mul_mont(t, t, dinv);
+    ecp_sm2z256_ord_mul_mont(t, t, ORD_RR);
+    ecp_sm2z256_ord_sub(s, t, r);
+    if (is_zero_words(s))
+        goto err;
+
+    ret = 1;
+ err:
+    OPENSSL_cleanse(t, sizeof(t));
+    return ret;
+}
+
+/*
+ * ecp_sm2z256_set_public_key sets |p| to the public key (x, y) in the
+ * Montgomery domain, returns zero unless it is a point on the curve.
+ */
+static int ecp_sm2z256_set_public_key(P256_POINT *p,
+                                      const BN_ULONG x[P256_LIMBS],
+                                      const BN_ULONG y[P256_LIMBS])
+{
+    /* The curve coefficient b in the Montgomery domain */
+    static const BN_ULONG B[P256_LIMBS] = {
+        TOBN(0x90d23063, 0x2bc0dd42), TOBN(0x71cf379a, 0xe9b537ab),
+        TOBN(0x52798150, 0x5ea51c3c), TOBN(0x240fe188, 0xba20e2c8)
+    };
+    /* p = 2^256 - 2^224 - 2^96 + 2^64 - 1 */
+    static const BN_ULONG P[P256_LIMBS] = {
+        TOBN(0xffffffff, 0xffffffff), TOBN(0xffffffff, 0x00000000),
+        TOBN(0xffffffff, 0xffffffff), TOBN(0xfffffffe, 0xffffffff)
+    };
+    BN_ULONG u[P256_LIMBS], v[P256_LIMBS];
+
+    /* y^2 = x^3 - 3x + b */
+    if (!ecp_sm2z256_sub_words(u, x, P) || !ecp_sm2z256_sub_words(u, y, P))
+        return 0;
+    ecp_sm2z256_to_mont(p->X, x);
+    ecp_sm2z256_to_mont(p->Y, y);
+    memcpy(p->Z, ONE, sizeof(ONE));
+    ecp_sm2z256_sqr_mont(u, p->X);
+    ecp_sm2z256_mul_mont(u, u, p->X);
+    ecp_sm2z256_mul_by_3(v, p->X);
+    ecp_sm2z256_sub(u, u, v);
+    ecp_sm2z256_add(u, u, B);
+    ecp_sm2z256_sqr_mont(v, p->Y);
+    return is_equal(u, v) & 1;
+}
+
+/*
+ * ecp_sm2z256_batch_to_affine sets out[i] to the affine form of in[i] with
+ * a single inversion, none of the points may be at infinity. |prod| is
+ * scratch space for |num| elements.
+ */
+static void ecp_sm2z256_batch_to_affine(P256_POINT_AFFINE *out,
+                                        const P256_POINT *in, size_t num,
+                                        BN_ULONG (*prod)[P256_LIMBS])
+{
+    BN_ULONG inv[P256_LIMBS], u[P256_LIMBS], z[P256_LIMBS];
+    size_t i;
+
+    memcpy(prod[0], in[0].Z, sizeof(prod[0]));
+    for (i = 1; i < num; i++)
+        ecp_sm2z256_mul_mont(prod[i], prod[i - 1], in[i].Z);
+
+    ecp_sm2z256_mod_inverse(inv, prod[num - 1]);
+    for (i = num; i-- > 0;) {
+        if (i > 0) {
+            ecp_sm2z256_mul_mont(u, inv, prod[i - 1]);
+            ecp_sm2z256_mul_mont(inv, inv, in[i].Z);
+        } else {
+            memcpy(u, inv, sizeof(u));
+        }
+        ecp_sm2z256_sqr_mont(z, u);
+        ecp_sm2z256_mul_mont(out[i].X, in[i].X, z);
+        ecp_sm2z256_mul_mont(z, z, u);
+        ecp_sm2z256_mul_mont(out[i].Y, in[i].Y, z);
+    }
+}
+
+/*
+ * ecp_sm2z256_precompute_w7 fills |table| with the same layout as
+ * ecp_sm2z256_precomputed for the affine point |p|, row j holds 1 .. 64
+ * times 2^(7*j)*P so that ecp_sm2z256_mul_g can multiply P. Returns zero
+ * if memory can not be allocated.
+ */
+static int ecp_sm2z256_precompute_w7(PRECOMP256_ROW *table,
+                                     const P256_POINT *p)
+{
+    void *storage;
+    P256_POINT *pts;
+    P256_POINT_AFFINE *aff;
+    BN_ULONG (*prod)[P256_LIMBS];
+    ALIGN32 P256_POINT base[37];
+    ALIGN32 P256_POINT_AFFINE base_aff[37];
+    int i, j, k;
+
+    if ((storage = OPENSSL_malloc(37 * 64 * (sizeof(P256_POINT)
+                                             + sizeof(P256_POINT_AFFINE)
+                                             + sizeof(prod[0])) + 64))
+        == NULL)
+        return 0;
+    pts = (void *)ALIGNPTR(storage, 64);
+    aff = (P256_POINT_AFFINE *)(pts + 37 * 64);
+    prod = (void *)(aff + 37 * 64);
+
+    /* base[j] = 2^(7*j)*P, made affine to use the cheaper mixed additions */
+    memcpy(&base[0], p, sizeof(base[0]));
+    for (j = 1; j < 37; j++) {
+        ecp_sm2z256_point_double(&base[j], &base[j - 1]);
+        for (i = 1; i < 7; i++)
+            ecp_sm2z256_point_double(&base[j], &base[j]);
+    }
+    ecp_sm2z256_batch_to_affine(base_aff, base, 37, prod);
+
+    /* n is a prime above 64, so none of the multiples is at infinity */
+    for (j = 0; j < 37; j++) {
+        P256_POINT *row = pts + j * 64;
+
+        memcpy(row[0].X, base_aff[j].X, sizeof(row[0].X));
+        memcpy(row[0].Y, base_aff[j].Y, sizeof(row[0].Y));
+        memcpy(row[0].Z, ONE, sizeof(row[0].Z));
+        ecp_sm2z256_point_double(&row[1], &row[0]);
+        for (k = 2; k < 64; k++)
+            ecp_sm2z256_point_add_affine(&row[k], &row[k - 1], &base_aff[j]);
+    }
+    ecp_sm2z256_batch_to_affine(aff, pts, 37 * 64, prod);
+
+    for (j = 0; j < 37; j++)
+        for (k = 0; k < 64; k++)
+            ecp_sm2z256_scatter_w7(table[j], &aff[j * 64 + k], k);
+
+    OPENSSL_free(storage);
+    return 1;
+}
+
+/*
+ * ecp_sm2z256_sm2_verify_mul sets q = s*G + (r + s)*P where |table| holds
+ * the multiples of P, or |comb| if it is not NULL, returns zero if r or s is
+ * out of range or r + s = 0.
+ */
+static int ecp_sm2z256_sm2_verify_mul(P256_POINT *q,
+                                      const BN_ULONG r[P256_LIMBS],
+                                      const BN_ULONG s[P256_LIMBS],
+                                      P256_POINT (*table)[16],
+                                      const PRECOMP256_ROW *comb,
+                                      P256_POINT temp[2])
+{
+    unsigned char p_str[1][33];
+    BN_ULONG t[P256_LIMBS];
+
+    /* r, s in [1, n - 1] and t = r + s != 0 */
+    if (is_zero_words(r) || !ecp_sm2z256_sub_words(t, r, ORD) ||
+        is_zero_words(s) || !ecp_sm2z256_sub_words(t, s, ORD))
+        return 0;
+    ecp_sm2z256_ord_add(t, r, s);
+    if (is_zero_words(t))
+        return 0;
+
+    ecp_sm2z256_words_to_str(p_str[0], t);
+    if (comb != NULL)
+        ecp_sm2z256_mul_g(q, p_str[0], comb);
+    else
+        ecp_sm2z256_windowed_mul_rows(q, p_str, table, temp, 1);
+    ecp_sm2z256_words_to_str(p_str[0], s);
+    ecp_sm2z256_mul_g(&temp[0], p_str[0], ecp_sm2z256_precomputed);
+    ecp_sm2z256_point_add(q, q, &temp[0]);
+    return 1;
+}
+
+/* returns one if r = e + x (mod n), x is out of the Montgomery domain */
+static int ecp_sm2z256_sm2_verify_x(const BN_ULONG r[P256_LIMBS],
+                                    const BN_ULONG e[P256_LIMBS],
+                                    const BN_ULONG x[P256_LIMBS])
+{
+    BN_ULONG u[P256_LIMBS], v[P256_LIMBS];
+
+    ecp_sm2z256_ord_reduce(u, x, 0);
+    ecp_sm2z256_ord_reduce(v, e, 0);
+    ecp_sm2z256_ord_add(u, u, v);
+    return is_equal(u, r) & 1;
+}
+
+/*
+ * ecp_sm2z256_sm2_verify checks the SM2 signature (r, s) of the digest |e|
+ * under the public key (x, y), returns one if it is valid.
+ */
+int ecp_sm2z256_sm2_verify(const BN_ULONG r[P256_LIMBS],
+                           const BN_ULONG s[P256_LIMBS],
+                           const BN_ULONG e[P256_LIMBS],
+                           const BN_ULONG x[P256_LIMBS],
+                           const BN_ULONG y[P256_LIMBS])
+{
+    unsigned char storage[16 * sizeof(P256_POINT) + 64];
+    P256_POINT (*table)[16] = (void *)ALIGNPTR(storage, 64);
+    ALIGN32 P256_POINT temp[5];
+    ALIGN32 P256_POINT q;
+    BN_ULONG u[P256_LIMBS];
+
+    if (!ecp_sm2z256_set_public_key(&temp[0], x, y))
+        return 0;
+
+    /* (x1, y1) = s*G + t*P */
+    ecp_sm2z256_precompute_w5(table[0], temp);
+    if (!ecp_sm2z256_sm2_verify_mul(&q, r, s, table, NULL, temp)
+        || !ecp_sm2z256_affine_x(u, &q))
+        return 0;
+
+    /* r == e + x1 (mod n) */
+    return ecp_sm2z256_sm2_verify_x(r, e, u);
+}
+
+/*
+ * The comb table of a public key that is verified against many times, see
+ * ecp_sm2z256_precompute_w7. It is reference counted so that a cache can
+ * drop it while a verification still uses it.
+ */
+struct sm2z256_verify_table_st {
+    BN_ULONG x[P256_LIMBS];
+    BN_ULONG y[P256_LIMBS];
+    PRECOMP256_ROW *rows;
+    void *storage;
+    int references;
+    CRYPTO_RWLOCK *lock;
+};
+
+/*
+ * ecp_sm2z256_verify_table_new builds the table of the public key (x, y),
+ * returns NULL if it is not on the curve or on allocation failure.
+ */
+SM2Z256_VERIFY_TABLE *ecp_sm2z256_verify_table_new(const BN_ULONG x[P256_LIMBS],
+                                                   const BN_ULONG y[P256_LIMBS])
+{
+    SM2Z256_VERIFY_TABLE *ret;
+    ALIGN32 P256_POINT p;
+
+    if (!ecp_sm2z256_set_public_key(&p, x, y)) {
+        ECerr(EC_F_ECP_SM2Z256_VERIFY_TABLE_NEW, EC_R_POINT_IS_NOT_ON_CURVE);
+        return NULL;
+    }
+
+    if ((ret = OPENSSL_zalloc(sizeof(*ret))) == NULL
+        || (ret->lock = CRYPTO_THREAD_lock_new()) == NULL
+        || (ret->storage = OPENSSL_malloc(37 * sizeof(PRECOMP256_ROW)
+                                          + 64)) == NULL)
+        goto err;
+    ret->rows = (void *)ALIGNPTR(ret->storage, 64);
+    if (!ecp_sm2z256_precompute_w7(ret->rows, &p))
+        goto err;
+
+    memcpy(ret->x, x, sizeof(ret->x));
+    memcpy(ret->y, y, sizeof(ret->y));
+    ret->references = 1;
+    return ret;
+
+ err:
+    ECerr(EC_F_ECP_SM2Z256_VERIFY_TABLE_NEW, ERR_R_MALLOC_FAILURE);
+    if (ret != NULL) {
+        OPENSSL_free(ret->storage);
+        CRYPTO_THREAD_lock_free(ret->lock);
+        OPENSSL_free(ret);
+    }
+    return NULL;
+}
+
+int ecp_sm2z256_verify_table_up_ref(SM2Z256_VERIFY_TABLE *table)
+{
+    int i;
+
+    if (CRYPTO_atomic_add(&table->references, 1, &i, table->lock) <= 0)
+        return 0;
+
+    REF_PRINT_COUNT("SM2Z256_VERIFY_TABLE", table);
+    REF_ASSERT_ISNT(i < 2);
+    return i > 1 ? 1 : 0;
+}
+
+void ecp_sm2z256_verify_table_free(SM2Z256_VERIFY_TABLE *table)
+{
+    int i;
+
+    if (table == NULL)
+        return;
+
+    CRYPTO_atomic_add(&table->references, -1, &i, table->lock);
+    REF_PRINT_COUNT("SM2Z256_VERIFY_TABLE", table);
+    if (i > 0)
+        return;
+    REF_ASSERT_ISNT(i < 0);
+
+    OPENSSL_free(table->storage);
+    CRYPTO_THREAD_lock_free(table->lock);
+    OPENSSL_free(table);
+}
+
+/* returns one if |table| was built for the public key (x, y) */
+int ecp_sm2z256_verify_table_is_for(const SM2Z256_VERIFY_TABLE *table,
+                                    const BN_ULONG x[P256_LIMBS],
+                                    const BN_ULONG y[P256_LIMBS])
+{
+    return memcmp(table->x, x, sizeof(table->x)) == 0
+        && memcmp(table->y, y, sizeof(table->y)) == 0;
+}
+
+/*
+ * ecp_sm2z256_sm2_verify_table is ecp_sm2z256_sm2_verify with the public
+ * key given by its table.
+ */
+int ecp_sm2z256_sm2_verify_table(const BN_ULONG r[P256_LIMBS],
+                                 const BN_ULONG s[P256_LIMBS],
+                                 const BN_ULONG e[P256_LIMBS],
+                                 const SM2Z256_VERIFY_TABLE *table)
+{
+    ALIGN32 P256_POINT temp[2];
+    ALIGN32 P256_POINT q;
+    BN_ULONG u[P256_LIMBS];
+
+    if (!ecp_sm2z256_sm2_verify_mul(&q, r, s, NULL, table->rows, temp)
+        || !ecp_sm2z256_affine_x(u, &q))
+        return 0;
+
+    return ecp_sm2z256_sm2_verify_x(r, e, u);
+}
+
+/*
+ * A key with at least this many signatures in a batch gets the full comb
+ * table of ecp_sm2z256_precompute_w7, which costs about a dozen verifications
+ * but makes (r + s)*P as cheap as the fixed-base s*G.
+ */
+#define SM2Z256_VERIFY_W7_MIN 32
+
+/*
+ * ecp_sm2z256_sm2_verify_batch checks |num| SM2 signatures at once. The
+ * distinct public keys are (x[j], y[j]) and signature i is under the key
+ * key[i]. The signatures are grouped by key so that each key has its table
+ * of multiples built only once, or taken from tables[j] if it is not NULL,
+ * and all sums s*G + t*P are brought to affine coordinates with a single
+ * inversion. |tables| itself may be NULL. ok[i] is set to one for the
+ * valid signatures and zero for the others, returns zero if memory can not
+ * be allocated.
+ */
+int ecp_sm2z256_sm2_verify_batch(int *ok, size_t num,
+                                 const BN_ULONG (*r)[4],
+                                 const BN_ULONG (*s)[4],
+                                 const BN_ULONG (*e)[4],
+                                 const size_t *key, size_t num_keys,
+                                 const BN_ULONG (*x)[4],
+                                 const BN_ULONG (*y)[4],
+                                 SM2Z256_VERIFY_TABLE *const *tables)
+{
+    void *storage, *comb_storage = NULL;
+    P256_POINT (*table)[16];
+    PRECOMP256_ROW *comb = NULL;
+    P256_POINT *q;
+    BN_ULONG (*prod)[P256_LIMBS];
+    size_t *start, *order;
+    ALIGN32 P256_POINT temp[5];
+    BN_ULONG inv[P256_LIMBS], u[P256_LIMBS];
+    size_t i, j, n;
+    int use_comb = 0;
+
+    if (num == 0)
+        return 1;
+
+    if ((storage = OPENSSL_malloc(16 * sizeof(P256_POINT)
+                                  + num * sizeof(P256_POINT)
+                                  + num * sizeof(prod[0])
+                                  + (num_keys + 1 + num) * sizeof(size_t)
+                                  + 64)) == NULL) {
+        ECerr(EC_F_ECP_SM2Z256_SM2_VERIFY_BATCH, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    table = (void *)ALIGNPTR(storage, 64);
+    q = (P256_POINT *)(table + 1);
+    prod = (void *)(q + num);
+    start = (size_t *)(prod + num);
+    order = start + num_keys + 1;
+
+    /* order lists the signatures of key j at start[j] .. start[j + 1] */
+    memset(start, 0, (num_keys + 1) * sizeof(size_t));
+    for (i = 0; i < num; i++) {
+        ok[i] = 0;
+        start[key[i] + 1]++;
+    }
+    for (j = 0; j < num_keys; j++) {
+        if (start[j + 1] >= SM2Z256_VERIFY_W7_MIN
+            && (tables == NULL || tables[j] == NULL))
+            use_comb = 1;
+        start[j + 1] += start[j];
+    }
+    for (i = 0; i < num; i++)
+        order[start[key[i]]++] = i;
+    for (j = num_keys; j > 0; j--)
+        start[j] = start[j - 1];
+    start[0] = 0;
+
+    /* the comb table is only an optimisation, go on without it */
+    if (use_comb && (comb_storage = OPENSSL_malloc(37 * sizeof(PRECOMP256_ROW)
+                                            + 64)) != NULL)
+        comb = (void *)ALIGNPTR(comb_storage, 64);
+
+    /* q[i] = s*G + t*P */
+    for (j = 0; j < num_keys; j++) {
+        const PRECOMP256_ROW *rows = NULL;
+
+        if (start[j] == start[j + 1])
+            continue;
+
+        if (tables != NULL && tables[j] != NULL)
+            rows = tables[j]->rows;
+        else if (!ecp_sm2z256_set_public_key(&temp[0], x[j], y[j]))
+            continue;
+        else if (comb != NULL && start[j + 1] - start[j] >= SM2Z256_VERIFY_W7_MIN
+            && ecp_sm2z256_precompute_w7(comb, &temp[0]))
+            rows = comb;
+        else
+            ecp_sm2z256_precompute_w5(table[0], temp);
+
+        for (n = start[j]; n < start[j + 1]; n++) {
+            i = order[n];
+            if (ecp_sm2z256_sm2_verify_mul(&q[i], r[i], s[i], table, rows,
+                                           temp))
+                ok[i] = !is_zero_words(q[i].Z);
+        }
+    }
+
+    /*
+     * prod[i] is the product of the Z coordinates of q[0] .. q[i], the
+     * invalid ones and the points at infinity count as one.
+     */
+    for (i = 0; i < num; i++) {
+        if (!ok[i])
+            memcpy(q[i].Z, ONE, sizeof(ONE));
+        if (i == 0)
+            memcpy(prod[0], q[0].Z, sizeof(prod[0]));
+        else
+            ecp_sm2z256_mul_mont(prod[i], prod[i - 1], q[i].Z);
+    }
+
+    /* inv = (Z[0] * .. * Z[i])^-1 on the way back */
+    ecp_sm2z256_mod_inverse(inv, prod[num - 1]);
+    for (i = num; i-- > 0;) {
+        if (i > 0) {
+            ecp_sm2z256_mul_mont(u, inv, prod[i - 1]);
+            ecp_sm2z256_mul_mont(inv, inv, q[i].Z);
+        } else {
+            memcpy(u, inv, sizeof(u));
+        }
+        if (!ok[i])
+            continue;
+
+        /* x1 = X/Z^2 */
+        ecp_sm2z256_sqr_mont(u, u);
+        ecp_sm2z256_mul_mont(u, u, q[i].X);
+        ecp_sm2z256_from_mont(u, u);
+        ok[i] = ecp_sm2z256_sm2_verify_x(r[i], e[i], u);
+    }
+
+    OPENSSL_free(comb_storage);
+    OPENSSL_free(storage);
+    return 1;
+}
+
 const EC_METHOD *EC_GFp_sm2z256_method(void)
 {
     static const EC_METHOD ret = {
@@ -1610,8 +2960,10 @@ const EC_METHOD *EC_GFp_sm2z256_method(void)
         ec_key_simple_generate_public_key,
         0, /* keycopy */
         0, /* keyfinish */
-        ecdh_simple_compute_key
+        ecdh_simple_compute_key,
+        ecp_sm2z256_inv_mod_ord                    /* field_inverse_mod_ord */
     };
 
     return &ret;
 }
+#endif
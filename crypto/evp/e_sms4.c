@@ -68,14 +68,6 @@
 # include <openssl/sms4.h>
 # include "sms4_lcl.h"
 
-# ifdef SMS4_AVX2
-void sms4_avx2_ecb_encrypt_blocks(const unsigned char *in,
-	unsigned char *out, size_t blocks, const sms4_key_t *key);
-void sms4_avx2_ctr32_encrypt_blocks(const unsigned char *in,
-	unsigned char *out, size_t blocks, const sms4_key_t *key,
-	const unsigned char iv[16]);
-# endif
-
 typedef struct {
 	block128_f block;
 	union {
@@ -104,11 +96,7 @@ static int sms4_init_key(EVP_CIPHER_CTX *ctx, const unsigned char *key,
 	dat->block = (block128_f)sms4_encrypt;
 
 	if (mode == EVP_CIPH_CTR_MODE) {
-# ifdef SMS4_AVX2
-		dat->stream.ctr = (ctr128_f) sms4_avx2_ctr32_encrypt_blocks;
-# else
-		dat->stream.ctr = (ctr128_f) sms4_ctr32_encrypt_blocks;
-# endif
+		dat->stream.ctr = (ctr128_f) sms4_bulk_ctr32_encrypt_blocks;
 	}
 
 	return 1;
@@ -125,7 +113,71 @@ static int sms4_ctrl(EVP_CIPHER_CTX *c, int type, int arg, void *ptr)
 	}
 }
 
-IMPLEMENT_BLOCK_CIPHER(sms4, ks.ks, sms4, EVP_SMS4_KEY, NID_sms4,
+/* ECB, CBC decryption and CFB decryption go to sms4_blocks_func() */
+static int sms4_ecb_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
+	const unsigned char *in, size_t len)
+{
+	EVP_SMS4_KEY *dat = EVP_C_DATA(EVP_SMS4_KEY, ctx);
+	size_t blocks = len / SMS4_BLOCK_SIZE;
+
+	if (blocks)
+		sms4_blocks_func(blocks)(in, out, blocks, &dat->ks.ks);
+	return 1;
+}
+
+static int sms4_cbc_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
+	const unsigned char *in, size_t len)
+{
+	EVP_SMS4_KEY *dat = EVP_C_DATA(EVP_SMS4_KEY, ctx);
+
+	if (EVP_CIPHER_CTX_encrypting(ctx))
+		CRYPTO_cbc128_encrypt(in, out, len, &dat->ks.ks,
+			EVP_CIPHER_CTX_iv_noconst(ctx), dat->block);
+	else
+		sms4_bulk_cbc_decrypt(in, out, len, &dat->ks.ks,
+			EVP_CIPHER_CTX_iv_noconst(ctx));
+	return 1;
+}
+
+static int sms4_cfb128_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
+	const unsigned char *in, size_t len)
+{
+	EVP_SMS4_KEY *dat = EVP_C_DATA(EVP_SMS4_KEY, ctx);
+	int num = EVP_CIPHER_CTX_num(ctx);
+	size_t n;
+
+	if (!EVP_CIPHER_CTX_encrypting(ctx)) {
+		/* finish the current block, then whole blocks in parallel */
+		if (num) {
+			n = (size_t)(SMS4_BLOCK_SIZE - num);
+			n = n < len ? n : len;
+			CRYPTO_cfb128_encrypt(in, out, n, &dat->ks.ks,
+				EVP_CIPHER_CTX_iv_noconst(ctx), &num, 0,
+				dat->block);
+			in += n;
+			out += n;
+			len -= n;
+		}
+		if (num == 0 && len >= SMS4_BLOCK_SIZE) {
+			n = len - len % SMS4_BLOCK_SIZE;
+			sms4_cfb128_decrypt_with(in, out, n, &dat->ks.ks,
+				EVP_CIPHER_CTX_iv_noconst(ctx),
+				sms4_blocks_func(n / SMS4_BLOCK_SIZE));
+			in += n;
+			out += n;
+			len -= n;
+		}
+	}
+
+	CRYPTO_cfb128_encrypt(in, out, len, &dat->ks.ks,
+		EVP_CIPHER_CTX_iv_noconst(ctx), &num,
+		EVP_CIPHER_CTX_encrypting(ctx), dat->block);
+	EVP_CIPHER_CTX_set_num(ctx, num);
+	return 1;
+}
+
+BLOCK_CIPHER_func_ofb(sms4, sms4, 128, EVP_SMS4_KEY, ks.ks)
+BLOCK_CIPHER_defs(sms4, EVP_SMS4_KEY, NID_sms4,
 	SMS4_BLOCK_SIZE, SMS4_KEY_LENGTH, SMS4_IV_LENGTH, 128,
 	EVP_CIPH_FLAG_DEFAULT_ASN1, sms4_init_key, NULL, NULL, NULL, sms4_ctrl)
 
@@ -68,6 +68,7 @@
 #ifndef OPENSSL_NO_SMS4
 
 # include <openssl/sms4.h>
+# include "sms4_lcl.h"
 
 typedef struct {
     union {
@@ -83,8 +84,12 @@ typedef struct {
     int iv_gen;                 /* It is OK to generate IVs */
     int tls_aad_len;            /* TLS AAD length */
     ctr128_f ctr;
+    int stitched;               /* Set if sms4_aesni_gcm_* can be used */
+    unsigned char htable[SMS4_GCM_HTABLE_SIZE];
 } EVP_SMS4_GCM_CTX;
 
+# define SMS4_GCM_ASM(gctx)      ((gctx)->stitched)
+
 
 static int sms4_gcm_cleanup(EVP_CIPHER_CTX *c)
 {
@@ -258,7 +263,10 @@ static int sms4_gcm_init_key(EVP_CIPHER_CTX *ctx, const unsigned char *key,
             sms4_set_encrypt_key(&gctx->ks.ks, key);
             CRYPTO_gcm128_init(&gctx->gcm, &gctx->ks,
                                (block128_f)sms4_encrypt);
-            gctx->ctr = NULL;
+            gctx->ctr = (ctr128_f)sms4_bulk_ctr32_encrypt_blocks;
+            gctx->stitched = sms4_aesni_gcm_capable();
+            if (gctx->stitched)
+                sms4_aesni_gcm_init(gctx->htable, &gctx->ks.ks);
         } while (0);
 
         /*
@@ -319,6 +327,16 @@ static int sms4_gcm_tls_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
         /* Encrypt payload */
         if (gctx->ctr) {
             size_t bulk = 0;
+            if (len >= 32 && SMS4_GCM_ASM(gctx)) {
+                if (CRYPTO_gcm128_encrypt(&gctx->gcm, NULL, NULL, 0))
+                    return -1;
+
+                bulk = sms4_aesni_gcm_encrypt(in, out, len,
+                                              gctx->gcm.key,
+                                              gctx->gcm.Yi.c, gctx->gcm.Xi.c,
+                                              gctx->htable);
+                gctx->gcm.len.u[1] += bulk;
+            }
             if (CRYPTO_gcm128_encrypt_ctr32(&gctx->gcm,
                                             in + bulk,
                                             out + bulk,
@@ -338,6 +356,16 @@ static int sms4_gcm_tls_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
         /* Decrypt */
         if (gctx->ctr) {
             size_t bulk = 0;
+            if (len >= 16 && SMS4_GCM_ASM(gctx)) {
+                if (CRYPTO_gcm128_decrypt(&gctx->gcm, NULL, NULL, 0))
+                    return -1;
+
+                bulk = sms4_aesni_gcm_decrypt(in, out, len,
+                                              gctx->gcm.key,
+                                              gctx->gcm.Yi.c, gctx->gcm.Xi.c,
+                                              gctx->htable);
+                gctx->gcm.len.u[1] += bulk;
+            }
             if (CRYPTO_gcm128_decrypt_ctr32(&gctx->gcm,
                                             in + bulk,
                                             out + bulk,
@@ -387,6 +415,19 @@ static int sms4_gcm_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
         } else if (EVP_CIPHER_CTX_encrypting(ctx)) {
             if (gctx->ctr) {
                 size_t bulk = 0;
+                if (len >= 32 && SMS4_GCM_ASM(gctx)) {
+                    size_t res = (16 - gctx->gcm.mres) % 16;
+
+                    if (CRYPTO_gcm128_encrypt(&gctx->gcm, in, out, res))
+                        return -1;
+
+                    bulk = sms4_aesni_gcm_encrypt(in + res,
+                                             out + res, len - res,
+                                             gctx->gcm.key, gctx->gcm.Yi.c,
+                                             gctx->gcm.Xi.c, gctx->htable);
+                    gctx->gcm.len.u[1] += bulk;
+                    bulk += res;
+                }
                 if (CRYPTO_gcm128_encrypt_ctr32(&gctx->gcm,
                                                 in + bulk,
                                                 out + bulk,
@@ -401,6 +442,19 @@ static int sms4_gcm_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
         } else {
             if (gctx->ctr) {
                 size_t bulk = 0;
+                if (len >= 16 && SMS4_GCM_ASM(gctx)) {
+                    size_t res = (16 - gctx->gcm.mres) % 16;
+
+                    if (CRYPTO_gcm128_decrypt(&gctx->gcm, in, out, res))
+                        return -1;
+
+                    bulk = sms4_aesni_gcm_decrypt(in + res,
+                                             out + res, len - res,
+                                             gctx->gcm.key, gctx->gcm.Yi.c,
+                                             gctx->gcm.Xi.c, gctx->htable);
+                    gctx->gcm.len.u[1] += bulk;
+                    bulk += res;
+                }
                 if (CRYPTO_gcm128_decrypt_ctr32(&gctx->gcm,
                                                 in + bulk,
                                                 out + bulk,
@@ -66,6 +66,7 @@
 
 #ifndef OPENSSL_NO_SMS4
 # include <openssl/sms4.h>
+# include "sms4_lcl.h"
 
 typedef struct {
     union {
@@ -112,11 +113,12 @@ static int sms4_xts_init_key(EVP_CIPHER_CTX *ctx, const unsigned char *key,
         return 1;
 
     if (key) {
-        xctx->stream = NULL;
         if (enc) {
             sms4_set_encrypt_key(&xctx->ks1.ks, key);
+            xctx->stream = sms4_bulk_xts_encrypt;
         } else {
             sms4_set_decrypt_key(&xctx->ks1.ks, key);
+            xctx->stream = sms4_bulk_xts_decrypt;
         }
         sms4_set_encrypt_key(&xctx->ks2.ks, key + SMS4_KEY_LENGTH);
         xctx->xts.block1 = (block128_f)sms4_encrypt;
@@ -140,6 +142,7 @@ static int sms4_xts_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
         return 0;
     if (!out || !in || len < SMS4_BLOCK_SIZE)
         return 0;
+    /* AES-NI/GFNI or bitsliced, see sms4_blocks_func() */
     if (xctx->stream)
         (*xctx->stream) (in, out, len,
                          xctx->xts.key1, xctx->xts.key2,
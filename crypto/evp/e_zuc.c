@@ -48,6 +48,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <openssl/evp.h>
 #include <openssl/crypto.h>
 #include <openssl/objects.h>
@@ -57,6 +58,7 @@
 #ifndef OPENSSL_NO_ZUC
 
 # include <openssl/zuc.h>
+# include "zuc_lcl.h"
 
 typedef struct {
 	ZUC_KEY ks;
@@ -71,21 +73,37 @@ static int zuc_init_key(EVP_CIPHER_CTX *ctx, const unsigned char *key,
 	return 1;
 }
 
+/*
+ * buf holds the last keyword in host byte order and num counts its bytes
+ * already used, so updates of any length stay on the word-wise path.
+ */
 static int zuc_do_cipher(EVP_CIPHER_CTX *ctx, unsigned char *out,
 	const unsigned char *in, size_t len)
 {
 	EVP_ZUC_KEY *dctx = EVP_C_DATA(EVP_ZUC_KEY, ctx);
 	unsigned char *buf = EVP_CIPHER_CTX_buf_noconst(ctx);
 	unsigned int n = EVP_CIPHER_CTX_num(ctx);
-	size_t l = 0;
+	size_t nwords;
+	uint32_t word;
+
+	while (n && len) {
+		*out++ = *in++ ^ buf[n];
+		--len;
+		n = (n + 1) % 4;
+	}
+
+	nwords = len / 4;
+	zuc_generate_keystream_xor(&dctx->ks, nwords, in, out);
+	in += nwords * 4;
+	out += nwords * 4;
+	len -= nwords * 4;
 
-	while (l < len) {
-		if (n == 0) {
-			ZUC_generate_keystream(&dctx->ks, 4, (uint32_t *)buf);
+	if (len) {
+		word = ZUC_generate_keyword(&dctx->ks);
+		memcpy(buf, &word, sizeof(word));
+		for (n = 0; n < len; n++) {
+			out[n] = in[n] ^ buf[n];
 		}
-		out[l] = in[l] ^ buf[n];
-		++l;
-		n = (n + 1) % 16;
 	}
 
 	EVP_CIPHER_CTX_set_num(ctx, n);
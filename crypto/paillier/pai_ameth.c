@@ -133,6 +133,10 @@ static int do_paillier_print(BIO *bp, const PAILLIER *x, int off, int priv)
 			goto end;
 		if (x->x && !ASN1_bn_print(bp, "x:", x->x, NULL, off))
 			goto end;
+		if (x->p && !ASN1_bn_print(bp, "prime1:", x->p, NULL, off))
+			goto end;
+		if (x->q && !ASN1_bn_print(bp, "prime2:", x->q, NULL, off))
+			goto end;
 	}
 	ret = 1;
 
@@ -66,6 +66,19 @@ static int paillier_cb(int operation, ASN1_VALUE **pval,
 		PAILLIER_free((PAILLIER *)*pval);
 		*pval = NULL;
 		return 2;
+	} else if (operation == ASN1_OP_D2I_POST) {
+		PAILLIER *key = (PAILLIER *)*pval;
+		BN_CTX *bn_ctx;
+		int ret;
+
+		/* keys without the factors still decrypt, without CRT */
+		if (!key->p || !key->q)
+			return 1;
+		if (!(bn_ctx = BN_CTX_new()))
+			return 0;
+		ret = paillier_crt_init(key, bn_ctx);
+		BN_CTX_free(bn_ctx);
+		return ret;
 	}
 	return 1;
 }
@@ -73,7 +86,10 @@ static int paillier_cb(int operation, ASN1_VALUE **pval,
 ASN1_SEQUENCE_cb(PaillierPrivateKey, paillier_cb) = {
 	ASN1_SIMPLE(PAILLIER, n, BIGNUM),
 	ASN1_SIMPLE(PAILLIER, lambda, BIGNUM),
-	ASN1_SIMPLE(PAILLIER, x, BIGNUM)
+	ASN1_SIMPLE(PAILLIER, x, BIGNUM),
+	/* optional so that keys encoded without them still decode */
+	ASN1_EXP_OPT(PAILLIER, p, BIGNUM, 0),
+	ASN1_EXP_OPT(PAILLIER, q, BIGNUM, 1)
 } ASN1_SEQUENCE_END_cb(PAILLIER, PaillierPrivateKey)
 
 ASN1_SEQUENCE_cb(PaillierPublicKey, paillier_cb) = {
@@ -25,11 +25,13 @@ static ERR_STRING_DATA PAILLIER_str_functs[] = {
     {ERR_FUNC(PAILLIER_F_PAILLIER_CIPHERTEXT_ADD), "PAILLIER_ciphertext_add"},
     {ERR_FUNC(PAILLIER_F_PAILLIER_CIPHERTEXT_SCALAR_MUL),
      "PAILLIER_ciphertext_scalar_mul"},
+    {ERR_FUNC(PAILLIER_F_PAILLIER_CRT_INIT), "paillier_crt_init"},
     {ERR_FUNC(PAILLIER_F_PAILLIER_DECRYPT), "PAILLIER_decrypt"},
     {ERR_FUNC(PAILLIER_F_PAILLIER_ENCRYPT), "PAILLIER_encrypt"},
     {ERR_FUNC(PAILLIER_F_PAILLIER_GENERATE_KEY), "PAILLIER_generate_key"},
     {ERR_FUNC(PAILLIER_F_PAILLIER_NEW), "PAILLIER_new"},
     {ERR_FUNC(PAILLIER_F_PAILLIER_PLAINTEXT_SIZE), "paillier_plaintext_size"},
+    {ERR_FUNC(PAILLIER_F_PAILLIER_PRECOMPUTE), "PAILLIER_precompute"},
     {ERR_FUNC(PAILLIER_F_PAILLIER_PRIV_DECODE), "paillier_priv_decode"},
     {ERR_FUNC(PAILLIER_F_PAILLIER_PRIV_ENCODE), "paillier_priv_encode"},
     {ERR_FUNC(PAILLIER_F_PAILLIER_PUB_DECODE), "paillier_pub_decode"},
@@ -48,6 +50,7 @@ static ERR_STRING_DATA PAILLIER_str_reasons[] = {
     {ERR_REASON(PAILLIER_R_DECODE_ERROR), "decode error"},
     {ERR_REASON(PAILLIER_R_GENERATE_PRIME_FAILED), "generate prime failed"},
     {ERR_REASON(PAILLIER_R_INVALID_PLAINTEXT), "invalid plaintext"},
+    {ERR_REASON(PAILLIER_R_INVALID_PRIVATE_KEY), "invalid private key"},
     {ERR_REASON(PAILLIER_R_KEY_SIZE_TOO_SMALL), "key size too small"},
     {ERR_REASON(PAILLIER_R_MALLOC_FAILED), "malloc failed"},
     {ERR_REASON(PAILLIER_R_NOT_IMPLEMENTED), "not implemented"},
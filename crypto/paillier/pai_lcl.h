@@ -60,10 +60,29 @@ struct paillier_st {
 	BIGNUM *n_plusone;	/* online */
 	BIGNUM *x;		/* online */
 
+	/* optional, decryption mod p^2 and q^2 with CRT */
+	BIGNUM *p;
+	BIGNUM *q;
+	BIGNUM *p_squared;	/* online */
+	BIGNUM *q_squared;	/* online */
+	BIGNUM *hp;		/* L_p(g^(p-1) mod p^2)^-1 mod p */
+	BIGNUM *hq;		/* L_q(g^(q-1) mod q^2)^-1 mod q */
+	BN_MONT_CTX *mont_p_squared;
+	BN_MONT_CTX *mont_q_squared;
+
+	BN_MONT_CTX *mont_n_squared;	/* online, with n_squared */
+
+	/* precomputed r^n mod n^2 in Montgomery form, taken under lock */
+	BIGNUM **rn_pool;
+	int rn_pool_num;
+	int rn_pool_size;
+
 	int references;
 	int flags;
 	CRYPTO_EX_DATA ex_data;
 	CRYPTO_RWLOCK *lock;
 };
 
+int paillier_crt_init(PAILLIER *key, BN_CTX *bn_ctx);
+
 #endif
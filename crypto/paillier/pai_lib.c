@@ -48,6 +48,7 @@
  */
 
 #include <stdio.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <openssl/err.h>
@@ -64,18 +65,48 @@ PAILLIER *PAILLIER_new(void)
 		return NULL;
 	}
 
+	ret->references = 1;
+	if (!(ret->lock = CRYPTO_THREAD_lock_new())) {
+		PAILLIERerr(PAILLIER_F_PAILLIER_NEW, PAILLIER_R_MALLOC_FAILED);
+		OPENSSL_free(ret);
+		return NULL;
+	}
+
 	return ret;
 }
 
 void PAILLIER_free(PAILLIER *key)
 {
-	if (key) {
-		BN_free(key->n);
-		BN_free(key->lambda);
-		BN_free(key->n_squared);
-		BN_free(key->n_plusone);
-		BN_free(key->x);
-	}
+	int i;
+
+	if (!key)
+		return;
+
+	CRYPTO_atomic_add(&key->references, -1, &i, key->lock);
+	REF_PRINT_COUNT("PAILLIER", key);
+	if (i > 0)
+		return;
+	REF_ASSERT_ISNT(i < 0);
+
+	CRYPTO_THREAD_lock_free(key->lock);
+
+	BN_free(key->n);
+	BN_free(key->lambda);
+	BN_free(key->n_squared);
+	BN_free(key->n_plusone);
+	BN_free(key->x);
+	BN_clear_free(key->p);
+	BN_clear_free(key->q);
+	BN_clear_free(key->p_squared);
+	BN_clear_free(key->q_squared);
+	BN_clear_free(key->hp);
+	BN_clear_free(key->hq);
+	BN_MONT_CTX_free(key->mont_p_squared);
+	BN_MONT_CTX_free(key->mont_q_squared);
+	BN_MONT_CTX_free(key->mont_n_squared);
+	for (i = 0; i < key->rn_pool_num; i++)
+		BN_clear_free(key->rn_pool[i]);
+	OPENSSL_free(key->rn_pool);
 	OPENSSL_clear_free(key, sizeof(*key));
 }
 
@@ -105,14 +136,18 @@ int PAILLIER_security_bits(const PAILLIER *key)
 int PAILLIER_generate_key(PAILLIER *key, int bits)
 {
 	int ret = 0;
-	BIGNUM *p = NULL;
-	BIGNUM *q = NULL;
+	BIGNUM *p1 = NULL;
+	BIGNUM *q1 = NULL;
 	BN_CTX *bn_ctx = NULL;
 
-	p = BN_new();
-	q = BN_new();
+	p1 = BN_new();
+	q1 = BN_new();
 	bn_ctx = BN_CTX_new();
 
+	if (!key->p)
+		key->p = BN_new();
+	if (!key->q)
+		key->q = BN_new();
 	if (!key->n)
 		key->n = BN_new();
 	if (!key->lambda)
@@ -124,7 +159,7 @@ int PAILLIER_generate_key(PAILLIER *key, int bits)
 	if (!key->x)
 		key->x = BN_new();
 
-	if (!p || !q || !bn_ctx || !key->n || !key->lambda ||
+	if (!p1 || !q1 || !bn_ctx || !key->p || !key->q || !key->n || !key->lambda ||
 		!key->n_squared || !key->n_plusone || !key->x) {
 		PAILLIERerr(PAILLIER_F_PAILLIER_GENERATE_KEY, ERR_R_MALLOC_FAILURE);
 		goto end;
@@ -132,34 +167,43 @@ int PAILLIER_generate_key(PAILLIER *key, int bits)
 
 	key->bits = bits;
 
+	/* anything computed for a previous n */
+	BN_MONT_CTX_free(key->mont_n_squared);
+	key->mont_n_squared = NULL;
+	while (key->rn_pool_num > 0)
+		BN_clear_free(key->rn_pool[--key->rn_pool_num]);
+
 	do {
-		if (!BN_generate_prime_ex(p, bits/2, 0, NULL, NULL, NULL)) {
+		if (!BN_generate_prime_ex(key->p, bits/2, 0, NULL, NULL, NULL)) {
 			PAILLIERerr(PAILLIER_F_PAILLIER_GENERATE_KEY,
 				PAILLIER_R_GENERATE_PRIME_FAILED);
 			goto end;
 		}
 
-		if (!BN_generate_prime_ex(q, bits/2, 0, NULL, NULL, NULL)) {
+		if (!BN_generate_prime_ex(key->q, bits/2, 0, NULL, NULL, NULL)) {
 			PAILLIERerr(PAILLIER_F_PAILLIER_GENERATE_KEY,
 				PAILLIER_R_GENERATE_PRIME_FAILED);
 			goto end;
 		}
 
-		if (!BN_mul(key->n, p, q, bn_ctx)
-			|| !BN_sub_word(p, 1)
-			|| !BN_sub_word(q, 1)
+		if (!BN_mul(key->n, key->p, key->q, bn_ctx)
+			|| !BN_copy(p1, key->p)
+			|| !BN_sub_word(p1, 1)
+			|| !BN_copy(q1, key->q)
+			|| !BN_sub_word(q1, 1)
 			/* lambda = (p - 1)*(q - 1) */
-			|| !BN_mul(key->lambda, p, q, bn_ctx)
+			|| !BN_mul(key->lambda, p1, q1, bn_ctx)
 			/* n_squared = n^2 */
 			|| !BN_sqr(key->n_squared, key->n, bn_ctx)
 			/* n_plusone = n + 1 */
 			|| !BN_copy(key->n_plusone, key->n)
 			|| !BN_add_word(key->n_plusone, 1)
-			/* x = (((g^lambda mod n^2) - 1)/n)^-1 mod n */
-			|| !BN_mod_exp(key->x, key->n_plusone, key->lambda, key->n_squared, bn_ctx)
-			|| !BN_sub_word(key->x, 1)
-			|| !BN_div(key->x, NULL, key->x, key->n, bn_ctx)
-			|| !BN_mod_inverse(key->x, key->x, key->n, bn_ctx)
+			/*
+			 * x = (((g^lambda mod n^2) - 1)/n)^-1 mod n, where
+			 * g^lambda = 1 + lambda*n mod n^2, so x = lambda^-1 mod n
+			 */
+			|| !BN_mod_inverse(key->x, key->lambda, key->n, bn_ctx)
+			|| !paillier_crt_init(key, bn_ctx)
 			) {
 			PAILLIERerr(PAILLIER_F_PAILLIER_GENERATE_KEY, ERR_R_BN_LIB);
 			goto end;
@@ -170,8 +214,143 @@ int PAILLIER_generate_key(PAILLIER *key, int bits)
 	ret = 1;
 
 end:
-	BN_clear_free(p);
-	BN_clear_free(q);
+	BN_clear_free(p1);
+	BN_clear_free(q1);
+	BN_CTX_free(bn_ctx);
+	return ret;
+}
+
+/*
+ * With g = n + 1, g^(p-1) = 1 + (p-1)*n mod p^2, so L_p(g^(p-1)) = -q mod p
+ * and hp = -q^-1 mod p, and the same for hq.
+ */
+int paillier_crt_init(PAILLIER *key, BN_CTX *bn_ctx)
+{
+	int ret = 0;
+
+	if (!key->p || !key->q) {
+		PAILLIERerr(PAILLIER_F_PAILLIER_CRT_INIT, PAILLIER_R_VALUE_MISSING);
+		return 0;
+	}
+
+	if (!key->p_squared)
+		key->p_squared = BN_new();
+	if (!key->q_squared)
+		key->q_squared = BN_new();
+	if (!key->hp)
+		key->hp = BN_new();
+	if (!key->hq)
+		key->hq = BN_new();
+	if (!key->mont_p_squared)
+		key->mont_p_squared = BN_MONT_CTX_new();
+	if (!key->mont_q_squared)
+		key->mont_q_squared = BN_MONT_CTX_new();
+
+	if (!key->p_squared || !key->q_squared || !key->hp || !key->hq
+		|| !key->mont_p_squared || !key->mont_q_squared) {
+		PAILLIERerr(PAILLIER_F_PAILLIER_CRT_INIT, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+
+	/* p and q come from the encoding when the key is decoded */
+	if (!BN_mul(key->p_squared, key->p, key->q, bn_ctx)) {
+		PAILLIERerr(PAILLIER_F_PAILLIER_CRT_INIT, ERR_R_BN_LIB);
+		goto end;
+	}
+	if (BN_cmp(key->p_squared, key->n) != 0) {
+		PAILLIERerr(PAILLIER_F_PAILLIER_CRT_INIT,
+			PAILLIER_R_INVALID_PRIVATE_KEY);
+		goto end;
+	}
+
+	if (!BN_sqr(key->p_squared, key->p, bn_ctx)
+		|| !BN_sqr(key->q_squared, key->q, bn_ctx)
+		|| !BN_MONT_CTX_set(key->mont_p_squared, key->p_squared, bn_ctx)
+		|| !BN_MONT_CTX_set(key->mont_q_squared, key->q_squared, bn_ctx)
+		/* hp = -q^-1 mod p */
+		|| !BN_mod_inverse(key->hp, key->q, key->p, bn_ctx)
+		|| !BN_sub(key->hp, key->p, key->hp)
+		/* hq = -p^-1 mod q */
+		|| !BN_mod_inverse(key->hq, key->p, key->q, bn_ctx)
+		|| !BN_sub(key->hq, key->q, key->hq)) {
+		PAILLIERerr(PAILLIER_F_PAILLIER_CRT_INIT, ERR_R_BN_LIB);
+		goto end;
+	}
+
+	ret = 1;
+end:
+	if (!ret) {
+		BN_clear_free(key->hp);
+		key->hp = NULL;
+	}
+	return ret;
+}
+
+/* mp = L_p(c^(p-1) mod p^2) * hp mod p */
+static int paillier_decrypt_prime(BIGNUM *mp, const BIGNUM *c,
+	const BIGNUM *p, const BIGNUM *p_squared, const BIGNUM *hp,
+	BN_MONT_CTX *mont, BN_CTX *bn_ctx)
+{
+	int ret = 0;
+	BIGNUM *e;
+	BIGNUM *t;
+
+	BN_CTX_start(bn_ctx);
+	e = BN_CTX_get(bn_ctx);
+	if (!(t = BN_CTX_get(bn_ctx))) {
+		goto end;
+	}
+
+	if (!BN_copy(e, p)
+		|| !BN_sub_word(e, 1)
+		|| !BN_nnmod(t, c, p_squared, bn_ctx)
+		|| !BN_mod_exp_mont_consttime(t, t, e, p_squared, bn_ctx, mont)
+		|| !BN_sub_word(t, 1)
+		|| !BN_div(t, NULL, t, p, bn_ctx)
+		|| !BN_mod_mul(mp, t, hp, p, bn_ctx)) {
+		goto end;
+	}
+
+	ret = 1;
+end:
+	BN_CTX_end(bn_ctx);
+	return ret;
+}
+
+/*
+ * Half-size exponentiations mod p^2 and q^2, then
+ * m = mq + q * ((mp - mq) * q^-1 mod p), where q^-1 = p - hp.
+ */
+static int paillier_decrypt_crt(BIGNUM *m, const BIGNUM *c, PAILLIER *key,
+	BN_CTX *bn_ctx)
+{
+	int ret = 0;
+	BIGNUM *mp;
+	BIGNUM *mq;
+	BIGNUM *qinv;
+
+	BN_CTX_start(bn_ctx);
+	mp = BN_CTX_get(bn_ctx);
+	mq = BN_CTX_get(bn_ctx);
+	if (!(qinv = BN_CTX_get(bn_ctx))) {
+		goto end;
+	}
+
+	if (!paillier_decrypt_prime(mp, c, key->p, key->p_squared, key->hp,
+			key->mont_p_squared, bn_ctx)
+		|| !paillier_decrypt_prime(mq, c, key->q, key->q_squared, key->hq,
+			key->mont_q_squared, bn_ctx)
+		|| !BN_sub(qinv, key->p, key->hp)
+		|| !BN_mod_sub(mp, mp, mq, key->p, bn_ctx)
+		|| !BN_mod_mul(mp, mp, qinv, key->p, bn_ctx)
+		|| !BN_mul(m, mp, key->q, bn_ctx)
+		|| !BN_add(m, m, mq)) {
+		goto end;
+	}
+
+	ret = 1;
+end:
+	BN_CTX_end(bn_ctx);
 	return ret;
 }
 
@@ -181,75 +360,196 @@ int PAILLIER_check_key(PAILLIER *key)
 	return 0;
 }
 
-int PAILLIER_encrypt(BIGNUM *c, const BIGNUM *m, PAILLIER *pub_key)
+/*
+ * n^2 and its Montgomery context are computed on first use. They are set
+ * under the key's lock, and whoever loses the race drops their copy.
+ */
+static int paillier_mont_init(PAILLIER *key, BN_CTX *bn_ctx)
 {
 	int ret = 0;
+	BIGNUM *n_squared = NULL;
+	BN_MONT_CTX *mont = NULL;
+
+	if (!CRYPTO_THREAD_read_lock(key->lock))
+		return 0;
+	ret = key->mont_n_squared != NULL;
+	CRYPTO_THREAD_unlock(key->lock);
+	if (ret)
+		return 1;
+
+	if (!(n_squared = BN_new())
+		|| !(mont = BN_MONT_CTX_new())
+		|| !BN_sqr(n_squared, key->n, bn_ctx)
+		|| !BN_MONT_CTX_set(mont, n_squared, bn_ctx)
+		|| !CRYPTO_THREAD_write_lock(key->lock)) {
+		goto end;
+	}
+	if (!key->mont_n_squared) {
+		/* PAILLIER_generate_key() sets n_squared */
+		if (!key->n_squared) {
+			key->n_squared = n_squared;
+			n_squared = NULL;
+		}
+		key->mont_n_squared = mont;
+		mont = NULL;
+	}
+	CRYPTO_THREAD_unlock(key->lock);
+
+	ret = 1;
+end:
+	BN_free(n_squared);
+	BN_MONT_CTX_free(mont);
+	return ret;
+}
+
+/* r^n mod n^2 in Montgomery form, for a random r in [1, n) */
+static int paillier_compute_rn(BIGNUM *rn, PAILLIER *key, BN_CTX *bn_ctx)
+{
+	do {
+		if (!BN_rand_range(rn, key->n))
+			return 0;
+	} while (BN_is_zero(rn));
+
+	return BN_mod_exp_mont(rn, rn, key->n, key->n_squared, bn_ctx,
+			key->mont_n_squared)
+		&& BN_to_montgomery(rn, rn, key->mont_n_squared, bn_ctx);
+}
+
+/* takes a precomputed r^n if the pool has one, computes it if not */
+static int paillier_get_rn(BIGNUM *rn, PAILLIER *key, BN_CTX *bn_ctx)
+{
 	BIGNUM *r = NULL;
+	int ret;
+
+	if (!CRYPTO_THREAD_write_lock(key->lock))
+		return 0;
+	if (key->rn_pool_num > 0)
+		r = key->rn_pool[--key->rn_pool_num];
+	CRYPTO_THREAD_unlock(key->lock);
+
+	if (!r)
+		return paillier_compute_rn(rn, key, bn_ctx);
+
+	ret = BN_copy(rn, r) != NULL;
+	BN_clear_free(r);
+	return ret;
+}
+
+int PAILLIER_precompute(PAILLIER *key, int num)
+{
+	int ret = 0;
+	BIGNUM **rn = NULL;
+	BIGNUM **pool;
 	BN_CTX *bn_ctx = NULL;
+	int i;
 
-	if (BN_cmp(m, pub_key->n) >= 0) {
-		PAILLIERerr(PAILLIER_F_PAILLIER_ENCRYPT, PAILLIER_R_INVALID_PLAINTEXT);
+	if (num <= 0)
+		return 1;
+
+	if (!(rn = OPENSSL_zalloc(sizeof(*rn) * num))
+		|| !(bn_ctx = BN_CTX_new())) {
+		PAILLIERerr(PAILLIER_F_PAILLIER_PRECOMPUTE, ERR_R_MALLOC_FAILURE);
 		goto end;
 	}
 
-	r = BN_new();
-	bn_ctx = BN_CTX_new();
-	if (!r || !bn_ctx) {
-		PAILLIERerr(PAILLIER_F_PAILLIER_ENCRYPT, ERR_R_BN_LIB);
+	/* the exponentiations are done without holding the lock */
+	if (!paillier_mont_init(key, bn_ctx)) {
+		PAILLIERerr(PAILLIER_F_PAILLIER_PRECOMPUTE, ERR_R_BN_LIB);
 		goto end;
 	}
-
-	do {
-		if (!BN_rand_range(r, pub_key->n)) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_ENCRYPT, ERR_R_BN_LIB);
+	for (i = 0; i < num; i++) {
+		if (!(rn[i] = BN_new())
+			|| !paillier_compute_rn(rn[i], key, bn_ctx)) {
+			PAILLIERerr(PAILLIER_F_PAILLIER_PRECOMPUTE, ERR_R_BN_LIB);
 			goto end;
 		}
-	} while (BN_is_zero(r));
+	}
 
-	if (!pub_key->n_plusone) {
-		if (!(pub_key->n_plusone = BN_dup(pub_key->n))) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_ENCRYPT, ERR_R_BN_LIB);
-			goto end;
-		}
-		if (!BN_add_word(pub_key->n_plusone, 1)) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_ENCRYPT, ERR_R_BN_LIB);
-			BN_free(pub_key->n_plusone);
-			pub_key->n_plusone = NULL;
+	if (!CRYPTO_THREAD_write_lock(key->lock)) {
+		PAILLIERerr(PAILLIER_F_PAILLIER_PRECOMPUTE, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+	if (num > INT_MAX - key->rn_pool_num) {
+		CRYPTO_THREAD_unlock(key->lock);
+		PAILLIERerr(PAILLIER_F_PAILLIER_PRECOMPUTE,
+			PAILLIER_R_BUFFER_TOO_SMALL);
+		goto end;
+	}
+	if (key->rn_pool_num + num > key->rn_pool_size) {
+		if (!(pool = OPENSSL_realloc(key->rn_pool,
+			sizeof(*pool) * (key->rn_pool_num + num)))) {
+			CRYPTO_THREAD_unlock(key->lock);
+			PAILLIERerr(PAILLIER_F_PAILLIER_PRECOMPUTE,
+				ERR_R_MALLOC_FAILURE);
 			goto end;
 		}
+		key->rn_pool = pool;
+		key->rn_pool_size = key->rn_pool_num + num;
 	}
+	memcpy(key->rn_pool + key->rn_pool_num, rn, sizeof(*rn) * num);
+	key->rn_pool_num += num;
+	CRYPTO_THREAD_unlock(key->lock);
 
-	if (!pub_key->n_squared) {
-		if (!(pub_key->n_squared = BN_new())) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_ENCRYPT, ERR_R_BN_LIB);
-			goto end;
-		}
-		if (!BN_sqr(pub_key->n_squared, pub_key->n, bn_ctx)) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_ENCRYPT, ERR_R_BN_LIB);
-			BN_free(pub_key->n_squared);
-			pub_key->n_squared = NULL;
-			goto end;
-		}
+	memset(rn, 0, sizeof(*rn) * num);
+	ret = 1;
+
+end:
+	if (rn) {
+		for (i = 0; i < num; i++)
+			BN_clear_free(rn[i]);
+		OPENSSL_free(rn);
 	}
+	BN_CTX_free(bn_ctx);
+	return ret;
+}
 
-	if (!BN_mod_exp(c, pub_key->n_plusone, m, pub_key->n_squared, bn_ctx)) {
+int PAILLIER_num_precomputed(PAILLIER *key)
+{
+	int ret;
+
+	if (!CRYPTO_THREAD_read_lock(key->lock))
+		return 0;
+	ret = key->rn_pool_num;
+	CRYPTO_THREAD_unlock(key->lock);
+	return ret;
+}
+
+int PAILLIER_encrypt(BIGNUM *c, const BIGNUM *m, PAILLIER *pub_key)
+{
+	int ret = 0;
+	BIGNUM *rn = NULL;
+	BN_CTX *bn_ctx = NULL;
+
+	if (BN_is_negative(m) || BN_cmp(m, pub_key->n) >= 0) {
+		PAILLIERerr(PAILLIER_F_PAILLIER_ENCRYPT, PAILLIER_R_INVALID_PLAINTEXT);
+		goto end;
+	}
+
+	rn = BN_new();
+	bn_ctx = BN_CTX_new();
+	if (!rn || !bn_ctx) {
 		PAILLIERerr(PAILLIER_F_PAILLIER_ENCRYPT, ERR_R_BN_LIB);
 		goto end;
 	}
 
-	if (!BN_mod_exp(r, r, pub_key->n, pub_key->n_squared, bn_ctx)) {
+	if (!paillier_mont_init(pub_key, bn_ctx)
+		|| !paillier_get_rn(rn, pub_key, bn_ctx)) {
 		PAILLIERerr(PAILLIER_F_PAILLIER_ENCRYPT, ERR_R_BN_LIB);
 		goto end;
 	}
 
-	if (!BN_mod_mul(c, c, r, pub_key->n_squared, bn_ctx)) {
+	/* g^m = (n + 1)^m = 1 + m*n mod n^2, and 1 + m*n < n^2 */
+	if (!BN_mul(c, m, pub_key->n, bn_ctx)
+		|| !BN_add_word(c, 1)
+		|| !BN_mod_mul_montgomery(c, c, rn, pub_key->mont_n_squared,
+			bn_ctx)) {
 		PAILLIERerr(PAILLIER_F_PAILLIER_ENCRYPT, ERR_R_BN_LIB);
 		goto end;
 	}
 
 	ret = 1;
 end:
-	BN_clear_free(r);
+	BN_clear_free(rn);
 	BN_CTX_free(bn_ctx);
 	return ret;
 }
@@ -264,18 +564,22 @@ int PAILLIER_decrypt(BIGNUM *m, const BIGNUM *c, PAILLIER *key)
 		goto end;
 	}
 
-	if (!key->n_squared) {
-		if (!(key->n_squared = BN_new())) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_DECRYPT, ERR_R_MALLOC_FAILURE);
-			goto end;
-		}
-		if (!BN_sqr(key->n_squared, key->n, bn_ctx)) {
+	if (key->hp) {
+		if (!paillier_decrypt_crt(m, c, key, bn_ctx)) {
 			PAILLIERerr(PAILLIER_F_PAILLIER_DECRYPT, ERR_R_BN_LIB);
 			goto end;
 		}
+		ret = 1;
+		goto end;
 	}
 
-	if (!BN_mod_exp(m, c, key->lambda, key->n_squared, bn_ctx)) {
+	if (!paillier_mont_init(key, bn_ctx)) {
+		PAILLIERerr(PAILLIER_F_PAILLIER_DECRYPT, ERR_R_BN_LIB);
+		goto end;
+	}
+
+	if (!BN_mod_exp_mont(m, c, key->lambda, key->n_squared, bn_ctx,
+		key->mont_n_squared)) {
 		PAILLIERerr(PAILLIER_F_PAILLIER_DECRYPT, ERR_R_BN_LIB);
 		goto end;
 	}
@@ -314,25 +618,8 @@ int PAILLIER_ciphertext_add(BIGNUM *r, const BIGNUM *a, const BIGNUM *b, PAILLIE
 		goto end;
 	}
 
-	do {
-		if (!BN_rand_range(k, key->n)) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_CIPHERTEXT_ADD, ERR_R_BN_LIB);
-			goto end;
-		}
-	} while (BN_is_zero(k));
-
-	if (!key->n_squared) {
-		if (!(key->n_squared = BN_new())) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_CIPHERTEXT_ADD, ERR_R_MALLOC_FAILURE);
-			goto end;
-		}
-		if (!BN_sqr(key->n_squared, key->n, bn_ctx)) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_CIPHERTEXT_ADD, ERR_R_BN_LIB);
-			goto end;
-		}
-	}
-
-	if (!BN_mod_exp(k, k, key->n, key->n_squared, bn_ctx)) {
+	if (!paillier_mont_init(key, bn_ctx)
+		|| !paillier_get_rn(k, key, bn_ctx)) {
 		PAILLIERerr(PAILLIER_F_PAILLIER_CIPHERTEXT_ADD, ERR_R_BN_LIB);
 		goto end;
 	}
@@ -342,7 +629,7 @@ int PAILLIER_ciphertext_add(BIGNUM *r, const BIGNUM *a, const BIGNUM *b, PAILLIE
 		goto end;
 	}
 
-	if (!BN_mod_mul(r, r, k, key->n_squared, bn_ctx)) {
+	if (!BN_mod_mul_montgomery(r, r, k, key->mont_n_squared, bn_ctx)) {
 		PAILLIERerr(PAILLIER_F_PAILLIER_CIPHERTEXT_ADD, ERR_R_BN_LIB);
 		goto end;
 	}
@@ -367,35 +654,19 @@ int PAILLIER_ciphertext_scalar_mul(BIGNUM *r, const BIGNUM *scalar, const BIGNUM
 		goto end;
 	}
 
-	do {
-		if (!BN_rand_range(k, key->n)) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_CIPHERTEXT_SCALAR_MUL, ERR_R_BN_LIB);
-			goto end;
-		}
-	} while (BN_is_zero(k));
-
-	if (!key->n_squared) {
-		if (!(key->n_squared = BN_new())) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_CIPHERTEXT_SCALAR_MUL, ERR_R_MALLOC_FAILURE);
-			goto end;
-		}
-		if (!BN_sqr(key->n_squared, key->n, bn_ctx)) {
-			PAILLIERerr(PAILLIER_F_PAILLIER_CIPHERTEXT_SCALAR_MUL, ERR_R_BN_LIB);
-			goto end;
-		}
-	}
-
-	if (!BN_mod_exp(k, k, key->n, key->n_squared, bn_ctx)) {
+	if (!paillier_mont_init(key, bn_ctx)
+		|| !paillier_get_rn(k, key, bn_ctx)) {
 		PAILLIERerr(PAILLIER_F_PAILLIER_CIPHERTEXT_SCALAR_MUL, ERR_R_BN_LIB);
 		goto end;
 	}
 
-	if (!BN_mod_exp(r, a, scalar, key->n_squared, bn_ctx)) {
+	if (!BN_mod_exp_mont(r, a, scalar, key->n_squared, bn_ctx,
+		key->mont_n_squared)) {
 		PAILLIERerr(PAILLIER_F_PAILLIER_CIPHERTEXT_SCALAR_MUL, ERR_R_BN_LIB);
 		goto end;
 	}
 
-	if (!BN_mod_mul(r, r, k, key->n_squared, bn_ctx)) {
+	if (!BN_mod_mul_montgomery(r, r, k, key->mont_n_squared, bn_ctx)) {
 		PAILLIERerr(PAILLIER_F_PAILLIER_CIPHERTEXT_SCALAR_MUL, ERR_R_BN_LIB);
 		goto end;
 	}
@@ -497,3 +497,511 @@ end:
 	EVP_MD_CTX_free(md_ctx);
 	return ret;
 }
+
+SM2_ENC_CTX *SM2_ENC_CTX_new(void)
+{
+	SM2_ENC_CTX *ret;
+
+	if (!(ret = OPENSSL_zalloc(sizeof(*ret)))) {
+		SM2err(SM2_F_SM2_ENC_CTX_NEW, ERR_R_MALLOC_FAILURE);
+		return NULL;
+	}
+	if (!(ret->kdf_ctx = EVP_MD_CTX_new())
+		|| !(ret->blk_ctx = EVP_MD_CTX_new())
+		|| !(ret->hash_ctx = EVP_MD_CTX_new())
+		|| !(ret->bn_ctx = BN_CTX_new())) {
+		SM2err(SM2_F_SM2_ENC_CTX_NEW, ERR_R_MALLOC_FAILURE);
+		SM2_ENC_CTX_free(ret);
+		return NULL;
+	}
+	return ret;
+}
+
+void SM2_ENC_CTX_free(SM2_ENC_CTX *ctx)
+{
+	if (!ctx)
+		return;
+	EVP_MD_CTX_free(ctx->kdf_ctx);
+	EVP_MD_CTX_free(ctx->blk_ctx);
+	EVP_MD_CTX_free(ctx->hash_ctx);
+	BN_CTX_free(ctx->bn_ctx);
+	OPENSSL_clear_free(ctx, sizeof(*ctx));
+}
+
+/*
+ * Starts t = KDF(x2 || y2) and Hash(x2 || M || y2) from the shared point.
+ * The KDF context keeps the digest state after x2 || y2 so that each block
+ * only hashes the counter.
+ */
+static int sm2_enc_ctx_start(SM2_ENC_CTX *ctx, const EVP_MD *md,
+	const EC_GROUP *group, const EC_POINT *point)
+{
+	unsigned char buf[(OPENSSL_ECC_MAX_FIELD_BITS + 7)/4 + 1];
+	size_t len;
+	int ret = 0;
+
+	if (!(len = EC_POINT_point2oct(group, point,
+		POINT_CONVERSION_UNCOMPRESSED, buf, sizeof(buf), ctx->bn_ctx))) {
+		return 0;
+	}
+	ctx->nbytes = (len - 1)/2;
+
+	if (!EVP_DigestInit_ex(ctx->kdf_ctx, md, NULL)
+		|| !EVP_DigestUpdate(ctx->kdf_ctx, buf + 1, len - 1)
+		|| !EVP_DigestInit_ex(ctx->hash_ctx, md, NULL)
+		|| !EVP_DigestUpdate(ctx->hash_ctx, buf + 1, ctx->nbytes)) {
+		goto end;
+	}
+	memcpy(ctx->y2, buf + 1 + ctx->nbytes, ctx->nbytes);
+
+	ctx->md = md;
+	ctx->counter = 1;
+	ctx->keylen = EVP_MD_size(md);
+	ctx->keypos = ctx->keylen;
+	ctx->nonzero = 0;
+	ret = 1;
+
+end:
+	OPENSSL_cleanse(buf, sizeof(buf));
+	return ret;
+}
+
+/* out = in xor t, continuing the key stream where the last call stopped */
+static int sm2_enc_ctx_xor(SM2_ENC_CTX *ctx, unsigned char *out,
+	const unsigned char *in, size_t inlen)
+{
+	unsigned char ctr[4];
+	size_t i, n;
+
+	while (inlen > 0) {
+		if (ctx->keypos == ctx->keylen) {
+			/* the 32-bit counter of X9.63 has wrapped */
+			if (ctx->counter == 0) {
+				SM2err(SM2_F_SM2_ENC_CTX_XOR, SM2_R_PLAINTEXT_TOO_LONG);
+				return 0;
+			}
+			ctr[0] = (unsigned char)(ctx->counter >> 24);
+			ctr[1] = (unsigned char)(ctx->counter >> 16);
+			ctr[2] = (unsigned char)(ctx->counter >> 8);
+			ctr[3] = (unsigned char)ctx->counter;
+			if (!EVP_MD_CTX_copy_ex(ctx->blk_ctx, ctx->kdf_ctx)
+				|| !EVP_DigestUpdate(ctx->blk_ctx, ctr, sizeof(ctr))
+				|| !EVP_DigestFinal_ex(ctx->blk_ctx, ctx->key, NULL)) {
+				SM2err(SM2_F_SM2_ENC_CTX_XOR, SM2_R_KDF_FAILURE);
+				return 0;
+			}
+			ctx->counter++;
+			ctx->keypos = 0;
+		}
+
+		n = ctx->keylen - ctx->keypos;
+		if (n > inlen)
+			n = inlen;
+		for (i = 0; i < n; i++) {
+			ctx->nonzero |= ctx->key[ctx->keypos + i];
+			out[i] = in[i] ^ ctx->key[ctx->keypos + i];
+		}
+		ctx->keypos += n;
+		in += n;
+		out += n;
+		inlen -= n;
+	}
+
+	return 1;
+}
+
+int SM2_encrypt_init(SM2_ENC_CTX *ctx, const EVP_MD *md, EC_KEY *ec_key,
+	unsigned char *c1, size_t *c1len)
+{
+	int ret = 0;
+	const EC_GROUP *group;
+	const EC_POINT *pub_key;
+	EC_POINT *ephem_point = NULL;
+	EC_POINT *share_point = NULL;
+	BIGNUM *n;
+	BIGNUM *h;
+	BIGNUM *k;
+	size_t len;
+
+	if (!ctx || !md || !ec_key || !c1len) {
+		SM2err(SM2_F_SM2_ENCRYPT_INIT, ERR_R_PASSED_NULL_PARAMETER);
+		return 0;
+	}
+	ctx->state = SM2_ENC_STATE_NONE;
+
+	if (!(group = EC_KEY_get0_group(ec_key))
+		|| !(pub_key = EC_KEY_get0_public_key(ec_key))) {
+		SM2err(SM2_F_SM2_ENCRYPT_INIT, SM2_R_INVALID_EC_KEY);
+		return 0;
+	}
+
+	len = 1 + 2 * ((EC_GROUP_get_degree(group) + 7) / 8);
+	if (!c1) {
+		*c1len = len;
+		return 1;
+	} else if (*c1len < len) {
+		SM2err(SM2_F_SM2_ENCRYPT_INIT, SM2_R_BUFFER_TOO_SMALL);
+		return 0;
+	}
+
+	BN_CTX_start(ctx->bn_ctx);
+	n = BN_CTX_get(ctx->bn_ctx);
+	h = BN_CTX_get(ctx->bn_ctx);
+	k = BN_CTX_get(ctx->bn_ctx);
+	if (!k
+		|| !(ephem_point = EC_POINT_new(group))
+		|| !(share_point = EC_POINT_new(group))) {
+		SM2err(SM2_F_SM2_ENCRYPT_INIT, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+
+	if (!EC_GROUP_get_order(group, n, ctx->bn_ctx)
+		|| !EC_GROUP_get_cofactor(group, h, ctx->bn_ctx)) {
+		SM2err(SM2_F_SM2_ENCRYPT_INIT, ERR_R_EC_LIB);
+		goto end;
+	}
+
+	/* check [h]P_B != O */
+	if (!EC_POINT_mul(group, share_point, NULL, pub_key, h, ctx->bn_ctx)) {
+		SM2err(SM2_F_SM2_ENCRYPT_INIT, ERR_R_EC_LIB);
+		goto end;
+	}
+	if (EC_POINT_is_at_infinity(group, share_point)) {
+		SM2err(SM2_F_SM2_ENCRYPT_INIT, SM2_R_INVALID_PUBLIC_KEY);
+		goto end;
+	}
+
+	/* rand k in [1, n-1] */
+	do {
+		if (!BN_rand_range(k, n)) {
+			SM2err(SM2_F_SM2_ENCRYPT_INIT,
+				SM2_R_RANDOM_NUMBER_GENERATION_FAILED);
+			goto end;
+		}
+	} while (BN_is_zero(k));
+
+	/* C1 = [k]G = (x1, y1), share_point = [k]P_B = (x2, y2) */
+	if (!EC_POINT_mul(group, ephem_point, k, NULL, NULL, ctx->bn_ctx)
+		|| !EC_POINT_mul(group, share_point, NULL, pub_key, k, ctx->bn_ctx)
+		|| EC_POINT_point2oct(group, ephem_point,
+			POINT_CONVERSION_UNCOMPRESSED, c1, len, ctx->bn_ctx) != len
+		|| !sm2_enc_ctx_start(ctx, md, group, share_point)) {
+		SM2err(SM2_F_SM2_ENCRYPT_INIT, ERR_R_EC_LIB);
+		goto end;
+	}
+
+	*c1len = len;
+	ctx->state = SM2_ENC_STATE_ENCRYPT;
+	ret = 1;
+
+end:
+	if (k)
+		BN_clear(k);
+	BN_CTX_end(ctx->bn_ctx);
+	EC_POINT_free(ephem_point);
+	EC_POINT_clear_free(share_point);
+	return ret;
+}
+
+int SM2_encrypt_update(SM2_ENC_CTX *ctx, unsigned char *out,
+	const unsigned char *in, size_t inlen)
+{
+	if (ctx->state != SM2_ENC_STATE_ENCRYPT) {
+		SM2err(SM2_F_SM2_ENCRYPT_UPDATE, SM2_R_NOT_INITIALIZED);
+		return 0;
+	}
+
+	/* hash M before out overwrites it when encrypting in place */
+	if (!EVP_DigestUpdate(ctx->hash_ctx, in, inlen)) {
+		SM2err(SM2_F_SM2_ENCRYPT_UPDATE, ERR_R_EVP_LIB);
+		goto err;
+	}
+	if (!sm2_enc_ctx_xor(ctx, out, in, inlen)) {
+		SM2err(SM2_F_SM2_ENCRYPT_UPDATE, SM2_R_ENCRYPT_FAILURE);
+		goto err;
+	}
+	return 1;
+
+err:
+	ctx->state = SM2_ENC_STATE_NONE;
+	return 0;
+}
+
+int SM2_encrypt_final(SM2_ENC_CTX *ctx, unsigned char *c3, size_t *c3len)
+{
+	if (ctx->state != SM2_ENC_STATE_ENCRYPT) {
+		SM2err(SM2_F_SM2_ENCRYPT_FINAL, SM2_R_NOT_INITIALIZED);
+		return 0;
+	}
+	if (!c3) {
+		*c3len = ctx->keylen;
+		return 1;
+	} else if (*c3len < ctx->keylen) {
+		SM2err(SM2_F_SM2_ENCRYPT_FINAL, SM2_R_BUFFER_TOO_SMALL);
+		return 0;
+	}
+	ctx->state = SM2_ENC_STATE_NONE;
+
+	/*
+	 * The output is gone, so an all zero t cannot be redone with a new k
+	 * as the standard asks, fail instead. It has negligible probability.
+	 */
+	if (!ctx->nonzero && ctx->counter != 1) {
+		SM2err(SM2_F_SM2_ENCRYPT_FINAL, SM2_R_KDF_FAILURE);
+		return 0;
+	}
+
+	/* C3 = Hash(x2 || M || y2) */
+	if (!EVP_DigestUpdate(ctx->hash_ctx, ctx->y2, ctx->nbytes)
+		|| !EVP_DigestFinal_ex(ctx->hash_ctx, c3, NULL)) {
+		SM2err(SM2_F_SM2_ENCRYPT_FINAL, ERR_R_EVP_LIB);
+		return 0;
+	}
+	OPENSSL_cleanse(ctx->key, sizeof(ctx->key));
+	OPENSSL_cleanse(ctx->y2, sizeof(ctx->y2));
+
+	*c3len = ctx->keylen;
+	return 1;
+}
+
+int SM2_decrypt_init(SM2_ENC_CTX *ctx, const EVP_MD *md, EC_KEY *ec_key,
+	const unsigned char *c1, size_t c1len)
+{
+	int ret = 0;
+	const EC_GROUP *group;
+	const BIGNUM *pri_key;
+	EC_POINT *point = NULL;
+	BIGNUM *h;
+
+	if (!ctx || !md || !ec_key || !c1) {
+		SM2err(SM2_F_SM2_DECRYPT_INIT, ERR_R_PASSED_NULL_PARAMETER);
+		return 0;
+	}
+	ctx->state = SM2_ENC_STATE_NONE;
+
+	if (!(group = EC_KEY_get0_group(ec_key))
+		|| !(pri_key = EC_KEY_get0_private_key(ec_key))) {
+		SM2err(SM2_F_SM2_DECRYPT_INIT, SM2_R_INVALID_EC_KEY);
+		return 0;
+	}
+
+	BN_CTX_start(ctx->bn_ctx);
+	if (!(h = BN_CTX_get(ctx->bn_ctx))
+		|| !(point = EC_POINT_new(group))) {
+		SM2err(SM2_F_SM2_DECRYPT_INIT, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+
+	/* C1 must be on the curve and [h]C1 != O */
+	if (!EC_POINT_oct2point(group, point, c1, c1len, ctx->bn_ctx)) {
+		SM2err(SM2_F_SM2_DECRYPT_INIT, SM2_R_INVALID_CIPHERTEXT);
+		goto end;
+	}
+	if (!EC_GROUP_get_cofactor(group, h, ctx->bn_ctx)
+		|| !EC_POINT_mul(group, point, NULL, point, h, ctx->bn_ctx)) {
+		SM2err(SM2_F_SM2_DECRYPT_INIT, ERR_R_EC_LIB);
+		goto end;
+	}
+	if (EC_POINT_is_at_infinity(group, point)) {
+		SM2err(SM2_F_SM2_DECRYPT_INIT, SM2_R_INVALID_CIPHERTEXT);
+		goto end;
+	}
+
+	/* compute ECDH [d]C1 = (x2, y2) */
+	if (!EC_POINT_oct2point(group, point, c1, c1len, ctx->bn_ctx)
+		|| !EC_POINT_mul(group, point, NULL, point, pri_key, ctx->bn_ctx)
+		|| !sm2_enc_ctx_start(ctx, md, group, point)) {
+		SM2err(SM2_F_SM2_DECRYPT_INIT, ERR_R_EC_LIB);
+		goto end;
+	}
+
+	ctx->state = SM2_ENC_STATE_DECRYPT;
+	ret = 1;
+
+end:
+	BN_CTX_end(ctx->bn_ctx);
+	EC_POINT_clear_free(point);
+	return ret;
+}
+
+int SM2_decrypt_update(SM2_ENC_CTX *ctx, unsigned char *out,
+	const unsigned char *in, size_t inlen)
+{
+	if (ctx->state != SM2_ENC_STATE_DECRYPT) {
+		SM2err(SM2_F_SM2_DECRYPT_UPDATE, SM2_R_NOT_INITIALIZED);
+		return 0;
+	}
+
+	if (!sm2_enc_ctx_xor(ctx, out, in, inlen)) {
+		SM2err(SM2_F_SM2_DECRYPT_UPDATE, SM2_R_DECRYPT_FAILURE);
+		goto err;
+	}
+	if (!EVP_DigestUpdate(ctx->hash_ctx, out, inlen)) {
+		SM2err(SM2_F_SM2_DECRYPT_UPDATE, ERR_R_EVP_LIB);
+		goto err;
+	}
+	return 1;
+
+err:
+	ctx->state = SM2_ENC_STATE_NONE;
+	return 0;
+}
+
+int SM2_decrypt_final(SM2_ENC_CTX *ctx, const unsigned char *c3, size_t c3len)
+{
+	unsigned char mac[EVP_MAX_MD_SIZE];
+
+	if (ctx->state != SM2_ENC_STATE_DECRYPT) {
+		SM2err(SM2_F_SM2_DECRYPT_FINAL, SM2_R_NOT_INITIALIZED);
+		return 0;
+	}
+	ctx->state = SM2_ENC_STATE_NONE;
+
+	/* check C3 == Hash(x2 || M || y2) */
+	if (!EVP_DigestUpdate(ctx->hash_ctx, ctx->y2, ctx->nbytes)
+		|| !EVP_DigestFinal_ex(ctx->hash_ctx, mac, NULL)) {
+		SM2err(SM2_F_SM2_DECRYPT_FINAL, ERR_R_EVP_LIB);
+		return 0;
+	}
+	OPENSSL_cleanse(ctx->key, sizeof(ctx->key));
+	OPENSSL_cleanse(ctx->y2, sizeof(ctx->y2));
+
+	if (c3len != ctx->keylen || CRYPTO_memcmp(c3, mac, c3len) != 0
+		|| (!ctx->nonzero && ctx->counter != 1)) {
+		SM2err(SM2_F_SM2_DECRYPT_FINAL, SM2_R_INVALID_CIPHERTEXT);
+		return 0;
+	}
+	return 1;
+}
+
+int SM2_encrypt_raw(const EVP_MD *md, int format,
+	const unsigned char *in, size_t inlen,
+	unsigned char *out, size_t *outlen, EC_KEY *ec_key)
+{
+	int ret = 0;
+	const EC_GROUP *group;
+	SM2_ENC_CTX *ctx = NULL;
+	size_t c1len, c3len, len;
+	unsigned char *c2, *c3;
+
+	if (!md || (!in && inlen) || !outlen || !ec_key) {
+		SM2err(SM2_F_SM2_ENCRYPT_RAW, ERR_R_PASSED_NULL_PARAMETER);
+		return 0;
+	}
+	if (format != SM2_CIPHERTEXT_C1C3C2 && format != SM2_CIPHERTEXT_C1C2C3) {
+		SM2err(SM2_F_SM2_ENCRYPT_RAW, SM2_R_INVALID_CIPHERTEXT_FORMAT);
+		return 0;
+	}
+	if (!(group = EC_KEY_get0_group(ec_key))) {
+		SM2err(SM2_F_SM2_ENCRYPT_RAW, SM2_R_INVALID_EC_KEY);
+		return 0;
+	}
+
+	c1len = 1 + 2 * ((EC_GROUP_get_degree(group) + 7) / 8);
+	c3len = EVP_MD_size(md);
+	if (inlen > SIZE_MAX - c1len - c3len) {
+		SM2err(SM2_F_SM2_ENCRYPT_RAW, SM2_R_PLAINTEXT_TOO_LONG);
+		return 0;
+	}
+	len = c1len + inlen + c3len;
+	if (!out) {
+		*outlen = len;
+		return 1;
+	} else if (*outlen < len) {
+		SM2err(SM2_F_SM2_ENCRYPT_RAW, SM2_R_BUFFER_TOO_SMALL);
+		return 0;
+	}
+
+	if (format == SM2_CIPHERTEXT_C1C3C2) {
+		c3 = out + c1len;
+		c2 = c3 + c3len;
+	} else {
+		c2 = out + c1len;
+		c3 = c2 + inlen;
+	}
+
+	if (!(ctx = SM2_ENC_CTX_new())) {
+		SM2err(SM2_F_SM2_ENCRYPT_RAW, ERR_R_MALLOC_FAILURE);
+		return 0;
+	}
+	if (!SM2_encrypt_init(ctx, md, ec_key, out, &c1len)
+		|| !SM2_encrypt_update(ctx, c2, in, inlen)
+		|| !SM2_encrypt_final(ctx, c3, &c3len)) {
+		SM2err(SM2_F_SM2_ENCRYPT_RAW, SM2_R_ENCRYPT_FAILURE);
+		goto end;
+	}
+
+	*outlen = len;
+	ret = 1;
+
+end:
+	SM2_ENC_CTX_free(ctx);
+	return ret;
+}
+
+int SM2_decrypt_raw(const EVP_MD *md, int format,
+	const unsigned char *in, size_t inlen,
+	unsigned char *out, size_t *outlen, EC_KEY *ec_key)
+{
+	int ret = 0;
+	const EC_GROUP *group;
+	SM2_ENC_CTX *ctx = NULL;
+	size_t c1len, c3len, len;
+	const unsigned char *c2, *c3;
+
+	if (!md || !in || !outlen || !ec_key) {
+		SM2err(SM2_F_SM2_DECRYPT_RAW, ERR_R_PASSED_NULL_PARAMETER);
+		return 0;
+	}
+	if (format != SM2_CIPHERTEXT_C1C3C2 && format != SM2_CIPHERTEXT_C1C2C3) {
+		SM2err(SM2_F_SM2_DECRYPT_RAW, SM2_R_INVALID_CIPHERTEXT_FORMAT);
+		return 0;
+	}
+	if (!(group = EC_KEY_get0_group(ec_key))) {
+		SM2err(SM2_F_SM2_DECRYPT_RAW, SM2_R_INVALID_EC_KEY);
+		return 0;
+	}
+
+	/* C1 is an uncompressed point */
+	c1len = 1 + 2 * ((EC_GROUP_get_degree(group) + 7) / 8);
+	c3len = EVP_MD_size(md);
+	if (inlen < c1len + c3len || in[0] != POINT_CONVERSION_UNCOMPRESSED) {
+		SM2err(SM2_F_SM2_DECRYPT_RAW, SM2_R_INVALID_CIPHERTEXT);
+		return 0;
+	}
+	len = inlen - c1len - c3len;
+	if (!out) {
+		*outlen = len;
+		return 1;
+	} else if (*outlen < len) {
+		SM2err(SM2_F_SM2_DECRYPT_RAW, SM2_R_BUFFER_TOO_SMALL);
+		return 0;
+	}
+
+	if (format == SM2_CIPHERTEXT_C1C3C2) {
+		c3 = in + c1len;
+		c2 = c3 + c3len;
+	} else {
+		c2 = in + c1len;
+		c3 = c2 + len;
+	}
+
+	if (!(ctx = SM2_ENC_CTX_new())) {
+		SM2err(SM2_F_SM2_DECRYPT_RAW, ERR_R_MALLOC_FAILURE);
+		return 0;
+	}
+	if (!SM2_decrypt_init(ctx, md, ec_key, in, c1len)
+		|| !SM2_decrypt_update(ctx, out, c2, len)
+		|| !SM2_decrypt_final(ctx, c3, c3len)) {
+		SM2err(SM2_F_SM2_DECRYPT_RAW, SM2_R_DECRYPT_FAILURE);
+		OPENSSL_cleanse(out, len);
+		goto end;
+	}
+
+	*outlen = len;
+	ret = 1;
+
+end:
+	SM2_ENC_CTX_free(ctx);
+	return ret;
+}
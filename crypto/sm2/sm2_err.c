@@ -32,12 +32,32 @@ static ERR_STRING_DATA SM2_str_functs[] = {
      "SM2_cosigner2_generate_proof"},
     {ERR_FUNC(SM2_F_SM2_COSIGNER2_SETUP), "SM2_cosigner2_setup"},
     {ERR_FUNC(SM2_F_SM2_DECRYPT), "SM2_decrypt"},
+    {ERR_FUNC(SM2_F_SM2_DECRYPT_FINAL), "SM2_decrypt_final"},
+    {ERR_FUNC(SM2_F_SM2_DECRYPT_INIT), "SM2_decrypt_init"},
+    {ERR_FUNC(SM2_F_SM2_DECRYPT_RAW), "SM2_decrypt_raw"},
+    {ERR_FUNC(SM2_F_SM2_DECRYPT_UPDATE), "SM2_decrypt_update"},
     {ERR_FUNC(SM2_F_SM2_DO_DECRYPT), "SM2_do_decrypt"},
     {ERR_FUNC(SM2_F_SM2_DO_ENCRYPT), "SM2_do_encrypt"},
     {ERR_FUNC(SM2_F_SM2_DO_SIGN), "SM2_do_sign"},
     {ERR_FUNC(SM2_F_SM2_DO_VERIFY), "SM2_do_verify"},
     {ERR_FUNC(SM2_F_SM2_ENCRYPT), "SM2_encrypt"},
+    {ERR_FUNC(SM2_F_SM2_ENCRYPT_FINAL), "SM2_encrypt_final"},
+    {ERR_FUNC(SM2_F_SM2_ENCRYPT_INIT), "SM2_encrypt_init"},
+    {ERR_FUNC(SM2_F_SM2_ENCRYPT_RAW), "SM2_encrypt_raw"},
+    {ERR_FUNC(SM2_F_SM2_ENCRYPT_UPDATE), "SM2_encrypt_update"},
+    {ERR_FUNC(SM2_F_SM2_ENC_CTX_NEW), "SM2_ENC_CTX_new"},
+    {ERR_FUNC(SM2_F_SM2_ENC_CTX_XOR), "sm2_enc_ctx_xor"},
+    {ERR_FUNC(SM2_F_SM2_P256_SIGN), "SM2_P256_sign"},
+    {ERR_FUNC(SM2_F_SM2_P256_SIGN_EX), "SM2_P256_sign_ex"},
+    {ERR_FUNC(SM2_F_SM2_P256_SIGN_SETUP), "SM2_P256_sign_setup"},
+    {ERR_FUNC(SM2_F_SM2_P256_VERIFY), "SM2_P256_verify"},
+    {ERR_FUNC(SM2_F_SM2_PRESIGN_POOL_NEW), "SM2_PRESIGN_POOL_new"},
+    {ERR_FUNC(SM2_F_SM2_PRESIGN_POOL_REFILL), "SM2_PRESIGN_POOL_refill"},
+    {ERR_FUNC(SM2_F_SM2_SET_PRESIGN_POOL), "SM2_set_presign_pool"},
+    {ERR_FUNC(SM2_F_SM2_SET_VERIFY_CACHE_SIZE), "SM2_set_verify_cache_size"},
     {ERR_FUNC(SM2_F_SM2_SIGN_SETUP), "SM2_sign_setup"},
+    {ERR_FUNC(SM2_F_SM2_VERIFY_BATCH), "SM2_verify_batch"},
+    {ERR_FUNC(SM2_F_SM2_VERIFY_PRECOMPUTE), "SM2_verify_precompute"},
     {0, NULL}
 };
 
@@ -47,15 +67,19 @@ static ERR_STRING_DATA SM2_str_reasons[] = {
     {ERR_REASON(SM2_R_DECRYPT_FAILURE), "decrypt failure"},
     {ERR_REASON(SM2_R_ENCRYPT_FAILURE), "encrypt failure"},
     {ERR_REASON(SM2_R_INVALID_CIPHERTEXT), "invalid ciphertext"},
+    {ERR_REASON(SM2_R_INVALID_CIPHERTEXT_FORMAT),
+     "invalid ciphertext format"},
     {ERR_REASON(SM2_R_INVALID_DIGEST_ALGOR), "invalid digest algor"},
     {ERR_REASON(SM2_R_INVALID_EC_KEY), "invalid ec key"},
     {ERR_REASON(SM2_R_INVALID_INPUT_LENGTH), "invalid input length"},
     {ERR_REASON(SM2_R_INVALID_PLAINTEXT_LENGTH), "invalid plaintext length"},
+    {ERR_REASON(SM2_R_INVALID_PRIVATE_KEY), "invalid private key"},
     {ERR_REASON(SM2_R_INVALID_PUBLIC_KEY), "invalid public key"},
     {ERR_REASON(SM2_R_KDF_FAILURE), "kdf failure"},
     {ERR_REASON(SM2_R_MISSING_PARAMETERS), "missing parameters"},
     {ERR_REASON(SM2_R_NEED_NEW_SETUP_VALUES), "need new setup values"},
     {ERR_REASON(SM2_R_NOT_IMPLEMENTED), "not implemented"},
+    {ERR_REASON(SM2_R_NOT_INITIALIZED), "not initialized"},
     {ERR_REASON(SM2_R_PLAINTEXT_TOO_LONG), "plaintext too long"},
     {ERR_REASON(SM2_R_RANDOM_NUMBER_GENERATION_FAILED),
      "random number generation failed"},
@@ -47,6 +47,7 @@
  * ====================================================================
  */
 
+#include <limits.h>
 #include <string.h>
 #include <openssl/ec.h>
 #include <openssl/sm2.h>
@@ -165,124 +166,417 @@ void SM2_KAP_CTX_cleanup(SM2_KAP_CTX *ctx)
 		BN_free(ctx->two_pow_w);
 		BN_free(ctx->order);
 		EC_POINT_free(ctx->point);
-		BN_free(ctx->t);
+		BN_clear_free(ctx->t);
+		SM2_KAP_POOL_free(ctx->pool);
 		memset(ctx, 0, sizeof(*ctx));
 	}
 }
 
-/* FIXME: ephem_point_len should be both input and output */
-int SM2_KAP_prepare(SM2_KAP_CTX *ctx, unsigned char *ephem_point,
-	size_t *ephem_point_len)
+/* x = 2^w + (x and (2^w - 1)) = 2^w + (x mod 2^w) for the x of point */
+static int sm2_kap_x_bar(const EC_GROUP *group, const EC_POINT *point,
+	const BIGNUM *two_pow_w, BIGNUM *x, BN_CTX *bn_ctx)
 {
-	int ret = 0;
-	const BIGNUM *prikey;
-	BIGNUM *h = NULL;
-	BIGNUM *r = NULL;
-	BIGNUM *x = NULL;
-
-	if (!(prikey = EC_KEY_get0_private_key(ctx->ec_key))) {
-		ECerr(EC_F_SM2_KAP_PREPARE, EC_R_SM2_KAP_NOT_INITED);
-		return 0;
+	if (EC_METHOD_get_field_type(EC_GROUP_method_of(group)) == NID_X9_62_prime_field) {
+		if (!EC_POINT_get_affine_coordinates_GFp(group, point, x, NULL, bn_ctx)) {
+			return 0;
+		}
+	} else {
+		if (!EC_POINT_get_affine_coordinates_GF2m(group, point, x, NULL, bn_ctx)) {
+			return 0;
+		}
 	}
 
-	h = BN_new();
-	r = BN_new();
-	x = BN_new();
-
-	if (!h || !r || !x) {
-		ECerr(EC_F_SM2_KAP_PREPARE, 0);
-		goto end;
-	}
+	return BN_nnmod(x, x, two_pow_w, bn_ctx) && BN_add(x, x, two_pow_w);
+}
 
-	/*
-	 * r = rand(1, n)
-	 * R = rG = (x, y)
-	 */
+/* t = h * ((d + x * r) mod n) */
+static int sm2_kap_compute_t(const EC_GROUP *group, BIGNUM *t,
+	const BIGNUM *d, const BIGNUM *x, const BIGNUM *r, BN_CTX *bn_ctx)
+{
+	const BIGNUM *order = EC_GROUP_get0_order(group);
+	const BIGNUM *h = EC_GROUP_get0_cofactor(group);
 
-	do {
-		if (!BN_rand_range(r, ctx->order)) {
-			ECerr(EC_F_SM2_KAP_PREPARE, EC_R_RANDOM_NUMBER_GENERATION_FAILED);
-			goto end;
-		}
+	if (!BN_mod_mul(t, x, r, order, bn_ctx)
+		|| !BN_mod_add(t, t, d, order, bn_ctx)) {
+		return 0;
+	}
 
-	} while (BN_is_zero(r));
+	return BN_is_one(h) || BN_mul(t, t, h, bn_ctx);
+}
 
+/*
+ * U = t * (P + x * R) = t * P + (t * x) * R as one multi-scalar
+ * multiplication. With a cofactor t * x is not reduced mod n, R might have
+ * a small order component.
+ */
+static int sm2_kap_compute_point(const EC_GROUP *group, EC_POINT *U,
+	const BIGNUM *t, const EC_POINT *P, const BIGNUM *x, const EC_POINT *R,
+	BN_CTX *bn_ctx)
+{
+	int ret = 0;
+	const EC_POINT *points[2];
+	const BIGNUM *scalars[2];
+	BIGNUM *tx;
 
-	if (!EC_POINT_mul(ctx->group, ctx->point, r, NULL, NULL, ctx->bn_ctx)) {
-		ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_EC_LIB);
+	BN_CTX_start(bn_ctx);
+	if (!(tx = BN_CTX_get(bn_ctx))) {
 		goto end;
 	}
 
-
-	if (EC_METHOD_get_field_type(EC_GROUP_method_of(ctx->group)) == NID_X9_62_prime_field) {
-		if (!EC_POINT_get_affine_coordinates_GFp(ctx->group, ctx->point, x, NULL, ctx->bn_ctx)) {
-			ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_EC_LIB);
+	if (BN_is_one(EC_GROUP_get0_cofactor(group))) {
+		if (!BN_mod_mul(tx, t, x, EC_GROUP_get0_order(group), bn_ctx)) {
 			goto end;
 		}
 	} else {
-		if (!EC_POINT_get_affine_coordinates_GF2m(ctx->group, ctx->point, x, NULL, ctx->bn_ctx)) {
-			ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_EC_LIB);
+		if (!BN_mul(tx, t, x, bn_ctx)) {
 			goto end;
 		}
 	}
 
-	/*
-	 * w = ceil(keybits / 2) - 1
-	 * x = 2^w + (x and (2^w - 1)) = 2^w + (x mod 2^w)
-	 * t = (d + x * r) mod n
-	 * t = (h * t) mod n
-	 */
+	points[0] = P;
+	points[1] = R;
+	scalars[0] = t;
+	scalars[1] = tx;
+	ret = EC_POINTs_mul(group, U, NULL, 2, points, scalars, bn_ctx);
 
-	if (!ctx->t) {
-		ECerr(EC_F_SM2_KAP_PREPARE, EC_R_SM2_KAP_NOT_INITED);
-		goto end;
+end:
+	BN_CTX_end(bn_ctx);
+	return ret;
+}
+
+static void sm2_kap_ephem_free(SM2_KAP_EPHEM *ephem)
+{
+	if (ephem) {
+		BN_clear_free(ephem->r);
+		BN_free(ephem->x);
+		OPENSSL_free(ephem);
 	}
+}
 
-	if (!BN_nnmod(x, x, ctx->two_pow_w, ctx->bn_ctx)) {
-		ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_BN_LIB);
-		goto end;
+SM2_KAP_POOL *SM2_KAP_POOL_new(const EC_GROUP *group, size_t max)
+{
+	SM2_KAP_POOL *ret = NULL;
+	int w;
+
+	if (!group) {
+		ECerr(EC_F_SM2_KAP_POOL_NEW, ERR_R_PASSED_NULL_PARAMETER);
+		return NULL;
+	}
+	if (!max || max > INT_MAX) {
+		ECerr(EC_F_SM2_KAP_POOL_NEW, EC_R_INVALID_ARGUMENT);
+		return NULL;
 	}
 
-	if (!BN_add(x, x, ctx->two_pow_w)) {
-		ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_BN_LIB);
+	if (!(ret = OPENSSL_zalloc(sizeof(*ret)))
+		|| !(ret->ephems = OPENSSL_zalloc(sizeof(*ret->ephems) * max))
+		|| !(ret->lock = CRYPTO_THREAD_lock_new())) {
+		ECerr(EC_F_SM2_KAP_POOL_NEW, ERR_R_MALLOC_FAILURE);
 		goto end;
 	}
+	ret->max = max;
+	ret->references = 1;
 
-	if (!BN_mod_mul(ctx->t, x, r, ctx->order, ctx->bn_ctx)) {
-		ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_BN_LIB);
+	if (!(ret->group = EC_GROUP_dup(group))) {
+		ECerr(EC_F_SM2_KAP_POOL_NEW, ERR_R_EC_LIB);
 		goto end;
 	}
 
-	if (!BN_mod_add(ctx->t, ctx->t, prikey, ctx->order, ctx->bn_ctx)) {
-		ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_BN_LIB);
+	/* 2^w with w = ceil(keybits / 2) - 1 */
+	w = (BN_num_bits(EC_GROUP_get0_order(group)) + 1)/2 - 1;
+	if (!(ret->two_pow_w = BN_new()) || !BN_set_bit(ret->two_pow_w, w)) {
+		ECerr(EC_F_SM2_KAP_POOL_NEW, ERR_R_BN_LIB);
 		goto end;
 	}
 
-	if (!EC_GROUP_get_cofactor(ctx->group, h, ctx->bn_ctx)) {
-		ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_EC_LIB);
+	return ret;
+
+end:
+	SM2_KAP_POOL_free(ret);
+	return NULL;
+}
+
+int SM2_KAP_POOL_up_ref(SM2_KAP_POOL *pool)
+{
+	int i;
+
+	if (CRYPTO_atomic_add(&pool->references, 1, &i, pool->lock) <= 0) {
+		return 0;
+	}
+	return i > 1 ? 1 : 0;
+}
+
+void SM2_KAP_POOL_free(SM2_KAP_POOL *pool)
+{
+	size_t i;
+	int n;
+
+	if (!pool) {
+		return;
+	}
+	if (pool->lock) {
+		CRYPTO_atomic_add(&pool->references, -1, &n, pool->lock);
+		if (n > 0) {
+			return;
+		}
+	}
+
+	for (i = 0; i < pool->num; i++) {
+		sm2_kap_ephem_free(pool->ephems[i]);
+	}
+	OPENSSL_free(pool->ephems);
+	EC_GROUP_free(pool->group);
+	BN_free(pool->two_pow_w);
+	CRYPTO_THREAD_lock_free(pool->lock);
+	OPENSSL_free(pool);
+}
+
+/*
+ * The pool is filled SM2_KAP_POOL_BATCH pairs at a time without holding
+ * its lock. The points of a batch are made affine together with a single
+ * field inversion, so the encoding and x_bar come almost for free.
+ */
+#define SM2_KAP_POOL_BATCH	16
+
+int SM2_KAP_POOL_refill(SM2_KAP_POOL *pool)
+{
+	int ret = 0;
+	const BIGNUM *order;
+	BN_CTX *bn_ctx = NULL;
+	SM2_KAP_EPHEM *ephems[SM2_KAP_POOL_BATCH];
+	EC_POINT *points[SM2_KAP_POOL_BATCH];
+	size_t need, n, i;
+
+	if (!pool) {
+		ECerr(EC_F_SM2_KAP_POOL_REFILL, ERR_R_PASSED_NULL_PARAMETER);
+		return 0;
+	}
+
+	memset(ephems, 0, sizeof(ephems));
+	memset(points, 0, sizeof(points));
+	order = EC_GROUP_get0_order(pool->group);
+
+	if (!(bn_ctx = BN_CTX_new())) {
+		ECerr(EC_F_SM2_KAP_POOL_REFILL, ERR_R_MALLOC_FAILURE);
 		goto end;
 	}
+	for (i = 0; i < SM2_KAP_POOL_BATCH; i++) {
+		if (!(points[i] = EC_POINT_new(pool->group))) {
+			ECerr(EC_F_SM2_KAP_POOL_REFILL, ERR_R_EC_LIB);
+			goto end;
+		}
+	}
 
-	if (!BN_mul(ctx->t, ctx->t, h, ctx->bn_ctx)) {
-		ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_BN_LIB);
+	/* pairs taken out meanwhile are left to the next refill */
+	if (!CRYPTO_THREAD_read_lock(pool->lock)) {
 		goto end;
 	}
+	need = pool->max - pool->num;
+	CRYPTO_THREAD_unlock(pool->lock);
+
+	for (; need; need -= n) {
+		n = need < SM2_KAP_POOL_BATCH ? need : SM2_KAP_POOL_BATCH;
+
+		for (i = 0; i < n; i++) {
+			if (!(ephems[i] = OPENSSL_zalloc(sizeof(*ephems[i])))
+				|| !(ephems[i]->r = BN_new())
+				|| !(ephems[i]->x = BN_new())) {
+				ECerr(EC_F_SM2_KAP_POOL_REFILL, ERR_R_MALLOC_FAILURE);
+				goto end;
+			}
+			do {
+				if (!BN_rand_range(ephems[i]->r, order)) {
+					ECerr(EC_F_SM2_KAP_POOL_REFILL,
+						EC_R_RANDOM_NUMBER_GENERATION_FAILED);
+					goto end;
+				}
+			} while (BN_is_zero(ephems[i]->r));
+
+			if (!EC_POINT_mul(pool->group, points[i], ephems[i]->r,
+				NULL, NULL, bn_ctx)) {
+				ECerr(EC_F_SM2_KAP_POOL_REFILL, ERR_R_EC_LIB);
+				goto end;
+			}
+		}
+
+		if (!EC_POINTs_make_affine(pool->group, n, points, bn_ctx)) {
+			ECerr(EC_F_SM2_KAP_POOL_REFILL, ERR_R_EC_LIB);
+			goto end;
+		}
+
+		for (i = 0; i < n; i++) {
+			if (!(ephems[i]->pointlen = EC_POINT_point2oct(pool->group,
+				points[i], POINT_CONVERSION_UNCOMPRESSED,
+				ephems[i]->point, sizeof(ephems[i]->point), bn_ctx))
+				|| !sm2_kap_x_bar(pool->group, points[i],
+					pool->two_pow_w, ephems[i]->x, bn_ctx)) {
+				ECerr(EC_F_SM2_KAP_POOL_REFILL, ERR_R_EC_LIB);
+				goto end;
+			}
+		}
 
-	/* encode R = (x, y) for output and local buffer */
+		if (!CRYPTO_THREAD_write_lock(pool->lock)) {
+			goto end;
+		}
+		for (i = 0; i < n && pool->num < pool->max; i++) {
+			pool->ephems[pool->num++] = ephems[i];
+			ephems[i] = NULL;
+		}
+		CRYPTO_THREAD_unlock(pool->lock);
 
-	// FIXME: ret is size_t and ret is the output length
-	ret = EC_POINT_point2oct(ctx->group, ctx->point, ctx->point_form,
-		ephem_point, *ephem_point_len, ctx->bn_ctx);
+		/* another refill got there first */
+		for (i = 0; i < n; i++) {
+			sm2_kap_ephem_free(ephems[i]);
+			ephems[i] = NULL;
+		}
+	}
 
-	memcpy(ctx->pt_buf, ephem_point, ret);
-	*ephem_point_len = ret;
 	ret = 1;
 
 end:
-	if (h) BN_free(h);
-	if (r) BN_free(r);
-	if (x) BN_free(x);
+	for (i = 0; i < SM2_KAP_POOL_BATCH; i++) {
+		sm2_kap_ephem_free(ephems[i]);
+		EC_POINT_free(points[i]);
+	}
+	BN_CTX_free(bn_ctx);
+	return ret;
+}
+
+size_t SM2_KAP_POOL_num(SM2_KAP_POOL *pool)
+{
+	size_t ret;
 
+	if (!pool || !CRYPTO_THREAD_read_lock(pool->lock)) {
+		return 0;
+	}
+	ret = pool->num;
+	CRYPTO_THREAD_unlock(pool->lock);
+	return ret;
+}
+
+static SM2_KAP_EPHEM *sm2_kap_pool_pop(SM2_KAP_POOL *pool)
+{
+	SM2_KAP_EPHEM *ret = NULL;
+
+	if (!CRYPTO_THREAD_write_lock(pool->lock)) {
+		return NULL;
+	}
+	if (pool->num) {
+		ret = pool->ephems[--pool->num];
+		pool->ephems[pool->num] = NULL;
+	}
+	CRYPTO_THREAD_unlock(pool->lock);
+	return ret;
+}
+
+int SM2_KAP_CTX_set_pool(SM2_KAP_CTX *ctx, SM2_KAP_POOL *pool)
+{
+	if (!ctx || !ctx->group) {
+		ECerr(EC_F_SM2_KAP_CTX_SET_POOL, EC_R_SM2_KAP_NOT_INITED);
+		return 0;
+	}
+	if (pool && EC_GROUP_cmp(pool->group, ctx->group, NULL) != 0) {
+		ECerr(EC_F_SM2_KAP_CTX_SET_POOL, EC_R_INCOMPATIBLE_OBJECTS);
+		return 0;
+	}
+
+	if (pool && !SM2_KAP_POOL_up_ref(pool)) {
+		ECerr(EC_F_SM2_KAP_CTX_SET_POOL, ERR_R_INTERNAL_ERROR);
+		return 0;
+	}
+	SM2_KAP_POOL_free(ctx->pool);
+	ctx->pool = pool;
+	return 1;
+}
+
+int SM2_KAP_prepare(SM2_KAP_CTX *ctx, unsigned char *ephem_point,
+	size_t *ephem_point_len)
+{
+	int ret = 0;
+	const BIGNUM *prikey;
+	SM2_KAP_EPHEM *ephem = NULL;
+	BIGNUM *r = NULL;
+	BIGNUM *x = NULL;
+	size_t len;
+
+	if (!(prikey = EC_KEY_get0_private_key(ctx->ec_key)) || !ctx->t) {
+		ECerr(EC_F_SM2_KAP_PREPARE, EC_R_SM2_KAP_NOT_INITED);
+		return 0;
+	}
+
+	/*
+	 * r = rand(1, n)
+	 * R = rG = (x, y)
+	 * x = 2^w + (x and (2^w - 1)) = 2^w + (x mod 2^w)
+	 *
+	 * all three are taken from the pool unless it is empty
+	 */
+
+	if (ctx->pool && ctx->point_form == POINT_CONVERSION_UNCOMPRESSED
+		&& (ephem = sm2_kap_pool_pop(ctx->pool))) {
+
+		r = ephem->r;
+		x = ephem->x;
+		if ((len = ephem->pointlen) > *ephem_point_len) {
+			ECerr(EC_F_SM2_KAP_PREPARE, EC_R_BUFFER_TOO_SMALL);
+			goto end;
+		}
+		memcpy(ephem_point, ephem->point, len);
+
+	} else {
+
+		r = BN_new();
+		x = BN_new();
+		if (!r || !x) {
+			ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_MALLOC_FAILURE);
+			goto end;
+		}
+
+		do {
+			if (!BN_rand_range(r, ctx->order)) {
+				ECerr(EC_F_SM2_KAP_PREPARE, EC_R_RANDOM_NUMBER_GENERATION_FAILED);
+				goto end;
+			}
+		} while (BN_is_zero(r));
+
+		if (!EC_POINT_mul(ctx->group, ctx->point, r, NULL, NULL, ctx->bn_ctx)) {
+			ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_EC_LIB);
+			goto end;
+		}
+
+		if (!(len = EC_POINT_point2oct(ctx->group, ctx->point, ctx->point_form,
+			ephem_point, *ephem_point_len, ctx->bn_ctx))) {
+			ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_EC_LIB);
+			goto end;
+		}
+
+		if (!sm2_kap_x_bar(ctx->group, ctx->point, ctx->two_pow_w, x, ctx->bn_ctx)) {
+			ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_EC_LIB);
+			goto end;
+		}
+	}
+
+	/*
+	 * t = (d + x * r) mod n
+	 * t = (h * t) mod n
+	 */
+
+	if (!sm2_kap_compute_t(ctx->group, ctx->t, prikey, x, r, ctx->bn_ctx)) {
+		ECerr(EC_F_SM2_KAP_PREPARE, ERR_R_BN_LIB);
+		goto end;
+	}
+
+	/* keep the encoded R = (x, y) for the checksum */
+	memcpy(ctx->pt_buf, ephem_point, len);
+	*ephem_point_len = len;
+	ret = 1;
+
+end:
+	if (ephem) {
+		sm2_kap_ephem_free(ephem);
+	} else {
+		BN_clear_free(r);
+		BN_free(x);
+	}
 	return ret;
 }
 
@@ -294,6 +588,7 @@ int SM2_KAP_compute_key(SM2_KAP_CTX *ctx, const unsigned char *remote_point,
 
 	EVP_MD_CTX *md_ctx = NULL;
 	BIGNUM *x = NULL;
+	EC_POINT *point = NULL;
 	unsigned char share_pt_buf[1 + (OPENSSL_ECC_MAX_FIELD_BITS+7)/4 + EVP_MAX_MD_SIZE * 2 + 100];
 	unsigned char remote_pt_buf[1 + (OPENSSL_ECC_MAX_FIELD_BITS+7)/4 + 111];
 	unsigned char dgst[EVP_MAX_MD_SIZE];
@@ -303,7 +598,8 @@ int SM2_KAP_compute_key(SM2_KAP_CTX *ctx, const unsigned char *remote_point,
 
 	md_ctx = EVP_MD_CTX_new();
 	x = BN_new();
-	if (!md_ctx || !x) {
+	point = EC_POINT_new(ctx->group);
+	if (!md_ctx || !x || !point) {
 		ECerr(EC_F_SM2_KAP_COMPUTE_KEY, 0);
 		goto end;
 	}
@@ -327,63 +623,30 @@ int SM2_KAP_compute_key(SM2_KAP_CTX *ctx, const unsigned char *remote_point,
 		goto end;
 	}
 
-	if (EC_METHOD_get_field_type(EC_GROUP_method_of(ctx->group)) == NID_X9_62_prime_field) {
-		if (!EC_POINT_get_affine_coordinates_GFp(ctx->group, ctx->point, x, NULL, ctx->bn_ctx)) {
-			ECerr(EC_F_SM2_KAP_COMPUTE_KEY, ERR_R_EC_LIB);
-			goto end;
-		}
-	} else {
-		if (!EC_POINT_get_affine_coordinates_GF2m(ctx->group, ctx->point, x, NULL, ctx->bn_ctx)) {
-			ECerr(EC_F_SM2_KAP_COMPUTE_KEY, ERR_R_EC_LIB);
-			goto end;
-		}
-	}
-
 	/* x = 2^w + (x and (2^w - 1)) = 2^w + (x mod 2^w) */
 
-	if (!BN_nnmod(x, x, ctx->two_pow_w, ctx->bn_ctx)) {
-		ECerr(EC_F_SM2_KAP_COMPUTE_KEY, ERR_R_BN_LIB);
-		goto end;
-	}
-
-	if (!BN_add(x, x, ctx->two_pow_w)) {
-		ECerr(EC_F_SM2_KAP_COMPUTE_KEY, ERR_R_BN_LIB);
-		goto end;
-	}
-
-	/*
-	if (!BN_mod_mul(x, x, ctx->t, ctx->order, ctx->bn_ctx)) {
-		ECerr(EC_F_SM2_KAP_COMPUTE_KEY, ERR_R_BN_LIB);
-		goto end;
-	}
-	*/
-
-	/* U = ht * (P + x * R), check U != O */
-
-	if (!EC_POINT_mul(ctx->group, ctx->point, NULL, ctx->point, x, ctx->bn_ctx)) {
+	if (!sm2_kap_x_bar(ctx->group, ctx->point, ctx->two_pow_w, x, ctx->bn_ctx)) {
 		ECerr(EC_F_SM2_KAP_COMPUTE_KEY, ERR_R_EC_LIB);
 		goto end;
 	}
 
-	if (!EC_POINT_add(ctx->group, ctx->point, ctx->point,
-		EC_KEY_get0_public_key(ctx->remote_pubkey), ctx->bn_ctx)) {
-		ECerr(EC_F_SM2_KAP_COMPUTE_KEY, ERR_R_EC_LIB);
-		goto end;
-	}
+	/* U = ht * (P + x * R), check U != O */
 
-	if (!EC_POINT_mul(ctx->group, ctx->point, NULL, ctx->point, ctx->t, ctx->bn_ctx)) {
+	if (!sm2_kap_compute_point(ctx->group, point, ctx->t,
+		EC_KEY_get0_public_key(ctx->remote_pubkey), x, ctx->point,
+		ctx->bn_ctx)) {
 		ECerr(EC_F_SM2_KAP_COMPUTE_KEY, ERR_R_EC_LIB);
 		goto end;
 	}
 
-	if (EC_POINT_is_at_infinity(ctx->group, ctx->point)) {
-		ECerr(EC_F_SM2_KAP_COMPUTE_KEY, 0);
+	if (EC_POINT_is_at_infinity(ctx->group, point)) {
+		ECerr(EC_F_SM2_KAP_COMPUTE_KEY, EC_R_POINT_AT_INFINITY);
 		goto end;
 	}
 
 	/* encode U, append with ZA, ZB */
 
-	if (!(len = EC_POINT_point2oct(ctx->group, ctx->point, POINT_CONVERSION_UNCOMPRESSED,
+	if (!(len = EC_POINT_point2oct(ctx->group, point, POINT_CONVERSION_UNCOMPRESSED,
 		share_pt_buf, sizeof(share_pt_buf), ctx->bn_ctx))) {
 		ECerr(EC_F_SM2_KAP_COMPUTE_KEY, 0);
 		goto end;
@@ -556,6 +819,7 @@ int SM2_KAP_compute_key(SM2_KAP_CTX *ctx, const unsigned char *remote_point,
 end:
 	EVP_MD_CTX_free(md_ctx);
 	BN_free(x);
+	EC_POINT_free(point);
 	return ret;
 }
 
@@ -581,18 +845,118 @@ int SM2_compute_share_key(unsigned char *out, size_t *outlen,
 	const EC_POINT *peer_pk, const unsigned char *peer_z, size_t peer_zlen,
 	const unsigned char *z, size_t zlen, EC_KEY *sk, int initiator)
 {
-	(void)out;
-	(void)outlen;
-	(void)peer_ephem;
-	(void)ephem;
-	(void)peer_pk;
-	(void)peer_z;
-	(void)peer_zlen;
-	(void)z;
-	(void)zlen;
-	(void)sk;
-	(void)initiator;
-
-	ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, EC_R_NOT_IMPLEMENTED);
-	return 0;
+	int ret = 0;
+	const EC_GROUP *group;
+	const BIGNUM *d;
+	const BIGNUM *r;
+	BN_CTX *bn_ctx = NULL;
+	BIGNUM *two_pow_w;
+	BIGNUM *x;
+	BIGNUM *t;
+	EC_POINT *point = NULL;
+	KDF_FUNC kdf;
+	unsigned char buf[1 + (OPENSSL_ECC_MAX_FIELD_BITS+7)/4 + EVP_MAX_MD_SIZE * 2];
+	size_t len;
+	int w;
+
+	if (!out || !outlen || !peer_ephem || !ephem || !peer_pk
+		|| !peer_z || !z || !sk) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, ERR_R_PASSED_NULL_PARAMETER);
+		return 0;
+	}
+	if (peer_zlen > EVP_MAX_MD_SIZE || zlen > EVP_MAX_MD_SIZE) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, EC_R_INVALID_ARGUMENT);
+		return 0;
+	}
+	if (!(group = EC_KEY_get0_group(sk))
+		|| !(d = EC_KEY_get0_private_key(sk))
+		|| !(r = EC_KEY_get0_private_key(ephem))
+		|| !EC_KEY_get0_public_key(ephem)) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, EC_R_MISSING_PRIVATE_KEY);
+		return 0;
+	}
+	if (EC_GROUP_cmp(group, EC_KEY_get0_group(ephem), NULL) != 0) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, EC_R_INCOMPATIBLE_OBJECTS);
+		return 0;
+	}
+
+	if (!(bn_ctx = BN_CTX_new())) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+	BN_CTX_start(bn_ctx);
+	if (!(point = EC_POINT_new(group))) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+	two_pow_w = BN_CTX_get(bn_ctx);
+	x = BN_CTX_get(bn_ctx);
+	if (!(t = BN_CTX_get(bn_ctx))) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+
+	w = (BN_num_bits(EC_GROUP_get0_order(group)) + 1)/2 - 1;
+	if (!BN_set_bit(two_pow_w, w)) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, ERR_R_BN_LIB);
+		goto end;
+	}
+
+	/* t = h * ((d + x1 * r) mod n) with x1 of our ephemeral point */
+	if (!sm2_kap_x_bar(group, EC_KEY_get0_public_key(ephem), two_pow_w,
+			x, bn_ctx)
+		|| !sm2_kap_compute_t(group, t, d, x, r, bn_ctx)) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, ERR_R_EC_LIB);
+		goto end;
+	}
+
+	/* U = t * (P + x2 * R) with x2 of the peer's ephemeral point R */
+	if (!sm2_kap_x_bar(group, peer_ephem, two_pow_w, x, bn_ctx)
+		|| !sm2_kap_compute_point(group, point, t, peer_pk, x, peer_ephem,
+			bn_ctx)) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, ERR_R_EC_LIB);
+		goto end;
+	}
+	if (EC_POINT_is_at_infinity(group, point)) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, EC_R_POINT_AT_INFINITY);
+		goto end;
+	}
+
+	/* out = KDF(xU || yU || ZA || ZB), ZA is the initiator's */
+	if (!(len = EC_POINT_point2oct(group, point, POINT_CONVERSION_UNCOMPRESSED,
+		buf, sizeof(buf) - EVP_MAX_MD_SIZE * 2, bn_ctx))) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, ERR_R_EC_LIB);
+		goto end;
+	}
+	if (initiator) {
+		memcpy(buf + len, z, zlen);
+		len += zlen;
+		memcpy(buf + len, peer_z, peer_zlen);
+		len += peer_zlen;
+	} else {
+		memcpy(buf + len, peer_z, peer_zlen);
+		len += peer_zlen;
+		memcpy(buf + len, z, zlen);
+		len += zlen;
+	}
+
+	if (!(kdf = KDF_get_x9_63(EVP_sm3()))) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, EC_R_INVALID_KDF_MD);
+		goto end;
+	}
+	if (!kdf(buf + 1, len - 1, out, outlen)) {
+		ECerr(EC_F_SM2_COMPUTE_SHARE_KEY, EC_R_KDF_PARAMETER_ERROR);
+		goto end;
+	}
+
+	ret = 1;
+
+end:
+	OPENSSL_cleanse(buf, sizeof(buf));
+	if (bn_ctx) {
+		BN_CTX_end(bn_ctx);
+	}
+	BN_CTX_free(bn_ctx);
+	EC_POINT_free(point);
+	return ret;
 }
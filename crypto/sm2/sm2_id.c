@@ -59,10 +59,205 @@
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 #include <openssl/x509.h>
+#ifndef OPENSSL_NO_SM3
+# include <openssl/sm3.h>
+#endif
 #include "sm2_lcl.h"
 
 #define EC_MAX_NBYTES  ((OPENSSL_ECC_MAX_FIELD_BITS + 7)/8)
 
+/*
+ * Z values are kept on the EC_KEY for the last few (public key, ID, digest)
+ * combinations it was used with, IDs longer than SM2_ID_DIGEST_CACHE_MAX_ID
+ * are not cached. The public key is kept to notice when it is changed.
+ */
+#define SM2_ID_DIGEST_CACHE_SIZE	4
+#define SM2_ID_DIGEST_CACHE_MAX_ID	64
+
+typedef struct {
+	int md_type;
+	size_t idlen;
+	char id[SM2_ID_DIGEST_CACHE_MAX_ID];
+	EC_POINT *pub_key;
+	unsigned char z[EVP_MAX_MD_SIZE];
+	size_t zlen;
+} SM2_ID_DIGEST;
+
+typedef struct {
+	SM2_ID_DIGEST entries[SM2_ID_DIGEST_CACHE_SIZE];
+	int next;
+} SM2_ID_DIGEST_CACHE;
+
+static CRYPTO_ONCE sm2_id_digest_once = CRYPTO_ONCE_STATIC_INIT;
+static int sm2_id_digest_idx = -1;
+static CRYPTO_RWLOCK *sm2_id_digest_lock = NULL;
+
+static void sm2_id_digest_cache_free(SM2_ID_DIGEST_CACHE *cache)
+{
+	int i;
+
+	if (!cache) {
+		return;
+	}
+	for (i = 0; i < SM2_ID_DIGEST_CACHE_SIZE; i++) {
+		EC_POINT_free(cache->entries[i].pub_key);
+	}
+	OPENSSL_free(cache);
+}
+
+/* an EC_KEY_dup() starts with an empty cache */
+static int sm2_id_digest_dup(CRYPTO_EX_DATA *to, const CRYPTO_EX_DATA *from,
+	void *srcp, int idx, long argl, void *argp)
+{
+	*(void **)srcp = NULL;
+
+	(void)to;
+	(void)from;
+	(void)idx;
+	(void)argl;
+	(void)argp;
+	return 1;
+}
+
+static void sm2_id_digest_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad,
+	int idx, long argl, void *argp)
+{
+	sm2_id_digest_cache_free(ptr);
+
+	(void)parent;
+	(void)ad;
+	(void)idx;
+	(void)argl;
+	(void)argp;
+}
+
+static void sm2_id_digest_cleanup(void)
+{
+	sm2_id_digest_idx = -1;
+	CRYPTO_THREAD_lock_free(sm2_id_digest_lock);
+	sm2_id_digest_lock = NULL;
+}
+
+static void sm2_id_digest_init(void)
+{
+	if (!(sm2_id_digest_lock = CRYPTO_THREAD_lock_new())) {
+		return;
+	}
+	if ((sm2_id_digest_idx = EC_KEY_get_ex_new_index(0, NULL, NULL,
+		sm2_id_digest_dup, sm2_id_digest_free)) < 0
+		|| !OPENSSL_atexit(sm2_id_digest_cleanup)) {
+		sm2_id_digest_idx = -1;
+		sm2_id_digest_cleanup();
+	}
+}
+
+/* returns one and sets out to the cached Z value if there is one */
+static int sm2_id_digest_lookup(EC_KEY *ec_key, int md_type,
+	const char *id, size_t idlen, unsigned char *out, size_t *outlen)
+{
+	const EC_GROUP *group = EC_KEY_get0_group(ec_key);
+	const EC_POINT *pub_key = EC_KEY_get0_public_key(ec_key);
+	SM2_ID_DIGEST_CACHE *cache;
+	SM2_ID_DIGEST *a;
+	int i, ret = 0;
+
+	if (idlen > SM2_ID_DIGEST_CACHE_MAX_ID || !group || !pub_key
+		|| !CRYPTO_THREAD_run_once(&sm2_id_digest_once, sm2_id_digest_init)
+		|| sm2_id_digest_idx < 0
+		|| !CRYPTO_THREAD_read_lock(sm2_id_digest_lock)) {
+		return 0;
+	}
+
+	if ((cache = EC_KEY_get_ex_data(ec_key, sm2_id_digest_idx))) {
+		for (i = 0; i < SM2_ID_DIGEST_CACHE_SIZE; i++) {
+			a = &cache->entries[i];
+			if (a->pub_key && a->md_type == md_type && a->idlen == idlen
+				&& !memcmp(a->id, id, idlen)
+				&& EC_POINT_cmp(group, a->pub_key, pub_key, NULL) == 0) {
+				memcpy(out, a->z, a->zlen);
+				*outlen = a->zlen;
+				ret = 1;
+				break;
+			}
+		}
+	}
+
+	CRYPTO_THREAD_unlock(sm2_id_digest_lock);
+	return ret;
+}
+
+/* remember the Z value, replacing the oldest one if all entries are used */
+static void sm2_id_digest_store(EC_KEY *ec_key, int md_type,
+	const char *id, size_t idlen, const unsigned char *z, size_t zlen)
+{
+	const EC_GROUP *group = EC_KEY_get0_group(ec_key);
+	const EC_POINT *pub_key = EC_KEY_get0_public_key(ec_key);
+	SM2_ID_DIGEST_CACHE *cache;
+	SM2_ID_DIGEST *a;
+	EC_POINT *point;
+
+	if (idlen > SM2_ID_DIGEST_CACHE_MAX_ID || sm2_id_digest_idx < 0
+		|| !(point = EC_POINT_dup(pub_key, group))) {
+		return;
+	}
+	if (!CRYPTO_THREAD_write_lock(sm2_id_digest_lock)) {
+		EC_POINT_free(point);
+		return;
+	}
+
+	if (!(cache = EC_KEY_get_ex_data(ec_key, sm2_id_digest_idx))) {
+		if (!(cache = OPENSSL_zalloc(sizeof(*cache)))
+			|| !EC_KEY_set_ex_data(ec_key, sm2_id_digest_idx, cache)) {
+			OPENSSL_free(cache);
+			EC_POINT_free(point);
+			goto end;
+		}
+	}
+
+	a = &cache->entries[cache->next];
+	cache->next = (cache->next + 1) % SM2_ID_DIGEST_CACHE_SIZE;
+	EC_POINT_free(a->pub_key);
+	a->pub_key = point;
+	a->md_type = md_type;
+	a->idlen = idlen;
+	memcpy(a->id, id, idlen);
+	memcpy(a->z, z, zlen);
+	a->zlen = zlen;
+
+end:
+	CRYPTO_THREAD_unlock(sm2_id_digest_lock);
+}
+
+#ifndef OPENSSL_NO_SM3
+/*
+ * sm3_compute_id_digest() knows the curve parameters of sm2p256v1 and
+ * starts from a fixed SM3 state for the default ID.
+ */
+static int sm2_p256_compute_id_digest(const char *id, unsigned char out[32],
+	EC_KEY *ec_key)
+{
+	int ret = 0;
+	BIGNUM *x = NULL;
+	BIGNUM *y = NULL;
+	unsigned char xy[64];
+
+	if (!(x = BN_new()) || !(y = BN_new())
+		|| !EC_POINT_get_affine_coordinates_GFp(EC_KEY_get0_group(ec_key),
+			EC_KEY_get0_public_key(ec_key), x, y, NULL)
+		|| BN_bn2binpad(x, xy, 32) != 32
+		|| BN_bn2binpad(y, xy + 32, 32) != 32) {
+		goto end;
+	}
+	sm3_compute_id_digest(out, id, xy, xy + 32);
+	ret = 1;
+
+end:
+	BN_free(x);
+	BN_free(y);
+	return ret;
+}
+#endif
+
 
 int SM2_get_public_key_data(EC_KEY *ec_key, unsigned char *out, size_t *outlen)
 {
@@ -236,6 +431,26 @@ int SM2_compute_id_digest(const EVP_MD *md, const char *id, size_t idlen,
 		return 0;
 	}
 
+	if (sm2_id_digest_lookup(ec_key, EVP_MD_type(md), id, idlen,
+		out, outlen)) {
+		return 1;
+	}
+
+#ifndef OPENSSL_NO_SM3
+	if (EVP_MD_type(md) == NID_sm3 && EC_KEY_get0_group(ec_key)
+		&& EC_GROUP_get_curve_name(EC_KEY_get0_group(ec_key))
+			== NID_sm2p256v1
+		&& EC_KEY_get0_public_key(ec_key)) {
+		if (!sm2_p256_compute_id_digest(id, out, ec_key)) {
+			ECerr(EC_F_SM2_COMPUTE_ID_DIGEST,
+				EC_R_GET_PUBLIC_KEY_DATA_FAILURE);
+			return 0;
+		}
+		*outlen = SM3_DIGEST_LENGTH;
+		sm2_id_digest_store(ec_key, NID_sm3, id, idlen, out, *outlen);
+		return 1;
+	}
+#endif
 
 	/* get public key data from ec_key */
 	size = sizeof(pkdata);
@@ -261,6 +476,7 @@ int SM2_compute_id_digest(const EVP_MD *md, const char *id, size_t idlen,
 	}
 
 	*outlen = len;
+	sm2_id_digest_store(ec_key, EVP_MD_type(md), id, idlen, out, len);
 	ret = 1;
 
 end:
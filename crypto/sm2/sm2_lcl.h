@@ -58,6 +58,53 @@
 
 int SM2_get_public_key_data(EC_KEY *ec_key, unsigned char *out, size_t *outlen);
 
+#ifdef ECP_SM2Z256_SM2
+/* sm2p256v1 signature on 64-bit words, needs ../ec/ec_lcl.h first */
+void sm2_p256_bin2words(BN_ULONG a[4], const unsigned char *in, size_t inlen);
+void sm2_p256_words2bin(unsigned char out[32], const BN_ULONG a[4]);
+int sm2_p256_sign_words(BN_ULONG r[4], BN_ULONG s[4], const BN_ULONG e[4],
+	const BN_ULONG dinv[4]);
+size_t sm2_p256_sig2der(unsigned char *out, const BN_ULONG r[4],
+	const BN_ULONG s[4]);
+int sm2_p256_der2sig(BN_ULONG r[4], BN_ULONG s[4],
+	const unsigned char *in, size_t inlen);
+int sm2_p256_verify_batch(const unsigned char **dgsts, const int *dgstlens,
+	const unsigned char **sigs, const int *siglens, EC_KEY **ec_keys,
+	size_t num, int *ok);
+SM2Z256_VERIFY_TABLE *sm2_p256_get_verify_table(EC_KEY *ec_key,
+	const BN_ULONG x[4], const BN_ULONG y[4], size_t uses);
+#endif
+
+#define SM2_PRESIGN_MAX_BYTES	((OPENSSL_ECC_MAX_FIELD_BITS + 7)/8 + 1)
+
+/* slot states of a SM2_PRESIGN_POOL */
+#define SM2_PRESIGN_EMPTY	0
+#define SM2_PRESIGN_FULL	1
+#define SM2_PRESIGN_BUSY	2	/* being written or read */
+
+/* nonce k and x = (kG).x mod n, big-endian of the length of the order */
+typedef struct {
+	int state;
+	unsigned char k[SM2_PRESIGN_MAX_BYTES];
+	unsigned char x[SM2_PRESIGN_MAX_BYTES];
+} SM2_PRESIGN;
+
+struct sm2_presign_pool_st {
+	EC_GROUP *group;
+	unsigned char order[SM2_PRESIGN_MAX_BYTES];
+	unsigned char mask;	/* of the top byte of k */
+	size_t nbytes;
+	SM2_PRESIGN *slots;
+	int max;
+	int avail;	/* full slots not yet claimed by a pop */
+	int references;
+	CRYPTO_RWLOCK *lock;
+};
+
+SM2_PRESIGN_POOL *sm2_get_presign_pool(EC_KEY *ec_key);
+int sm2_presign_pop(SM2_PRESIGN_POOL *pool, unsigned char *k,
+	unsigned char *x);
+
 struct SM2CiphertextValue_st {
 	BIGNUM *xCoordinate;
 	BIGNUM *yCoordinate;
@@ -65,6 +112,44 @@ struct SM2CiphertextValue_st {
 	ASN1_OCTET_STRING *ciphertext;
 };
 
+#define SM2_ENC_STATE_NONE	0
+#define SM2_ENC_STATE_ENCRYPT	1
+#define SM2_ENC_STATE_DECRYPT	2
+
+struct sm2_enc_ctx_st {
+	int state;
+	const EVP_MD *md;
+	EVP_MD_CTX *kdf_ctx;	/* digest state after x2 || y2 */
+	EVP_MD_CTX *blk_ctx;
+	EVP_MD_CTX *hash_ctx;	/* x2 || M so far */
+	BN_CTX *bn_ctx;
+	unsigned char y2[(OPENSSL_ECC_MAX_FIELD_BITS + 7)/8];
+	size_t nbytes;
+	uint32_t counter;
+	unsigned char key[EVP_MAX_MD_SIZE];
+	size_t keylen;
+	size_t keypos;
+	unsigned char nonzero;
+};
+
+/* ephemeral key pair of SM2_KAP_prepare(), R is encoded uncompressed */
+typedef struct {
+	BIGNUM *r;
+	BIGNUM *x;	/* x_bar = 2^w + (x mod 2^w) of R */
+	unsigned char point[1 + (OPENSSL_ECC_MAX_FIELD_BITS+7)/4];
+	size_t pointlen;
+} SM2_KAP_EPHEM;
+
+struct sm2_kap_pool_st {
+	EC_GROUP *group;
+	BIGNUM *two_pow_w;
+	SM2_KAP_EPHEM **ephems;
+	size_t num;
+	size_t max;
+	int references;
+	CRYPTO_RWLOCK *lock;
+};
+
 struct sm2_kap_ctx_st {
 
 	const EVP_MD *id_dgst_md;
@@ -94,5 +179,7 @@ struct sm2_kap_ctx_st {
 	unsigned char pt_buf[1 + (OPENSSL_ECC_MAX_FIELD_BITS+7)/4];
 	unsigned char checksum[EVP_MAX_MD_SIZE];
 
+	SM2_KAP_POOL *pool;
+
 };
 
@@ -0,0 +1,738 @@
+/* ====================================================================
+ * Copyright (c) 2018 The GmSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the GmSSL Project.
+ *    (http://gmssl.org/)"
+ *
+ * 4. The name "GmSSL Project" must not be used to endorse or promote
+ *    products derived from this software without prior written
+ *    permission. For written permission, please contact
+ *    guanzhi1980@gmail.com.
+ *
+ * 5. Products derived from this software may not be called "GmSSL"
+ *    nor may "GmSSL" appear in their names without prior written
+ *    permission of the GmSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the GmSSL Project
+ *    (http://gmssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE GmSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE GmSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+/*
+ * SM2 signature on the sm2p256v1 curve with fixed size values.
+ *
+ * Scalars are four little-endian 64-bit words and the public key is the
+ * 65-byte uncompressed point, so that signing and verifying need no BIGNUM,
+ * BN_CTX or EC_POINT and run straight on the sm2z256 kernels. The same
+ * functions back SM2_sign() and SM2_verify() for sm2p256v1 keys, together
+ * with the tables of public keys that are verified against many times.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/ec.h>
+#include <openssl/err.h>
+#include <openssl/lhash.h>
+#include <openssl/rand.h>
+#include <openssl/sm2.h>
+#include "internal/bn_int.h"
+#include "../ec/ec_lcl.h"
+#include "sm2_lcl.h"
+
+#ifdef ECP_SM2Z256_SM2
+
+/* give up if this many nonces in a row are rejected */
+#define SM2_P256_MAX_SIGN_TRIES		64
+
+/* a = in mod 2^256, |in| is big-endian and at most 32 bytes */
+void sm2_p256_bin2words(BN_ULONG a[4], const unsigned char *in, size_t inlen)
+{
+	size_t i;
+
+	memset(a, 0, sizeof(BN_ULONG) * 4);
+	for (i = 0; i < inlen && i < 32; i++) {
+		a[i / 8] |= (BN_ULONG)in[inlen - 1 - i] << (8 * (i % 8));
+	}
+}
+
+void sm2_p256_words2bin(unsigned char out[32], const BN_ULONG a[4])
+{
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		out[31 - i] = (unsigned char)(a[i / 8] >> (8 * (i % 8)));
+	}
+}
+
+int sm2_p256_sign_words(BN_ULONG r[4], BN_ULONG s[4], const BN_ULONG e[4],
+	const BN_ULONG dinv[4])
+{
+	unsigned char buf[32];
+	BN_ULONG k[4];
+	int i, ret = 0;
+
+	for (i = 0; i < SM2_P256_MAX_SIGN_TRIES; i++) {
+		if (RAND_bytes(buf, sizeof(buf)) <= 0) {
+			break;
+		}
+		sm2_p256_bin2words(k, buf, sizeof(buf));
+		if (ecp_sm2z256_sm2_sign(r, s, e, k, dinv)) {
+			ret = 1;
+			break;
+		}
+	}
+
+	OPENSSL_cleanse(buf, sizeof(buf));
+	OPENSSL_cleanse(k, sizeof(k));
+	return ret;
+}
+
+/* DER INTEGER of a non-negative 256-bit value, returns the length */
+static size_t sm2_p256_int2der(unsigned char *out, const BN_ULONG a[4])
+{
+	unsigned char buf[32];
+	size_t i, len;
+
+	sm2_p256_words2bin(buf, a);
+	for (i = 0; i < 31 && buf[i] == 0; i++)
+		;
+	len = 32 - i;
+
+	if (out) {
+		*out++ = V_ASN1_INTEGER;
+		if (buf[i] & 0x80) {
+			*out++ = (unsigned char)(len + 1);
+			*out++ = 0;
+		} else {
+			*out++ = (unsigned char)len;
+		}
+		memcpy(out, buf + i, len);
+	}
+	return 2 + len + (buf[i] >> 7);
+}
+
+size_t sm2_p256_sig2der(unsigned char *out, const BN_ULONG r[4],
+	const BN_ULONG s[4])
+{
+	size_t rlen = sm2_p256_int2der(NULL, r);
+	size_t slen = sm2_p256_int2der(NULL, s);
+
+	out[0] = V_ASN1_SEQUENCE | V_ASN1_CONSTRUCTED;
+	out[1] = (unsigned char)(rlen + slen);
+	sm2_p256_int2der(out + 2, r);
+	sm2_p256_int2der(out + 2 + rlen, s);
+	return 2 + rlen + slen;
+}
+
+/*
+ * Reads a DER INTEGER of at most 256 bits, returns zero unless the encoding
+ * is minimal and the value is non-negative.
+ */
+static int sm2_p256_der2int(BN_ULONG a[4], const unsigned char **pin,
+	size_t *inlen)
+{
+	const unsigned char *p = *pin;
+	size_t len;
+
+	if (*inlen < 3 || p[0] != V_ASN1_INTEGER) {
+		return 0;
+	}
+	len = p[1];
+	p += 2;
+	if (len < 1 || len > *inlen - 2 || (p[0] & 0x80)) {
+		return 0;
+	}
+	if (p[0] == 0 && len > 1) {
+		if (!(p[1] & 0x80)) {
+			return 0;
+		}
+		p++;
+		len--;
+	}
+	if (len > 32) {
+		return 0;
+	}
+
+	sm2_p256_bin2words(a, p, len);
+	*inlen -= p + len - *pin;
+	*pin = p + len;
+	return 1;
+}
+
+int sm2_p256_der2sig(BN_ULONG r[4], BN_ULONG s[4],
+	const unsigned char *in, size_t inlen)
+{
+	if (inlen < 2 || inlen > SM2_MAX_SIGNATURE_LENGTH
+		|| in[0] != (V_ASN1_SEQUENCE | V_ASN1_CONSTRUCTED)
+		|| in[1] != inlen - 2) {
+		return 0;
+	}
+	in += 2;
+	inlen -= 2;
+	return sm2_p256_der2int(r, &in, &inlen)
+		&& sm2_p256_der2int(s, &in, &inlen)
+		&& inlen == 0;
+}
+
+/* public keys sorted by value, so that a repeated key gets one table */
+typedef struct {
+	BN_ULONG x[4];
+	BN_ULONG y[4];
+	size_t i;
+} SM2_P256_BATCH_KEY;
+
+static int sm2_p256_batch_key_cmp(const void *a, const void *b)
+{
+	const SM2_P256_BATCH_KEY *ka = a;
+	const SM2_P256_BATCH_KEY *kb = b;
+	int i;
+
+	for (i = 3; i >= 0; i--) {
+		if (ka->x[i] != kb->x[i]) {
+			return ka->x[i] < kb->x[i] ? -1 : 1;
+		}
+	}
+	for (i = 3; i >= 0; i--) {
+		if (ka->y[i] != kb->y[i]) {
+			return ka->y[i] < kb->y[i] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+int sm2_p256_verify_batch(const unsigned char **dgsts, const int *dgstlens,
+	const unsigned char **sigs, const int *siglens, EC_KEY **ec_keys,
+	size_t num, int *ok)
+{
+	int ret = 0;
+	void *buf = NULL;
+	BN_ULONG (*r)[4], (*s)[4], (*e)[4], (*x)[4], (*y)[4];
+	SM2_P256_BATCH_KEY *keys;
+	SM2Z256_VERIFY_TABLE **tables;
+	size_t *key, *item, *uses;
+	int *res;
+	size_t i, j, m = 0, num_keys = 0;
+
+	if (!(buf = OPENSSL_malloc(num * (5 * sizeof(r[0])
+		+ sizeof(SM2_P256_BATCH_KEY) + sizeof(*tables)
+		+ 3 * sizeof(size_t) + sizeof(int)) + 1))) {
+		SM2err(SM2_F_SM2_VERIFY_BATCH, ERR_R_MALLOC_FAILURE);
+		return 0;
+	}
+	r = buf;
+	s = r + num;
+	e = s + num;
+	x = e + num;
+	y = x + num;
+	keys = (SM2_P256_BATCH_KEY *)(y + num);
+	tables = (SM2Z256_VERIFY_TABLE **)(keys + num);
+	key = (size_t *)(tables + num);
+	item = key + num;
+	uses = item + num;
+	res = (int *)(uses + num);
+
+	/* the signatures that the generic code has to check are left as -2 */
+	for (i = 0; i < num; i++) {
+		const EC_GROUP *group = EC_KEY_get0_group(ec_keys[i]);
+		const EC_POINT *pub_key = EC_KEY_get0_public_key(ec_keys[i]);
+
+		ok[i] = -2;
+		if (!group || !pub_key || !ecp_sm2z256_group_is_sm2p256v1(group)
+			|| dgstlens[i] < 0 || dgstlens[i] > 32 || siglens[i] <= 0
+			|| !sm2_p256_der2sig(r[m], s[m], sigs[i], siglens[i])
+			|| !ecp_sm2z256_point_get_affine_words(pub_key,
+				keys[m].x, keys[m].y)) {
+			continue;
+		}
+		sm2_p256_bin2words(e[m], dgsts[i], dgstlens[i]);
+		keys[m].i = m;
+		item[m] = i;
+		m++;
+	}
+
+	qsort(keys, m, sizeof(keys[0]), sm2_p256_batch_key_cmp);
+	for (j = 0; j < m; j++) {
+		if (j == 0 || sm2_p256_batch_key_cmp(&keys[j - 1], &keys[j])) {
+			memcpy(x[num_keys], keys[j].x, sizeof(x[0]));
+			memcpy(y[num_keys], keys[j].y, sizeof(y[0]));
+			uses[num_keys] = 0;
+			num_keys++;
+		}
+		key[keys[j].i] = num_keys - 1;
+		uses[num_keys - 1]++;
+	}
+
+	/* the tables of SM2_verify_precompute() or of the cache, if any */
+	for (j = 0; j < m; j++) {
+		tables[key[j]] = NULL;
+	}
+	for (j = 0; j < m; j++) {
+		if (uses[key[j]]) {
+			tables[key[j]] = sm2_p256_get_verify_table(ec_keys[item[j]],
+				x[key[j]], y[key[j]], uses[key[j]]);
+			uses[key[j]] = 0;
+		}
+	}
+
+	if (!ecp_sm2z256_sm2_verify_batch(res, m, (const BN_ULONG (*)[4])r,
+		(const BN_ULONG (*)[4])s, (const BN_ULONG (*)[4])e, key, num_keys,
+		(const BN_ULONG (*)[4])x, (const BN_ULONG (*)[4])y, tables)) {
+		SM2err(SM2_F_SM2_VERIFY_BATCH, ERR_R_EC_LIB);
+		goto end;
+	}
+	for (j = 0; j < m; j++) {
+		ok[item[j]] = res[j];
+	}
+
+	ret = 1;
+end:
+	for (j = 0; j < num_keys; j++) {
+		ecp_sm2z256_verify_table_free(tables[j]);
+	}
+	OPENSSL_free(buf);
+	return ret;
+}
+
+
+/*
+ * Verification tables of public keys, see ecp_sm2z256_verify_table_new().
+ * SM2_verify_precompute() attaches one to an EC_KEY. The process-wide cache
+ * finds them by the public key value, so that the EC_KEYs that X509 parses
+ * again and again share them. Its entries are kept in order of last use
+ * and a key only gets a table after SM2_P256_CACHE_MIN_USES verifications,
+ * as the table costs about a dozen of them and 150 KB.
+ */
+#define SM2_P256_CACHE_MIN_USES		8
+
+typedef struct sm2_p256_cache_entry_st SM2_P256_CACHE_ENTRY;
+
+struct sm2_p256_cache_entry_st {
+	BN_ULONG x[4];
+	BN_ULONG y[4];
+	size_t uses;
+	int building;
+	SM2Z256_VERIFY_TABLE *table;
+	SM2_P256_CACHE_ENTRY *prev;
+	SM2_P256_CACHE_ENTRY *next;
+};
+
+DEFINE_LHASH_OF(SM2_P256_CACHE_ENTRY);
+
+static CRYPTO_ONCE sm2_p256_cache_once = CRYPTO_ONCE_STATIC_INIT;
+static int sm2_p256_cache_inited = 0;
+static int sm2_verify_idx = -1;
+static CRYPTO_RWLOCK *sm2_p256_cache_lock = NULL;
+static LHASH_OF(SM2_P256_CACHE_ENTRY) *sm2_p256_cache = NULL;
+/* most recently used first */
+static SM2_P256_CACHE_ENTRY *sm2_p256_cache_head = NULL;
+static SM2_P256_CACHE_ENTRY *sm2_p256_cache_tail = NULL;
+static size_t sm2_p256_cache_max = 0;
+
+static unsigned long sm2_p256_cache_hash(const SM2_P256_CACHE_ENTRY *a)
+{
+	return (unsigned long)(a->x[0] ^ a->y[0]);
+}
+
+static int sm2_p256_cache_cmp(const SM2_P256_CACHE_ENTRY *a,
+	const SM2_P256_CACHE_ENTRY *b)
+{
+	if (memcmp(a->x, b->x, sizeof(a->x))) {
+		return 1;
+	}
+	return memcmp(a->y, b->y, sizeof(a->y)) != 0;
+}
+
+static void sm2_p256_cache_unlink(SM2_P256_CACHE_ENTRY *a)
+{
+	if (a->prev) {
+		a->prev->next = a->next;
+	} else {
+		sm2_p256_cache_head = a->next;
+	}
+	if (a->next) {
+		a->next->prev = a->prev;
+	} else {
+		sm2_p256_cache_tail = a->prev;
+	}
+	a->prev = a->next = NULL;
+}
+
+static void sm2_p256_cache_push(SM2_P256_CACHE_ENTRY *a)
+{
+	a->prev = NULL;
+	a->next = sm2_p256_cache_head;
+	if (sm2_p256_cache_head) {
+		sm2_p256_cache_head->prev = a;
+	} else {
+		sm2_p256_cache_tail = a;
+	}
+	sm2_p256_cache_head = a;
+}
+
+/* drop the least recently used entries, the lock has to be held */
+static void sm2_p256_cache_evict(size_t max)
+{
+	SM2_P256_CACHE_ENTRY *a;
+
+	while (lh_SM2_P256_CACHE_ENTRY_num_items(sm2_p256_cache) > max) {
+		a = sm2_p256_cache_tail;
+		sm2_p256_cache_unlink(a);
+		lh_SM2_P256_CACHE_ENTRY_delete(sm2_p256_cache, a);
+		ecp_sm2z256_verify_table_free(a->table);
+		OPENSSL_free(a);
+	}
+}
+
+static void sm2_p256_cache_cleanup(void)
+{
+	if (!sm2_p256_cache_inited) {
+		return;
+	}
+	sm2_p256_cache_inited = 0;
+	sm2_p256_cache_evict(0);
+	lh_SM2_P256_CACHE_ENTRY_free(sm2_p256_cache);
+	sm2_p256_cache = NULL;
+	CRYPTO_THREAD_lock_free(sm2_p256_cache_lock);
+	sm2_p256_cache_lock = NULL;
+}
+
+/* an EC_KEY_dup() shares the table of the original key */
+static int sm2_verify_dup(CRYPTO_EX_DATA *to, const CRYPTO_EX_DATA *from,
+	void *srcp, int idx, long argl, void *argp)
+{
+	SM2Z256_VERIFY_TABLE **table = srcp;
+
+	if (*table && !ecp_sm2z256_verify_table_up_ref(*table)) {
+		*table = NULL;
+	}
+
+	(void)to;
+	(void)from;
+	(void)idx;
+	(void)argl;
+	(void)argp;
+	return 1;
+}
+
+static void sm2_verify_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad,
+	int idx, long argl, void *argp)
+{
+	ecp_sm2z256_verify_table_free(ptr);
+
+	(void)parent;
+	(void)ad;
+	(void)idx;
+	(void)argl;
+	(void)argp;
+}
+
+static void sm2_p256_cache_init(void)
+{
+	if (!(sm2_p256_cache_lock = CRYPTO_THREAD_lock_new())
+		|| !(sm2_p256_cache = lh_SM2_P256_CACHE_ENTRY_new(
+			sm2_p256_cache_hash, sm2_p256_cache_cmp))
+		|| (sm2_verify_idx = EC_KEY_get_ex_new_index(0, NULL, NULL,
+			sm2_verify_dup, sm2_verify_free)) < 0
+		|| !OPENSSL_atexit(sm2_p256_cache_cleanup)) {
+		lh_SM2_P256_CACHE_ENTRY_free(sm2_p256_cache);
+		sm2_p256_cache = NULL;
+		CRYPTO_THREAD_lock_free(sm2_p256_cache_lock);
+		sm2_p256_cache_lock = NULL;
+		return;
+	}
+	sm2_p256_cache_inited = 1;
+}
+
+static int sm2_p256_cache_setup(void)
+{
+	return CRYPTO_THREAD_run_once(&sm2_p256_cache_once, sm2_p256_cache_init)
+		&& sm2_p256_cache_inited;
+}
+
+/*
+ * Returns a reference to the table of the public key (x, y) of |ec_key|, or
+ * NULL if there is none (yet). |uses| is the number of signatures that are
+ * about to be verified with it.
+ */
+SM2Z256_VERIFY_TABLE *sm2_p256_get_verify_table(EC_KEY *ec_key,
+	const BN_ULONG x[4], const BN_ULONG y[4], size_t uses)
+{
+	SM2Z256_VERIFY_TABLE *table;
+	SM2_P256_CACHE_ENTRY tmpl;
+	SM2_P256_CACHE_ENTRY *a;
+	int build = 0;
+
+	if (!sm2_p256_cache_inited) {
+		return NULL;
+	}
+
+	/* the public key may have been changed after SM2_verify_precompute() */
+	if ((table = EC_KEY_get_ex_data(ec_key, sm2_verify_idx)) != NULL
+		&& ecp_sm2z256_verify_table_is_for(table, x, y)
+		&& ecp_sm2z256_verify_table_up_ref(table)) {
+		return table;
+	}
+	table = NULL;
+
+	if (!CRYPTO_THREAD_write_lock(sm2_p256_cache_lock)) {
+		return NULL;
+	}
+	if (sm2_p256_cache_max == 0) {
+		goto end;
+	}
+
+	memcpy(tmpl.x, x, sizeof(tmpl.x));
+	memcpy(tmpl.y, y, sizeof(tmpl.y));
+	if ((a = lh_SM2_P256_CACHE_ENTRY_retrieve(sm2_p256_cache, &tmpl))) {
+		sm2_p256_cache_unlink(a);
+	} else {
+		if (!(a = OPENSSL_zalloc(sizeof(*a)))) {
+			goto end;
+		}
+		memcpy(a->x, x, sizeof(a->x));
+		memcpy(a->y, y, sizeof(a->y));
+		lh_SM2_P256_CACHE_ENTRY_insert(sm2_p256_cache, a);
+		if (lh_SM2_P256_CACHE_ENTRY_error(sm2_p256_cache)) {
+			OPENSSL_free(a);
+			goto end;
+		}
+	}
+	sm2_p256_cache_push(a);
+	sm2_p256_cache_evict(sm2_p256_cache_max);
+
+	a->uses += uses;
+	if (a->table) {
+		if (ecp_sm2z256_verify_table_up_ref(a->table)) {
+			table = a->table;
+		}
+	} else if (a->uses >= SM2_P256_CACHE_MIN_USES && !a->building) {
+		a->building = build = 1;
+	}
+
+end:
+	CRYPTO_THREAD_unlock(sm2_p256_cache_lock);
+	if (!build) {
+		return table;
+	}
+
+	/* build it without the lock, the entry may be gone by then */
+	ERR_set_mark();
+	table = ecp_sm2z256_verify_table_new(x, y);
+	ERR_pop_to_mark();
+	if (!CRYPTO_THREAD_write_lock(sm2_p256_cache_lock)) {
+		return table;
+	}
+	if ((a = lh_SM2_P256_CACHE_ENTRY_retrieve(sm2_p256_cache, &tmpl))
+		&& a->building) {
+		a->building = 0;
+		if (table && ecp_sm2z256_verify_table_up_ref(table)) {
+			a->table = table;
+		}
+	}
+	CRYPTO_THREAD_unlock(sm2_p256_cache_lock);
+	return table;
+}
+
+#endif /* ECP_SM2Z256_SM2 */
+
+int SM2_P256_sign_setup(uint64_t dinv[4], const uint64_t d[4])
+{
+#ifdef ECP_SM2Z256_SM2
+	BN_ULONG a[4], b[4];
+	int i, ret;
+
+	for (i = 0; i < 4; i++) {
+		a[i] = (BN_ULONG)d[i];
+	}
+	if ((ret = ecp_sm2z256_sm2_sign_precompute(b, a))) {
+		for (i = 0; i < 4; i++) {
+			dinv[i] = b[i];
+		}
+	} else {
+		SM2err(SM2_F_SM2_P256_SIGN_SETUP, SM2_R_INVALID_PRIVATE_KEY);
+	}
+
+	OPENSSL_cleanse(a, sizeof(a));
+	OPENSSL_cleanse(b, sizeof(b));
+	return ret;
+#else
+	SM2err(SM2_F_SM2_P256_SIGN_SETUP, SM2_R_NOT_IMPLEMENTED);
+	return 0;
+#endif
+}
+
+int SM2_P256_sign_ex(uint64_t r[4], uint64_t s[4],
+	const unsigned char dgst[32], const uint64_t k[4],
+	const uint64_t dinv[4])
+{
+#ifdef ECP_SM2Z256_SM2
+	BN_ULONG rr[4], ss[4], e[4], kk[4], di[4];
+	int i, ret;
+
+	sm2_p256_bin2words(e, dgst, 32);
+	for (i = 0; i < 4; i++) {
+		kk[i] = (BN_ULONG)k[i];
+		di[i] = (BN_ULONG)dinv[i];
+	}
+
+	if ((ret = ecp_sm2z256_sm2_sign(rr, ss, e, kk, di))) {
+		for (i = 0; i < 4; i++) {
+			r[i] = rr[i];
+			s[i] = ss[i];
+		}
+	} else {
+		SM2err(SM2_F_SM2_P256_SIGN_EX, SM2_R_NEED_NEW_SETUP_VALUES);
+	}
+
+	OPENSSL_cleanse(kk, sizeof(kk));
+	OPENSSL_cleanse(di, sizeof(di));
+	return ret;
+#else
+	SM2err(SM2_F_SM2_P256_SIGN_EX, SM2_R_NOT_IMPLEMENTED);
+	return 0;
+#endif
+}
+
+int SM2_P256_sign(uint64_t r[4], uint64_t s[4],
+	const unsigned char dgst[32], const uint64_t dinv[4])
+{
+#ifdef ECP_SM2Z256_SM2
+	BN_ULONG rr[4], ss[4], e[4], di[4];
+	int i, ret;
+
+	sm2_p256_bin2words(e, dgst, 32);
+	for (i = 0; i < 4; i++) {
+		di[i] = (BN_ULONG)dinv[i];
+	}
+
+	if ((ret = sm2_p256_sign_words(rr, ss, e, di))) {
+		for (i = 0; i < 4; i++) {
+			r[i] = rr[i];
+			s[i] = ss[i];
+		}
+	} else {
+		SM2err(SM2_F_SM2_P256_SIGN,
+			SM2_R_RANDOM_NUMBER_GENERATION_FAILED);
+	}
+
+	OPENSSL_cleanse(di, sizeof(di));
+	return ret;
+#else
+	SM2err(SM2_F_SM2_P256_SIGN, SM2_R_NOT_IMPLEMENTED);
+	return 0;
+#endif
+}
+
+int SM2_P256_verify(const unsigned char dgst[32],
+	const uint64_t r[4], const uint64_t s[4],
+	const unsigned char point[SM2_P256_POINT_LENGTH])
+{
+#ifdef ECP_SM2Z256_SM2
+	BN_ULONG rr[4], ss[4], e[4], x[4], y[4];
+	int i;
+
+	if (point[0] != POINT_CONVERSION_UNCOMPRESSED) {
+		SM2err(SM2_F_SM2_P256_VERIFY, SM2_R_INVALID_PUBLIC_KEY);
+		return -1;
+	}
+
+	sm2_p256_bin2words(e, dgst, 32);
+	sm2_p256_bin2words(x, point + 1, 32);
+	sm2_p256_bin2words(y, point + 33, 32);
+	for (i = 0; i < 4; i++) {
+		rr[i] = (BN_ULONG)r[i];
+		ss[i] = (BN_ULONG)s[i];
+	}
+
+	return ecp_sm2z256_sm2_verify(rr, ss, e, x, y);
+#else
+	SM2err(SM2_F_SM2_P256_VERIFY, SM2_R_NOT_IMPLEMENTED);
+	return -1;
+#endif
+}
+
+int SM2_verify_precompute(EC_KEY *ec_key)
+{
+#ifdef ECP_SM2Z256_SM2
+	const EC_GROUP *group = EC_KEY_get0_group(ec_key);
+	const EC_POINT *pub_key = EC_KEY_get0_public_key(ec_key);
+	SM2Z256_VERIFY_TABLE *table, *old;
+	BN_ULONG x[4], y[4];
+
+	if (!sm2_p256_cache_setup()) {
+		SM2err(SM2_F_SM2_VERIFY_PRECOMPUTE, ERR_R_MALLOC_FAILURE);
+		return 0;
+	}
+	if (!group || !pub_key || !ecp_sm2z256_group_is_sm2p256v1(group)
+		|| !ecp_sm2z256_point_get_affine_words(pub_key, x, y)) {
+		SM2err(SM2_F_SM2_VERIFY_PRECOMPUTE, SM2_R_INVALID_EC_KEY);
+		return 0;
+	}
+
+	old = EC_KEY_get_ex_data(ec_key, sm2_verify_idx);
+	if (old && ecp_sm2z256_verify_table_is_for(old, x, y)) {
+		return 1;
+	}
+	if (!(table = ecp_sm2z256_verify_table_new(x, y))) {
+		SM2err(SM2_F_SM2_VERIFY_PRECOMPUTE, ERR_R_EC_LIB);
+		return 0;
+	}
+	if (!EC_KEY_set_ex_data(ec_key, sm2_verify_idx, table)) {
+		SM2err(SM2_F_SM2_VERIFY_PRECOMPUTE, ERR_R_EC_LIB);
+		ecp_sm2z256_verify_table_free(table);
+		return 0;
+	}
+	ecp_sm2z256_verify_table_free(old);
+	return 1;
+#else
+	SM2err(SM2_F_SM2_VERIFY_PRECOMPUTE, SM2_R_NOT_IMPLEMENTED);
+	return 0;
+#endif
+}
+
+int SM2_set_verify_cache_size(size_t num)
+{
+#ifdef ECP_SM2Z256_SM2
+	if (!sm2_p256_cache_setup()
+		|| !CRYPTO_THREAD_write_lock(sm2_p256_cache_lock)) {
+		SM2err(SM2_F_SM2_SET_VERIFY_CACHE_SIZE, ERR_R_MALLOC_FAILURE);
+		return 0;
+	}
+	sm2_p256_cache_max = num;
+	sm2_p256_cache_evict(num);
+	CRYPTO_THREAD_unlock(sm2_p256_cache_lock);
+#else
+	(void)num;
+#endif
+	return 1;
+}
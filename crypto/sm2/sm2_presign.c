@@ -0,0 +1,506 @@
+/* ====================================================================
+ * Copyright (c) 2018 The GmSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the GmSSL Project.
+ *    (http://gmssl.org/)"
+ *
+ * 4. The name "GmSSL Project" must not be used to endorse or promote
+ *    products derived from this software without prior written
+ *    permission. For written permission, please contact
+ *    guanzhi1980@gmail.com.
+ *
+ * 5. Products derived from this software may not be called "GmSSL"
+ *    nor may "GmSSL" appear in their names without prior written
+ *    permission of the GmSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the GmSSL Project
+ *    (http://gmssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE GmSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE GmSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+#include <string.h>
+#include <limits.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/sm2.h>
+#include <openssl/err.h>
+#include <openssl/rand.h>
+#include <openssl/obj_mac.h>
+#include "../ec/ec_lcl.h"
+#include "sm2_lcl.h"
+
+/*
+ * Slots change state with a compare-and-swap where the compiler has
+ * lock-free atomics, as in CRYPTO_atomic_add(), and under the pool lock
+ * otherwise. A slot is only written or read by the thread that moved it to
+ * SM2_PRESIGN_BUSY. The avail count is taken before a slot is searched
+ * for, so a pop that gets past it always finds a full one.
+ */
+#if defined(__GNUC__) && defined(__ATOMIC_ACQ_REL)
+# define SM2_PRESIGN_ATOMICS
+#endif
+
+static int sm2_presign_state(SM2_PRESIGN *slot)
+{
+#ifdef SM2_PRESIGN_ATOMICS
+	if (__atomic_is_lock_free(sizeof(slot->state), &slot->state)) {
+		return __atomic_load_n(&slot->state, __ATOMIC_RELAXED);
+	}
+#endif
+	/* only a hint, sm2_presign_cas() checks it again */
+	return *(volatile int *)&slot->state;
+}
+
+static int sm2_presign_cas(SM2_PRESIGN_POOL *pool, SM2_PRESIGN *slot,
+	int from, int to)
+{
+	int ret;
+
+#ifdef SM2_PRESIGN_ATOMICS
+	if (__atomic_is_lock_free(sizeof(slot->state), &slot->state)) {
+		return __atomic_compare_exchange_n(&slot->state, &from, to, 0,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+	}
+#endif
+	if (!CRYPTO_THREAD_write_lock(pool->lock)) {
+		return 0;
+	}
+	if ((ret = slot->state == from)) {
+		slot->state = to;
+	}
+	CRYPTO_THREAD_unlock(pool->lock);
+	return ret;
+}
+
+static int sm2_presign_set(SM2_PRESIGN_POOL *pool, SM2_PRESIGN *slot, int to)
+{
+#ifdef SM2_PRESIGN_ATOMICS
+	if (__atomic_is_lock_free(sizeof(slot->state), &slot->state)) {
+		__atomic_store_n(&slot->state, to, __ATOMIC_RELEASE);
+		return 1;
+	}
+#endif
+	if (!CRYPTO_THREAD_write_lock(pool->lock)) {
+		return 0;
+	}
+	slot->state = to;
+	CRYPTO_THREAD_unlock(pool->lock);
+	return 1;
+}
+
+int sm2_presign_pop(SM2_PRESIGN_POOL *pool, unsigned char *k,
+	unsigned char *x)
+{
+	SM2_PRESIGN *slot;
+	int n, i;
+
+	if (!CRYPTO_atomic_add(&pool->avail, -1, &n, pool->lock)) {
+		return 0;
+	}
+	if (n < 0) {
+		CRYPTO_atomic_add(&pool->avail, 1, &n, pool->lock);
+		return 0;
+	}
+
+	/* concurrent pops see different counts and start apart */
+	for (i = n % pool->max; ; i = (i + 1) % pool->max) {
+		slot = &pool->slots[i];
+		if (sm2_presign_state(slot) == SM2_PRESIGN_FULL
+			&& sm2_presign_cas(pool, slot, SM2_PRESIGN_FULL,
+				SM2_PRESIGN_BUSY)) {
+			break;
+		}
+	}
+
+	memcpy(k, slot->k, pool->nbytes);
+	memcpy(x, slot->x, pool->nbytes);
+	OPENSSL_cleanse(slot->k, sizeof(slot->k));
+	OPENSSL_cleanse(slot->x, sizeof(slot->x));
+	sm2_presign_set(pool, slot, SM2_PRESIGN_EMPTY);
+	return 1;
+}
+
+/* returns 0 when there is no empty slot left after *pos */
+static int sm2_presign_push(SM2_PRESIGN_POOL *pool, int *pos,
+	const unsigned char *k, const unsigned char *x)
+{
+	SM2_PRESIGN *slot;
+	int n;
+
+	for (; *pos < pool->max; (*pos)++) {
+		slot = &pool->slots[*pos];
+		if (sm2_presign_state(slot) != SM2_PRESIGN_EMPTY
+			|| !sm2_presign_cas(pool, slot, SM2_PRESIGN_EMPTY,
+				SM2_PRESIGN_BUSY)) {
+			continue;
+		}
+		memcpy(slot->k, k, pool->nbytes);
+		memcpy(slot->x, x, pool->nbytes);
+		if (!sm2_presign_set(pool, slot, SM2_PRESIGN_FULL)) {
+			return 0;
+		}
+		CRYPTO_atomic_add(&pool->avail, 1, &n, pool->lock);
+		(*pos)++;
+		return 1;
+	}
+	return 0;
+}
+
+/* random k in [1, n - 1] */
+static int sm2_presign_rand_k(SM2_PRESIGN_POOL *pool, unsigned char *k)
+{
+	unsigned char nonzero;
+	size_t i;
+
+	do {
+		if (RAND_bytes(k, (int)pool->nbytes) <= 0) {
+			return 0;
+		}
+		k[0] &= pool->mask;
+		for (nonzero = 0, i = 0; i < pool->nbytes; i++) {
+			nonzero |= k[i];
+		}
+	} while (!nonzero || memcmp(k, pool->order, pool->nbytes) >= 0);
+
+	return 1;
+}
+
+#define SM2_PRESIGN_POOL_BATCH	16
+
+#ifdef ECP_SM2Z256_SM2
+static int sm2_presign_generate_p256(SM2_PRESIGN_POOL *pool,
+	unsigned char (*k)[SM2_PRESIGN_MAX_BYTES],
+	unsigned char (*x)[SM2_PRESIGN_MAX_BYTES], int n)
+{
+	BN_ULONG kw[SM2_PRESIGN_POOL_BATCH][4];
+	BN_ULONG xw[SM2_PRESIGN_POOL_BATCH][4];
+	int i, ret = 0;
+
+	for (i = 0; i < n; i++) {
+		if (!sm2_presign_rand_k(pool, k[i])) {
+			goto end;
+		}
+		sm2_p256_bin2words(kw[i], k[i], 32);
+	}
+	if (!ecp_sm2z256_sm2_presign(xw, (const BN_ULONG (*)[4])kw, n)) {
+		goto end;
+	}
+	for (i = 0; i < n; i++) {
+		sm2_p256_words2bin(x[i], xw[i]);
+	}
+
+	ret = 1;
+end:
+	OPENSSL_cleanse(kw, sizeof(kw));
+	OPENSSL_cleanse(xw, sizeof(xw));
+	return ret;
+}
+#endif
+
+/*
+ * The points of a batch are made affine together with a single field
+ * inversion, sm2p256v1 does the same on fixed size words.
+ */
+static int sm2_presign_generate(SM2_PRESIGN_POOL *pool,
+	unsigned char (*k)[SM2_PRESIGN_MAX_BYTES],
+	unsigned char (*x)[SM2_PRESIGN_MAX_BYTES], int n)
+{
+	int ret = 0;
+	const BIGNUM *order = EC_GROUP_get0_order(pool->group);
+	BN_CTX *bn_ctx = NULL;
+	BIGNUM *bn = NULL;
+	EC_POINT *points[SM2_PRESIGN_POOL_BATCH];
+	int i;
+
+#ifdef ECP_SM2Z256_SM2
+	if (ecp_sm2z256_group_is_sm2p256v1(pool->group)) {
+		return sm2_presign_generate_p256(pool, k, x, n);
+	}
+#endif
+
+	memset(points, 0, sizeof(points));
+	if (!(bn_ctx = BN_CTX_new()) || !(bn = BN_new())) {
+		goto end;
+	}
+	for (i = 0; i < n; i++) {
+		if (!(points[i] = EC_POINT_new(pool->group))
+			|| !sm2_presign_rand_k(pool, k[i])
+			|| !BN_bin2bn(k[i], (int)pool->nbytes, bn)
+			|| !EC_POINT_mul(pool->group, points[i], bn, NULL, NULL,
+				bn_ctx)) {
+			goto end;
+		}
+	}
+
+	if (!EC_POINTs_make_affine(pool->group, n, points, bn_ctx)) {
+		goto end;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (EC_METHOD_get_field_type(EC_GROUP_method_of(pool->group))
+			== NID_X9_62_prime_field) {
+			if (!EC_POINT_get_affine_coordinates_GFp(pool->group,
+				points[i], bn, NULL, bn_ctx)) {
+				goto end;
+			}
+		} else /* NID_X9_62_characteristic_two_field */ {
+			if (!EC_POINT_get_affine_coordinates_GF2m(pool->group,
+				points[i], bn, NULL, bn_ctx)) {
+				goto end;
+			}
+		}
+		if (!BN_nnmod(bn, bn, order, bn_ctx)
+			|| BN_bn2binpad(bn, x[i], (int)pool->nbytes) < 0) {
+			goto end;
+		}
+	}
+
+	ret = 1;
+end:
+	for (i = 0; i < SM2_PRESIGN_POOL_BATCH; i++) {
+		EC_POINT_clear_free(points[i]);
+	}
+	BN_clear_free(bn);
+	BN_CTX_free(bn_ctx);
+	return ret;
+}
+
+SM2_PRESIGN_POOL *SM2_PRESIGN_POOL_new(const EC_GROUP *group, size_t max)
+{
+	SM2_PRESIGN_POOL *ret = NULL;
+	const BIGNUM *order;
+	int bits;
+
+	if (!group) {
+		SM2err(SM2_F_SM2_PRESIGN_POOL_NEW, ERR_R_PASSED_NULL_PARAMETER);
+		return NULL;
+	}
+	if (!max || max > INT_MAX / 2) {
+		SM2err(SM2_F_SM2_PRESIGN_POOL_NEW, SM2_R_INVALID_INPUT_LENGTH);
+		return NULL;
+	}
+	if (!(order = EC_GROUP_get0_order(group)) || BN_is_zero(order)
+		|| (bits = BN_num_bits(order)) > 8 * SM2_PRESIGN_MAX_BYTES) {
+		SM2err(SM2_F_SM2_PRESIGN_POOL_NEW, SM2_R_MISSING_PARAMETERS);
+		return NULL;
+	}
+
+	if (!(ret = OPENSSL_zalloc(sizeof(*ret)))
+		|| !(ret->slots = OPENSSL_zalloc(sizeof(*ret->slots) * max))
+		|| !(ret->lock = CRYPTO_THREAD_lock_new())) {
+		SM2err(SM2_F_SM2_PRESIGN_POOL_NEW, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+	ret->max = (int)max;
+	ret->references = 1;
+
+	if (!(ret->group = EC_GROUP_dup(group))) {
+		SM2err(SM2_F_SM2_PRESIGN_POOL_NEW, ERR_R_EC_LIB);
+		goto end;
+	}
+	ret->nbytes = (bits + 7)/8;
+	ret->mask = 0xff >> (8 * ret->nbytes - bits);
+	if (BN_bn2binpad(order, ret->order, (int)ret->nbytes) < 0) {
+		SM2err(SM2_F_SM2_PRESIGN_POOL_NEW, ERR_R_BN_LIB);
+		goto end;
+	}
+
+	return ret;
+
+end:
+	SM2_PRESIGN_POOL_free(ret);
+	return NULL;
+}
+
+int SM2_PRESIGN_POOL_up_ref(SM2_PRESIGN_POOL *pool)
+{
+	int i;
+
+	if (CRYPTO_atomic_add(&pool->references, 1, &i, pool->lock) <= 0) {
+		return 0;
+	}
+	return i > 1 ? 1 : 0;
+}
+
+void SM2_PRESIGN_POOL_free(SM2_PRESIGN_POOL *pool)
+{
+	int i;
+
+	if (!pool) {
+		return;
+	}
+	if (pool->lock) {
+		CRYPTO_atomic_add(&pool->references, -1, &i, pool->lock);
+		if (i > 0) {
+			return;
+		}
+	}
+
+	OPENSSL_clear_free(pool->slots, sizeof(*pool->slots) * pool->max);
+	EC_GROUP_free(pool->group);
+	CRYPTO_THREAD_lock_free(pool->lock);
+	OPENSSL_free(pool);
+}
+
+/* pairs taken out meanwhile are left to the next refill */
+int SM2_PRESIGN_POOL_refill(SM2_PRESIGN_POOL *pool)
+{
+	int ret = 0;
+	unsigned char k[SM2_PRESIGN_POOL_BATCH][SM2_PRESIGN_MAX_BYTES];
+	unsigned char x[SM2_PRESIGN_POOL_BATCH][SM2_PRESIGN_MAX_BYTES];
+	int need, n, i, pos = 0;
+
+	if (!pool) {
+		SM2err(SM2_F_SM2_PRESIGN_POOL_REFILL,
+			ERR_R_PASSED_NULL_PARAMETER);
+		return 0;
+	}
+
+	if (!CRYPTO_atomic_add(&pool->avail, 0, &n, pool->lock)) {
+		SM2err(SM2_F_SM2_PRESIGN_POOL_REFILL, ERR_R_INTERNAL_ERROR);
+		return 0;
+	}
+	need = pool->max - (n > 0 ? n : 0);
+
+	for (; need > 0; need -= n) {
+		n = need < SM2_PRESIGN_POOL_BATCH ? need : SM2_PRESIGN_POOL_BATCH;
+
+		if (!sm2_presign_generate(pool, k, x, n)) {
+			SM2err(SM2_F_SM2_PRESIGN_POOL_REFILL, ERR_R_EC_LIB);
+			goto end;
+		}
+		for (i = 0; i < n; i++) {
+			/* filled up by a concurrent refill */
+			if (!sm2_presign_push(pool, &pos, k[i], x[i])) {
+				ret = 1;
+				goto end;
+			}
+		}
+	}
+
+	ret = 1;
+end:
+	OPENSSL_cleanse(k, sizeof(k));
+	OPENSSL_cleanse(x, sizeof(x));
+	return ret;
+}
+
+size_t SM2_PRESIGN_POOL_num(SM2_PRESIGN_POOL *pool)
+{
+	int n;
+
+	if (!pool || !CRYPTO_atomic_add(&pool->avail, 0, &n, pool->lock)) {
+		return 0;
+	}
+	return n > 0 ? (size_t)n : 0;
+}
+
+static CRYPTO_ONCE sm2_presign_once = CRYPTO_ONCE_STATIC_INIT;
+static int sm2_presign_idx = -1;
+
+/* an EC_KEY_dup() shares the pool of the original key */
+static int sm2_presign_dup(CRYPTO_EX_DATA *to, const CRYPTO_EX_DATA *from,
+	void *srcp, int idx, long argl, void *argp)
+{
+	SM2_PRESIGN_POOL **pool = srcp;
+
+	if (*pool && !SM2_PRESIGN_POOL_up_ref(*pool)) {
+		*pool = NULL;
+	}
+
+	(void)to;
+	(void)from;
+	(void)idx;
+	(void)argl;
+	(void)argp;
+	return 1;
+}
+
+static void sm2_presign_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad,
+	int idx, long argl, void *argp)
+{
+	SM2_PRESIGN_POOL_free(ptr);
+
+	(void)parent;
+	(void)ad;
+	(void)idx;
+	(void)argl;
+	(void)argp;
+}
+
+static void sm2_presign_init(void)
+{
+	sm2_presign_idx = EC_KEY_get_ex_new_index(0, NULL, NULL,
+		sm2_presign_dup, sm2_presign_free);
+}
+
+SM2_PRESIGN_POOL *sm2_get_presign_pool(EC_KEY *ec_key)
+{
+	if (sm2_presign_idx < 0) {
+		return NULL;
+	}
+	return EC_KEY_get_ex_data(ec_key, sm2_presign_idx);
+}
+
+int SM2_set_presign_pool(EC_KEY *ec_key, SM2_PRESIGN_POOL *pool)
+{
+	const EC_GROUP *group;
+	SM2_PRESIGN_POOL *old;
+
+	if (!ec_key) {
+		SM2err(SM2_F_SM2_SET_PRESIGN_POOL, ERR_R_PASSED_NULL_PARAMETER);
+		return 0;
+	}
+	if (!CRYPTO_THREAD_run_once(&sm2_presign_once, sm2_presign_init)
+		|| sm2_presign_idx < 0) {
+		SM2err(SM2_F_SM2_SET_PRESIGN_POOL, ERR_R_EC_LIB);
+		return 0;
+	}
+	if (pool && (!(group = EC_KEY_get0_group(ec_key))
+		|| EC_GROUP_cmp(group, pool->group, NULL) != 0)) {
+		SM2err(SM2_F_SM2_SET_PRESIGN_POOL, SM2_R_INVALID_EC_KEY);
+		return 0;
+	}
+
+	if (pool && !SM2_PRESIGN_POOL_up_ref(pool)) {
+		SM2err(SM2_F_SM2_SET_PRESIGN_POOL, ERR_R_INTERNAL_ERROR);
+		return 0;
+	}
+	old = EC_KEY_get_ex_data(ec_key, sm2_presign_idx);
+	if (!EC_KEY_set_ex_data(ec_key, sm2_presign_idx, pool)) {
+		SM2err(SM2_F_SM2_SET_PRESIGN_POOL, ERR_R_EC_LIB);
+		SM2_PRESIGN_POOL_free(pool);
+		return 0;
+	}
+	SM2_PRESIGN_POOL_free(old);
+	return 1;
+}
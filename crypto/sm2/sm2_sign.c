@@ -55,7 +55,9 @@
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 #include <openssl/obj_mac.h>
+#include "internal/bn_int.h"
 #include "../ec/ec_lcl.h"
+#include "sm2_lcl.h"
 
 static int sm2_sign_idx = -1;
 
@@ -75,6 +77,186 @@ static void sm2_sign_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad,
 	(void)argp;
 }
 
+/* an EC_KEY_dup() gets its own copy, it is recomputed if that fails */
+static int sm2_sign_dup(CRYPTO_EX_DATA *to, const CRYPTO_EX_DATA *from,
+	void *srcp, int idx, long argl, void *argp)
+{
+	BIGNUM **bn = (BIGNUM **)srcp;
+
+	if (*bn) {
+		*bn = BN_dup(*bn);
+	}
+
+	(void)to;
+	(void)from;
+	(void)idx;
+	(void)argl;
+	(void)argp;
+	return 1;
+}
+
+#ifdef ECP_SM2Z256_SM2
+/*
+ * Signatures with sm2p256v1 keys run on the fixed size sm2z256 code in
+ * sm2_p256.c, without the BN_CTX, BIGNUM and EC_POINT temporaries of the
+ * generic code below.
+ */
+static int sm2_p256_enabled(const EC_KEY *ec_key, int dgstlen)
+{
+	const EC_GROUP *group = EC_KEY_get0_group(ec_key);
+
+	return group != NULL && dgstlen >= 0 && dgstlen <= 32
+		&& ecp_sm2z256_group_is_sm2p256v1(group);
+}
+
+/* get the cached (1 + d)^-1, it is computed on first use */
+static int sm2_p256_get_dinv(BN_ULONG dinv[4], EC_KEY *ec_key)
+{
+	int ret = 0;
+	const BIGNUM *priv_key;
+	BIGNUM *bn = NULL;
+	BN_ULONG d[4];
+
+	if (sm2_sign_idx < 0) {
+		if ((sm2_sign_idx = EC_KEY_get_ex_new_index(0, NULL, NULL,
+			sm2_sign_dup, sm2_sign_free)) < 0) {
+			SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_EC_LIB);
+			return 0;
+		}
+	}
+
+	if ((bn = EC_KEY_get_ex_data(ec_key, sm2_sign_idx)) != NULL) {
+		return bn_copy_words(dinv, bn, 4);
+	}
+
+	if (!(priv_key = EC_KEY_get0_private_key(ec_key))
+		|| !bn_copy_words(d, priv_key, 4)
+		|| !ecp_sm2z256_sm2_sign_precompute(dinv, d)) {
+		SM2err(SM2_F_SM2_SIGN_SETUP, SM2_R_INVALID_PRIVATE_KEY);
+		goto end;
+	}
+	if (!(bn = BN_new()) || !bn_set_words(bn, dinv, 4)) {
+		SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_MALLOC_FAILURE);
+		BN_clear_free(bn);
+		goto end;
+	}
+	if (!EC_KEY_set_ex_data(ec_key, sm2_sign_idx, bn)) {
+		SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_EC_LIB);
+		BN_clear_free(bn);
+		goto end;
+	}
+
+	ret = 1;
+end:
+	OPENSSL_cleanse(d, sizeof(d));
+	return ret;
+}
+
+static int sm2_p256_sign(BN_ULONG r[4], BN_ULONG s[4],
+	const unsigned char *dgst, int dgstlen, EC_KEY *ec_key)
+{
+	int ret = 0;
+	SM2_PRESIGN_POOL *pool;
+	unsigned char kbuf[SM2_PRESIGN_MAX_BYTES];
+	unsigned char xbuf[SM2_PRESIGN_MAX_BYTES];
+	BN_ULONG e[4];
+	BN_ULONG dinv[4];
+	BN_ULONG k[4];
+	BN_ULONG x[4];
+
+	sm2_p256_bin2words(e, dgst, dgstlen);
+
+	if (!sm2_p256_get_dinv(dinv, ec_key)) {
+		SM2err(SM2_F_SM2_DO_SIGN, ERR_R_EC_LIB);
+		goto end;
+	}
+
+	/* a precomputed nonce is used once, even if it does not work out */
+	if ((pool = sm2_get_presign_pool(ec_key)) != NULL
+		&& sm2_presign_pop(pool, kbuf, xbuf)) {
+		sm2_p256_bin2words(k, kbuf, 32);
+		sm2_p256_bin2words(x, xbuf, 32);
+		ret = ecp_sm2z256_sm2_sign_presigned(r, s, e, k, x, dinv);
+	}
+	if (!ret && !sm2_p256_sign_words(r, s, e, dinv)) {
+		SM2err(SM2_F_SM2_DO_SIGN, SM2_R_RANDOM_NUMBER_GENERATION_FAILED);
+		goto end;
+	}
+
+	ret = 1;
+end:
+	OPENSSL_cleanse(kbuf, sizeof(kbuf));
+	OPENSSL_cleanse(xbuf, sizeof(xbuf));
+	OPENSSL_cleanse(dinv, sizeof(dinv));
+	OPENSSL_cleanse(k, sizeof(k));
+	return ret;
+}
+
+/* returns -1 if the public key has to go through the generic code */
+static int sm2_p256_verify(const BN_ULONG r[4], const BN_ULONG s[4],
+	const unsigned char *dgst, int dgstlen, EC_KEY *ec_key)
+{
+	const EC_POINT *pub_key;
+	SM2Z256_VERIFY_TABLE *table;
+	BN_ULONG e[4];
+	BN_ULONG x[4];
+	BN_ULONG y[4];
+	int ret;
+
+	if (!(pub_key = EC_KEY_get0_public_key(ec_key))
+		|| !ecp_sm2z256_point_get_affine_words(pub_key, x, y)) {
+		return -1;
+	}
+
+	sm2_p256_bin2words(e, dgst, dgstlen);
+	if ((table = sm2_p256_get_verify_table(ec_key, x, y, 1)) != NULL) {
+		ret = ecp_sm2z256_sm2_verify_table(r, s, e, table);
+		ecp_sm2z256_verify_table_free(table);
+		return ret;
+	}
+	return ecp_sm2z256_sm2_verify(r, s, e, x, y);
+}
+#endif
+
+/* get the cached (1 + d)^-1, it is computed on first use */
+static const BIGNUM *sm2_get_dinv(EC_KEY *ec_key, BN_CTX *ctx)
+{
+	BIGNUM *d = NULL;
+
+	if (sm2_sign_idx < 0) {
+		if ((sm2_sign_idx = EC_KEY_get_ex_new_index(0, NULL, NULL,
+			sm2_sign_dup, sm2_sign_free)) < 0) {
+			SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_EC_LIB);
+			return NULL;
+		}
+	}
+
+	if ((d = EC_KEY_get_ex_data(ec_key, sm2_sign_idx)) != NULL) {
+		return d;
+	}
+
+	if (!(d = BN_dup(EC_KEY_get0_private_key(ec_key)))) {
+		SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_MALLOC_FAILURE);
+		return NULL;
+	}
+	if (!BN_add_word(d, 1)) {
+		SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_BN_LIB);
+		BN_clear_free(d);
+		return NULL;
+	}
+	if (!ec_group_do_inverse_ord(EC_KEY_get0_group(ec_key), d, d, ctx)) {
+		SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_EC_LIB);
+		BN_clear_free(d);
+		return NULL;
+	}
+	if (!EC_KEY_set_ex_data(ec_key, sm2_sign_idx, d)) {
+		SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_EC_LIB);
+		BN_clear_free(d);
+		return NULL;
+	}
+	return d;
+}
+
 static int sm2_sign_setup(EC_KEY *ec_key, BN_CTX *ctx_in, BIGNUM **kp, BIGNUM **xp)
 {
 	int ret = 0;
@@ -120,34 +302,8 @@ static int sm2_sign_setup(EC_KEY *ec_key, BN_CTX *ctx_in, BIGNUM **kp, BIGNUM **
 	}
 
 	/* do pre compute (1 + d)^-1 */
-	if (sm2_sign_idx < 0) {
-		if ((sm2_sign_idx = EC_KEY_get_ex_new_index(0, NULL, NULL, NULL,
-			sm2_sign_free)) < 0) {
-			SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_EC_LIB);
-			goto end;
-		}
-	}
-
-	if (!EC_KEY_get_ex_data(ec_key, sm2_sign_idx)) {
-		BIGNUM *d = NULL;
-		if (!(d = BN_dup(EC_KEY_get0_private_key(ec_key)))) {
-			SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_MALLOC_FAILURE);
-			goto end;
-		}
-		if (!BN_add_word(d, 1)) {
-			SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_BN_LIB);
-			BN_clear_free(d);
-			goto end;
-		}
-		if (!BN_mod_inverse(d, d, order, ctx)) {
-			SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_BN_LIB);
-			BN_clear_free(d);
-			goto end;
-		}
-		if (!EC_KEY_set_ex_data(ec_key, sm2_sign_idx, d)) {
-			SM2err(SM2_F_SM2_SIGN_SETUP, ERR_R_EC_LIB);
-			goto end;
-		}
+	if (!sm2_get_dinv(ec_key, ctx)) {
+		goto end;
 	}
 
 	do {
@@ -216,6 +372,10 @@ static ECDSA_SIG *sm2_do_sign(const unsigned char *dgst, int dgstlen,
 	const EC_GROUP *ec_group;
 	const BIGNUM *priv_key;
 	const BIGNUM *ck;
+	const BIGNUM *dinv;
+	SM2_PRESIGN_POOL *pool = NULL;
+	unsigned char kbuf[SM2_PRESIGN_MAX_BYTES];
+	unsigned char xbuf[SM2_PRESIGN_MAX_BYTES];
 	BIGNUM *k = NULL;
 	BN_CTX *ctx = NULL;
 	BIGNUM *order = NULL;
@@ -230,6 +390,27 @@ static ECDSA_SIG *sm2_do_sign(const unsigned char *dgst, int dgstlen,
 		return NULL;
 	}
 
+#ifdef ECP_SM2Z256_SM2
+	if (!in_k && !in_x && sm2_p256_enabled(ec_key, dgstlen)) {
+		BN_ULONG r[4], s[4];
+
+		if (!sm2_p256_sign(r, s, dgst, dgstlen, ec_key)) {
+			return NULL;
+		}
+		if (!(ret = ECDSA_SIG_new())
+			|| !(k = BN_new()) || !(bn = BN_new())
+			|| !bn_set_words(k, r, 4) || !bn_set_words(bn, s, 4)
+			|| !ECDSA_SIG_set0(ret, k, bn)) {
+			SM2err(SM2_F_SM2_DO_SIGN, ERR_R_MALLOC_FAILURE);
+			ECDSA_SIG_free(ret);
+			BN_free(k);
+			BN_free(bn);
+			return NULL;
+		}
+		return ret;
+	}
+#endif
+
 	if (!(ret = ECDSA_SIG_new())) {
 		SM2err(SM2_F_SM2_DO_SIGN, ERR_R_MALLOC_FAILURE);
 		return NULL;
@@ -268,9 +449,24 @@ static ECDSA_SIG *sm2_do_sign(const unsigned char *dgst, int dgstlen,
 	}
 #endif
 
+	if (!(dinv = sm2_get_dinv(ec_key, ctx))) {
+		SM2err(SM2_F_SM2_DO_SIGN, ERR_R_EC_LIB);
+		goto end;
+	}
+	if (!in_k || !in_x) {
+		pool = sm2_get_presign_pool(ec_key);
+	}
+
 	do {
-		/* use or compute k and (kG).x */
-		if (!in_k || !in_x) {
+		/* use or compute k and (kG).x, or take them from the pool */
+		if (pool && sm2_presign_pop(pool, kbuf, xbuf)) {
+			if (!(k = BN_bin2bn(kbuf, (int)pool->nbytes, k))
+				|| !BN_bin2bn(xbuf, (int)pool->nbytes, ret->r)) {
+				SM2err(SM2_F_SM2_DO_SIGN, ERR_R_BN_LIB);
+				goto end;
+			}
+			ck = k;
+		} else if (!in_k || !in_x) {
 			if (!sm2_sign_setup(ec_key, ctx, &k, &ret->r)) {
 				SM2err(SM2_F_SM2_DO_SIGN, ERR_R_ECDSA_LIB);
 				goto end;
@@ -334,8 +530,7 @@ static ECDSA_SIG *sm2_do_sign(const unsigned char *dgst, int dgstlen,
 		}
 #else
 		/* s = d'(k + r) - r mod n */
-		if (!BN_mod_mul(ret->s, EC_KEY_get_ex_data(ec_key, sm2_sign_idx),
-			bn, order, ctx)) {
+		if (!BN_mod_mul(ret->s, dinv, bn, order, ctx)) {
 			SM2err(SM2_F_SM2_DO_SIGN, ERR_R_BN_LIB);
 			goto end;
 		}
@@ -379,7 +574,9 @@ end:
 		ECDSA_SIG_free(ret);
 		ret = NULL;
 	}
-	BN_free(k);
+	OPENSSL_cleanse(kbuf, sizeof(kbuf));
+	OPENSSL_cleanse(xbuf, sizeof(xbuf));
+	BN_clear_free(k);
 	BN_CTX_free(ctx);
 	BN_free(order);
 	BN_free(e);
@@ -409,6 +606,21 @@ int sm2_do_verify(const unsigned char *dgst, int dgstlen,
 		return -1;
 	}
 
+#ifdef ECP_SM2Z256_SM2
+	if (sm2_p256_enabled(ec_key, dgstlen)) {
+		BN_ULONG r[4], s[4];
+
+		if (BN_is_negative(sig->r) || !bn_copy_words(r, sig->r, 4) ||
+			BN_is_negative(sig->s) || !bn_copy_words(s, sig->s, 4)) {
+			SM2err(SM2_F_SM2_DO_VERIFY, SM2_R_BAD_SIGNATURE);
+			return 0;
+		}
+		if ((ret = sm2_p256_verify(r, s, dgst, dgstlen, ec_key)) >= 0) {
+			return ret;
+		}
+	}
+#endif
+
 	ctx = BN_CTX_new();
 	order = BN_new();
 	e = BN_new();
@@ -554,6 +766,19 @@ int SM2_sign_ex(int type, const unsigned char *dgst, int dgstlen,
 
 	RAND_seed(dgst, dgstlen);
 
+#ifdef ECP_SM2Z256_SM2
+	if (!k && !x && sm2_p256_enabled(ec_key, dgstlen)) {
+		BN_ULONG rr[4], ss[4];
+
+		if (!sm2_p256_sign(rr, ss, dgst, dgstlen, ec_key)) {
+			*siglen = 0;
+			return 0;
+		}
+		*siglen = (unsigned int)sm2_p256_sig2der(sig, rr, ss);
+		return 1;
+	}
+#endif
+
 	if (!(s = SM2_do_sign_ex(dgst, dgstlen, k, x, ec_key))) {
 		*siglen = 0;
 		return 0;
@@ -584,6 +809,18 @@ int SM2_verify(int type, const unsigned char *dgst, int dgstlen,
 		return ret;
 	}
 
+#ifdef ECP_SM2Z256_SM2
+	if (sm2_p256_enabled(ec_key, dgstlen)) {
+		BN_ULONG rr[4], ss[4];
+
+		/* anything but a canonical encoding goes through d2i_ECDSA_SIG */
+		if (siglen > 0 && sm2_p256_der2sig(rr, ss, sig, siglen)
+			&& (ret = sm2_p256_verify(rr, ss, dgst, dgstlen, ec_key)) >= 0) {
+			return ret;
+		}
+	}
+#endif
+
 	if (!(s = ECDSA_SIG_new())) {
 		return ret;
 	}
@@ -606,3 +843,38 @@ err:
 	ECDSA_SIG_free(s);
 	return ret;
 }
+
+int SM2_verify_batch(int type, const unsigned char **dgsts, const int *dgstlens,
+	const unsigned char **sigs, const int *siglens, EC_KEY **ec_keys,
+	size_t num, int *ok)
+{
+	int ret = 1;
+	size_t i;
+
+	if (type != NID_undef) {
+		return -1;
+	}
+
+#ifdef ECP_SM2Z256_SM2
+	if (!sm2_p256_verify_batch(dgsts, dgstlens, sigs, siglens, ec_keys,
+		num, ok)) {
+		return -1;
+	}
+#else
+	for (i = 0; i < num; i++) {
+		ok[i] = -2;
+	}
+#endif
+
+	for (i = 0; i < num; i++) {
+		if (ok[i] == -2) {
+			ok[i] = SM2_verify(type, dgsts[i], dgstlens[i],
+				sigs[i], siglens[i], ec_keys[i]);
+		}
+		if (ok[i] != 1) {
+			ret = 0;
+		}
+	}
+
+	return ret;
+}
@@ -53,9 +53,17 @@
 #include "internal/byteorder.h"
 #include "modes_lcl.h"
 
-#ifdef SM3_SSE3
-# include <x86intrin.h>
+/*
+ * On x86_64 the compression function is compiled for several instruction
+ * sets and selected at runtime from OPENSSL_ia32cap_P, so a generic build
+ * still gets the SIMD message expansion.
+ */
+#if defined(OPENSSL_CPUID_OBJ) && !defined(OPENSSL_NO_ASM) \
+	&& (defined(__x86_64) || defined(__x86_64__)) \
+	&& (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+# define SM3_X86_64
 # include <immintrin.h>
+extern unsigned int OPENSSL_ia32cap_P[];
 
 # define _mm_rotl_epi32(X,i) \
 	_mm_xor_si128(_mm_slli_epi32((X),(i)), _mm_srli_epi32((X),32-(i)))
@@ -81,7 +89,8 @@ void sm3_init(sm3_ctx_t *ctx)
 void sm3_compute_id_digest(unsigned char z[32], const char *id,
 	const unsigned char x[32], const unsigned char y[32])
 {
-	unsigned char zin[] = {
+	/* ENTL || ID || a || b || xG || yG for the default ID and sm2p256v1 */
+	static const unsigned char zin[146] = {
 		0x00, 0x80,
 		0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38,
 		0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38,
@@ -93,38 +102,33 @@ void sm3_compute_id_digest(unsigned char z[32], const char *id,
 		0x4D, 0x5A, 0x9E, 0x4B, 0xCF, 0x65, 0x09, 0xA7,
 		0xF3, 0x97, 0x89, 0xF5, 0x15, 0xAB, 0x8F, 0x92,
 		0xDD, 0xBC, 0xBD, 0x41, 0x4D, 0x94, 0x0E, 0x93,
-       		0x32, 0xC4, 0xAE, 0x2C, 0x1F, 0x19, 0x81, 0x19,
+		0x32, 0xC4, 0xAE, 0x2C, 0x1F, 0x19, 0x81, 0x19,
 		0x5F, 0x99, 0x04, 0x46, 0x6A, 0x39, 0xC9, 0x94,
 		0x8F, 0xE3, 0x0B, 0xBF, 0xF2, 0x66, 0x0B, 0xE1,
 		0x71, 0x5A, 0x45, 0x89, 0x33, 0x4C, 0x74, 0xC7,
 		0xBC, 0x37, 0x36, 0xA2, 0xF4, 0xF6, 0x77, 0x9C,
 		0x59, 0xBD, 0xCE, 0xE3, 0x6B, 0x69, 0x21, 0x53,
 		0xD0, 0xA9, 0x87, 0x7C, 0xC6, 0x2A, 0x47, 0x40,
-        	0x02, 0xDF, 0x32, 0xE5, 0x21, 0x39, 0xF0, 0xA0,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-		0x00, 0x00, 0x00, 0x00, 0x06, 0x90,
+		0x02, 0xDF, 0x32, 0xE5, 0x21, 0x39, 0xF0, 0xA0,
 	};
 
-	if (!id || strcmp(id, "1234567812345678")) {
-		unsigned int digest[8] = {
-			0xadadedb5U, 0x0446043fU, 0x08a87aceU, 0xe86d2243U,
-			0x8e232383U, 0xbfc81fe2U, 0xcf9117c8U, 0x4707011dU,
+	if (!id || !strcmp(id, "1234567812345678")) {
+		/* the state after the first block of zin */
+		uint32_t digest[8] = {
+			0xf88731c5U, 0xa551dc5fU, 0x7d241146U, 0x295642dcU,
+			0xf88842edU, 0x6f273ee5U, 0xc78b0e1cU, 0x38349f56U,
 		};
-		memcpy(&zin[128], x, 32);
-		memcpy(&zin[160], y, 32);
-		sm3_compress_blocks(digest, zin, 2);
+		/* the rest of zin, x and y padded to 210 bytes in total */
+		unsigned char buf[3 * SM3_BLOCK_SIZE];
+
+		memcpy(buf, zin + SM3_BLOCK_SIZE, sizeof(zin) - SM3_BLOCK_SIZE);
+		memcpy(buf + 82, x, 32);
+		memcpy(buf + 114, y, 32);
+		buf[146] = 0x80;
+		memset(buf + 147, 0, sizeof(buf) - 147 - 2);
+		buf[190] = 0x06;
+		buf[191] = 0x90;
+		sm3_compress_blocks(digest, buf, 3);
 		PUTU32(z     , digest[0]);
 		PUTU32(z +  4, digest[1]);
 		PUTU32(z +  8, digest[2]);
@@ -220,7 +224,11 @@ void sm3_final(sm3_ctx_t *ctx, unsigned char *digest)
 }
 
 #define ROTL(x,n)  (((x)<<(n)) | ((x)>>(32-(n))))
-#define P0(x) ((x) ^ ROL32((x), 9) ^ ROL32((x),17))
+#define P0(x) ((x) ^ ROTL((x), 9) ^ ROTL((x),17))
+/*
+ * ROL32 keeps the scalar message expansion from being auto-vectorized,
+ * which is slower than the plain loop because of the W[j - 3] dependency.
+ */
 #define P1(x) ((x) ^ ROL32((x),15) ^ ROL32((x),23))
 
 #define FF00(x,y,z)  ((x) ^ (y) ^ (z))
@@ -229,13 +237,13 @@ void sm3_final(sm3_ctx_t *ctx, unsigned char *digest)
 #define GG16(x,y,z)  ((((y)^(z)) & (x)) ^ (z))
 
 #define R(A, B, C, D, E, F, G, H, xx)				\
-	SS1 = ROL32((ROL32(A, 12) + E + K[j]), 7);		\
-	SS2 = SS1 ^ ROL32(A, 12);				\
+	SS1 = ROTL((ROTL(A, 12) + E + K[j]), 7);		\
+	SS2 = SS1 ^ ROTL(A, 12);				\
 	TT1 = FF##xx(A, B, C) + D + SS2 + (W[j] ^ W[j + 4]);	\
 	TT2 = GG##xx(E, F, G) + H + SS1 + W[j];			\
-	B = ROL32(B, 9);					\
+	B = ROTL(B, 9);						\
 	H = TT1;						\
-	F = ROL32(F, 19);					\
+	F = ROTL(F, 19);					\
 	D = P0(TT2);						\
 	j++
 
@@ -319,7 +327,7 @@ void sm3_final(sm3_ctx_t *ctx, unsigned char *digest)
 #define K62	0x9ea1e762U
 #define K63	0x3d43cec5U
 
-uint32_t K[64] = {
+static const uint32_t K[64] = {
 	K0,  K1,  K2,  K3,  K4,  K5,  K6,  K7,
 	K8,  K9,  K10, K11, K12, K13, K14, K15,
 	K16, K17, K18, K19, K20, K21, K22, K23,
@@ -348,147 +356,220 @@ uint32_t K[64] = {
 	*/
 };
 
-static void sm3_compress_blocks(uint32_t digest[8],
-	const unsigned char *data, size_t blocks)
-{
-	uint32_t A;
-	uint32_t B;
-	uint32_t C;
-	uint32_t D;
-	uint32_t E;
-	uint32_t F;
-	uint32_t G;
-	uint32_t H;
-	uint32_t W[68];
-	uint32_t SS1, SS2, TT1, TT2;
-	int j;
-
-#ifdef SM3_SSE3
-	__m128i X, T, R;
-	__m128i M = _mm_setr_epi32(0, 0, 0, 0xffffffff);
-	__m128i V = _mm_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);
+/*
+ * The message expansion and the rounds are inlined into each of the
+ * compression functions below, so that they are compiled with the
+ * instruction set of that function.
+ */
+#if defined(__GNUC__)
+# define SM3_INLINE static inline __attribute__((always_inline))
+#else
+# define SM3_INLINE static ossl_inline
 #endif
 
-	while (blocks--) {
+SM3_INLINE void sm3_expand(uint32_t W[68], const unsigned char *data)
+{
+	int j;
 
-		A = digest[0];
-		B = digest[1];
-		C = digest[2];
-		D = digest[3];
-		E = digest[4];
-		F = digest[5];
-		G = digest[6];
-		H = digest[7];
+	for (j = 0; j < 16; j++)
+		W[j] = GETU32(data + j*4);
 
+	for (; j < 68; j++)
+		W[j] = P1(W[j - 16] ^ W[j - 9] ^ ROL32(W[j - 3], 15))
+			^ ROL32(W[j - 13], 7) ^ W[j - 6];
+}
 
-#ifdef SM3_SSE3
+SM3_INLINE void sm3_rounds(uint32_t digest[8], const uint32_t W[68])
+{
+	uint32_t A = digest[0];
+	uint32_t B = digest[1];
+	uint32_t C = digest[2];
+	uint32_t D = digest[3];
+	uint32_t E = digest[4];
+	uint32_t F = digest[5];
+	uint32_t G = digest[6];
+	uint32_t H = digest[7];
+	uint32_t SS1, SS2, TT1, TT2;
+	int j = 0;
+
+	R8(A, B, C, D, E, F, G, H, 00);
+	R8(A, B, C, D, E, F, G, H, 00);
+	R8(A, B, C, D, E, F, G, H, 16);
+	R8(A, B, C, D, E, F, G, H, 16);
+	R8(A, B, C, D, E, F, G, H, 16);
+	R8(A, B, C, D, E, F, G, H, 16);
+	R8(A, B, C, D, E, F, G, H, 16);
+	R8(A, B, C, D, E, F, G, H, 16);
+
+	digest[0] ^= A;
+	digest[1] ^= B;
+	digest[2] ^= C;
+	digest[3] ^= D;
+	digest[4] ^= E;
+	digest[5] ^= F;
+	digest[6] ^= G;
+	digest[7] ^= H;
+}
 
-		for (j = 0; j < 16; j += 4) {
-			X = _mm_loadu_si128((__m128i *)(data + j * 4));
-			X = _mm_shuffle_epi8(X, V);
-			_mm_storeu_si128((__m128i *)(W + j), X);
-		}
+static void sm3_compress_blocks_c(uint32_t digest[8],
+	const unsigned char *data, size_t blocks)
+{
+	uint32_t W[68];
 
-		for (j = 16; j < 68; j += 4) {
-			/* X = (W[j - 3], W[j - 2], W[j - 1], 0) */
-			X = _mm_loadu_si128((__m128i *)(W + j - 3));
-			X = _mm_andnot_si128(M, X);
-
-			X = _mm_rotl_epi32(X, 15);
-			T = _mm_loadu_si128((__m128i *)(W + j - 9));
-			X = _mm_xor_si128(X, T);
-			T = _mm_loadu_si128((__m128i *)(W + j - 16));
-			X = _mm_xor_si128(X, T);
-
-			/* P1() */
-			T = _mm_rotl_epi32(X, (23 - 15));
-			T = _mm_xor_si128(T, X);
-			T = _mm_rotl_epi32(T, 15);
-			X = _mm_xor_si128(X, T);
-
-			T = _mm_loadu_si128((__m128i *)(W + j - 13));
-			T = _mm_rotl_epi32(T, 7);
-			X = _mm_xor_si128(X, T);
-			T = _mm_loadu_si128((__m128i *)(W + j - 6));
-			X = _mm_xor_si128(X, T);
-
-			/* W[j + 3] ^= P1(ROL32(W[j + 1], 15)) */
-			R = _mm_shuffle_epi32(X, 0);
-			R = _mm_and_si128(R, M);
-			T = _mm_rotl_epi32(R, 15);
-			T = _mm_xor_si128(T, R);
-			T = _mm_rotl_epi32(T, 9);
-			R = _mm_xor_si128(R, T);
-			R = _mm_rotl_epi32(R, 6);
-			X = _mm_xor_si128(X, R);
-
-			_mm_storeu_si128((__m128i *)(W + j), X);
-		}
-#else
-		for (j = 0; j < 16; j++)
-			W[j] = GETU32(data + j*4);
+	while (blocks--) {
+		sm3_expand(W, data);
+		sm3_rounds(digest, W);
+		data += 64;
+	}
+}
 
-		for (; j < 68; j++)
-			W[j] = P1(W[j - 16] ^ W[j - 9] ^ ROL32(W[j - 3], 15))
-				^ ROL32(W[j - 13], 7) ^ W[j - 6];
-#endif
+#ifdef SM3_X86_64
+/*
+ * W[j .. j + 3] from the previous 16 words kept in X0 .. X3, the result
+ * replaces X0.  W[j + 3] depends on W[j], it is computed with W[j] = 0
+ * and fixed up at the end.
+ */
+#define SM3_EXPAND4(X0, X1, X2, X3, j)					\
+	X = _mm_srli_si128(X3, 4);					\
+	X = _mm_rotl_epi32(X, 15);					\
+	X = _mm_xor_si128(X, _mm_alignr_epi8(X2, X1, 12));		\
+	X = _mm_xor_si128(X, X0);					\
+	T = _mm_rotl_epi32(X, (23 - 15));				\
+	T = _mm_xor_si128(T, X);					\
+	T = _mm_rotl_epi32(T, 15);					\
+	X = _mm_xor_si128(X, T);					\
+	T = _mm_alignr_epi8(X1, X0, 12);				\
+	T = _mm_rotl_epi32(T, 7);					\
+	X = _mm_xor_si128(X, T);					\
+	X = _mm_xor_si128(X, _mm_alignr_epi8(X3, X2, 8));		\
+	R = _mm_shuffle_epi32(X, 0);					\
+	R = _mm_and_si128(R, M);					\
+	T = _mm_rotl_epi32(R, 15);					\
+	T = _mm_xor_si128(T, R);					\
+	T = _mm_rotl_epi32(T, 9);					\
+	R = _mm_xor_si128(R, T);					\
+	R = _mm_rotl_epi32(R, 6);					\
+	X0 = _mm_xor_si128(X, R);					\
+	_mm_store_si128((__m128i *)(W + (j)), X0)
+
+#define R4(A, B, C, D, E, F, G, H, xx)				\
+	R(A, B, C, D, E, F, G, H, xx);				\
+	R(H, A, B, C, D, E, F, G, xx);				\
+	R(G, H, A, B, C, D, E, F, xx);				\
+	R(F, G, H, A, B, C, D, E, xx)
 
+/*
+ * The message expansion runs in SSE registers interleaved with the scalar
+ * rounds, 4 new words are computed while the rounds consume earlier ones.
+ */
+__attribute__((target("ssse3")))
+SM3_INLINE void sm3_compress_simd(uint32_t digest[8], const unsigned char *data)
+{
+	const __m128i M = _mm_setr_epi32(0, 0, 0, 0xffffffff);
+	const __m128i V = _mm_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);
+	__m128i X0, X1, X2, X3, X, T, R;
+	uint32_t W[68] __attribute__((aligned(16)));
+	uint32_t A = digest[0];
+	uint32_t B = digest[1];
+	uint32_t C = digest[2];
+	uint32_t D = digest[3];
+	uint32_t E = digest[4];
+	uint32_t F = digest[5];
+	uint32_t G = digest[6];
+	uint32_t H = digest[7];
+	uint32_t SS1, SS2, TT1, TT2;
+	int j = 0;
+
+	X0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), V);
+	X1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), V);
+	X2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), V);
+	X3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), V);
+	_mm_store_si128((__m128i *)W, X0);
+	_mm_store_si128((__m128i *)(W + 4), X1);
+	_mm_store_si128((__m128i *)(W + 8), X2);
+	_mm_store_si128((__m128i *)(W + 12), X3);
+
+	SM3_EXPAND4(X0, X1, X2, X3, 16); R4(A, B, C, D, E, F, G, H, 00);
+	SM3_EXPAND4(X1, X2, X3, X0, 20); R4(E, F, G, H, A, B, C, D, 00);
+	SM3_EXPAND4(X2, X3, X0, X1, 24); R4(A, B, C, D, E, F, G, H, 00);
+	SM3_EXPAND4(X3, X0, X1, X2, 28); R4(E, F, G, H, A, B, C, D, 00);
+	SM3_EXPAND4(X0, X1, X2, X3, 32); R4(A, B, C, D, E, F, G, H, 16);
+	SM3_EXPAND4(X1, X2, X3, X0, 36); R4(E, F, G, H, A, B, C, D, 16);
+	SM3_EXPAND4(X2, X3, X0, X1, 40); R4(A, B, C, D, E, F, G, H, 16);
+	SM3_EXPAND4(X3, X0, X1, X2, 44); R4(E, F, G, H, A, B, C, D, 16);
+	SM3_EXPAND4(X0, X1, X2, X3, 48); R4(A, B, C, D, E, F, G, H, 16);
+	SM3_EXPAND4(X1, X2, X3, X0, 52); R4(E, F, G, H, A, B, C, D, 16);
+	SM3_EXPAND4(X2, X3, X0, X1, 56); R4(A, B, C, D, E, F, G, H, 16);
+	SM3_EXPAND4(X3, X0, X1, X2, 60); R4(E, F, G, H, A, B, C, D, 16);
+	SM3_EXPAND4(X0, X1, X2, X3, 64); R4(A, B, C, D, E, F, G, H, 16);
+	R4(E, F, G, H, A, B, C, D, 16);
+	R4(A, B, C, D, E, F, G, H, 16);
+	R4(E, F, G, H, A, B, C, D, 16);
+
+	digest[0] ^= A;
+	digest[1] ^= B;
+	digest[2] ^= C;
+	digest[3] ^= D;
+	digest[4] ^= E;
+	digest[5] ^= F;
+	digest[6] ^= G;
+	digest[7] ^= H;
+}
 
-		j = 0;
+__attribute__((target("ssse3")))
+static void sm3_compress_blocks_ssse3(uint32_t digest[8],
+	const unsigned char *data, size_t blocks)
+{
+	while (blocks--) {
+		sm3_compress_simd(digest, data);
+		data += 64;
+	}
+}
 
-#define FULL_UNROLL
-#ifdef FULL_UNROLL
-		R8(A, B, C, D, E, F, G, H, 00);
-		R8(A, B, C, D, E, F, G, H, 00);
-		R8(A, B, C, D, E, F, G, H, 16);
-		R8(A, B, C, D, E, F, G, H, 16);
-		R8(A, B, C, D, E, F, G, H, 16);
-		R8(A, B, C, D, E, F, G, H, 16);
-		R8(A, B, C, D, E, F, G, H, 16);
-		R8(A, B, C, D, E, F, G, H, 16);
-#else
-		for (; j < 16; j++) {
-			SS1 = ROL32((ROL32(A, 12) + E + K(j)), 7);
-			SS2 = SS1 ^ ROL32(A, 12);
-			TT1 = FF00(A, B, C) + D + SS2 + (W[j] ^ W[j + 4]);
-			TT2 = GG00(E, F, G) + H + SS1 + W[j];
-			D = C;
-			C = ROL32(B, 9);
-			B = A;
-			A = TT1;
-			H = G;
-			G = ROL32(F, 19);
-			F = E;
-			E = P0(TT2);
-		}
+/* same code with VEX encoding */
+__attribute__((target("avx")))
+static void sm3_compress_blocks_avx(uint32_t digest[8],
+	const unsigned char *data, size_t blocks)
+{
+	while (blocks--) {
+		sm3_compress_simd(digest, data);
+		data += 64;
+	}
+}
 
-		for (; j < 64; j++) {
-			SS1 = ROL32((ROL32(A, 12) + E + K(j)), 7);
-			SS2 = SS1 ^ ROL32(A, 12);
-			TT1 = FF16(A, B, C) + D + SS2 + (W[j] ^ W[j + 4]);
-			TT2 = GG16(E, F, G) + H + SS1 + W[j];
-			D = C;
-			C = ROL32(B, 9);
-			B = A;
-			A = TT1;
-			H = G;
-			G = ROL32(F, 19);
-			F = E;
-			E = P0(TT2);
-		}
+/* with BMI2 the rotations of the rounds are done by rorx */
+__attribute__((target("avx2,bmi2")))
+static void sm3_compress_blocks_avx2(uint32_t digest[8],
+	const unsigned char *data, size_t blocks)
+{
+	while (blocks--) {
+		sm3_compress_simd(digest, data);
+		data += 64;
+	}
+}
 #endif
 
-		digest[0] ^= A;
-		digest[1] ^= B;
-		digest[2] ^= C;
-		digest[3] ^= D;
-		digest[4] ^= E;
-		digest[5] ^= F;
-		digest[6] ^= G;
-		digest[7] ^= H;
-
-		data += 64;
+static void sm3_compress_blocks(uint32_t digest[8],
+	const unsigned char *data, size_t blocks)
+{
+#ifdef SM3_X86_64
+	/* AVX2 and BMI2 */
+	if ((OPENSSL_ia32cap_P[2] & ((1 << 5) | (1 << 8))) == ((1 << 5) | (1 << 8))) {
+		sm3_compress_blocks_avx2(digest, data, blocks);
+		return;
+	}
+	/* AVX */
+	if (OPENSSL_ia32cap_P[1] & (1 << (60 - 32))) {
+		sm3_compress_blocks_avx(digest, data, blocks);
+		return;
 	}
+	/* SSSE3 */
+	if (OPENSSL_ia32cap_P[1] & (1 << (41 - 32))) {
+		sm3_compress_blocks_ssse3(digest, data, blocks);
+		return;
+	}
+#endif
+	sm3_compress_blocks_c(digest, data, blocks);
 }
 
 void sm3_compress(uint32_t digest[8], const unsigned char block[64])
@@ -47,310 +47,298 @@
  * ====================================================================
  */
 
+/*
+ * Multi-buffer SM3: independent messages are hashed in the 8 32-bit lanes
+ * of AVX2 registers.  Each lane runs its own message, when a message is
+ * finished the next pending one is loaded into the free lane, so messages
+ * of different lengths keep the lanes busy.  When too few messages are
+ * left to fill the lanes, or without AVX2, the scalar sm3_compress() is
+ * used.
+ */
+
 #include <string.h>
+#include <openssl/crypto.h>
 #include <openssl/sm3.h>
 #include "internal/rotate.h"
 #include "internal/byteorder.h"
 #include "modes_lcl.h"
-#include <immintrin.h>
 
+#if defined(OPENSSL_CPUID_OBJ) && !defined(OPENSSL_NO_ASM) \
+	&& (defined(__x86_64) || defined(__x86_64__)) \
+	&& (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+# define SM3_MB_AVX2
+# include <immintrin.h>
+extern unsigned int OPENSSL_ia32cap_P[];
+# define SM3_MB_AVX2_CAPABLE	(OPENSSL_ia32cap_P[2] & (1 << 5))
+#endif
 
-typedef struct {
-	uint32_t A[8];
-	uint32_t B[8];
-	uint32_t C[8];
-	uint32_t D[8];
-	uint32_t E[8];
-	uint32_t F[8];
-	uint32_t G[8];
-	uint32_t H[8];
-} SM3_AVX2_CTX;
+/* below this number of busy lanes the scalar code is faster */
+#define SM3_MB_MIN_LANES	4
 
+#ifdef SM3_MB_AVX2
 
-void sm3_mb_init(sm3_mb_ctx_t *ctx)
+static const uint32_t sm3_iv[8] = {
+	0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600,
+	0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E,
+};
+
+/*
+ * Pad the last (datalen % 64) bytes of a message into one or two blocks,
+ * returns the number of blocks.
+ */
+static size_t sm3_mb_pad(unsigned char tail[SM3_BLOCK_SIZE * 2],
+	const unsigned char *data, size_t datalen)
 {
-	int i;
-	memset(ctx, 0, sizeof(*ctx));
-	for (i = 0; i < 8; i++) {
-		ctx->A[i] = 0x7380166F;
-		ctx->B[i] = 0x4914B2B9;
-		ctx->C[i] = 0x172442D7;
-		ctx->D[i] = 0xDA8A0600;
-		ctx->E[i] = 0xA96F30BC;
-		ctx->F[i] = 0x163138AA;
-		ctx->G[i] = 0xE38DEE4D;
-		ctx->H[i] = 0xB0FB0E4E;
+	size_t num = datalen % SM3_BLOCK_SIZE;
+	size_t blocks = (num + 9 <= SM3_BLOCK_SIZE) ? 1 : 2;
+	uint64_t nbits = (uint64_t)datalen << 3;
+
+	memset(tail, 0, SM3_BLOCK_SIZE * blocks);
+	if (num) {
+		memcpy(tail, data + datalen - num, num);
 	}
+	tail[num] = 0x80;
+	PUTU32(tail + SM3_BLOCK_SIZE * blocks - 8, (uint32_t)(nbits >> 32));
+	PUTU32(tail + SM3_BLOCK_SIZE * blocks - 4, (uint32_t)nbits);
+	return blocks;
 }
 
-void sm3_update(sm3_ctx_t *ctx, const unsigned char *data, size_t data_len)
+static const uint32_t sm3_mb_K[64] = {
+	0x79cc4519U, 0xf3988a32U, 0xe7311465U, 0xce6228cbU,
+	0x9cc45197U, 0x3988a32fU, 0x7311465eU, 0xe6228cbcU,
+	0xcc451979U, 0x988a32f3U, 0x311465e7U, 0x6228cbceU,
+	0xc451979cU, 0x88a32f39U, 0x11465e73U, 0x228cbce6U,
+	0x9d8a7a87U, 0x3b14f50fU, 0x7629ea1eU, 0xec53d43cU,
+	0xd8a7a879U, 0xb14f50f3U, 0x629ea1e7U, 0xc53d43ceU,
+	0x8a7a879dU, 0x14f50f3bU, 0x29ea1e76U, 0x53d43cecU,
+	0xa7a879d8U, 0x4f50f3b1U, 0x9ea1e762U, 0x3d43cec5U,
+	0x7a879d8aU, 0xf50f3b14U, 0xea1e7629U, 0xd43cec53U,
+	0xa879d8a7U, 0x50f3b14fU, 0xa1e7629eU, 0x43cec53dU,
+	0x879d8a7aU, 0x0f3b14f5U, 0x1e7629eaU, 0x3cec53d4U,
+	0x79d8a7a8U, 0xf3b14f50U, 0xe7629ea1U, 0xcec53d43U,
+	0x9d8a7a87U, 0x3b14f50fU, 0x7629ea1eU, 0xec53d43cU,
+	0xd8a7a879U, 0xb14f50f3U, 0x629ea1e7U, 0xc53d43ceU,
+	0x8a7a879dU, 0x14f50f3bU, 0x29ea1e76U, 0x53d43cecU,
+	0xa7a879d8U, 0x4f50f3b1U, 0x9ea1e762U, 0x3d43cec5U,
+};
+
+# define VADD(X, Y)	_mm256_add_epi32(X, Y)
+# define VXOR(X, Y)	_mm256_xor_si256(X, Y)
+# define VAND(X, Y)	_mm256_and_si256(X, Y)
+# define VOR(X, Y)	_mm256_or_si256(X, Y)
+# define VROL(X, i)	VOR(_mm256_slli_epi32(X, i), _mm256_srli_epi32(X, 32 - (i)))
+# define VP0(X)		VXOR(VXOR(X, VROL(X, 9)), VROL(X, 17))
+# define VP1(X)		VXOR(VXOR(X, VROL(X, 15)), VROL(X, 23))
+
+/*
+ * Compress one block in each of the 8 lanes, state[i][j] is the i-th word
+ * of the digest of lane j.
+ */
+__attribute__((target("avx2")))
+static void sm3_mb_compress_avx2(uint32_t state[8][8],
+	const unsigned char *const block[8])
 {
-	size_t blocks = data_len / SM3_BLOCK_SIZE;
-
-	if (ctx->num) {
-		unsigned int left = SM3_BLOCK_SIZE - ctx->num;
-		if (data_len < left) {
-			memcpy(ctx->block + ctx->num, data, data_len);
-			ctx->num += data_len;
-			return;
-		} else {
-			memcpy(ctx->block + ctx->num, data, left);
-			sm3_compress(ctx->digest, ctx->block);
-			ctx->nblocks++;
-			data += left;
-			data_len -= left;
+	const __m256i bswap = _mm256_setr_epi8(
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	__m256i W[68];
+	__m256i A, B, C, D, E, F, G, H;
+	__m256i A12, SS1, SS2, TT1, TT2;
+	__m256i R[8], T[8], U[8];
+	int i, j;
+
+	/* load and transpose 8 words of the 8 lanes at once */
+	for (j = 0; j < 16; j += 8) {
+		for (i = 0; i < 8; i++) {
+			R[i] = _mm256_loadu_si256((const __m256i *)(block[i] + j * 4));
+			R[i] = _mm256_shuffle_epi8(R[i], bswap);
+		}
+		for (i = 0; i < 8; i += 2) {
+			T[i] = _mm256_unpacklo_epi32(R[i], R[i + 1]);
+			T[i + 1] = _mm256_unpackhi_epi32(R[i], R[i + 1]);
+		}
+		for (i = 0; i < 8; i += 4) {
+			U[i] = _mm256_unpacklo_epi64(T[i], T[i + 2]);
+			U[i + 1] = _mm256_unpackhi_epi64(T[i], T[i + 2]);
+			U[i + 2] = _mm256_unpacklo_epi64(T[i + 1], T[i + 3]);
+			U[i + 3] = _mm256_unpackhi_epi64(T[i + 1], T[i + 3]);
+		}
+		for (i = 0; i < 4; i++) {
+			W[j + i] = _mm256_permute2x128_si256(U[i], U[i + 4], 0x20);
+			W[j + i + 4] = _mm256_permute2x128_si256(U[i], U[i + 4], 0x31);
 		}
 	}
 
-	sm3_compress_blocks(ctx->digest, data, blocks);
-	ctx->nblocks += blocks;
-	data += SM3_BLOCK_SIZE * blocks;
-	data_len -= SM3_BLOCK_SIZE * blocks;
+	for (j = 16; j < 68; j++) {
+		W[j] = VXOR(VXOR(VP1(VXOR(VXOR(W[j - 16], W[j - 9]), VROL(W[j - 3], 15))),
+			VROL(W[j - 13], 7)), W[j - 6]);
+	}
 
-	ctx->num = data_len;
-	if (data_len) {
-		memcpy(ctx->block, data, data_len);
+	A = _mm256_loadu_si256((const __m256i *)state[0]);
+	B = _mm256_loadu_si256((const __m256i *)state[1]);
+	C = _mm256_loadu_si256((const __m256i *)state[2]);
+	D = _mm256_loadu_si256((const __m256i *)state[3]);
+	E = _mm256_loadu_si256((const __m256i *)state[4]);
+	F = _mm256_loadu_si256((const __m256i *)state[5]);
+	G = _mm256_loadu_si256((const __m256i *)state[6]);
+	H = _mm256_loadu_si256((const __m256i *)state[7]);
+
+	for (j = 0; j < 64; j++) {
+		A12 = VROL(A, 12);
+		SS1 = VADD(VADD(A12, E), _mm256_set1_epi32((int)sm3_mb_K[j]));
+		SS1 = VROL(SS1, 7);
+		SS2 = VXOR(SS1, A12);
+		if (j < 16) {
+			/* FF00(A, B, C) = A ^ B ^ C, GG00(E, F, G) = E ^ F ^ G */
+			TT1 = VXOR(VXOR(A, B), C);
+			TT2 = VXOR(VXOR(E, F), G);
+		} else {
+			/* FF16 = (A & B) | (A & C) | (B & C), GG16 = ((F ^ G) & E) ^ G */
+			TT1 = VOR(VAND(A, B), VAND(VOR(A, B), C));
+			TT2 = VXOR(VAND(VXOR(F, G), E), G);
+		}
+		TT1 = VADD(VADD(TT1, D), VADD(SS2, VXOR(W[j], W[j + 4])));
+		TT2 = VADD(VADD(TT2, H), VADD(SS1, W[j]));
+		D = C;
+		C = VROL(B, 9);
+		B = A;
+		A = TT1;
+		H = G;
+		G = VROL(F, 19);
+		F = E;
+		E = VP0(TT2);
 	}
+
+	_mm256_storeu_si256((__m256i *)state[0], VXOR(A, _mm256_loadu_si256((const __m256i *)state[0])));
+	_mm256_storeu_si256((__m256i *)state[1], VXOR(B, _mm256_loadu_si256((const __m256i *)state[1])));
+	_mm256_storeu_si256((__m256i *)state[2], VXOR(C, _mm256_loadu_si256((const __m256i *)state[2])));
+	_mm256_storeu_si256((__m256i *)state[3], VXOR(D, _mm256_loadu_si256((const __m256i *)state[3])));
+	_mm256_storeu_si256((__m256i *)state[4], VXOR(E, _mm256_loadu_si256((const __m256i *)state[4])));
+	_mm256_storeu_si256((__m256i *)state[5], VXOR(F, _mm256_loadu_si256((const __m256i *)state[5])));
+	_mm256_storeu_si256((__m256i *)state[6], VXOR(G, _mm256_loadu_si256((const __m256i *)state[6])));
+	_mm256_storeu_si256((__m256i *)state[7], VXOR(H, _mm256_loadu_si256((const __m256i *)state[7])));
 }
 
-void sm3_final(sm3_ctx_t *ctx, unsigned char *digest)
+typedef struct {
+	const unsigned char *data;	/* full blocks of the message */
+	unsigned char *digest;
+	size_t full;			/* number of full blocks */
+	size_t blocks;			/* full blocks plus padding blocks */
+	size_t next;			/* next block to compress */
+	unsigned char tail[SM3_BLOCK_SIZE * 2];
+} SM3_MB_LANE;
+
+static const unsigned char *sm3_mb_lane_block(const SM3_MB_LANE *lane)
 {
-	int i;
-
-	ctx->block[ctx->num] = 0x80;
-
-	if (ctx->num + 9 <= SM3_BLOCK_SIZE) {
-		memset(ctx->block + ctx->num + 1, 0, SM3_BLOCK_SIZE - ctx->num - 9);
-	} else {
-		memset(ctx->block + ctx->num + 1, 0, SM3_BLOCK_SIZE - ctx->num - 1);
-		sm3_compress(ctx->digest, ctx->block);
-		memset(ctx->block, 0, SM3_BLOCK_SIZE - 8);
-	}
-	PUTU32(ctx->block + 56, ctx->nblocks >> 23);
-	PUTU32(ctx->block + 60, (ctx->nblocks << 9) + (ctx->num << 3));
-
-	sm3_compress(ctx->digest, ctx->block);
-	for (i = 0; i < 8; i++) {
-		PUTU32(digest + i*4, ctx->digest[i]);
+	if (lane->next < lane->full) {
+		return lane->data + SM3_BLOCK_SIZE * lane->next;
 	}
+	return lane->tail + SM3_BLOCK_SIZE * (lane->next - lane->full);
 }
 
-
-#define VPUT(addr, X)	_mm256_store_si256((__m256i *)(addr), _mm256_load_si256((__m256i *)(addr), X))
-# define _mm256_rotl_epi32(X, i)			\
-	_mm256_xor_si256(				\
-		_mm256_slli_epi32(a, i),		\
-		_mm256_srli_epi32(a, 32 - i))
-
-/* P0(X) = X ^ (X <<< 9) ^ (X <<< 17) */
-#define P0(X)						\
-	_mm256_xor_si256(				\
-		_mm256_xor_si256(X,			\
-			_mm256_rotl_epi32(X, 9)),	\
-		_mm256_rotl_epi32(X, 17))
-
-/* P1(X) = X ^ (X <<< 15) ^ (X <<< 23) */
-#define P1(X)						\
-	_mm256_xor_si256(				\
-		_mm256_xor_si256(X,			\
-			_mm256_rotl_epi32(X, 15)),	\
-		_mm256_rotl_epi32(X, 23))
-
-/* FF0(X, Y, Z) = X ^ Y ^ Z */
-#define FF00(X,Y,Z)					\
-	_mm256_xor_si256(X, _mm256_xor_si256(Y, Z))
-
-/* FF16(X, Y, Z) = (X and Y) or (X and Z) or (Y and Z) */
-#define FF16(X,Y,Z)					\
-	_mm256_or_si256(				\
-		_mm256_and_si256(X, Y),			\
-		_mm256_or_si256(			\
-			_mm256_and_si256(X, Z),		\
-			_mm256_and_si256(Y, Z)))
-
-/* GG00(X, Y, Z) = X ^ Y ^ Z */
-#define G00(X,Y,Z)	F00(X,Y,Z)
-
-/* #define GG16(x,y,z)  ((((y)^(z)) & (x)) ^ (z)) */
-#define GG16(X,Y,Z)					\
-	_mm256_xor_si256(Z,				\
-		_mm256_and_si256(X,			\
-			_mm256_xor_si256(Y, Z)))
-
-#define R(A, B, C, D, E, F, G, H, xx)				\
-	SS1 = ROL32((ROL32(A, 12) + E + K[j]), 7);		\
-	A12 = VROL(A, 12);					\
-	SS1 = VADD(A12, E);					\
-	SS1 = VADD(SS1, K(j));					\
-	SS1 = VROL(SS1, 7);					\
-	SS2 = VXOR(SS1, A12);					\
-	TT1 = FF##xx(A, B, C);
-	TT1 = VADD(TT1, D);
-	TT1 = VADD(TT1, SS2);
-	TT1 = VXOR(W(j), W(j+4));
-	TT2 = 
-
-	SS2 = SS1 ^ ROL32(A, 12);				\
-	TT1 = FF##xx(A, B, C) + D + SS2 + (W[j] ^ W[j + 4]);	\
-	TT2 = GG##xx(E, F, G) + H + SS1 + W[j];			\
-	B = ROL32(B, 9);					\
-	H = TT1;						\
-	F = ROL32(F, 19);					\
-	D = P0(TT2);						\
-	j++
-
-
-#define R8(A, B, C, D, E, F, G, H, xx)				\
-	R1(A, B, C, D, E, F, G, H, xx);				\
-	R1(H, A, B, C, D, E, F, G, xx);				\
-	R1(G, H, A, B, C, D, E, F, xx);				\
-	R1(F, G, H, A, B, C, D, E, xx);				\
-	R1(E, F, G, H, A, B, C, D, xx);				\
-	R1(D, E, F, G, H, A, B, C, xx);				\
-	R1(C, D, E, F, G, H, A, B, xx);				\
-	R1(B, C, D, E, F, G, H, A, xx)
-
-
-#define T00 0x79cc4519U
-#define T16 0x7a879d8aU
-
-#define K0	0x79cc4519U
-#define K1	0xf3988a32U
-#define K2	0xe7311465U
-#define K3	0xce6228cbU
-#define K4	0x9cc45197U
-#define K5	0x3988a32fU
-#define K6	0x7311465eU
-#define K7	0xe6228cbcU
-#define K8	0xcc451979U
-#define K9	0x988a32f3U
-#define K10	0x311465e7U
-#define K11	0x6228cbceU
-#define K12	0xc451979cU
-#define K13	0x88a32f39U
-#define K14	0x11465e73U
-#define K15	0x228cbce6U
-#define K16	0x9d8a7a87U
-#define K17	0x3b14f50fU
-#define K18	0x7629ea1eU
-#define K19	0xec53d43cU
-#define K20	0xd8a7a879U
-#define K21	0xb14f50f3U
-#define K22	0x629ea1e7U
-#define K23	0xc53d43ceU
-#define K24	0x8a7a879dU
-#define K25	0x14f50f3bU
-#define K26	0x29ea1e76U
-#define K27	0x53d43cecU
-#define K28	0xa7a879d8U
-#define K29	0x4f50f3b1U
-#define K30	0x9ea1e762U
-#define K31	0x3d43cec5U
-#define K32	0x7a879d8aU
-#define K33	0xf50f3b14U
-#define K34	0xea1e7629U
-#define K35	0xd43cec53U
-#define K36	0xa879d8a7U
-#define K37	0x50f3b14fU
-#define K38	0xa1e7629eU
-#define K39	0x43cec53dU
-#define K40	0x879d8a7aU
-#define K41	0x0f3b14f5U
-#define K42	0x1e7629eaU
-#define K43	0x3cec53d4U
-#define K44	0x79d8a7a8U
-#define K45	0xf3b14f50U
-#define K46	0xe7629ea1U
-#define K47	0xcec53d43U
-#define K48	0x9d8a7a87U
-#define K49	0x3b14f50fU
-#define K50	0x7629ea1eU
-#define K51	0xec53d43cU
-#define K52	0xd8a7a879U
-#define K53	0xb14f50f3U
-#define K54	0x629ea1e7U
-#define K55	0xc53d43ceU
-#define K56	0x8a7a879dU
-#define K57	0x14f50f3bU
-#define K58	0x29ea1e76U
-#define K59	0x53d43cecU
-#define K60	0xa7a879d8U
-#define K61	0x4f50f3b1U
-#define K62	0x9ea1e762U
-#define K63	0x3d43cec5U
-
-
-
-
-
-static void sm3_avx2_compress_blocks(uint32_t digest[8][8],
-	const unsigned char *data, size_t offset[8], size_t blocks)
+/* hash the messages, returns how many were started in the lanes */
+static size_t sm3_mb_avx2(const unsigned char *const data[],
+	const size_t datalen[], unsigned char *const digest[], size_t num)
 {
-	VREG A, B, C, D, E, F, G, H;
-	VREG SS1, SS2, TT1, TT2;
-
-	uint32_t W[68][8];
-	int j;
-
-	while (blocks--) {
-
-		A = _mm256_load_si256((__m256i *)ctx->A);
-		B = _mm256_load_si256((__m256i *)ctx->B);
-		C = _mm256_load_si256((__m256i *)ctx->C);
-		D = _mm256_load_si256((__m256i *)ctx->D);
-		E = _mm256_load_si256((__m256i *)ctx->E);
-		F = _mm256_load_si256((__m256i *)ctx->F);
-		G = _mm256_load_si256((__m256i *)ctx->G);
-		H = _mm256_load_si256((__m256i *)ctx->H);
-
-		for (j = 0; j < 16; j++) {
-			W = _mm256_i32gather_epi32((int *)data, I, 4);
-			W = _mm255_shuffle_epi8(W, vindex_swap);
-			_mm256_store_si256((__m256i *)(w + j * 8), W);
+	static const unsigned char zero_block[SM3_BLOCK_SIZE] = {0};
+	SM3_MB_LANE lane[SM3_MB_LANES];
+	uint32_t state[8][SM3_MB_LANES];
+	const unsigned char *block[SM3_MB_LANES];
+	uint32_t dgst[8];
+	size_t todo = 0;
+	int busy = 0;
+	int i, j;
+
+	/* fill the lanes */
+	for (j = 0; j < SM3_MB_LANES; j++) {
+		if (todo < num) {
+			lane[j].data = data[todo];
+			lane[j].digest = digest[todo];
+			lane[j].full = datalen[todo] / SM3_BLOCK_SIZE;
+			lane[j].blocks = lane[j].full
+				+ sm3_mb_pad(lane[j].tail, data[todo], datalen[todo]);
+			lane[j].next = 0;
+			for (i = 0; i < 8; i++) {
+				state[i][j] = sm3_iv[i];
+			}
+			todo++;
+			busy++;
+		} else {
+			lane[j].data = NULL;
 		}
+	}
 
-		for (; j < 68; j++) {
-			PUTV32(W[j],
-				P1(GETV32(W[j - 16]) ^ GETV32(W[j - 9]) ^ ROL32(GETV32(W[j - 3]), 15))
-					^ ROL32(GETV32(W[j - 13]), 7) ^ W[j - 6];
-
+	while (busy >= SM3_MB_MIN_LANES) {
+		for (j = 0; j < SM3_MB_LANES; j++) {
+			block[j] = lane[j].data ? sm3_mb_lane_block(&lane[j]) : zero_block;
 		}
+		sm3_mb_compress_avx2(state, block);
+
+		for (j = 0; j < SM3_MB_LANES; j++) {
+			if (!lane[j].data || ++lane[j].next < lane[j].blocks) {
+				continue;
+			}
+			for (i = 0; i < 8; i++) {
+				PUTU32(lane[j].digest + i * 4, state[i][j]);
+			}
+
+			/* load the next message in the free lane */
+			if (todo < num) {
+				lane[j].data = data[todo];
+				lane[j].digest = digest[todo];
+				lane[j].full = datalen[todo] / SM3_BLOCK_SIZE;
+				lane[j].blocks = lane[j].full
+					+ sm3_mb_pad(lane[j].tail, data[todo], datalen[todo]);
+				lane[j].next = 0;
+				for (i = 0; i < 8; i++) {
+					state[i][j] = sm3_iv[i];
+				}
+				todo++;
+			} else {
+				lane[j].data = NULL;
+				busy--;
+			}
+		}
+	}
 
-
-		j = 0;
-
-
-
-
-
-
-		VPUT(ctx->A, A);
-		VPUT(ctx->B, B);
-		VPUT(ctx->C, C);
-		VPUT(ctx->D, D);
-		VPUT(ctx->E, E);
-		VPUT(ctx->F, F);
-		VPUT(ctx->G, G);
-		VPUT(ctx->H, H);
-
-		data += 64;
+	/* finish the remaining lanes one by one */
+	for (j = 0; j < SM3_MB_LANES; j++) {
+		if (!lane[j].data) {
+			continue;
+		}
+		for (i = 0; i < 8; i++) {
+			dgst[i] = state[i][j];
+		}
+		for (; lane[j].next < lane[j].blocks; lane[j].next++) {
+			sm3_compress(dgst, sm3_mb_lane_block(&lane[j]));
+		}
+		for (i = 0; i < 8; i++) {
+			PUTU32(lane[j].digest + i * 4, dgst[i]);
+		}
 	}
-}
 
-void sm3_compress(uint32_t digest[8], const unsigned char block[64])
-{
-	return sm3_compress_blocks(digest, block, 1);
+	OPENSSL_cleanse(lane, sizeof(lane));
+	OPENSSL_cleanse(state, sizeof(state));
+	OPENSSL_cleanse(dgst, sizeof(dgst));
+	return todo;
 }
+#endif
 
-void sm3(const unsigned char *msg, size_t msglen,
-	unsigned char dgst[SM3_DIGEST_LENGTH])
+/*
+ * digest[i] = SM3(data[i]) for i in [0, num), the messages are independent
+ * and may have different lengths.
+ */
+void sm3_mb(const unsigned char *const data[], const size_t datalen[],
+	unsigned char *const digest[], size_t num)
 {
-	sm3_ctx_t ctx;
+	size_t i = 0;
 
-	sm3_init(&ctx);
-	sm3_update(&ctx, msg, msglen);
-	sm3_final(&ctx, dgst);
-
-	memset(&ctx, 0, sizeof(sm3_ctx_t));
+#ifdef SM3_MB_AVX2
+	if (num >= SM3_MB_MIN_LANES && SM3_MB_AVX2_CAPABLE) {
+		i = sm3_mb_avx2(data, datalen, digest, num);
+	}
+#endif
+	for (; i < num; i++) {
+		sm3(data[i], datalen[i], digest[i]);
+	}
 }
-
@@ -67,9 +67,12 @@ int SM9_unwrap_key(int type,
 	EC_POINT *C = NULL;
 	EVP_MD_CTX *md_ctx = NULL;
 	BN_CTX *bn_ctx = NULL;
-	point_t de;
-	fp12_t w;
-	const BIGNUM *p = SM9_get0_prime();
+	BIGNUM *x;
+	BIGNUM *y;
+	const SM9_Z256_LINE_TABLE *lines;
+	sm9_z256_t xC;
+	sm9_z256_t yC;
+	sm9_z256_fp12_t w;
 	const EVP_MD *kdf_md;
 	unsigned char wbuf[384];
 	unsigned char *out = key;
@@ -98,32 +101,31 @@ int SM9_unwrap_key(int type,
 		goto end;
 	}
 	BN_CTX_start(bn_ctx);
-	if (!point_init(&de, bn_ctx) || !fp12_init(w, bn_ctx)) {
+	x = BN_CTX_get(bn_ctx);
+	y = BN_CTX_get(bn_ctx);
+	if (!y) {
 		SM9err(SM9_F_SM9_UNWRAP_KEY, ERR_R_MALLOC_FAILURE);
 		goto end;
 	}
 
 	/* parse C on E(F_p) */
-	if (!EC_POINT_oct2point(group, C, enced_key, enced_len, bn_ctx)) {
+	if (!EC_POINT_oct2point(group, C, enced_key, enced_len, bn_ctx)
+		|| !EC_POINT_get_affine_coordinates_GFp(group, C, x, y, bn_ctx)
+		|| !sm9_z256_from_bn(xC, x)
+		|| !sm9_z256_from_bn(yC, y)) {
 		SM9err(SM9_F_SM9_UNWRAP_KEY, ERR_R_MALLOC_FAILURE);
 		goto end;
 	}
 
-	/* parse de on E'(E_p^2) */
-	if (!point_from_octets(&de, ASN1_STRING_get0_data(sk->privatePoint), p, bn_ctx)) {
-		SM9err(SM9_F_SM9_UNWRAP_KEY, ERR_R_MALLOC_FAILURE);
+	/* Miller loop lines of de on E'(E_p^2), cached with sk */
+	if (!(lines = sm9_key_get0_line_table(sk))) {
+		SM9err(SM9_F_SM9_UNWRAP_KEY, SM9_R_INVALID_PRIVATE_POINT);
 		goto end;
 	}
 
 	/* w = e(C, de) */
-	if (!rate_pairing(w, &de, C, bn_ctx)) {
-		SM9err(SM9_F_SM9_UNWRAP_KEY, ERR_R_MALLOC_FAILURE);
-		goto end;
-	}
-	if (!fp12_to_bin(w, wbuf)) {
-		SM9err(SM9_F_SM9_UNWRAP_KEY, ERR_R_MALLOC_FAILURE);
-		goto end;
-	}
+	sm9_z256_pairing_with_table(w, lines, xC, yC);
+	sm9_z256_fp12_to_bin(w, wbuf);
 
 	/* K = KDF(C||w||ID_B, klen) */
 	while (outlen > 0) {
@@ -152,8 +154,8 @@ end:
 	EC_GROUP_free(group);
 	EC_POINT_free(C);
 	EVP_MD_CTX_free(md_ctx);
-	fp12_cleanup(w);
-	point_cleanup(&de);
+	OPENSSL_cleanse(w, sizeof(w));
+	OPENSSL_cleanse(wbuf, sizeof(wbuf));
 	if (bn_ctx) {
 		BN_CTX_end(bn_ctx);
 	}
@@ -174,10 +176,10 @@ int SM9_wrap_key(int type, /* NID_sm9kdf_with_sm3 */
 	BN_CTX *bn_ctx = NULL;
 	BIGNUM *r = NULL;
 	BIGNUM *h = NULL;
-	fp12_t w;
+	const SM9_Z256_FP12_TABLE *g;
+	sm9_z256_fp12_t w;
 	const EVP_MD *kdf_md;
 	const EVP_MD *hash1_md;
-	const BIGNUM *p = SM9_get0_prime();
 	const BIGNUM *n = SM9_get0_order();
 	unsigned char cbuf[65];
 	unsigned char wbuf[384];
@@ -210,7 +212,7 @@ int SM9_wrap_key(int type, /* NID_sm9kdf_with_sm3 */
 		goto end;
 	}
 	BN_CTX_start(bn_ctx);
-	if (!(r = BN_CTX_get(bn_ctx)) || !fp12_init(w, bn_ctx)) {
+	if (!(r = BN_CTX_get(bn_ctx))) {
 		SM9err(SM9_F_SM9_WRAP_KEY, ERR_R_MALLOC_FAILURE);
 		goto end;
 	}
@@ -222,8 +224,8 @@ int SM9_wrap_key(int type, /* NID_sm9kdf_with_sm3 */
 		goto end;
 	}
 
-	/* g = e(Ppube, P2) */
-	if (!rate_pairing(w, NULL, Ppube, bn_ctx)) {
+	/* g = e(Ppube, P2), cached with the public parameters */
+	if (!(g = sm9_master_key_get0_gt_table(mpk))) {
 		SM9err(SM9_F_SM9_WRAP_KEY, SM9_R_RATE_PAIRING_ERROR);
 		goto end;
 	}
@@ -272,10 +274,11 @@ int SM9_wrap_key(int type, /* NID_sm9kdf_with_sm3 */
 		}
 
 		/* w = g^r */
-		if (!fp12_pow(w, w, r, p, bn_ctx) || !fp12_to_bin(w, wbuf)) {
+		if (!sm9_z256_fp12_table_pow(w, g, r)) {
 			SM9err(SM9_F_SM9_WRAP_KEY, SM9_R_EXTENSION_FIELD_ERROR);
 			goto end;
 		}
+		sm9_z256_fp12_to_bin(w, wbuf);
 
 		/* K = KDF(C||w||ID_B, klen) */
 		while (outlen > 0) {
@@ -325,6 +328,7 @@ end:
 	OPENSSL_cleanse(cbuf, sizeof(cbuf));
 	OPENSSL_cleanse(wbuf, sizeof(wbuf));
 	OPENSSL_cleanse(dgst, sizeof(dgst));
+	OPENSSL_cleanse(w, sizeof(w));
 	return ret;
 }
 
@@ -44,7 +44,9 @@ static ERR_STRING_DATA SM9_str_functs[] = {
     {ERR_FUNC(SM9_F_SM9_GENERATE_KEY_EXCHANGE), "SM9_generate_key_exchange"},
     {ERR_FUNC(SM9_F_SM9_GENERATE_MASTER_SECRET),
      "SM9_generate_master_secret"},
+    {ERR_FUNC(SM9_F_SM9_GT_TABLE_NEW), "sm9_gt_table_new"},
     {ERR_FUNC(SM9_F_SM9_KEY_NEW), "SM9_KEY_new"},
+    {ERR_FUNC(SM9_F_SM9_LINE_TABLE_NEW), "sm9_line_table_new"},
     {ERR_FUNC(SM9_F_SM9_MASTER_KEY_EXTRACT_KEY),
      "SM9_MASTER_KEY_extract_key"},
     {ERR_FUNC(SM9_F_SM9_MASTER_KEY_NEW), "SM9_MASTER_KEY_new"},
@@ -62,6 +64,7 @@ static ERR_STRING_DATA SM9_str_functs[] = {
     {ERR_FUNC(SM9_F_SM9_SIGNINIT), "SM9_SignInit"},
     {ERR_FUNC(SM9_F_SM9_UNWRAP_KEY), "SM9_unwrap_key"},
     {ERR_FUNC(SM9_F_SM9_VERIFY), "SM9_verify"},
+    {ERR_FUNC(SM9_F_SM9_VERIFY_BATCH), "SM9_verify_batch"},
     {ERR_FUNC(SM9_F_SM9_VERIFYFINAL), "SM9_VerifyFinal"},
     {ERR_FUNC(SM9_F_SM9_VERIFYINIT), "SM9_VerifyInit"},
     {ERR_FUNC(SM9_F_SM9_WRAP_KEY), "SM9_wrap_key"},
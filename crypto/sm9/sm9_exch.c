@@ -75,9 +75,9 @@ int SM9_generate_key_exchange(unsigned char *R, size_t *Rlen,
 	BIGNUM *h = NULL;
 	const EVP_MD *md;
 	int point_form = POINT_CONVERSION_UNCOMPRESSED;
-	const BIGNUM *p = SM9_get0_prime();
 	const BIGNUM *n = SM9_get0_order();
-	fp12_t g;
+	const SM9_Z256_FP12_TABLE *g;
+	sm9_z256_fp12_t w;
 	int len;
 
 	if (!(group = EC_GROUP_new_by_curve_name(NID_sm9bn256v1))
@@ -88,10 +88,6 @@ int SM9_generate_key_exchange(unsigned char *R, size_t *Rlen,
 		goto end;
 	}
 	BN_CTX_start(bn_ctx);
-	if (!fp12_init(g, bn_ctx)) {
-		SM9err(SM9_F_SM9_GENERATE_KEY_EXCHANGE, ERR_R_MALLOC_FAILURE);
-		goto end;
-	}
 
 	/* r = rand(1, n-1) */
 	do {
@@ -137,17 +133,18 @@ int SM9_generate_key_exchange(unsigned char *R, size_t *Rlen,
 	}
 	*Rlen = len;
 
-	/* g = e(Ppube, P2) */
-	if (!rate_pairing(g, NULL, Ppube, bn_ctx)) {
+	/* g = e(Ppube, P2), cached with the key */
+	if (!(g = sm9_key_get0_gt_table(sk))) {
 		SM9err(SM9_F_SM9_GENERATE_KEY_EXCHANGE, ERR_R_SM9_LIB);
 		goto end;
 	}
 
 	/* g1' = g2 = g^r */
-	if (!fp12_pow(g, g, r, p, bn_ctx) || !fp12_to_bin(g, gr)) {
+	if (!sm9_z256_fp12_table_pow(w, g, r)) {
 		SM9err(SM9_F_SM9_GENERATE_KEY_EXCHANGE, ERR_R_SM9_LIB);
 		goto end;
 	}
+	sm9_z256_fp12_to_bin(w, gr);
 
 	ret = 1;
 
@@ -156,7 +153,7 @@ end:
 	EC_POINT_free(Ppube);
 	EC_POINT_free(Q);
 	BN_free(h);
-	fp12_cleanup(g);
+	OPENSSL_cleanse(w, sizeof(w));
 	if (bn_ctx) {
 		BN_CTX_end(bn_ctx);
 	}
@@ -183,9 +180,12 @@ int SM9_compute_share_key_A(int type,
 	EC_POINT *P = NULL;
 	EVP_MD_CTX *md_ctx = NULL;
 	BN_CTX *bn_ctx = NULL;
-	fp12_t g;
-	point_t deA;
-	const BIGNUM *p = SM9_get0_prime();
+	BIGNUM *x;
+	BIGNUM *y;
+	const SM9_Z256_LINE_TABLE *lines;
+	sm9_z256_t xP;
+	sm9_z256_t yP;
+	sm9_z256_fp12_t g;
 	unsigned char x82[1] = {0x82};
 	unsigned char x83[1] = {0x83};
 	unsigned char buf[384 * 2];
@@ -217,36 +217,38 @@ int SM9_compute_share_key_A(int type,
 		goto end;
 	}
 	BN_CTX_start(bn_ctx);
-	if (!point_init(&deA, bn_ctx)
-		|| !fp12_init(g, bn_ctx)) {
+	x = BN_CTX_get(bn_ctx);
+	y = BN_CTX_get(bn_ctx);
+	if (!y) {
 		SM9err(SM9_F_SM9_COMPUTE_SHARE_KEY_A, ERR_R_MALLOC_FAILURE);
 		goto end;
 	}
 
-	/* parse deA */
-	if (ASN1_STRING_length(skA->privatePoint) != 129
-		|| !point_from_octets(&deA, ASN1_STRING_get0_data(skA->privatePoint), p, bn_ctx)) {
+	/* Miller loop lines of deA, cached with skA */
+	if (!(lines = sm9_key_get0_line_table(skA))) {
 		SM9err(SM9_F_SM9_COMPUTE_SHARE_KEY_A, ERR_R_SM9_LIB);
 		goto end;
 	}
 
 	/* parse RB */
-	if (!EC_POINT_oct2point(group, P, RB, 65, bn_ctx)) {
+	if (!EC_POINT_oct2point(group, P, RB, 65, bn_ctx)
+		|| !EC_POINT_get_affine_coordinates_GFp(group, P, x, y, bn_ctx)
+		|| !sm9_z256_from_bn(xP, x)
+		|| !sm9_z256_from_bn(yP, y)) {
 		SM9err(SM9_F_SM9_COMPUTE_SHARE_KEY_A, ERR_R_SM9_LIB);
 		goto end;
 	}
 
 	/* g2' = e(RB, deA) */
-	if (!rate_pairing(g, &deA, P, bn_ctx) || !fp12_to_bin(g, buf)) {
-		SM9err(SM9_F_SM9_COMPUTE_SHARE_KEY_A, ERR_R_SM9_LIB);
-		goto end;
-	}
+	sm9_z256_pairing_with_table(g, lines, xP, yP);
+	sm9_z256_fp12_to_bin(g, buf);
 
 	/* g3' = (g2')^r_A */
-	if (!fp12_pow(g, g, rA, p, bn_ctx) || !fp12_to_bin(g, buf + 384)) {
+	if (!sm9_z256_fp12_pow(g, g, rA)) {
 		SM9err(SM9_F_SM9_COMPUTE_SHARE_KEY_A, ERR_R_SM9_LIB);
 		goto end;
 	}
+	sm9_z256_fp12_to_bin(g, buf + 384);
 
 	/* compute optional S1 */
 	if (SA) {
@@ -328,8 +330,7 @@ end:
 	EC_GROUP_free(group);
 	EC_POINT_free(P);
 	EVP_MD_CTX_free(md_ctx);
-	fp12_cleanup(g);
-	point_cleanup(&deA);
+	OPENSSL_cleanse(g, sizeof(g));
 	if (bn_ctx) {
 		BN_CTX_end(bn_ctx);
 	}
@@ -356,9 +357,12 @@ int SM9_compute_share_key_B(int type,
 	EC_POINT *P = NULL;
 	EVP_MD_CTX *md_ctx = NULL;
 	BN_CTX *bn_ctx = NULL;
-	fp12_t g;
-	point_t deB;
-	const BIGNUM *p = SM9_get0_prime();
+	BIGNUM *x;
+	BIGNUM *y;
+	const SM9_Z256_LINE_TABLE *lines;
+	sm9_z256_t xP;
+	sm9_z256_t yP;
+	sm9_z256_fp12_t g;
 	unsigned char x82[1] = {0x82};
 	unsigned char x83[1] = {0x83};
 	unsigned char g1[384];
@@ -391,36 +395,38 @@ int SM9_compute_share_key_B(int type,
 		goto end;
 	}
 	BN_CTX_start(bn_ctx);
-	if (!point_init(&deB, bn_ctx)
-		|| !fp12_init(g, bn_ctx)) {
+	x = BN_CTX_get(bn_ctx);
+	y = BN_CTX_get(bn_ctx);
+	if (!y) {
 		SM9err(SM9_F_SM9_COMPUTE_SHARE_KEY_B, ERR_R_MALLOC_FAILURE);
 		goto end;
 	}
 
-	/* parse deB */
-	if (ASN1_STRING_length(skB->privatePoint) != 129
-		|| !point_from_octets(&deB, ASN1_STRING_get0_data(skB->privatePoint), p, bn_ctx)) {
+	/* Miller loop lines of deB, cached with skB */
+	if (!(lines = sm9_key_get0_line_table(skB))) {
 		SM9err(SM9_F_SM9_COMPUTE_SHARE_KEY_B, ERR_R_SM9_LIB);
 		goto end;
 	}
 
 	/* parse RA */
-	if (!EC_POINT_oct2point(group, P, RA, 65, bn_ctx)) {
+	if (!EC_POINT_oct2point(group, P, RA, 65, bn_ctx)
+		|| !EC_POINT_get_affine_coordinates_GFp(group, P, x, y, bn_ctx)
+		|| !sm9_z256_from_bn(xP, x)
+		|| !sm9_z256_from_bn(yP, y)) {
 		SM9err(SM9_F_SM9_COMPUTE_SHARE_KEY_B, ERR_R_SM9_LIB);
 		goto end;
 	}
 
 	/* g1 = e(RA, deB) */
-	if (!rate_pairing(g, &deB, P, bn_ctx) || !fp12_to_bin(g, g1)) {
-		SM9err(SM9_F_SM9_COMPUTE_SHARE_KEY_B, ERR_R_SM9_LIB);
-		goto end;
-	}
+	sm9_z256_pairing_with_table(g, lines, xP, yP);
+	sm9_z256_fp12_to_bin(g, g1);
 
 	/* g3 = (g1)^r_B */
-	if (!fp12_pow(g, g, rB, p, bn_ctx) || !fp12_to_bin(g, g3)) {
+	if (!sm9_z256_fp12_pow(g, g, rB)) {
 		SM9err(SM9_F_SM9_COMPUTE_SHARE_KEY_B, ERR_R_SM9_LIB);
 		goto end;
 	}
+	sm9_z256_fp12_to_bin(g, g3);
 
  	/* SKB = KDF(ID_A || ID_B || R_A || R_B || g1 || g2 || g3, Klen) */
 	while (SKBlen > 0) {
@@ -489,8 +495,7 @@ end:
 	EC_GROUP_free(group);
 	EC_POINT_free(P);
 	EVP_MD_CTX_free(md_ctx);
-	fp12_cleanup(g);
-	point_cleanup(&deB);
+	OPENSSL_cleanse(g, sizeof(g));
 	if (bn_ctx) {
 		BN_CTX_end(bn_ctx);
 	}
@@ -102,6 +102,9 @@ struct SM9_MASTER_KEY_st {
 	/* private */
 	BIGNUM *masterSecret;
 
+	/* cached e(P1, Ppubs) or e(Ppube, P2) */
+	struct sm9_z256_fp12_table_st *gt_table;
+
 	int references;
 	int flags;
 	CRYPTO_EX_DATA ex_data;
@@ -120,6 +123,11 @@ struct SM9_KEY_st {
 	/* private */
 	ASN1_OCTET_STRING *privatePoint;
 
+	/* cached e(P1, Ppubs) or e(Ppube, P2) */
+	struct sm9_z256_fp12_table_st *gt_table;
+	/* cached Miller loop lines of h1 * P2 + Ppubs or de */
+	struct sm9_z256_line_table_st *line_table;
+
 	int references;
 	int flags;
 	CRYPTO_EX_DATA ex_data;
@@ -317,9 +325,98 @@ int rate(fp12_t f, const point_t *Q, const BIGNUM *xP, const BIGNUM *yP,
 	const BIGNUM *a, const BIGNUM *k, const BIGNUM *p, BN_CTX *ctx);
 int rate_test(void);
 int rate_pairing(fp12_t r, const point_t *Q, const EC_POINT *P, BN_CTX *ctx);
+int rate_multi_pairing(fp12_t r, const point_t *Q[], const EC_POINT *P[],
+	size_t n, BN_CTX *ctx);
+
+/* fixed-width Montgomery arithmetic, see sm9_z256.c */
+typedef uint64_t sm9_z256_t[4];
+typedef sm9_z256_t sm9_z256_fp2_t[2];
+typedef sm9_z256_fp2_t sm9_z256_fp4_t[2];
+typedef sm9_z256_fp4_t sm9_z256_fp12_t[3];
+
+typedef struct {
+	sm9_z256_fp2_t X;
+	sm9_z256_fp2_t Y;
+	sm9_z256_fp2_t Z;
+} SM9_Z256_TWIST_POINT;
+
+int sm9_z256_from_bn(sm9_z256_t r, const BIGNUM *a);
+int sm9_z256_to_bn(BIGNUM *r, const sm9_z256_t a);
+
+void sm9_z256_fp12_set_one(sm9_z256_fp12_t r);
+void sm9_z256_fp12_copy(sm9_z256_fp12_t r, const sm9_z256_fp12_t a);
+int sm9_z256_fp12_equ(const sm9_z256_fp12_t a, const sm9_z256_fp12_t b);
+void sm9_z256_fp12_mul(sm9_z256_fp12_t r, const sm9_z256_fp12_t a, const sm9_z256_fp12_t b);
+void sm9_z256_fp12_sqr(sm9_z256_fp12_t r, const sm9_z256_fp12_t a);
+void sm9_z256_fp12_inv(sm9_z256_fp12_t r, const sm9_z256_fp12_t a);
+int sm9_z256_fp12_pow(sm9_z256_fp12_t r, const sm9_z256_fp12_t a, const BIGNUM *k);
+int sm9_z256_fp12_from_fp12(sm9_z256_fp12_t r, const fp12_t a);
+int sm9_z256_fp12_to_fp12(fp12_t r, const sm9_z256_fp12_t a);
+void sm9_z256_fp12_to_bin(const sm9_z256_fp12_t a, unsigned char to[384]);
+
+typedef struct sm9_z256_fp12_table_st {
+	sm9_z256_fp12_t g;
+	sm9_z256_fp12_t table[64][15];
+} SM9_Z256_FP12_TABLE;
+
+void sm9_z256_fp12_table_init(SM9_Z256_FP12_TABLE *t, const sm9_z256_fp12_t g);
+int sm9_z256_fp12_table_pow(sm9_z256_fp12_t r, const SM9_Z256_FP12_TABLE *t,
+	const BIGNUM *k);
+
+void sm9_z256_twist_point_set_infinity(SM9_Z256_TWIST_POINT *R);
+int sm9_z256_twist_point_is_at_infinity(const SM9_Z256_TWIST_POINT *P);
+void sm9_z256_twist_point_copy(SM9_Z256_TWIST_POINT *R, const SM9_Z256_TWIST_POINT *P);
+void sm9_z256_twist_point_set_generator(SM9_Z256_TWIST_POINT *R);
+int sm9_z256_twist_point_is_on_curve(const SM9_Z256_TWIST_POINT *P);
+void sm9_z256_twist_point_get_affine(sm9_z256_fp2_t x, sm9_z256_fp2_t y,
+	const SM9_Z256_TWIST_POINT *P);
+void sm9_z256_twist_point_set_affine(SM9_Z256_TWIST_POINT *R,
+	const sm9_z256_fp2_t x, const sm9_z256_fp2_t y);
+void sm9_z256_twist_point_neg(SM9_Z256_TWIST_POINT *R, const SM9_Z256_TWIST_POINT *P);
+void sm9_z256_twist_point_dbl(SM9_Z256_TWIST_POINT *R, const SM9_Z256_TWIST_POINT *P);
+void sm9_z256_twist_point_add(SM9_Z256_TWIST_POINT *R, const SM9_Z256_TWIST_POINT *P,
+	const SM9_Z256_TWIST_POINT *Q);
+int sm9_z256_twist_point_mul(SM9_Z256_TWIST_POINT *R, const BIGNUM *k,
+	const SM9_Z256_TWIST_POINT *P);
+int sm9_z256_twist_point_from_octets(SM9_Z256_TWIST_POINT *R,
+	const unsigned char from[129]);
+int sm9_z256_twist_point_from_point(SM9_Z256_TWIST_POINT *R, const point_t *P);
+int sm9_z256_twist_point_to_point(point_t *R, const SM9_Z256_TWIST_POINT *P);
+
+void sm9_z256_eval_g_tangent(sm9_z256_fp4_t A, sm9_z256_fp2_t B,
+	SM9_Z256_TWIST_POINT *T, const sm9_z256_t xP, const sm9_z256_t yP);
+void sm9_z256_eval_g_line(sm9_z256_fp4_t A, sm9_z256_fp2_t B,
+	SM9_Z256_TWIST_POINT *T, const SM9_Z256_TWIST_POINT *Q,
+	const sm9_z256_t xP, const sm9_z256_t yP);
+void sm9_z256_miller_loop(sm9_z256_fp12_t f, const SM9_Z256_TWIST_POINT *Q,
+	const sm9_z256_t xP, const sm9_z256_t yP);
+
+/* 65 doublings, 15 additions and the two Frobenius lines */
+#define SM9_Z256_NUM_LINES	82
+
+typedef struct sm9_z256_line_table_st {
+	sm9_z256_fp2_t lines[SM9_Z256_NUM_LINES][3];
+} SM9_Z256_LINE_TABLE;
+
+void sm9_z256_line_table_init(SM9_Z256_LINE_TABLE *t, const SM9_Z256_TWIST_POINT *Q);
+void sm9_z256_miller_loop_with_table(sm9_z256_fp12_t f,
+	const SM9_Z256_LINE_TABLE *t, const sm9_z256_t xP, const sm9_z256_t yP);
+void sm9_z256_final_exponent(sm9_z256_fp12_t r, const sm9_z256_fp12_t f);
+int sm9_z256_final_exponent_batch(sm9_z256_fp12_t *r, const sm9_z256_fp12_t *f,
+	size_t n);
+void sm9_z256_pairing(sm9_z256_fp12_t r, const SM9_Z256_TWIST_POINT *Q,
+	const sm9_z256_t xP, const sm9_z256_t yP);
+void sm9_z256_pairing_with_table(sm9_z256_fp12_t r, const SM9_Z256_LINE_TABLE *t,
+	const sm9_z256_t xP, const sm9_z256_t yP);
+int sm9_z256_multi_pairing(sm9_z256_fp12_t r, const SM9_Z256_TWIST_POINT *Q,
+	const sm9_z256_t *xP, const sm9_z256_t *yP, size_t n);
 
 int params_test(void);
 
+const SM9_Z256_FP12_TABLE *sm9_master_key_get0_gt_table(SM9_MASTER_KEY *key);
+const SM9_Z256_FP12_TABLE *sm9_key_get0_gt_table(SM9_KEY *key);
+const SM9_Z256_LINE_TABLE *sm9_key_get0_line_table(SM9_KEY *key);
+
 int sm9_check_pairing(int nid);
 int sm9_check_scheme(int nid);
 int sm9_check_hash1(int nid);
@@ -94,6 +94,11 @@ SM9_MASTER_KEY *SM9_MASTER_KEY_new(void)
 		SM9err(SM9_F_SM9_MASTER_KEY_NEW, ERR_R_MALLOC_FAILURE);
 		return NULL;
 	}
+	if (!(ret->lock = CRYPTO_THREAD_lock_new())) {
+		SM9err(SM9_F_SM9_MASTER_KEY_NEW, ERR_R_MALLOC_FAILURE);
+		OPENSSL_free(ret);
+		return NULL;
+	}
 
 	return ret;
 }
@@ -106,6 +111,8 @@ void SM9_MASTER_KEY_free(SM9_MASTER_KEY *key)
 		ASN1_OBJECT_free(key->hash1);
 		ASN1_OCTET_STRING_free(key->pointPpub);
 		BN_clear_free(key->masterSecret);
+		OPENSSL_free(key->gt_table);
+		CRYPTO_THREAD_lock_free(key->lock);
 	}
 	OPENSSL_clear_free(key, sizeof(*key));
 }
@@ -118,6 +125,11 @@ SM9_KEY *SM9_KEY_new(void)
 		SM9err(SM9_F_SM9_KEY_NEW, ERR_R_MALLOC_FAILURE);
 		return NULL;
 	}
+	if (!(ret->lock = CRYPTO_THREAD_lock_new())) {
+		SM9err(SM9_F_SM9_KEY_NEW, ERR_R_MALLOC_FAILURE);
+		OPENSSL_free(ret);
+		return NULL;
+	}
 
 	return ret;
 }
@@ -131,10 +143,246 @@ void SM9_KEY_free(SM9_KEY *key)
 		ASN1_OCTET_STRING_free(key->pointPpub);
 		ASN1_OCTET_STRING_free(key->identity);
 		ASN1_OCTET_STRING_free(key->publicPoint);
+		OPENSSL_free(key->gt_table);
+		OPENSSL_clear_free(key->line_table, sizeof(*key->line_table));
+		CRYPTO_THREAD_lock_free(key->lock);
 	}
 	OPENSSL_clear_free(key, sizeof(*key));
 }
 
+/*
+ * The pairing value g used by sign/verify (e(P1, Ppubs), Ppubs in G2) and by
+ * encrypt/key exchange (e(Ppube, P2), Ppube in G1) only depends on the
+ * master public key, so it is computed on first use together with a
+ * fixed-base table for g^r and kept until the key is freed.
+ */
+static SM9_Z256_FP12_TABLE *sm9_gt_table_new(const ASN1_OCTET_STRING *pointPpub)
+{
+	SM9_Z256_FP12_TABLE *ret = NULL;
+	SM9_Z256_FP12_TABLE *table = NULL;
+	EC_GROUP *group = NULL;
+	EC_POINT *P = NULL;
+	BN_CTX *bn_ctx = NULL;
+	BIGNUM *x;
+	BIGNUM *y;
+	SM9_Z256_TWIST_POINT Q;
+	sm9_z256_t xP;
+	sm9_z256_t yP;
+	sm9_z256_fp12_t g;
+
+	if (!pointPpub) {
+		SM9err(SM9_F_SM9_GT_TABLE_NEW, SM9_R_INVALID_POINTPPUB);
+		return NULL;
+	}
+	if (!(table = OPENSSL_malloc(sizeof(*table)))
+		|| !(group = EC_GROUP_new_by_curve_name(NID_sm9bn256v1))
+		|| !(P = EC_POINT_new(group))
+		|| !(bn_ctx = BN_CTX_new())) {
+		SM9err(SM9_F_SM9_GT_TABLE_NEW, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+	BN_CTX_start(bn_ctx);
+	x = BN_CTX_get(bn_ctx);
+	y = BN_CTX_get(bn_ctx);
+	if (!y) {
+		SM9err(SM9_F_SM9_GT_TABLE_NEW, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+
+	if (ASN1_STRING_length(pointPpub) == 129) {
+		/* g = e(P1, Ppubs) */
+		if (!sm9_z256_twist_point_from_octets(&Q, ASN1_STRING_get0_data(pointPpub))
+			|| !EC_POINT_copy(P, EC_GROUP_get0_generator(group))) {
+			SM9err(SM9_F_SM9_GT_TABLE_NEW, SM9_R_INVALID_POINTPPUB);
+			goto end;
+		}
+	} else {
+		/* g = e(Ppube, P2) */
+		if (!EC_POINT_oct2point(group, P, ASN1_STRING_get0_data(pointPpub),
+			ASN1_STRING_length(pointPpub), bn_ctx)) {
+			SM9err(SM9_F_SM9_GT_TABLE_NEW, SM9_R_INVALID_POINTPPUB);
+			goto end;
+		}
+		sm9_z256_twist_point_set_generator(&Q);
+	}
+
+	if (!EC_POINT_get_affine_coordinates_GFp(group, P, x, y, bn_ctx)
+		|| !sm9_z256_from_bn(xP, x)
+		|| !sm9_z256_from_bn(yP, y)) {
+		SM9err(SM9_F_SM9_GT_TABLE_NEW, SM9_R_PAIRING_ERROR);
+		goto end;
+	}
+	sm9_z256_pairing(g, &Q, xP, yP);
+	sm9_z256_fp12_table_init(table, g);
+
+	ret = table;
+	table = NULL;
+
+end:
+	OPENSSL_free(table);
+	EC_GROUP_free(group);
+	EC_POINT_free(P);
+	if (bn_ctx) {
+		BN_CTX_end(bn_ctx);
+	}
+	BN_CTX_free(bn_ctx);
+	return ret;
+}
+
+/*
+ * The G2 point in the pairing of a key is fixed: the verification point
+ * h1 * P2 + Ppubs of a signing identity, or the private point de of an
+ * encryption or key exchange key.  The Miller loop lines of that point are
+ * computed on first use and kept with the key.
+ */
+static SM9_Z256_LINE_TABLE *sm9_line_table_new(const SM9_KEY *key)
+{
+	SM9_Z256_LINE_TABLE *ret = NULL;
+	SM9_Z256_LINE_TABLE *table = NULL;
+	BN_CTX *bn_ctx = NULL;
+	BIGNUM *h = NULL;
+	const EVP_MD *md;
+	SM9_Z256_TWIST_POINT Ppubs;
+	SM9_Z256_TWIST_POINT Q;
+
+	if (!(table = OPENSSL_malloc(sizeof(*table)))) {
+		SM9err(SM9_F_SM9_LINE_TABLE_NEW, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+
+	if (OBJ_obj2nid(key->scheme) == NID_sm9sign) {
+
+		/* Q = H1(ID||hid, N) * P2 + Ppubs, not trusting publicPoint */
+		switch (OBJ_obj2nid(key->hash1)) {
+		case NID_sm9hash1_with_sm3:
+			md = EVP_sm3();
+			break;
+		case NID_sm9hash1_with_sha256:
+			md = EVP_sha256();
+			break;
+		default:
+			SM9err(SM9_F_SM9_LINE_TABLE_NEW, SM9_R_INVALID_HASH1);
+			goto end;
+		}
+		if (!key->pointPpub || ASN1_STRING_length(key->pointPpub) != 129
+			|| !sm9_z256_twist_point_from_octets(&Ppubs,
+				ASN1_STRING_get0_data(key->pointPpub))) {
+			SM9err(SM9_F_SM9_LINE_TABLE_NEW, SM9_R_INVALID_POINTPPUB);
+			goto end;
+		}
+		if (!key->identity) {
+			SM9err(SM9_F_SM9_LINE_TABLE_NEW, SM9_R_IDENTITY_REQUIRED);
+			goto end;
+		}
+		if (!(bn_ctx = BN_CTX_new())) {
+			SM9err(SM9_F_SM9_LINE_TABLE_NEW, ERR_R_MALLOC_FAILURE);
+			goto end;
+		}
+		if (!SM9_hash1(md, &h, (const char *)ASN1_STRING_get0_data(key->identity),
+			ASN1_STRING_length(key->identity), SM9_HID_SIGN,
+			SM9_get0_order(), bn_ctx)) {
+			SM9err(SM9_F_SM9_LINE_TABLE_NEW, ERR_R_SM9_LIB);
+			goto end;
+		}
+		sm9_z256_twist_point_set_generator(&Q);
+		if (!sm9_z256_twist_point_mul(&Q, h, &Q)) {
+			SM9err(SM9_F_SM9_LINE_TABLE_NEW, ERR_R_SM9_LIB);
+			goto end;
+		}
+		sm9_z256_twist_point_add(&Q, &Q, &Ppubs);
+
+	} else {
+
+		/* Q = de */
+		if (!key->privatePoint || ASN1_STRING_length(key->privatePoint) != 129
+			|| !sm9_z256_twist_point_from_octets(&Q,
+				ASN1_STRING_get0_data(key->privatePoint))) {
+			SM9err(SM9_F_SM9_LINE_TABLE_NEW, SM9_R_INVALID_PRIVATE_POINT);
+			goto end;
+		}
+	}
+
+	if (sm9_z256_twist_point_is_at_infinity(&Q)) {
+		SM9err(SM9_F_SM9_LINE_TABLE_NEW, SM9_R_PAIRING_ERROR);
+		goto end;
+	}
+	sm9_z256_line_table_init(table, &Q);
+
+	ret = table;
+	table = NULL;
+
+end:
+	OPENSSL_clear_free(table, sizeof(*table));
+	BN_free(h);
+	BN_CTX_free(bn_ctx);
+	return ret;
+}
+
+/*
+ * Returns *cache, computing it with cache_new() on first use.  The value is
+ * computed without holding the lock, if another thread published its value
+ * first ours is discarded.
+ */
+static const void *sm9_get0_cached(void **cache, CRYPTO_RWLOCK *lock,
+	void *(*cache_new)(const void *arg), const void *arg, size_t size)
+{
+	void *value;
+
+	if (!CRYPTO_THREAD_read_lock(lock)) {
+		return NULL;
+	}
+	value = *cache;
+	CRYPTO_THREAD_unlock(lock);
+	if (value) {
+		return value;
+	}
+
+	if (!(value = cache_new(arg))) {
+		return NULL;
+	}
+
+	if (!CRYPTO_THREAD_write_lock(lock)) {
+		OPENSSL_clear_free(value, size);
+		return NULL;
+	}
+	if (!*cache) {
+		*cache = value;
+		value = NULL;
+	}
+	CRYPTO_THREAD_unlock(lock);
+	OPENSSL_clear_free(value, size);
+
+	/* *cache is never changed once set */
+	return *cache;
+}
+
+static void *sm9_gt_table_new_cb(const void *pointPpub)
+{
+	return sm9_gt_table_new(pointPpub);
+}
+
+static void *sm9_line_table_new_cb(const void *key)
+{
+	return sm9_line_table_new(key);
+}
+
+const SM9_Z256_FP12_TABLE *sm9_master_key_get0_gt_table(SM9_MASTER_KEY *key)
+{
+	return sm9_get0_cached((void **)&key->gt_table, key->lock,
+		sm9_gt_table_new_cb, key->pointPpub, sizeof(SM9_Z256_FP12_TABLE));
+}
+
+const SM9_Z256_FP12_TABLE *sm9_key_get0_gt_table(SM9_KEY *key)
+{
+	return sm9_get0_cached((void **)&key->gt_table, key->lock,
+		sm9_gt_table_new_cb, key->pointPpub, sizeof(SM9_Z256_FP12_TABLE));
+}
+
+const SM9_Z256_LINE_TABLE *sm9_key_get0_line_table(SM9_KEY *key)
+{
+	return sm9_get0_cached((void **)&key->line_table, key->lock,
+		sm9_line_table_new_cb, key, sizeof(SM9_Z256_LINE_TABLE));
+}
 
 int SM9PrivateKey_get_gmtls_public_key(SM9PublicParameters *mpk,
 	SM9PrivateKey *sk, unsigned char pub_key[1024])
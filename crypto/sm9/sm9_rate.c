@@ -2158,44 +2158,26 @@ int point_sub(point_t *R, const point_t *P, const point_t *Q, const BIGNUM *p, B
 
 int point_mul(point_t *R, const BIGNUM *k, const point_t *P, const BIGNUM *p, BN_CTX *ctx)
 {
-	int i, n;
-
-	if (BN_is_zero(k)) {
-		return point_set_to_infinity(R);
-	}
+	SM9_Z256_TWIST_POINT T;
 
-	if (!point_copy(R, P)) {
+	if (!sm9_z256_twist_point_from_point(&T, P)
+		|| !sm9_z256_twist_point_mul(&T, k, &T)
+		|| !sm9_z256_twist_point_to_point(R, &T)) {
 		return 0;
 	}
-	n = BN_num_bits(k);
-	for (i = n - 2; i >= 0; i--) {
-
-		if (!point_dbl(R, R, p, ctx)) {
-			return 0;
-		}
-		if (BN_is_bit_set(k, i)) {
-			if (!point_add(R, R, P, p, ctx)) {
-				return 0;
-			}
-		}
-	}
-
 	return 1;
 }
 
 int point_mul_generator(point_t *R, const BIGNUM *k, const BIGNUM *p, BN_CTX *ctx)
 {
-	point_t G;
-
-	memset(&G, 0, sizeof(G));
-	point_init(&G, ctx);
-	point_set_affine_coordinates_bignums(&G,
-		SM9_get0_generator2_x0(),
-		SM9_get0_generator2_x1(),
-		SM9_get0_generator2_y0(),
-		SM9_get0_generator2_y1());
+	SM9_Z256_TWIST_POINT T;
 
-	return point_mul(R, k, &G, p, ctx);
+	sm9_z256_twist_point_set_generator(&T);
+	if (!sm9_z256_twist_point_mul(&T, k, &T)
+		|| !sm9_z256_twist_point_to_point(R, &T)) {
+		return 0;
+	}
+	return 1;
 }
 
 int point_test(const BIGNUM *p, BN_CTX *ctx)
@@ -2621,53 +2603,120 @@ int params_test(void)
 	return 1;
 }
 
+/*
+ * r = e(P, Q), where a NULL Q means the generator P2 of G2 and a NULL P means
+ * the generator P1 of G1.  The pairing is computed with the fixed-width
+ * arithmetic of sm9_z256.c, the BIGNUM based rate() is kept as reference.
+ */
 int rate_pairing(fp12_t r, const point_t *Q, const EC_POINT *P, BN_CTX *ctx)
 {
-	int ret = 1;
-	const EC_GROUP *group;
-	const BIGNUM *p;
-	const BIGNUM *a;
-	const BIGNUM *k;
-	BIGNUM *xP = NULL;
-	BIGNUM *yP = NULL;
+	int ret = 0;
+	EC_GROUP *group = NULL;
+	BIGNUM *xP;
+	BIGNUM *yP;
+	SM9_Z256_TWIST_POINT Qz;
+	sm9_z256_t x, y;
+	sm9_z256_fp12_t f;
 
-	group = EC_GROUP_new_by_curve_name(NID_sm9bn256v1);
-	p = SM9_get0_prime();
-	a = SM9_get0_loop_count();
-#ifdef NOSM9_FAST
-	k = SM9_get0_final_exponent();
-#else
-	k = SM9_get0_fast_final_exponent_p3();
-#endif
+	BN_CTX_start(ctx);
 	xP = BN_CTX_get(ctx);
 	yP = BN_CTX_get(ctx);
+	if (!yP) {
+		goto end;
+	}
 
+	if (!(group = EC_GROUP_new_by_curve_name(NID_sm9bn256v1))) {
+		goto end;
+	}
 	if (!P) {
-		EC_POINT_get_affine_coordinates_GFp(group,
-			EC_GROUP_get0_generator(group), xP, yP, ctx);
-	} else {
-		EC_POINT_get_affine_coordinates_GFp(group, P, xP, yP, ctx);
+		P = EC_GROUP_get0_generator(group);
+	}
+	if (!EC_POINT_get_affine_coordinates_GFp(group, P, xP, yP, ctx)
+		|| !sm9_z256_from_bn(x, xP)
+		|| !sm9_z256_from_bn(y, yP)) {
+		goto end;
 	}
 
 	if (!Q) {
-		point_t P2;
-		point_init(&P2, ctx);
-		point_set_affine_coordinates_bignums(&P2,
-			SM9_get0_generator2_x0(),
-			SM9_get0_generator2_x1(),
-			SM9_get0_generator2_y0(),
-			SM9_get0_generator2_y1());
+		sm9_z256_twist_point_set_generator(&Qz);
+	} else if (!sm9_z256_twist_point_from_point(&Qz, Q)) {
+		goto end;
+	}
 
-		rate(r, &P2, xP, yP, a, k, p, ctx);
+	sm9_z256_pairing(f, &Qz, x, y);
+	if (!sm9_z256_fp12_to_fp12(r, f)) {
+		goto end;
+	}
 
-		point_cleanup(&P2);
-	} else {
-		rate(r, Q, xP, yP, a, k, p, ctx);
+	ret = 1;
+end:
+	EC_GROUP_free(group);
+	BN_CTX_end(ctx);
+	return ret;
+}
+
+/*
+ * r = e(P[0], Q[0]) * ... * e(P[n-1], Q[n-1]), the Miller loops run over the
+ * same loop count bits into one accumulator and share a single final
+ * exponentiation.  NULL entries mean the generators as in rate_pairing().
+ */
+int rate_multi_pairing(fp12_t r, const point_t *Q[], const EC_POINT *P[],
+	size_t n, BN_CTX *ctx)
+{
+	int ret = 0;
+	EC_GROUP *group = NULL;
+	BIGNUM *xP;
+	BIGNUM *yP;
+	SM9_Z256_TWIST_POINT *Qz = NULL;
+	sm9_z256_t *x = NULL;
+	sm9_z256_t *y = NULL;
+	sm9_z256_fp12_t f;
+	size_t i;
+
+	BN_CTX_start(ctx);
+	xP = BN_CTX_get(ctx);
+	yP = BN_CTX_get(ctx);
+	if (!yP) {
+		goto end;
 	}
 
-	BN_free(xP);
-	BN_free(yP);
-	EC_GROUP_clear_free(group);
+	if (!(group = EC_GROUP_new_by_curve_name(NID_sm9bn256v1))) {
+		goto end;
+	}
+	if (n > 0
+		&& (!(Qz = OPENSSL_malloc(sizeof(*Qz) * n))
+		|| !(x = OPENSSL_malloc(sizeof(*x) * n))
+		|| !(y = OPENSSL_malloc(sizeof(*y) * n)))) {
+		goto end;
+	}
+
+	for (i = 0; i < n; i++) {
+		const EC_POINT *Pi = P[i] ? P[i] : EC_GROUP_get0_generator(group);
+
+		if (!EC_POINT_get_affine_coordinates_GFp(group, Pi, xP, yP, ctx)
+			|| !sm9_z256_from_bn(x[i], xP)
+			|| !sm9_z256_from_bn(y[i], yP)) {
+			goto end;
+		}
+		if (!Q[i]) {
+			sm9_z256_twist_point_set_generator(&Qz[i]);
+		} else if (!sm9_z256_twist_point_from_point(&Qz[i], Q[i])) {
+			goto end;
+		}
+	}
+
+	if (!sm9_z256_multi_pairing(f, Qz, x, y, n)
+		|| !sm9_z256_fp12_to_fp12(r, f)) {
+		goto end;
+	}
+
+	ret = 1;
+end:
+	OPENSSL_free(Qz);
+	OPENSSL_free(x);
+	OPENSSL_free(y);
+	EC_GROUP_free(group);
+	BN_CTX_end(ctx);
 	return ret;
 }
 
@@ -2721,9 +2770,38 @@ int rate_test(void)
 }
 
 /* for SM9 sign, the (xP, yP) is the fixed generator of E(Fp)
+ * the output r[] is in the order of a[0][0][0], a[0][0][1], a[0][1][0], ...
  */
 int SM9_rate_pairing(BIGNUM *r[12], const BIGNUM *xQ[2], const BIGNUM *yQ[2],
 	const BIGNUM *xP, const BIGNUM *yP, BN_CTX *ctx)
 {
-	return 0;
+	SM9_Z256_TWIST_POINT Q;
+	sm9_z256_t x, y;
+	sm9_z256_fp12_t f;
+	int i, j;
+
+	if (!sm9_z256_from_bn(Q.X[0], xQ[0])
+		|| !sm9_z256_from_bn(Q.X[1], xQ[1])
+		|| !sm9_z256_from_bn(Q.Y[0], yQ[0])
+		|| !sm9_z256_from_bn(Q.Y[1], yQ[1])
+		|| !sm9_z256_from_bn(x, xP)
+		|| !sm9_z256_from_bn(y, yP)) {
+		return 0;
+	}
+	sm9_z256_from_bn(Q.Z[0], BN_value_one());
+	memset(Q.Z[1], 0, sizeof(Q.Z[1]));
+	if (!sm9_z256_twist_point_is_on_curve(&Q)) {
+		return 0;
+	}
+
+	sm9_z256_pairing(f, &Q, x, y);
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 2; j++) {
+			if (!sm9_z256_to_bn(r[4*i + 2*j], f[i][j][0])
+				|| !sm9_z256_to_bn(r[4*i + 2*j + 1], f[i][j][1])) {
+				return 0;
+			}
+		}
+	}
+	return 1;
 }
@@ -85,7 +85,6 @@ SM9Signature *SM9_SignFinal(EVP_MD_CTX *ctx1, SM9PrivateKey *sk)
 {
 	SM9Signature *ret = NULL;
 	SM9Signature *sig = NULL;
-	const BIGNUM *p = SM9_get0_prime();
 	const BIGNUM *n = SM9_get0_order();
 	int point_form = POINT_CONVERSION_COMPRESSED;
 	/* buf for w and prefix zeros of ct1/2 */
@@ -98,8 +97,8 @@ SM9Signature *SM9_SignFinal(EVP_MD_CTX *ctx1, SM9PrivateKey *sk)
 	EC_POINT *S = NULL;
 	BN_CTX *bn_ctx = NULL;
 	BIGNUM *r = NULL;
-	point_t Ppubs;
-	fp12_t w;
+	const SM9_Z256_FP12_TABLE *g;
+	sm9_z256_fp12_t w;
 
 	if (!(sig = SM9Signature_new())
 		|| !(ctx2 = EVP_MD_CTX_new())
@@ -110,22 +109,17 @@ SM9Signature *SM9_SignFinal(EVP_MD_CTX *ctx1, SM9PrivateKey *sk)
 		goto end;
 	}
 	BN_CTX_start(bn_ctx);
-	if (!(r = BN_CTX_get(bn_ctx))
-		|| !fp12_init(w, bn_ctx)
-		|| !point_init(&Ppubs, bn_ctx)) {
+	if (!(r = BN_CTX_get(bn_ctx))) {
 		SM9err(SM9_F_SM9_SIGNFINAL, ERR_R_MALLOC_FAILURE);
 		goto end;
 	}
 
-
-	/* get Ppubs */
-	if (ASN1_STRING_length(sk->pointPpub) != 129
-		|| !point_from_octets(&Ppubs, ASN1_STRING_get0_data(sk->pointPpub), p, bn_ctx)) {
+	/* g = e(P1, Ppubs), cached with the key */
+	if (ASN1_STRING_length(sk->pointPpub) != 129) {
 		SM9err(SM9_F_SM9_SIGNFINAL, SM9_R_INVALID_POINTPPUB);
 		goto end;
 	}
-	/* g = e(P1, Ppubs) */
-	if (!rate_pairing(w, &Ppubs, EC_GROUP_get0_generator(group), bn_ctx)) {
+	if (!(g = sm9_key_get0_gt_table(sk))) {
 		SM9err(SM9_F_SM9_SIGNFINAL, SM9_R_PAIRING_ERROR);
 		goto end;
 	}
@@ -140,11 +134,11 @@ SM9Signature *SM9_SignFinal(EVP_MD_CTX *ctx1, SM9PrivateKey *sk)
 		} while (BN_is_zero(r));
 
 		/* w = g^r */
-		if (!fp12_pow(w, w, r, p, bn_ctx)
-			|| !fp12_to_bin(w, buf)) {
+		if (!sm9_z256_fp12_table_pow(w, g, r)) {
 			SM9err(SM9_F_SM9_SIGNFINAL, SM9_R_EXTENSION_FIELD_ERROR);
 			goto end;
 		}
+		sm9_z256_fp12_to_bin(w, buf);
 
 		if (!EVP_DigestUpdate(ctx1, buf, sizeof(buf))
 			|| !EVP_MD_CTX_copy(ctx2, ctx1)
@@ -194,8 +188,7 @@ end:
 	EC_GROUP_free(group);
 	EC_POINT_free(S);
 	BN_free(r);
-	point_cleanup(&Ppubs);
-	fp12_cleanup(w);
+	OPENSSL_cleanse(w, sizeof(w));
 	BN_CTX_end(bn_ctx);
 	BN_CTX_free(bn_ctx);
 	return ret;
@@ -228,12 +221,14 @@ static const EVP_MD *sm9hash1_to_md(const ASN1_OBJECT *hash1obj)
 	return NULL;
 }
 
-int SM9_VerifyFinal(EVP_MD_CTX *ctx1, const SM9Signature *sig, SM9PublicKey *pk)
+/*
+ * g is the cached e(P1, Ppubs) of the master public key, lines are the
+ * Miller loop lines of P = h1 * P2 + Ppubs of the signer
+ */
+static int sm9_do_verify_final(EVP_MD_CTX *ctx1, const SM9Signature *sig,
+	const SM9_Z256_LINE_TABLE *lines, const SM9_Z256_FP12_TABLE *g)
 {
 	int ret = -1;
-	const BIGNUM *p = SM9_get0_prime();
-	const BIGNUM *n = SM9_get0_order();
-	const EVP_MD *md;
 	unsigned char buf[384] = {0};
 	unsigned int len;
 	const unsigned char ct1[4] = {0x00, 0x00, 0x00, 0x01};
@@ -242,11 +237,13 @@ int SM9_VerifyFinal(EVP_MD_CTX *ctx1, const SM9Signature *sig, SM9PublicKey *pk)
 	EC_GROUP *group = NULL;
 	EC_POINT *S = NULL;
 	BN_CTX *bn_ctx = NULL;
-	BIGNUM *h = NULL;
-	point_t Ppubs;
-	point_t P;
-	fp12_t w;
-	fp12_t u;
+	BIGNUM *h;
+	BIGNUM *x;
+	BIGNUM *y;
+	sm9_z256_t xS;
+	sm9_z256_t yS;
+	sm9_z256_fp12_t t;
+	sm9_z256_fp12_t u;
 
 	if (!(ctx2 = EVP_MD_CTX_new())
 		|| !(group = EC_GROUP_new_by_curve_name(NID_sm9bn256v1))
@@ -256,11 +253,10 @@ int SM9_VerifyFinal(EVP_MD_CTX *ctx1, const SM9Signature *sig, SM9PublicKey *pk)
 		goto end;
 	}
 	BN_CTX_start(bn_ctx);
-	if (!(h = BN_CTX_get(bn_ctx))
-		|| !point_init(&Ppubs, bn_ctx)
-		|| !point_init(&P, bn_ctx)
-		|| !fp12_init(w, bn_ctx)
-		|| !fp12_init(u, bn_ctx)) {
+	h = BN_CTX_get(bn_ctx);
+	x = BN_CTX_get(bn_ctx);
+	y = BN_CTX_get(bn_ctx);
+	if (!y) {
 		SM9err(SM9_F_SM9_VERIFYFINAL, ERR_R_MALLOC_FAILURE);
 		goto end;
 	}
@@ -271,50 +267,26 @@ int SM9_VerifyFinal(EVP_MD_CTX *ctx1, const SM9Signature *sig, SM9PublicKey *pk)
 		goto end;
 	}
 	if (!EC_POINT_oct2point(group, S, ASN1_STRING_get0_data(sig->pointS),
-		ASN1_STRING_length(sig->pointS), bn_ctx)) {
+		ASN1_STRING_length(sig->pointS), bn_ctx)
+		|| !EC_POINT_get_affine_coordinates_GFp(group, S, x, y, bn_ctx)
+		|| !sm9_z256_from_bn(xS, x)
+		|| !sm9_z256_from_bn(yS, y)) {
 		SM9err(SM9_F_SM9_VERIFYFINAL, SM9_R_INVALID_SIGNATURE);
 		goto end;
 	}
 
-	/* g = e(P1, Ppubs) */
-	if (ASN1_STRING_length(pk->pointPpub) != 129
-		|| !point_from_octets(&Ppubs, ASN1_STRING_get0_data(pk->pointPpub), p, bn_ctx)) {
-		SM9err(SM9_F_SM9_VERIFYFINAL, SM9_R_INVALID_POINTPPUB);
-		goto end;
-	}
-	if (!rate_pairing(w, &Ppubs, EC_GROUP_get0_generator(group), bn_ctx)) {
-		SM9err(SM9_F_SM9_VERIFYFINAL, SM9_R_PAIRING_ERROR);
-		goto end;
-	}
-
 	/* t = g^(sig->h) */
-	if (!fp12_pow(w, w, sig->h, p, bn_ctx)) {
+	if (!sm9_z256_fp12_table_pow(t, g, sig->h)) {
 		SM9err(SM9_F_SM9_VERIFYFINAL, SM9_R_EXTENSION_FIELD_ERROR);
 		goto end;
 	}
 
-	/* h1 = H1(ID||hid, N) */
-	if (!(md = sm9hash1_to_md(pk->hash1))) {
-		SM9err(SM9_F_SM9_VERIFYFINAL, SM9_R_INVALID_HASH1);
-		goto end;
-	}
-	if (!SM9_hash1(md, &h, (const char *)ASN1_STRING_get0_data(pk->identity),
-		ASN1_STRING_length(pk->identity), SM9_HID_SIGN, n, bn_ctx)) {
-		SM9err(SM9_F_SM9_VERIFYFINAL, ERR_R_SM9_LIB);
-		goto end;
-	}
+	/* u = e(sig->S, P) */
+	sm9_z256_pairing_with_table(u, lines, xS, yS);
 
-	/* P = h1 * P2 + Ppubs */
-	if (!point_mul_generator(&P, h, p, bn_ctx)
-		|| !point_add(&P, &P, &Ppubs, p, bn_ctx)
-		/* u = e(sig->S, P) */
-		|| !rate_pairing(u, &P, S, bn_ctx)
-		/* w = u * t */
-		|| !fp12_mul(w, u, w, p, bn_ctx)
-		|| !fp12_to_bin(w, buf)) {
-		SM9err(SM9_F_SM9_VERIFYFINAL, SM9_R_EXTENSION_FIELD_ERROR);
-		goto end;
-	}
+	/* w = u * t */
+	sm9_z256_fp12_mul(u, u, t);
+	sm9_z256_fp12_to_bin(u, buf);
 
 	/* h2 = H2(M||w) mod n */
 	if (!EVP_DigestUpdate(ctx1, buf, sizeof(buf))
@@ -350,16 +322,27 @@ end:
 	EVP_MD_CTX_free(ctx2);
 	EC_GROUP_free(group);
 	EC_POINT_free(S);
-	BN_free(h);
-	point_cleanup(&Ppubs);
-	point_cleanup(&P);
-	fp12_cleanup(w);
-	fp12_cleanup(u);
-	BN_CTX_end(bn_ctx);
+	if (bn_ctx) {
+		BN_CTX_end(bn_ctx);
+	}
 	BN_CTX_free(bn_ctx);
 	return ret;
 }
 
+int SM9_VerifyFinal(EVP_MD_CTX *ctx1, const SM9Signature *sig, SM9PublicKey *pk)
+{
+	const SM9_Z256_FP12_TABLE *g;
+	const SM9_Z256_LINE_TABLE *lines;
+
+	/* g = e(P1, Ppubs) and the lines of h1 * P2 + Ppubs, cached with the key */
+	if (!(g = sm9_key_get0_gt_table(pk))
+		|| !(lines = sm9_key_get0_line_table(pk))) {
+		SM9err(SM9_F_SM9_VERIFYFINAL, SM9_R_PAIRING_ERROR);
+		return -1;
+	}
+	return sm9_do_verify_final(ctx1, sig, lines, g);
+}
+
 int SM9_sign(int type, /* NID_[sm3 | sha256] */
 	const unsigned char *data, size_t datalen,
 	unsigned char *sig, size_t *siglen,
@@ -412,6 +395,8 @@ int SM9_verify(int type, /* NID_[sm3 | sha256] */
 	EVP_MD_CTX *ctx = NULL;
 	SM9Signature *sm9sig = NULL;
 	SM9PublicKey *pk = NULL;
+	const SM9_Z256_FP12_TABLE *g;
+	const SM9_Z256_LINE_TABLE *lines;
 	const EVP_MD *md;
 
 	if (!(md = EVP_get_digestbynid(type))
@@ -435,9 +420,15 @@ int SM9_verify(int type, /* NID_[sm3 | sha256] */
 		SM9err(SM9_F_SM9_VERIFY, ERR_R_MALLOC_FAILURE);
 		goto end;
 	}
+	/* use the pairing cached with mpk, pk only lives for this call */
+	if (!(g = sm9_master_key_get0_gt_table(mpk))
+		|| !(lines = sm9_key_get0_line_table(pk))) {
+		SM9err(SM9_F_SM9_VERIFY, SM9_R_PAIRING_ERROR);
+		goto end;
+	}
 	if (!SM9_VerifyInit(ctx, md, NULL)
 		|| !SM9_VerifyUpdate(ctx, data, datalen)
-		|| (ret = SM9_VerifyFinal(ctx, sm9sig, pk)) < 0) {
+		|| (ret = sm9_do_verify_final(ctx, sm9sig, lines, g)) < 0) {
 		SM9err(SM9_F_SM9_VERIFY, ERR_R_SM9_LIB);
 		goto end;
 	}
@@ -448,3 +439,221 @@ end:
 	SM9PublicKey_free(pk);
 	return ret;
 }
+
+/*
+ * Verify num signatures under the same master public key. ok[i] is set to 1
+ * if signature i is valid, 0 if it is not and -1 on error. Returns 1 if all
+ * the signatures are valid, 0 if any of them is invalid and -1 on error.
+ *
+ * An SM9 signature is checked by comparing h with H2(M||w') where
+ * w' = e(S, h1 * P2 + Ppubs) * g^h, so every w' has to be computed on its
+ * own.  What is shared between the signatures is the parsing of mpk, the
+ * cached g table, the Miller loop lines of the h1 * P2 + Ppubs point of
+ * consecutive signatures with the same identity and the fp12 inversion of
+ * all final exponentiations.
+ */
+int SM9_verify_batch(int type, /* NID_[sm3 | sha256] */
+	const unsigned char *const data[], const size_t datalen[],
+	const unsigned char *const sig[], const size_t siglen[],
+	const char *const id[], const size_t idlen[], size_t num,
+	SM9PublicParameters *mpk, int *ok)
+{
+	int ret = -1;
+	const BIGNUM *n = SM9_get0_order();
+	const EVP_MD *md;
+	const EVP_MD *hash1_md;
+	const SM9_Z256_FP12_TABLE *g;
+	unsigned char prefix[1] = {0x02};
+	const unsigned char ct1[4] = {0x00, 0x00, 0x00, 0x01};
+	const unsigned char ct2[4] = {0x00, 0x00, 0x00, 0x02};
+	unsigned char buf[384];
+	unsigned int len;
+	SM9Signature **sigs = NULL;
+	sm9_z256_fp12_t *f = NULL;
+	SM9_Z256_LINE_TABLE *lines = NULL;
+	EVP_MD_CTX *ctx1 = NULL;
+	EVP_MD_CTX *ctx2 = NULL;
+	EC_GROUP *group = NULL;
+	EC_POINT *S = NULL;
+	BN_CTX *bn_ctx = NULL;
+	BIGNUM *h = NULL;
+	BIGNUM *x;
+	BIGNUM *y;
+	SM9_Z256_TWIST_POINT Ppubs;
+	SM9_Z256_TWIST_POINT P;
+	sm9_z256_t xS;
+	sm9_z256_t yS;
+	sm9_z256_fp12_t t;
+	const char *lines_id = NULL;
+	size_t lines_idlen = 0;
+	size_t i;
+
+	for (i = 0; i < num; i++) {
+		ok[i] = -1;
+	}
+
+	if (!(md = EVP_get_digestbynid(type))
+		|| EVP_MD_size(md) != EVP_MD_size(EVP_sm3())) {
+		SM9err(SM9_F_SM9_VERIFY_BATCH, SM9_R_INVALID_HASH2_DIGEST);
+		return -1;
+	}
+	if (!(hash1_md = sm9hash1_to_md(mpk->hash1))) {
+		SM9err(SM9_F_SM9_VERIFY_BATCH, SM9_R_INVALID_HASH1);
+		return -1;
+	}
+	if (num == 0) {
+		return 1;
+	}
+
+	if (!(sigs = OPENSSL_zalloc(sizeof(*sigs) * num))
+		|| !(f = OPENSSL_malloc(sizeof(*f) * num))
+		|| !(lines = OPENSSL_malloc(sizeof(*lines)))
+		|| !(ctx1 = EVP_MD_CTX_new())
+		|| !(ctx2 = EVP_MD_CTX_new())
+		|| !(group = EC_GROUP_new_by_curve_name(NID_sm9bn256v1))
+		|| !(S = EC_POINT_new(group))
+		|| !(bn_ctx = BN_CTX_new())) {
+		SM9err(SM9_F_SM9_VERIFY_BATCH, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+	BN_CTX_start(bn_ctx);
+	x = BN_CTX_get(bn_ctx);
+	y = BN_CTX_get(bn_ctx);
+	if (!y) {
+		SM9err(SM9_F_SM9_VERIFY_BATCH, ERR_R_MALLOC_FAILURE);
+		goto end;
+	}
+
+	/* g = e(P1, Ppubs) */
+	if (ASN1_STRING_length(mpk->pointPpub) != 129
+		|| !sm9_z256_twist_point_from_octets(&Ppubs,
+			ASN1_STRING_get0_data(mpk->pointPpub))) {
+		SM9err(SM9_F_SM9_VERIFY_BATCH, SM9_R_INVALID_POINTPPUB);
+		goto end;
+	}
+	if (!(g = sm9_master_key_get0_gt_table(mpk))) {
+		SM9err(SM9_F_SM9_VERIFY_BATCH, SM9_R_PAIRING_ERROR);
+		goto end;
+	}
+
+	for (i = 0; i < num; i++) {
+		const unsigned char *p = sig[i];
+
+		/* check signature (h, S), a malformed one is just invalid */
+		ERR_set_mark();
+		if (!(sigs[i] = d2i_SM9Signature(NULL, &p, siglen[i]))
+			|| i2d_SM9Signature(sigs[i], NULL) != siglen[i]
+			|| BN_is_zero(sigs[i]->h) || BN_cmp(sigs[i]->h, n) >= 0
+			|| !EC_POINT_oct2point(group, S, ASN1_STRING_get0_data(sigs[i]->pointS),
+				ASN1_STRING_length(sigs[i]->pointS), bn_ctx)
+			|| !EC_POINT_get_affine_coordinates_GFp(group, S, x, y, bn_ctx)
+			|| !sm9_z256_from_bn(xS, x)
+			|| !sm9_z256_from_bn(yS, y)) {
+			ERR_pop_to_mark();
+			ok[i] = 0;
+			sm9_z256_fp12_set_one(f[i]);
+			continue;
+		}
+		ERR_pop_to_mark();
+
+		/* P = H1(ID||hid, N) * P2 + Ppubs */
+		if (!lines_id || idlen[i] != lines_idlen
+			|| memcmp(id[i], lines_id, idlen[i]) != 0) {
+			if (!SM9_hash1(hash1_md, &h, id[i], idlen[i], SM9_HID_SIGN, n, bn_ctx)) {
+				SM9err(SM9_F_SM9_VERIFY_BATCH, ERR_R_SM9_LIB);
+				goto end;
+			}
+			sm9_z256_twist_point_set_generator(&P);
+			if (!sm9_z256_twist_point_mul(&P, h, &P)) {
+				SM9err(SM9_F_SM9_VERIFY_BATCH, SM9_R_TWIST_CURVE_ERROR);
+				goto end;
+			}
+			sm9_z256_twist_point_add(&P, &P, &Ppubs);
+			sm9_z256_line_table_init(lines, &P);
+			lines_id = id[i];
+			lines_idlen = idlen[i];
+		}
+
+		/* f[i] = Miller loop of e(S, P) */
+		sm9_z256_miller_loop_with_table(f[i], lines, xS, yS);
+	}
+
+	if (!sm9_z256_final_exponent_batch(f, f, num)) {
+		SM9err(SM9_F_SM9_VERIFY_BATCH, SM9_R_PAIRING_ERROR);
+		goto end;
+	}
+
+	ret = 1;
+	for (i = 0; i < num; i++) {
+		if (ok[i] == 0) {
+			ret = 0;
+			continue;
+		}
+
+		/* w = e(S, P) * g^h */
+		if (!sm9_z256_fp12_table_pow(t, g, sigs[i]->h)) {
+			SM9err(SM9_F_SM9_VERIFY_BATCH, SM9_R_EXTENSION_FIELD_ERROR);
+			ret = -1;
+			goto end;
+		}
+		sm9_z256_fp12_mul(t, f[i], t);
+		sm9_z256_fp12_to_bin(t, buf);
+
+		/* h2 = H2(M||w) mod n */
+		if (!EVP_DigestInit_ex(ctx1, md, NULL)
+			|| !EVP_DigestUpdate(ctx1, prefix, sizeof(prefix))
+			|| !EVP_DigestUpdate(ctx1, data[i], datalen[i])
+			|| !EVP_DigestUpdate(ctx1, buf, sizeof(buf))
+			|| !EVP_MD_CTX_copy(ctx2, ctx1)
+			/* Ha1 = Hv(0x02||M||w||0x00000001) */
+			|| !EVP_DigestUpdate(ctx1, ct1, sizeof(ct1))
+			/* Ha2 = Hv(0x02||M||w||0x00000002) */
+			|| !EVP_DigestUpdate(ctx2, ct2, sizeof(ct2))
+			|| !EVP_DigestFinal_ex(ctx1, buf, &len)
+			|| !EVP_DigestFinal_ex(ctx2, buf + len, &len)) {
+			SM9err(SM9_F_SM9_VERIFY_BATCH, SM9_R_DIGEST_FAILURE);
+			ret = -1;
+			goto end;
+		}
+		/* Ha = Ha1||Ha2[0..7] */
+		if (!BN_bin2bn(buf, 40, x)
+			/* h2 = (Ha mod (n - 1)) + 1 */
+			|| !BN_mod(x, x, SM9_get0_order_minus_one(), bn_ctx)
+			|| !BN_add_word(x, 1)) {
+			SM9err(SM9_F_SM9_VERIFY_BATCH, ERR_R_BN_LIB);
+			ret = -1;
+			goto end;
+		}
+
+		/* check if h2 == sig->h */
+		ok[i] = BN_cmp(x, sigs[i]->h) == 0;
+		if (!ok[i]) {
+			ret = 0;
+		}
+	}
+
+end:
+	if (ret < 0) {
+		for (i = 0; i < num; i++) {
+			ok[i] = -1;
+		}
+	}
+	if (sigs) {
+		for (i = 0; i < num; i++) {
+			SM9Signature_free(sigs[i]);
+		}
+		OPENSSL_free(sigs);
+	}
+	OPENSSL_free(f);
+	OPENSSL_free(lines);
+	EVP_MD_CTX_free(ctx1);
+	EVP_MD_CTX_free(ctx2);
+	EC_GROUP_free(group);
+	EC_POINT_free(S);
+	BN_free(h);
+	if (bn_ctx) {
+		BN_CTX_end(bn_ctx);
+	}
+	BN_CTX_free(bn_ctx);
+	return ret;
+}
@@ -0,0 +1,1881 @@
+/* ====================================================================
+ * Copyright (c) 2018 The GmSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the GmSSL Project.
+ *    (http://gmssl.org/)"
+ *
+ * 4. The name "GmSSL Project" must not be used to endorse or promote
+ *    products derived from this software without prior written
+ *    permission. For written permission, please contact
+ *    guanzhi1980@gmail.com.
+ *
+ * 5. Products derived from this software may not be called "GmSSL"
+ *    nor may "GmSSL" appear in their names without prior written
+ *    permission of the GmSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the GmSSL Project
+ *    (http://gmssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE GmSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE GmSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+
+/*
+ * Fixed-width arithmetic for the SM9 BN256 pairing.
+ *
+ * Elements of Fp are kept in Montgomery form as four 64-bit limbs (least
+ * significant limb first), and the tower
+ *
+ *	Fp2  = Fp[u]/(u^2 + 2)
+ *	Fp4  = Fp2[v]/(v^2 - u)
+ *	Fp12 = Fp4[w]/(w^3 - v)
+ *
+ * is the same as the one used by the BIGNUM based fp2_t/fp4_t/fp12_t code
+ * in sm9_rate.c, so the two representations can be converted into each
+ * other component by component.
+ *
+ * Products in Fp2 and Fp4 are accumulated as unreduced 512-bit values
+ * modulo p^2 and only reduced once per output coefficient.  All temporary
+ * values live on the stack.
+ */
+
+#include <string.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include "sm9_lcl.h"
+
+typedef uint64_t sm9_z512_t[8];
+typedef sm9_z512_t sm9_z512_fp2_t[2];
+
+/* p = 0xB640000002A3A6F1D603AB4FF58EC74521F2934B1A7AEEDBE56F9B27E351457D */
+static const sm9_z256_t SM9_Z256_P = {
+	0xE56F9B27E351457DULL, 0x21F2934B1A7AEEDBULL,
+	0xD603AB4FF58EC745ULL, 0xB640000002A3A6F1ULL,
+};
+
+static const sm9_z256_t SM9_Z256_P_MINUS_TWO = {
+	0xE56F9B27E351457BULL, 0x21F2934B1A7AEEDBULL,
+	0xD603AB4FF58EC745ULL, 0xB640000002A3A6F1ULL,
+};
+
+/* -p^-1 mod 2^64 */
+#define SM9_Z256_P_INV	0x892BC42C2F2EE42BULL
+
+static const sm9_z512_t SM9_Z512_P2 = {
+	0x5B27C51EB9F69F09ULL, 0xFD03EDF8F0B52A25ULL,
+	0x24A1841EAB2C32C3ULL, 0xD22D09C84FBF1235ULL,
+	0xD03A1173374DF1FEULL, 0xBE7D331FEC144803ULL,
+	0x553F30A5254EE814ULL, 0x81BF100003C20333ULL,
+};
+
+/* 2^256 mod p, i.e. 1 in Montgomery form */
+static const sm9_z256_t SM9_Z256_MONT_ONE = {
+	0x1A9064D81CAEBA83ULL, 0xDE0D6CB4E5851124ULL,
+	0x29FC54B00A7138BAULL, 0x49BFFFFFFD5C590EULL,
+};
+
+/* 2^512 mod p */
+static const sm9_z256_t SM9_Z256_MONT_R2 = {
+	0x27DEA312B417E2D2ULL, 0x88F8105FAE1A5D3FULL,
+	0xE479B522D6706E7BULL, 0x2EA795A656F62FBDULL,
+};
+
+/* 5 in Montgomery form, the twist curve is y^2 = x^3 + 5u */
+static const sm9_z256_t SM9_Z256_MONT_FIVE = {
+	0xB9F2C1E8C8C71995ULL, 0x125DF8F246A377FCULL,
+	0x25E650D049188D1CULL, 0x043FFFFFED866F63ULL,
+};
+
+/*
+ * Frobenius constants, SM9_Z256_FROBENIUS[j - 1][k] = u^(k*(p^j - 1)/6) for
+ * the coefficient of w^k, all of them lie in Fp.  The coefficient a[i][j]
+ * of an fp12 element is the coefficient of w^(i + 3*j).
+ */
+static const sm9_z256_t SM9_Z256_FROBENIUS[3][6] = {
+	{
+	{0x1A9064D81CAEBA83ULL, 0xDE0D6CB4E5851124ULL, 0x29FC54B00A7138BAULL, 0x49BFFFFFFD5C590EULL},
+	{0x1A98DFBD4575299FULL, 0x9EC8547B245C54FDULL, 0xF51F5EAC13DF846CULL, 0x9EF74015D5A16393ULL},
+	{0xB626197DCE4736CAULL, 0x08296B3557ED0186ULL, 0x9C705DB2FD91512AULL, 0x1C753E748601C992ULL},
+	{0x39B4EF0F3EE72529ULL, 0xDB043BF508582782ULL, 0xB8554AB054AC91E3ULL, 0x9848EEC25498CAB5ULL},
+	{0x81054FCD94E9C1C4ULL, 0x4C0E91CB8CE2DF3EULL, 0x4877B452E8AEDFB4ULL, 0x88F53E748B491776ULL},
+	{0x048BAA79DCC34107ULL, 0x5E2E7AC4FE76C161ULL, 0x99399754365BD4BCULL, 0xAF91AEAC819B0E13ULL},
+	},
+	{
+	{0x1A9064D81CAEBA83ULL, 0xDE0D6CB4E5851124ULL, 0x29FC54B00A7138BAULL, 0x49BFFFFFFD5C590EULL},
+	{0xB626197DCE4736CAULL, 0x08296B3557ED0186ULL, 0x9C705DB2FD91512AULL, 0x1C753E748601C992ULL},
+	{0x81054FCD94E9C1C4ULL, 0x4C0E91CB8CE2DF3EULL, 0x4877B452E8AEDFB4ULL, 0x88F53E748B491776ULL},
+	{0xCADF364FC6A28AFAULL, 0x43E5269634F5DDB7ULL, 0xAC07569FEB1D8E8AULL, 0x6C80000005474DE3ULL},
+	{0x2F4981AA150A0EB3ULL, 0x19C92815C28DED55ULL, 0x39934D9CF7FD761BULL, 0x99CAC18B7CA1DD5FULL},
+	{0x646A4B5A4E6783B9ULL, 0xD5E4017F8D980F9DULL, 0x8D8BF6FD0CDFE790ULL, 0x2D4AC18B775A8F7BULL},
+	},
+	{
+	{0x1A9064D81CAEBA83ULL, 0xDE0D6CB4E5851124ULL, 0x29FC54B00A7138BAULL, 0x49BFFFFFFD5C590EULL},
+	{0x39B4EF0F3EE72529ULL, 0xDB043BF508582782ULL, 0xB8554AB054AC91E3ULL, 0x9848EEC25498CAB5ULL},
+	{0xCADF364FC6A28AFAULL, 0x43E5269634F5DDB7ULL, 0xAC07569FEB1D8E8AULL, 0x6C80000005474DE3ULL},
+	{0xABBAAC18A46A2054ULL, 0x46EE57561222C759ULL, 0x1DAE609FA0E23561ULL, 0x1DF7113DAE0ADC3CULL},
+	{0x1A9064D81CAEBA83ULL, 0xDE0D6CB4E5851124ULL, 0x29FC54B00A7138BAULL, 0x49BFFFFFFD5C590EULL},
+	{0x39B4EF0F3EE72529ULL, 0xDB043BF508582782ULL, 0xB8554AB054AC91E3ULL, 0x9848EEC25498CAB5ULL},
+	},
+};
+
+/*
+ * Frobenius on the twist: pi(x, y) = (conj(x) * c2, conj(y) * c3) with
+ * c2 = u^(-(p-1)/3) and c3 = u^(-(p-1)/2), both in Fp.  For pi^2 the
+ * constants become c2^2 and c3^2 = -1.
+ */
+static const sm9_z256_t SM9_Z256_TWIST_FROBENIUS_X = {
+	0x646A4B5A4E6783B9ULL, 0xD5E4017F8D980F9DULL,
+	0x8D8BF6FD0CDFE790ULL, 0x2D4AC18B775A8F7BULL,
+};
+static const sm9_z256_t SM9_Z256_TWIST_FROBENIUS_Y = {
+	0xABBAAC18A46A2054ULL, 0x46EE57561222C759ULL,
+	0x1DAE609FA0E23561ULL, 0x1DF7113DAE0ADC3CULL,
+};
+static const sm9_z256_t SM9_Z256_TWIST_FROBENIUS2_X = {
+	0x2F4981AA150A0EB3ULL, 0x19C92815C28DED55ULL,
+	0x39934D9CF7FD761BULL, 0x99CAC18B7CA1DD5FULL,
+};
+
+/* generator P2 of G2, in Montgomery form */
+static const SM9_Z256_TWIST_POINT SM9_Z256_P2 = {
+	{{0x260226A68CE2DA8FULL, 0x7EE5645EDBF6C06BULL,
+	  0xF8F57C82B1495444ULL, 0x61FCF018BC47C4D1ULL},
+	 {0xDB6DB4822750A8A6ULL, 0x84C6135A5121F134ULL,
+	  0x1874032F88791D41ULL, 0x905112F2B85F3A37ULL}},
+	{{0xC03F138F9171C24AULL, 0x92FBAB45A15A3CA7ULL,
+	  0x2445561E2FF77CDBULL, 0x108495E0C0F62ECEULL},
+	 {0xF7B82DAC4C89BFBBULL, 0x3706F3F6A49DC12FULL,
+	  0x1E29DE93D3EEF769ULL, 0x81E448C3C76A5D53ULL}},
+	{{0x1A9064D81CAEBA83ULL, 0xDE0D6CB4E5851124ULL,
+	  0x29FC54B00A7138BAULL, 0x49BFFFFFFD5C590EULL},
+	 {0, 0, 0, 0}},
+};
+
+/* BN parameter t, the pairing loop count is 6t + 2 */
+#define SM9_Z256_T		0x600000000058F98AULL
+#define SM9_Z256_LOOP_HI	0x2ULL
+#define SM9_Z256_LOOP_LO	0x400000000215D93EULL
+
+
+#if !defined(PEDANTIC) && \
+    (defined(__SIZEOF_INT128__) && __SIZEOF_INT128__==16)
+
+typedef unsigned __int128 sm9_u128;
+
+/* (hi, lo) = a * b + c + d */
+# define SM9_Z256_MAC(hi, lo, a, b, c, d) do { \
+	sm9_u128 t_ = (sm9_u128)(a) * (b) + (c) + (d); \
+	(lo) = (uint64_t)t_; \
+	(hi) = (uint64_t)(t_ >> 64); \
+	} while (0)
+
+#else
+
+static void sm9_z256_umul(uint64_t *hi, uint64_t *lo, uint64_t a, uint64_t b)
+{
+	uint64_t a0 = a & 0xffffffffULL, a1 = a >> 32;
+	uint64_t b0 = b & 0xffffffffULL, b1 = b >> 32;
+	uint64_t t00 = a0 * b0, t01 = a0 * b1, t10 = a1 * b0, t11 = a1 * b1;
+	uint64_t mid = (t00 >> 32) + (t01 & 0xffffffffULL) + (t10 & 0xffffffffULL);
+
+	*lo = (mid << 32) | (t00 & 0xffffffffULL);
+	*hi = t11 + (t01 >> 32) + (t10 >> 32) + (mid >> 32);
+}
+
+# define SM9_Z256_MAC(hi, lo, a, b, c, d) do { \
+	uint64_t h_, l_, c_ = (c), d_ = (d); \
+	sm9_z256_umul(&h_, &l_, (a), (b)); \
+	l_ += c_; h_ += (l_ < c_); \
+	l_ += d_; h_ += (l_ < d_); \
+	(lo) = l_; \
+	(hi) = h_; \
+	} while (0)
+
+#endif
+
+
+/*
+ * Limb arithmetic
+ */
+
+static uint64_t sm9_z256_add(sm9_z256_t r, const sm9_z256_t a, const sm9_z256_t b)
+{
+	uint64_t t, c = 0;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		t = a[i] + c;
+		c = t < c;
+		r[i] = t + b[i];
+		c += r[i] < t;
+	}
+	return c;
+}
+
+static uint64_t sm9_z256_sub(sm9_z256_t r, const sm9_z256_t a, const sm9_z256_t b)
+{
+	uint64_t t, c = 0;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		t = a[i] - c;
+		c = t > a[i];
+		r[i] = t - b[i];
+		c += r[i] > t;
+	}
+	return c;
+}
+
+/* r = mask ? a : b */
+static void sm9_z256_select(sm9_z256_t r, const sm9_z256_t a,
+	const sm9_z256_t b, uint64_t mask)
+{
+	int i;
+	for (i = 0; i < 4; i++) {
+		r[i] = (a[i] & mask) | (b[i] & ~mask);
+	}
+}
+
+static void sm9_z256_copy(sm9_z256_t r, const sm9_z256_t a)
+{
+	memcpy(r, a, sizeof(sm9_z256_t));
+}
+
+static int sm9_z256_is_zero(const sm9_z256_t a)
+{
+	return !(a[0] | a[1] | a[2] | a[3]);
+}
+
+static int sm9_z256_equ(const sm9_z256_t a, const sm9_z256_t b)
+{
+	return !((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3]));
+}
+
+static void sm9_z256_mul(sm9_z512_t r, const sm9_z256_t a, const sm9_z256_t b)
+{
+	uint64_t c;
+	int i, j;
+
+	memset(r, 0, sizeof(sm9_z512_t));
+	for (i = 0; i < 4; i++) {
+		c = 0;
+		for (j = 0; j < 4; j++) {
+			SM9_Z256_MAC(c, r[i + j], a[i], b[j], r[i + j], c);
+		}
+		r[i + 4] = c;
+	}
+}
+
+static uint64_t sm9_z512_add(sm9_z512_t r, const sm9_z512_t a, const sm9_z512_t b)
+{
+	uint64_t t, c = 0;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		t = a[i] + c;
+		c = t < c;
+		r[i] = t + b[i];
+		c += r[i] < t;
+	}
+	return c;
+}
+
+static uint64_t sm9_z512_sub(sm9_z512_t r, const sm9_z512_t a, const sm9_z512_t b)
+{
+	uint64_t t, c = 0;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		t = a[i] - c;
+		c = t > a[i];
+		r[i] = t - b[i];
+		c += r[i] > t;
+	}
+	return c;
+}
+
+/*
+ * Montgomery reduction, r = a * 2^-256 mod p for a < p * 2^256.
+ */
+static void sm9_z256_mont_redc(sm9_z256_t r, const sm9_z512_t a)
+{
+	uint64_t t[9];
+	uint64_t m, c, s;
+	sm9_z256_t d;
+	uint64_t borrow;
+	int i, j;
+
+	memcpy(t, a, sizeof(sm9_z512_t));
+	t[8] = 0;
+
+	for (i = 0; i < 4; i++) {
+		m = t[i] * SM9_Z256_P_INV;
+		c = 0;
+		for (j = 0; j < 4; j++) {
+			SM9_Z256_MAC(c, t[i + j], m, SM9_Z256_P[j], t[i + j], c);
+		}
+		for (j = i + 4; j < 9; j++) {
+			s = t[j] + c;
+			c = s < c;
+			t[j] = s;
+		}
+	}
+
+	/* t[4..8] < 2p, subtract p once if needed */
+	borrow = sm9_z256_sub(d, t + 4, SM9_Z256_P);
+	sm9_z256_select(r, t + 4, d, 0 - (uint64_t)(borrow & (t[8] ^ 1)));
+}
+
+static void sm9_z256_modp_add(sm9_z256_t r, const sm9_z256_t a, const sm9_z256_t b)
+{
+	sm9_z256_t t, d;
+	uint64_t c, borrow;
+
+	c = sm9_z256_add(t, a, b);
+	borrow = sm9_z256_sub(d, t, SM9_Z256_P);
+	sm9_z256_select(r, t, d, 0 - (uint64_t)(borrow & (c ^ 1)));
+}
+
+static void sm9_z256_modp_sub(sm9_z256_t r, const sm9_z256_t a, const sm9_z256_t b)
+{
+	sm9_z256_t t, s;
+	uint64_t borrow;
+
+	borrow = sm9_z256_sub(t, a, b);
+	sm9_z256_add(s, t, SM9_Z256_P);
+	sm9_z256_select(r, s, t, 0 - borrow);
+}
+
+static void sm9_z256_modp_dbl(sm9_z256_t r, const sm9_z256_t a)
+{
+	sm9_z256_modp_add(r, a, a);
+}
+
+static void sm9_z256_modp_tri(sm9_z256_t r, const sm9_z256_t a)
+{
+	sm9_z256_t t;
+	sm9_z256_modp_add(t, a, a);
+	sm9_z256_modp_add(r, t, a);
+}
+
+static void sm9_z256_modp_neg(sm9_z256_t r, const sm9_z256_t a)
+{
+	sm9_z256_t zero = {0, 0, 0, 0};
+	sm9_z256_modp_sub(r, zero, a);
+}
+
+static void sm9_z256_modp_mont_mul(sm9_z256_t r, const sm9_z256_t a, const sm9_z256_t b)
+{
+	sm9_z512_t t;
+	sm9_z256_mul(t, a, b);
+	sm9_z256_mont_redc(r, t);
+}
+
+static void sm9_z256_modp_mont_sqr(sm9_z256_t r, const sm9_z256_t a)
+{
+	sm9_z256_modp_mont_mul(r, a, a);
+}
+
+static void sm9_z256_modp_to_mont(sm9_z256_t r, const sm9_z256_t a)
+{
+	sm9_z256_modp_mont_mul(r, a, SM9_Z256_MONT_R2);
+}
+
+static void sm9_z256_modp_from_mont(sm9_z256_t r, const sm9_z256_t a)
+{
+	sm9_z512_t t;
+
+	memset(t, 0, sizeof(t));
+	sm9_z256_copy(t, a);
+	sm9_z256_mont_redc(r, t);
+}
+
+/* r = a^(p-2), the exponent is public so a plain square-and-multiply is fine */
+static void sm9_z256_modp_mont_inv(sm9_z256_t r, const sm9_z256_t a)
+{
+	sm9_z256_t t;
+	int i;
+
+	sm9_z256_copy(t, SM9_Z256_MONT_ONE);
+	for (i = 255; i >= 0; i--) {
+		sm9_z256_modp_mont_sqr(t, t);
+		if ((SM9_Z256_P_MINUS_TWO[i / 64] >> (i % 64)) & 1) {
+			sm9_z256_modp_mont_mul(t, t, a);
+		}
+	}
+	sm9_z256_copy(r, t);
+}
+
+static void sm9_z256_to_bytes(const sm9_z256_t a, unsigned char to[32])
+{
+	int i, j;
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 8; j++) {
+			to[31 - (i * 8 + j)] = (unsigned char)(a[i] >> (j * 8));
+		}
+	}
+}
+
+static void sm9_z256_from_bytes(sm9_z256_t r, const unsigned char from[32])
+{
+	int i, j;
+	for (i = 0; i < 4; i++) {
+		r[i] = 0;
+		for (j = 0; j < 8; j++) {
+			r[i] |= (uint64_t)from[31 - (i * 8 + j)] << (j * 8);
+		}
+	}
+}
+
+int sm9_z256_from_bn(sm9_z256_t r, const BIGNUM *a)
+{
+	unsigned char buf[32];
+
+	if (BN_is_negative(a) || BN_ucmp(a, SM9_get0_prime()) >= 0
+		|| BN_bn2binpad(a, buf, sizeof(buf)) != sizeof(buf)) {
+		return 0;
+	}
+	sm9_z256_from_bytes(r, buf);
+	sm9_z256_modp_to_mont(r, r);
+	return 1;
+}
+
+int sm9_z256_to_bn(BIGNUM *r, const sm9_z256_t a)
+{
+	unsigned char buf[32];
+	sm9_z256_t t;
+
+	sm9_z256_modp_from_mont(t, a);
+	sm9_z256_to_bytes(t, buf);
+	return BN_bin2bn(buf, sizeof(buf), r) != NULL;
+}
+
+
+/*
+ * Double-width values modulo p^2, all values are kept in [0, p^2)
+ */
+
+static void sm9_z512_modp2_add(sm9_z512_t r, const sm9_z512_t a, const sm9_z512_t b)
+{
+	sm9_z512_t t, d;
+	uint64_t c, borrow, mask;
+	int i;
+
+	c = sm9_z512_add(t, a, b);
+	borrow = sm9_z512_sub(d, t, SM9_Z512_P2);
+	mask = 0 - (uint64_t)(borrow & (c ^ 1));
+	for (i = 0; i < 8; i++) {
+		r[i] = (t[i] & mask) | (d[i] & ~mask);
+	}
+}
+
+static void sm9_z512_modp2_sub(sm9_z512_t r, const sm9_z512_t a, const sm9_z512_t b)
+{
+	sm9_z512_t t, s;
+	uint64_t mask;
+	int i;
+
+	mask = 0 - sm9_z512_sub(t, a, b);
+	sm9_z512_add(s, t, SM9_Z512_P2);
+	for (i = 0; i < 8; i++) {
+		r[i] = (s[i] & mask) | (t[i] & ~mask);
+	}
+}
+
+
+/*
+ * Fp2
+ */
+
+static void sm9_z256_fp2_copy(sm9_z256_fp2_t r, const sm9_z256_fp2_t a)
+{
+	memcpy(r, a, sizeof(sm9_z256_fp2_t));
+}
+
+static void sm9_z256_fp2_set_zero(sm9_z256_fp2_t r)
+{
+	memset(r, 0, sizeof(sm9_z256_fp2_t));
+}
+
+static void sm9_z256_fp2_set_one(sm9_z256_fp2_t r)
+{
+	sm9_z256_copy(r[0], SM9_Z256_MONT_ONE);
+	memset(r[1], 0, sizeof(sm9_z256_t));
+}
+
+static int sm9_z256_fp2_is_zero(const sm9_z256_fp2_t a)
+{
+	return sm9_z256_is_zero(a[0]) && sm9_z256_is_zero(a[1]);
+}
+
+static int sm9_z256_fp2_equ(const sm9_z256_fp2_t a, const sm9_z256_fp2_t b)
+{
+	return sm9_z256_equ(a[0], b[0]) && sm9_z256_equ(a[1], b[1]);
+}
+
+static void sm9_z256_fp2_add(sm9_z256_fp2_t r, const sm9_z256_fp2_t a, const sm9_z256_fp2_t b)
+{
+	sm9_z256_modp_add(r[0], a[0], b[0]);
+	sm9_z256_modp_add(r[1], a[1], b[1]);
+}
+
+static void sm9_z256_fp2_sub(sm9_z256_fp2_t r, const sm9_z256_fp2_t a, const sm9_z256_fp2_t b)
+{
+	sm9_z256_modp_sub(r[0], a[0], b[0]);
+	sm9_z256_modp_sub(r[1], a[1], b[1]);
+}
+
+static void sm9_z256_fp2_dbl(sm9_z256_fp2_t r, const sm9_z256_fp2_t a)
+{
+	sm9_z256_modp_dbl(r[0], a[0]);
+	sm9_z256_modp_dbl(r[1], a[1]);
+}
+
+static void sm9_z256_fp2_tri(sm9_z256_fp2_t r, const sm9_z256_fp2_t a)
+{
+	sm9_z256_modp_tri(r[0], a[0]);
+	sm9_z256_modp_tri(r[1], a[1]);
+}
+
+static void sm9_z256_fp2_neg(sm9_z256_fp2_t r, const sm9_z256_fp2_t a)
+{
+	sm9_z256_modp_neg(r[0], a[0]);
+	sm9_z256_modp_neg(r[1], a[1]);
+}
+
+static void sm9_z256_fp2_conjugate(sm9_z256_fp2_t r, const sm9_z256_fp2_t a)
+{
+	sm9_z256_copy(r[0], a[0]);
+	sm9_z256_modp_neg(r[1], a[1]);
+}
+
+/* r = a * k for k in Fp */
+static void sm9_z256_fp2_mul_fp(sm9_z256_fp2_t r, const sm9_z256_fp2_t a, const sm9_z256_t k)
+{
+	sm9_z256_modp_mont_mul(r[0], a[0], k);
+	sm9_z256_modp_mont_mul(r[1], a[1], k);
+}
+
+/* r = a * u = -2 * a1 + a0 * u */
+static void sm9_z256_fp2_mul_u(sm9_z256_fp2_t r, const sm9_z256_fp2_t a)
+{
+	sm9_z256_t t;
+	sm9_z256_modp_dbl(t, a[1]);
+	sm9_z256_copy(r[1], a[0]);
+	sm9_z256_modp_neg(r[0], t);
+}
+
+/* unreduced product, Karatsuba with the two coefficients kept mod p^2 */
+static void sm9_z256_fp2_mul_wide(sm9_z512_fp2_t r, const sm9_z256_fp2_t a, const sm9_z256_fp2_t b)
+{
+	sm9_z512_t t0, t1, t2;
+	sm9_z256_t s0, s1;
+
+	sm9_z256_mul(t0, a[0], b[0]);
+	sm9_z256_mul(t1, a[1], b[1]);
+	sm9_z256_modp_add(s0, a[0], a[1]);
+	sm9_z256_modp_add(s1, b[0], b[1]);
+	sm9_z256_mul(t2, s0, s1);
+
+	/* r1 = (a0 + a1)(b0 + b1) - a0 * b0 - a1 * b1 */
+	sm9_z512_modp2_sub(t2, t2, t0);
+	sm9_z512_modp2_sub(r[1], t2, t1);
+
+	/* r0 = a0 * b0 - 2 * a1 * b1 */
+	sm9_z512_modp2_sub(t0, t0, t1);
+	sm9_z512_modp2_sub(r[0], t0, t1);
+}
+
+static void sm9_z256_fp2_sqr_wide(sm9_z512_fp2_t r, const sm9_z256_fp2_t a)
+{
+	sm9_z512_t t0, t1;
+	sm9_z256_t s0, s1;
+
+	/* r0 = (a0 + a1)(a0 - 2 * a1) + a0 * a1 = a0^2 - 2 * a1^2 */
+	sm9_z256_mul(t0, a[0], a[1]);
+	sm9_z256_modp_add(s0, a[0], a[1]);
+	sm9_z256_modp_dbl(s1, a[1]);
+	sm9_z256_modp_sub(s1, a[0], s1);
+	sm9_z256_mul(t1, s0, s1);
+	sm9_z512_modp2_add(r[0], t1, t0);
+
+	/* r1 = 2 * a0 * a1 */
+	sm9_z512_modp2_add(r[1], t0, t0);
+}
+
+static void sm9_z256_fp2_reduce(sm9_z256_fp2_t r, const sm9_z512_fp2_t a)
+{
+	sm9_z256_mont_redc(r[0], a[0]);
+	sm9_z256_mont_redc(r[1], a[1]);
+}
+
+static void sm9_z512_fp2_add(sm9_z512_fp2_t r, const sm9_z512_fp2_t a, const sm9_z512_fp2_t b)
+{
+	sm9_z512_modp2_add(r[0], a[0], b[0]);
+	sm9_z512_modp2_add(r[1], a[1], b[1]);
+}
+
+static void sm9_z512_fp2_sub(sm9_z512_fp2_t r, const sm9_z512_fp2_t a, const sm9_z512_fp2_t b)
+{
+	sm9_z512_modp2_sub(r[0], a[0], b[0]);
+	sm9_z512_modp2_sub(r[1], a[1], b[1]);
+}
+
+/* r = a * u on unreduced values */
+static void sm9_z512_fp2_mul_u(sm9_z512_fp2_t r, const sm9_z512_fp2_t a)
+{
+	sm9_z512_t zero, t;
+
+	memset(zero, 0, sizeof(zero));
+	sm9_z512_modp2_add(t, a[1], a[1]);
+	memcpy(r[1], a[0], sizeof(sm9_z512_t));
+	sm9_z512_modp2_sub(r[0], zero, t);
+}
+
+static void sm9_z256_fp2_mul(sm9_z256_fp2_t r, const sm9_z256_fp2_t a, const sm9_z256_fp2_t b)
+{
+	sm9_z512_fp2_t t;
+	sm9_z256_fp2_mul_wide(t, a, b);
+	sm9_z256_fp2_reduce(r, t);
+}
+
+static void sm9_z256_fp2_sqr(sm9_z256_fp2_t r, const sm9_z256_fp2_t a)
+{
+	sm9_z512_fp2_t t;
+	sm9_z256_fp2_sqr_wide(t, a);
+	sm9_z256_fp2_reduce(r, t);
+}
+
+static void sm9_z256_fp2_inv(sm9_z256_fp2_t r, const sm9_z256_fp2_t a)
+{
+	sm9_z256_t k, t;
+
+	/* k = (a0^2 + 2 * a1^2)^-1 */
+	sm9_z256_modp_mont_sqr(k, a[0]);
+	sm9_z256_modp_mont_sqr(t, a[1]);
+	sm9_z256_modp_dbl(t, t);
+	sm9_z256_modp_add(k, k, t);
+	sm9_z256_modp_mont_inv(k, k);
+
+	/* r = (a0 * k, -a1 * k) */
+	sm9_z256_modp_mont_mul(r[0], a[0], k);
+	sm9_z256_modp_mont_mul(r[1], a[1], k);
+	sm9_z256_modp_neg(r[1], r[1]);
+}
+
+static int sm9_z256_fp2_from_fp2(sm9_z256_fp2_t r, const fp2_t a)
+{
+	return sm9_z256_from_bn(r[0], a[0])
+		&& sm9_z256_from_bn(r[1], a[1]);
+}
+
+static int sm9_z256_fp2_to_fp2(fp2_t r, const sm9_z256_fp2_t a)
+{
+	return sm9_z256_to_bn(r[0], a[0])
+		&& sm9_z256_to_bn(r[1], a[1]);
+}
+
+/* same layout as fp2_to_bin() */
+static void sm9_z256_fp2_to_bin(const sm9_z256_fp2_t a, unsigned char to[64])
+{
+	sm9_z256_t t;
+	sm9_z256_modp_from_mont(t, a[1]);
+	sm9_z256_to_bytes(t, to);
+	sm9_z256_modp_from_mont(t, a[0]);
+	sm9_z256_to_bytes(t, to + 32);
+}
+
+
+/*
+ * Fp4
+ */
+
+static void sm9_z256_fp4_add(sm9_z256_fp4_t r, const sm9_z256_fp4_t a, const sm9_z256_fp4_t b)
+{
+	sm9_z256_fp2_add(r[0], a[0], b[0]);
+	sm9_z256_fp2_add(r[1], a[1], b[1]);
+}
+
+static void sm9_z256_fp4_sub(sm9_z256_fp4_t r, const sm9_z256_fp4_t a, const sm9_z256_fp4_t b)
+{
+	sm9_z256_fp2_sub(r[0], a[0], b[0]);
+	sm9_z256_fp2_sub(r[1], a[1], b[1]);
+}
+
+static void sm9_z256_fp4_dbl(sm9_z256_fp4_t r, const sm9_z256_fp4_t a)
+{
+	sm9_z256_fp2_dbl(r[0], a[0]);
+	sm9_z256_fp2_dbl(r[1], a[1]);
+}
+
+/* r = a * v = a1 * u + a0 * v */
+static void sm9_z256_fp4_mul_v(sm9_z256_fp4_t r, const sm9_z256_fp4_t a)
+{
+	sm9_z256_fp2_t t;
+	sm9_z256_fp2_mul_u(t, a[1]);
+	sm9_z256_fp2_copy(r[1], a[0]);
+	sm9_z256_fp2_copy(r[0], t);
+}
+
+/* r = a * k for k in Fp2 */
+static void sm9_z256_fp4_mul_fp2(sm9_z256_fp4_t r, const sm9_z256_fp4_t a, const sm9_z256_fp2_t k)
+{
+	sm9_z256_fp2_mul(r[0], a[0], k);
+	sm9_z256_fp2_mul(r[1], a[1], k);
+}
+
+static void sm9_z256_fp4_mul(sm9_z256_fp4_t r, const sm9_z256_fp4_t a, const sm9_z256_fp4_t b)
+{
+	sm9_z512_fp2_t t0, t1, t2;
+	sm9_z256_fp2_t s0, s1;
+
+	sm9_z256_fp2_mul_wide(t0, a[0], b[0]);
+	sm9_z256_fp2_mul_wide(t1, a[1], b[1]);
+	sm9_z256_fp2_add(s0, a[0], a[1]);
+	sm9_z256_fp2_add(s1, b[0], b[1]);
+	sm9_z256_fp2_mul_wide(t2, s0, s1);
+
+	/* r1 = (a0 + a1)(b0 + b1) - a0 * b0 - a1 * b1 */
+	sm9_z512_fp2_sub(t2, t2, t0);
+	sm9_z512_fp2_sub(t2, t2, t1);
+	sm9_z256_fp2_reduce(r[1], t2);
+
+	/* r0 = a0 * b0 + a1 * b1 * u */
+	sm9_z512_fp2_mul_u(t1, t1);
+	sm9_z512_fp2_add(t0, t0, t1);
+	sm9_z256_fp2_reduce(r[0], t0);
+}
+
+static void sm9_z256_fp4_sqr(sm9_z256_fp4_t r, const sm9_z256_fp4_t a)
+{
+	sm9_z512_fp2_t t0, t1, t2;
+
+	sm9_z256_fp2_sqr_wide(t0, a[0]);
+	sm9_z256_fp2_sqr_wide(t1, a[1]);
+	sm9_z256_fp2_mul_wide(t2, a[0], a[1]);
+
+	/* r1 = 2 * a0 * a1 */
+	sm9_z512_fp2_add(t2, t2, t2);
+	sm9_z256_fp2_reduce(r[1], t2);
+
+	/* r0 = a0^2 + a1^2 * u */
+	sm9_z512_fp2_mul_u(t1, t1);
+	sm9_z512_fp2_add(t0, t0, t1);
+	sm9_z256_fp2_reduce(r[0], t0);
+}
+
+static void sm9_z256_fp4_inv(sm9_z256_fp4_t r, const sm9_z256_fp4_t a)
+{
+	sm9_z256_fp2_t k, t;
+
+	/* k = (a0^2 - a1^2 * u)^-1 */
+	sm9_z256_fp2_sqr(k, a[0]);
+	sm9_z256_fp2_sqr(t, a[1]);
+	sm9_z256_fp2_mul_u(t, t);
+	sm9_z256_fp2_sub(k, k, t);
+	sm9_z256_fp2_inv(k, k);
+
+	/* r = (a0 * k, -a1 * k) */
+	sm9_z256_fp2_mul(r[0], a[0], k);
+	sm9_z256_fp2_mul(r[1], a[1], k);
+	sm9_z256_fp2_neg(r[1], r[1]);
+}
+
+
+/*
+ * Fp12
+ */
+
+void sm9_z256_fp12_set_one(sm9_z256_fp12_t r)
+{
+	memset(r, 0, sizeof(sm9_z256_fp12_t));
+	sm9_z256_copy(r[0][0][0], SM9_Z256_MONT_ONE);
+}
+
+void sm9_z256_fp12_copy(sm9_z256_fp12_t r, const sm9_z256_fp12_t a)
+{
+	memcpy(r, a, sizeof(sm9_z256_fp12_t));
+}
+
+int sm9_z256_fp12_equ(const sm9_z256_fp12_t a, const sm9_z256_fp12_t b)
+{
+	return memcmp(a, b, sizeof(sm9_z256_fp12_t)) == 0;
+}
+
+void sm9_z256_fp12_mul(sm9_z256_fp12_t r, const sm9_z256_fp12_t a, const sm9_z256_fp12_t b)
+{
+	sm9_z256_fp4_t v0, v1, v2, s, t, r0, r1, r2;
+
+	sm9_z256_fp4_mul(v0, a[0], b[0]);
+	sm9_z256_fp4_mul(v1, a[1], b[1]);
+	sm9_z256_fp4_mul(v2, a[2], b[2]);
+
+	/* r0 = v0 + ((a1 + a2)(b1 + b2) - v1 - v2) * v */
+	sm9_z256_fp4_add(s, a[1], a[2]);
+	sm9_z256_fp4_add(t, b[1], b[2]);
+	sm9_z256_fp4_mul(r0, s, t);
+	sm9_z256_fp4_sub(r0, r0, v1);
+	sm9_z256_fp4_sub(r0, r0, v2);
+	sm9_z256_fp4_mul_v(r0, r0);
+	sm9_z256_fp4_add(r0, r0, v0);
+
+	/* r1 = (a0 + a1)(b0 + b1) - v0 - v1 + v2 * v */
+	sm9_z256_fp4_add(s, a[0], a[1]);
+	sm9_z256_fp4_add(t, b[0], b[1]);
+	sm9_z256_fp4_mul(r1, s, t);
+	sm9_z256_fp4_sub(r1, r1, v0);
+	sm9_z256_fp4_sub(r1, r1, v1);
+	sm9_z256_fp4_mul_v(t, v2);
+	sm9_z256_fp4_add(r1, r1, t);
+
+	/* r2 = (a0 + a2)(b0 + b2) - v0 - v2 + v1 */
+	sm9_z256_fp4_add(s, a[0], a[2]);
+	sm9_z256_fp4_add(t, b[0], b[2]);
+	sm9_z256_fp4_mul(r2, s, t);
+	sm9_z256_fp4_sub(r2, r2, v0);
+	sm9_z256_fp4_sub(r2, r2, v2);
+	sm9_z256_fp4_add(r2, r2, v1);
+
+	memcpy(r[0], r0, sizeof(sm9_z256_fp4_t));
+	memcpy(r[1], r1, sizeof(sm9_z256_fp4_t));
+	memcpy(r[2], r2, sizeof(sm9_z256_fp4_t));
+}
+
+void sm9_z256_fp12_sqr(sm9_z256_fp12_t r, const sm9_z256_fp12_t a)
+{
+	sm9_z256_fp4_t s0, s1, s2, s3, s4, t;
+
+	/* Chung-Hasan SQR2 */
+	sm9_z256_fp4_sqr(s0, a[0]);
+	sm9_z256_fp4_mul(s1, a[0], a[1]);
+	sm9_z256_fp4_dbl(s1, s1);
+	sm9_z256_fp4_sub(t, a[0], a[1]);
+	sm9_z256_fp4_add(t, t, a[2]);
+	sm9_z256_fp4_sqr(s2, t);
+	sm9_z256_fp4_mul(s3, a[1], a[2]);
+	sm9_z256_fp4_dbl(s3, s3);
+	sm9_z256_fp4_sqr(s4, a[2]);
+
+	/* r2 = s1 + s2 + s3 - s0 - s4 */
+	sm9_z256_fp4_add(t, s1, s2);
+	sm9_z256_fp4_add(t, t, s3);
+	sm9_z256_fp4_sub(t, t, s0);
+	sm9_z256_fp4_sub(r[2], t, s4);
+
+	/* r0 = s0 + s3 * v */
+	sm9_z256_fp4_mul_v(s3, s3);
+	sm9_z256_fp4_add(r[0], s0, s3);
+
+	/* r1 = s1 + s4 * v */
+	sm9_z256_fp4_mul_v(s4, s4);
+	sm9_z256_fp4_add(r[1], s1, s4);
+}
+
+void sm9_z256_fp12_inv(sm9_z256_fp12_t r, const sm9_z256_fp12_t a)
+{
+	sm9_z256_fp4_t t0, t1, t2, k, t;
+
+	/* t0 = a0^2 - a1 * a2 * v */
+	sm9_z256_fp4_sqr(t0, a[0]);
+	sm9_z256_fp4_mul(t, a[1], a[2]);
+	sm9_z256_fp4_mul_v(t, t);
+	sm9_z256_fp4_sub(t0, t0, t);
+
+	/* t1 = a2^2 * v - a0 * a1 */
+	sm9_z256_fp4_sqr(t1, a[2]);
+	sm9_z256_fp4_mul_v(t1, t1);
+	sm9_z256_fp4_mul(t, a[0], a[1]);
+	sm9_z256_fp4_sub(t1, t1, t);
+
+	/* t2 = a1^2 - a0 * a2 */
+	sm9_z256_fp4_sqr(t2, a[1]);
+	sm9_z256_fp4_mul(t, a[0], a[2]);
+	sm9_z256_fp4_sub(t2, t2, t);
+
+	/* k = (a0 * t0 + (a2 * t1 + a1 * t2) * v)^-1 */
+	sm9_z256_fp4_mul(k, a[2], t1);
+	sm9_z256_fp4_mul(t, a[1], t2);
+	sm9_z256_fp4_add(k, k, t);
+	sm9_z256_fp4_mul_v(k, k);
+	sm9_z256_fp4_mul(t, a[0], t0);
+	sm9_z256_fp4_add(k, k, t);
+	sm9_z256_fp4_inv(k, k);
+
+	sm9_z256_fp4_mul(r[0], t0, k);
+	sm9_z256_fp4_mul(r[1], t1, k);
+	sm9_z256_fp4_mul(r[2], t2, k);
+}
+
+/* r = a^(p^6), i.e. negate the coefficients of the odd powers of w */
+static void sm9_z256_fp12_conjugate(sm9_z256_fp12_t r, const sm9_z256_fp12_t a)
+{
+	sm9_z256_fp2_copy(r[0][0], a[0][0]);
+	sm9_z256_fp2_neg(r[0][1], a[0][1]);
+	sm9_z256_fp2_neg(r[1][0], a[1][0]);
+	sm9_z256_fp2_copy(r[1][1], a[1][1]);
+	sm9_z256_fp2_copy(r[2][0], a[2][0]);
+	sm9_z256_fp2_neg(r[2][1], a[2][1]);
+}
+
+/* r = a^(p^n), n = 1, 2 or 3 */
+static void sm9_z256_fp12_frobenius(sm9_z256_fp12_t r, const sm9_z256_fp12_t a, int n)
+{
+	int i, j;
+
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 2; j++) {
+			const sm9_z256_t *k = &SM9_Z256_FROBENIUS[n - 1][i + 3 * j];
+			if (n & 1) {
+				sm9_z256_fp2_conjugate(r[i][j], a[i][j]);
+				sm9_z256_fp2_mul_fp(r[i][j], r[i][j], *k);
+			} else {
+				sm9_z256_fp2_mul_fp(r[i][j], a[i][j], *k);
+			}
+		}
+	}
+}
+
+/*
+ * r = w ? table[w - 1] : 1, every entry is read so that the memory access
+ * pattern does not depend on the secret window value w
+ */
+static void sm9_z256_fp12_select(sm9_z256_fp12_t r, const sm9_z256_fp12_t table[15],
+	int w)
+{
+	uint64_t *pr = (uint64_t *)r;
+	const uint64_t *pt;
+	uint64_t mask;
+	int j;
+	size_t n;
+
+	sm9_z256_fp12_set_one(r);
+	mask = 0 - (uint64_t)(w != 0);
+	for (n = 0; n < sizeof(sm9_z256_fp12_t)/sizeof(uint64_t); n++) {
+		pr[n] &= ~mask;
+	}
+	for (j = 0; j < 15; j++) {
+		mask = 0 - (uint64_t)(w == j + 1);
+		pt = (const uint64_t *)table[j];
+		for (n = 0; n < sizeof(sm9_z256_fp12_t)/sizeof(uint64_t); n++) {
+			pr[n] |= pt[n] & mask;
+		}
+	}
+}
+
+/*
+ * Variable-base exponentiation with a 4-bit fixed window.  k is padded to
+ * 256 bits so the number of squarings and multiplications is fixed, and
+ * the window value is selected with sm9_z256_fp12_select().
+ */
+int sm9_z256_fp12_pow(sm9_z256_fp12_t r, const sm9_z256_fp12_t a, const BIGNUM *k)
+{
+	unsigned char buf[32];
+	sm9_z256_fp12_t table[15];
+	sm9_z256_fp12_t t, s;
+	int i, j, w;
+
+	if (BN_is_negative(k) || BN_num_bytes(k) > (int)sizeof(buf)
+		|| BN_bn2binpad(k, buf, sizeof(buf)) != sizeof(buf)) {
+		return 0;
+	}
+
+	sm9_z256_fp12_copy(table[0], a);
+	for (j = 1; j < 15; j++) {
+		sm9_z256_fp12_mul(table[j], table[j - 1], a);
+	}
+
+	sm9_z256_fp12_set_one(t);
+	for (i = 0; i < (int)sizeof(buf); i++) {
+		for (j = 4; j >= 0; j -= 4) {
+			sm9_z256_fp12_sqr(t, t);
+			sm9_z256_fp12_sqr(t, t);
+			sm9_z256_fp12_sqr(t, t);
+			sm9_z256_fp12_sqr(t, t);
+			w = (buf[i] >> j) & 0x0f;
+			sm9_z256_fp12_select(s, table, w);
+			sm9_z256_fp12_mul(t, t, s);
+		}
+	}
+
+	sm9_z256_fp12_copy(r, t);
+	OPENSSL_cleanse(buf, sizeof(buf));
+	OPENSSL_cleanse(table, sizeof(table));
+	OPENSSL_cleanse(t, sizeof(t));
+	OPENSSL_cleanse(s, sizeof(s));
+	return 1;
+}
+
+/* r = a^t for the BN parameter t */
+static void sm9_z256_fp12_pow_t(sm9_z256_fp12_t r, const sm9_z256_fp12_t a)
+{
+	sm9_z256_fp12_t t;
+	int i;
+
+	sm9_z256_fp12_copy(t, a);
+	for (i = 61; i >= 0; i--) {
+		sm9_z256_fp12_sqr(t, t);
+		if ((SM9_Z256_T >> i) & 1) {
+			sm9_z256_fp12_mul(t, t, a);
+		}
+	}
+	sm9_z256_fp12_copy(r, t);
+}
+
+int sm9_z256_fp12_from_fp12(sm9_z256_fp12_t r, const fp12_t a)
+{
+	int i, j;
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 2; j++) {
+			if (!sm9_z256_fp2_from_fp2(r[i][j], a[i][j])) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+int sm9_z256_fp12_to_fp12(fp12_t r, const sm9_z256_fp12_t a)
+{
+	int i, j;
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 2; j++) {
+			if (!sm9_z256_fp2_to_fp2(r[i][j], a[i][j])) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/* same layout as fp12_to_bin() */
+void sm9_z256_fp12_to_bin(const sm9_z256_fp12_t a, unsigned char to[384])
+{
+	sm9_z256_fp2_to_bin(a[2][1], to);
+	sm9_z256_fp2_to_bin(a[2][0], to + 64);
+	sm9_z256_fp2_to_bin(a[1][1], to + 128);
+	sm9_z256_fp2_to_bin(a[1][0], to + 192);
+	sm9_z256_fp2_to_bin(a[0][1], to + 256);
+	sm9_z256_fp2_to_bin(a[0][0], to + 320);
+}
+
+/*
+ * Fixed-base exponentiation of a GT element, the table keeps g^(j * 16^i)
+ * for every 4-bit window i of a 256-bit exponent, so g^k costs 64 fp12
+ * multiplications and no squaring.  Every table row is scanned entirely
+ * to select the window value.
+ */
+void sm9_z256_fp12_table_init(SM9_Z256_FP12_TABLE *t, const sm9_z256_fp12_t g)
+{
+	sm9_z256_fp12_t base;
+	int i, j;
+
+	sm9_z256_fp12_copy(t->g, g);
+	sm9_z256_fp12_copy(base, g);
+	for (i = 0; i < 64; i++) {
+		sm9_z256_fp12_copy(t->table[i][0], base);
+		for (j = 1; j < 15; j++) {
+			sm9_z256_fp12_mul(t->table[i][j], t->table[i][j - 1], base);
+		}
+		sm9_z256_fp12_mul(base, t->table[i][14], base);
+	}
+}
+
+int sm9_z256_fp12_table_pow(sm9_z256_fp12_t r, const SM9_Z256_FP12_TABLE *t,
+	const BIGNUM *k)
+{
+	unsigned char buf[32];
+	sm9_z256_fp12_t a, s;
+	int i, w;
+
+	if (BN_is_negative(k) || BN_num_bytes(k) > (int)sizeof(buf)
+		|| BN_bn2binpad(k, buf, sizeof(buf)) != sizeof(buf)) {
+		return 0;
+	}
+
+	sm9_z256_fp12_set_one(a);
+	for (i = 0; i < 64; i++) {
+		w = (buf[31 - i/2] >> ((i & 1) * 4)) & 0x0f;
+
+		sm9_z256_fp12_select(s, t->table[i], w);
+		sm9_z256_fp12_mul(a, a, s);
+	}
+
+	sm9_z256_fp12_copy(r, a);
+	OPENSSL_cleanse(buf, sizeof(buf));
+	OPENSSL_cleanse(a, sizeof(a));
+	OPENSSL_cleanse(s, sizeof(s));
+	return 1;
+}
+
+
+/*
+ * Points on the twist curve E'(Fp2): y^2 = x^3 + 5u in Jacobian coordinates,
+ * the point at infinity has Z = 0.
+ */
+
+void sm9_z256_twist_point_set_infinity(SM9_Z256_TWIST_POINT *R)
+{
+	sm9_z256_fp2_set_one(R->X);
+	sm9_z256_fp2_set_one(R->Y);
+	sm9_z256_fp2_set_zero(R->Z);
+}
+
+int sm9_z256_twist_point_is_at_infinity(const SM9_Z256_TWIST_POINT *P)
+{
+	return sm9_z256_fp2_is_zero(P->Z);
+}
+
+void sm9_z256_twist_point_copy(SM9_Z256_TWIST_POINT *R, const SM9_Z256_TWIST_POINT *P)
+{
+	memcpy(R, P, sizeof(SM9_Z256_TWIST_POINT));
+}
+
+void sm9_z256_twist_point_set_generator(SM9_Z256_TWIST_POINT *R)
+{
+	sm9_z256_twist_point_copy(R, &SM9_Z256_P2);
+}
+
+int sm9_z256_twist_point_is_on_curve(const SM9_Z256_TWIST_POINT *P)
+{
+	sm9_z256_fp2_t x, y, t;
+
+	if (sm9_z256_twist_point_is_at_infinity(P)) {
+		return 1;
+	}
+	sm9_z256_twist_point_get_affine(x, y, P);
+
+	/* y^2 == x^3 + 5u */
+	sm9_z256_fp2_sqr(t, x);
+	sm9_z256_fp2_mul(x, x, t);
+	sm9_z256_modp_add(x[1], x[1], SM9_Z256_MONT_FIVE);
+	sm9_z256_fp2_sqr(y, y);
+	return sm9_z256_fp2_equ(x, y);
+}
+
+void sm9_z256_twist_point_get_affine(sm9_z256_fp2_t x, sm9_z256_fp2_t y,
+	const SM9_Z256_TWIST_POINT *P)
+{
+	sm9_z256_fp2_t zi, zi2;
+
+	sm9_z256_fp2_set_one(zi);
+	if (sm9_z256_fp2_equ(P->Z, zi)) {
+		sm9_z256_fp2_copy(x, P->X);
+		sm9_z256_fp2_copy(y, P->Y);
+		return;
+	}
+	sm9_z256_fp2_inv(zi, P->Z);
+	sm9_z256_fp2_sqr(zi2, zi);
+	sm9_z256_fp2_mul(x, P->X, zi2);
+	sm9_z256_fp2_mul(zi2, zi2, zi);
+	sm9_z256_fp2_mul(y, P->Y, zi2);
+}
+
+void sm9_z256_twist_point_set_affine(SM9_Z256_TWIST_POINT *R,
+	const sm9_z256_fp2_t x, const sm9_z256_fp2_t y)
+{
+	sm9_z256_fp2_copy(R->X, x);
+	sm9_z256_fp2_copy(R->Y, y);
+	sm9_z256_fp2_set_one(R->Z);
+}
+
+void sm9_z256_twist_point_neg(SM9_Z256_TWIST_POINT *R, const SM9_Z256_TWIST_POINT *P)
+{
+	sm9_z256_fp2_copy(R->X, P->X);
+	sm9_z256_fp2_neg(R->Y, P->Y);
+	sm9_z256_fp2_copy(R->Z, P->Z);
+}
+
+void sm9_z256_twist_point_dbl(SM9_Z256_TWIST_POINT *R, const SM9_Z256_TWIST_POINT *P)
+{
+	sm9_z256_fp2_t A, B, C, D, E, F;
+
+	if (sm9_z256_twist_point_is_at_infinity(P)) {
+		sm9_z256_twist_point_copy(R, P);
+		return;
+	}
+
+	/* dbl-2009-l */
+	sm9_z256_fp2_sqr(A, P->X);
+	sm9_z256_fp2_sqr(B, P->Y);
+	sm9_z256_fp2_sqr(C, B);
+	sm9_z256_fp2_add(D, P->X, B);
+	sm9_z256_fp2_sqr(D, D);
+	sm9_z256_fp2_sub(D, D, A);
+	sm9_z256_fp2_sub(D, D, C);
+	sm9_z256_fp2_dbl(D, D);
+	sm9_z256_fp2_tri(E, A);
+	sm9_z256_fp2_sqr(F, E);
+
+	/* Z3 = 2 * Y1 * Z1 */
+	sm9_z256_fp2_mul(R->Z, P->Y, P->Z);
+	sm9_z256_fp2_dbl(R->Z, R->Z);
+	/* X3 = F - 2 * D */
+	sm9_z256_fp2_dbl(A, D);
+	sm9_z256_fp2_sub(R->X, F, A);
+	/* Y3 = E * (D - X3) - 8 * C */
+	sm9_z256_fp2_sub(D, D, R->X);
+	sm9_z256_fp2_mul(D, E, D);
+	sm9_z256_fp2_dbl(C, C);
+	sm9_z256_fp2_dbl(C, C);
+	sm9_z256_fp2_dbl(C, C);
+	sm9_z256_fp2_sub(R->Y, D, C);
+}
+
+void sm9_z256_twist_point_add(SM9_Z256_TWIST_POINT *R, const SM9_Z256_TWIST_POINT *P,
+	const SM9_Z256_TWIST_POINT *Q)
+{
+	sm9_z256_fp2_t Z1Z1, Z2Z2, U1, U2, S1, S2, H, I, J, r, V;
+
+	if (sm9_z256_twist_point_is_at_infinity(P)) {
+		sm9_z256_twist_point_copy(R, Q);
+		return;
+	}
+	if (sm9_z256_twist_point_is_at_infinity(Q)) {
+		sm9_z256_twist_point_copy(R, P);
+		return;
+	}
+
+	/* add-2007-bl */
+	sm9_z256_fp2_sqr(Z1Z1, P->Z);
+	sm9_z256_fp2_sqr(Z2Z2, Q->Z);
+	sm9_z256_fp2_mul(U1, P->X, Z2Z2);
+	sm9_z256_fp2_mul(U2, Q->X, Z1Z1);
+	sm9_z256_fp2_mul(S1, P->Y, Q->Z);
+	sm9_z256_fp2_mul(S1, S1, Z2Z2);
+	sm9_z256_fp2_mul(S2, Q->Y, P->Z);
+	sm9_z256_fp2_mul(S2, S2, Z1Z1);
+	sm9_z256_fp2_sub(H, U2, U1);
+	sm9_z256_fp2_sub(r, S2, S1);
+
+	if (sm9_z256_fp2_is_zero(H)) {
+		if (sm9_z256_fp2_is_zero(r)) {
+			sm9_z256_twist_point_dbl(R, P);
+		} else {
+			sm9_z256_twist_point_set_infinity(R);
+		}
+		return;
+	}
+
+	sm9_z256_fp2_dbl(I, H);
+	sm9_z256_fp2_sqr(I, I);
+	sm9_z256_fp2_mul(J, H, I);
+	sm9_z256_fp2_dbl(r, r);
+	sm9_z256_fp2_mul(V, U1, I);
+
+	/* Z3 = ((Z1 + Z2)^2 - Z1Z1 - Z2Z2) * H */
+	sm9_z256_fp2_add(I, P->Z, Q->Z);
+	sm9_z256_fp2_sqr(I, I);
+	sm9_z256_fp2_sub(I, I, Z1Z1);
+	sm9_z256_fp2_sub(I, I, Z2Z2);
+	sm9_z256_fp2_mul(R->Z, I, H);
+	/* X3 = r^2 - J - 2 * V */
+	sm9_z256_fp2_sqr(I, r);
+	sm9_z256_fp2_sub(I, I, J);
+	sm9_z256_fp2_sub(I, I, V);
+	sm9_z256_fp2_sub(R->X, I, V);
+	/* Y3 = r * (V - X3) - 2 * S1 * J */
+	sm9_z256_fp2_sub(V, V, R->X);
+	sm9_z256_fp2_mul(V, r, V);
+	sm9_z256_fp2_mul(S1, S1, J);
+	sm9_z256_fp2_dbl(S1, S1);
+	sm9_z256_fp2_sub(R->Y, V, S1);
+}
+
+/* R = k * P, k is a big-endian byte string, 4-bit fixed window */
+static void sm9_z256_twist_point_mul_bin(SM9_Z256_TWIST_POINT *R,
+	const unsigned char *k, size_t klen, const SM9_Z256_TWIST_POINT *P)
+{
+	SM9_Z256_TWIST_POINT table[16];
+	SM9_Z256_TWIST_POINT T, S;
+	size_t i;
+	int j, w, m;
+
+	sm9_z256_twist_point_set_infinity(&table[0]);
+	sm9_z256_twist_point_copy(&table[1], P);
+	for (m = 2; m < 16; m++) {
+		if (m & 1) {
+			sm9_z256_twist_point_add(&table[m], &table[m - 1], P);
+		} else {
+			sm9_z256_twist_point_dbl(&table[m], &table[m / 2]);
+		}
+	}
+
+	sm9_z256_twist_point_set_infinity(&T);
+	for (i = 0; i < klen; i++) {
+		for (j = 4; j >= 0; j -= 4) {
+			sm9_z256_twist_point_dbl(&T, &T);
+			sm9_z256_twist_point_dbl(&T, &T);
+			sm9_z256_twist_point_dbl(&T, &T);
+			sm9_z256_twist_point_dbl(&T, &T);
+			w = (k[i] >> j) & 0x0f;
+
+			/* read the whole table to select the window value */
+			memset(&S, 0, sizeof(S));
+			for (m = 0; m < 16; m++) {
+				uint64_t mask = 0 - (uint64_t)(m == w);
+				uint64_t *s = (uint64_t *)&S;
+				const uint64_t *t = (const uint64_t *)&table[m];
+				size_t n;
+				for (n = 0; n < sizeof(S)/sizeof(uint64_t); n++) {
+					s[n] |= t[n] & mask;
+				}
+			}
+			sm9_z256_twist_point_add(&T, &T, &S);
+		}
+	}
+
+	sm9_z256_twist_point_copy(R, &T);
+	OPENSSL_cleanse(table, sizeof(table));
+	OPENSSL_cleanse(&S, sizeof(S));
+}
+
+int sm9_z256_twist_point_mul(SM9_Z256_TWIST_POINT *R, const BIGNUM *k,
+	const SM9_Z256_TWIST_POINT *P)
+{
+	unsigned char buf[64];
+	int len;
+
+	if (BN_is_negative(k) || (len = BN_num_bytes(k)) > (int)sizeof(buf)) {
+		return 0;
+	}
+	if (!BN_bn2bin(k, buf)) {
+		return 0;
+	}
+	sm9_z256_twist_point_mul_bin(R, buf, len, P);
+	OPENSSL_cleanse(buf, sizeof(buf));
+	return 1;
+}
+
+int sm9_z256_twist_point_from_point(SM9_Z256_TWIST_POINT *R, const point_t *P)
+{
+	if (point_is_at_infinity(P)) {
+		sm9_z256_twist_point_set_infinity(R);
+		return 1;
+	}
+	return sm9_z256_fp2_from_fp2(R->X, P->X)
+		&& sm9_z256_fp2_from_fp2(R->Y, P->Y)
+		&& sm9_z256_fp2_from_fp2(R->Z, P->Z);
+}
+
+/* parse the 129-byte encoding of point_to_octets() */
+int sm9_z256_twist_point_from_octets(SM9_Z256_TWIST_POINT *R,
+	const unsigned char from[129])
+{
+	sm9_z256_t t;
+	int i;
+
+	if (from[0] != 0x04) {
+		return 0;
+	}
+	for (i = 0; i < 4; i++) {
+		sm9_z256_from_bytes(t, from + 1 + 32 * i);
+		if (!sm9_z256_sub(t, t, SM9_Z256_P)) {
+			return 0;
+		}
+	}
+	sm9_z256_from_bytes(R->X[1], from + 1);
+	sm9_z256_from_bytes(R->X[0], from + 33);
+	sm9_z256_from_bytes(R->Y[1], from + 65);
+	sm9_z256_from_bytes(R->Y[0], from + 97);
+	sm9_z256_modp_to_mont(R->X[0], R->X[0]);
+	sm9_z256_modp_to_mont(R->X[1], R->X[1]);
+	sm9_z256_modp_to_mont(R->Y[0], R->Y[0]);
+	sm9_z256_modp_to_mont(R->Y[1], R->Y[1]);
+	sm9_z256_fp2_set_one(R->Z);
+	return sm9_z256_twist_point_is_on_curve(R);
+}
+
+/* the point_t routines expect affine coordinates with Z = 1 */
+int sm9_z256_twist_point_to_point(point_t *R, const SM9_Z256_TWIST_POINT *P)
+{
+	sm9_z256_fp2_t x, y;
+
+	if (sm9_z256_twist_point_is_at_infinity(P)) {
+		return point_set_to_infinity(R);
+	}
+	sm9_z256_twist_point_get_affine(x, y, P);
+	return sm9_z256_fp2_to_fp2(R->X, x)
+		&& sm9_z256_fp2_to_fp2(R->Y, y)
+		&& fp2_set_one(R->Z);
+}
+
+/* Q1 = pi(Q), Q2 = -pi^2(Q) for affine Q */
+static void sm9_z256_twist_point_pi1(SM9_Z256_TWIST_POINT *R, const SM9_Z256_TWIST_POINT *Q)
+{
+	sm9_z256_fp2_conjugate(R->X, Q->X);
+	sm9_z256_fp2_mul_fp(R->X, R->X, SM9_Z256_TWIST_FROBENIUS_X);
+	sm9_z256_fp2_conjugate(R->Y, Q->Y);
+	sm9_z256_fp2_mul_fp(R->Y, R->Y, SM9_Z256_TWIST_FROBENIUS_Y);
+	sm9_z256_fp2_copy(R->Z, Q->Z);
+}
+
+static void sm9_z256_twist_point_pi2_neg(SM9_Z256_TWIST_POINT *R, const SM9_Z256_TWIST_POINT *Q)
+{
+	sm9_z256_fp2_mul_fp(R->X, Q->X, SM9_Z256_TWIST_FROBENIUS2_X);
+	sm9_z256_fp2_copy(R->Y, Q->Y);
+	sm9_z256_fp2_copy(R->Z, Q->Z);
+}
+
+
+/*
+ * R-ate pairing
+ *
+ * The line functions are evaluated in the same embedding as eval_tangent()
+ * and eval_line(), i.e. (x, y) -> (x * w^-2, y * w^-3), but are scaled by
+ * factors in the proper subfields Fp2 and Fp4, which are all mapped to one
+ * by the final exponentiation.  After scaling a line has the sparse form
+ *
+ *	l = (l0 + l1 * v) + l2 * w^2,	l0, l2 in Fp2, l1 = c * yP with c in Fp2
+ */
+
+static void sm9_z256_fp12_mul_line(sm9_z256_fp12_t f, const sm9_z256_fp4_t A,
+	const sm9_z256_fp2_t B)
+{
+	sm9_z256_fp4_t t0, t1, t2, s;
+
+	/* f * (A + B * w^2) */
+	sm9_z256_fp4_mul(t0, f[0], A);
+	sm9_z256_fp4_mul(t1, f[1], A);
+	sm9_z256_fp4_mul(t2, f[2], A);
+
+	sm9_z256_fp4_mul_fp2(s, f[1], B);
+	sm9_z256_fp4_mul_v(s, s);
+	sm9_z256_fp4_add(t0, t0, s);
+
+	sm9_z256_fp4_mul_fp2(s, f[2], B);
+	sm9_z256_fp4_mul_v(s, s);
+	sm9_z256_fp4_add(t1, t1, s);
+
+	sm9_z256_fp4_mul_fp2(s, f[0], B);
+	sm9_z256_fp4_add(t2, t2, s);
+
+	memcpy(f[0], t0, sizeof(sm9_z256_fp4_t));
+	memcpy(f[1], t1, sizeof(sm9_z256_fp4_t));
+	memcpy(f[2], t2, sizeof(sm9_z256_fp4_t));
+}
+
+/*
+ * The line coefficients (c0, c1, c2) only depend on the twist points, the
+ * line evaluated at P = (xP, yP) is
+ *	l = (c0 + c1 * yP * v) + c2 * xP * w^2
+ */
+static void sm9_z256_line_eval(sm9_z256_fp4_t A, sm9_z256_fp2_t B,
+	const sm9_z256_fp2_t c[3], const sm9_z256_t xP, const sm9_z256_t yP)
+{
+	sm9_z256_fp2_copy(A[0], c[0]);
+	sm9_z256_fp2_mul_fp(A[1], c[1], yP);
+	sm9_z256_fp2_mul_fp(B, c[2], xP);
+}
+
+/*
+ * Tangent line at T, T = 2 * T.
+ *	c0 = 2 * Y^2 - 3 * X^3, c1 = -2 * Y * Z^3, c2 = 3 * X^2 * Z^2
+ */
+static void sm9_z256_g_tangent_coeffs(sm9_z256_fp2_t c[3], SM9_Z256_TWIST_POINT *T)
+{
+	sm9_z256_fp2_t XX, YY, ZZ, t;
+
+	sm9_z256_fp2_sqr(XX, T->X);
+	sm9_z256_fp2_sqr(YY, T->Y);
+	sm9_z256_fp2_sqr(ZZ, T->Z);
+
+	/* c0 = 2 * Y^2 - 3 * X^3 */
+	sm9_z256_fp2_mul(t, XX, T->X);
+	sm9_z256_fp2_tri(t, t);
+	sm9_z256_fp2_dbl(c[0], YY);
+	sm9_z256_fp2_sub(c[0], c[0], t);
+
+	/* c2 = 3 * X^2 * Z^2 */
+	sm9_z256_fp2_mul(t, XX, ZZ);
+	sm9_z256_fp2_tri(c[2], t);
+
+	sm9_z256_twist_point_dbl(T, T);
+
+	/* c1 = -(2 * Y * Z) * Z^2, where 2 * Y * Z is the new Z */
+	sm9_z256_fp2_mul(t, T->Z, ZZ);
+	sm9_z256_fp2_neg(c[1], t);
+}
+
+/*
+ * Line through T and the affine point Q, T = T + Q.
+ * With H = x2 * Z^2 - X, R = y2 * Z^3 - Y and Z3 = Z * H:
+ *	c0 = y2 * Z3 - R * x2, c1 = -Z3, c2 = R
+ */
+static void sm9_z256_g_line_coeffs(sm9_z256_fp2_t c[3], SM9_Z256_TWIST_POINT *T,
+	const SM9_Z256_TWIST_POINT *Q)
+{
+	sm9_z256_fp2_t ZZ, H, R, HH, HHH, V, t;
+
+	/* madd */
+	sm9_z256_fp2_sqr(ZZ, T->Z);
+	sm9_z256_fp2_mul(H, Q->X, ZZ);
+	sm9_z256_fp2_sub(H, H, T->X);
+	sm9_z256_fp2_mul(R, Q->Y, T->Z);
+	sm9_z256_fp2_mul(R, R, ZZ);
+	sm9_z256_fp2_sub(R, R, T->Y);
+
+	sm9_z256_fp2_sqr(HH, H);
+	sm9_z256_fp2_mul(HHH, HH, H);
+	sm9_z256_fp2_mul(V, T->X, HH);
+
+	sm9_z256_fp2_mul(T->Z, T->Z, H);
+	sm9_z256_fp2_sqr(t, R);
+	sm9_z256_fp2_sub(t, t, HHH);
+	sm9_z256_fp2_sub(t, t, V);
+	sm9_z256_fp2_sub(T->X, t, V);
+	sm9_z256_fp2_sub(V, V, T->X);
+	sm9_z256_fp2_mul(V, V, R);
+	sm9_z256_fp2_mul(t, T->Y, HHH);
+	sm9_z256_fp2_sub(T->Y, V, t);
+
+	/* c0 = y2 * Z3 - R * x2 */
+	sm9_z256_fp2_mul(c[0], Q->Y, T->Z);
+	sm9_z256_fp2_mul(t, R, Q->X);
+	sm9_z256_fp2_sub(c[0], c[0], t);
+
+	/* c1 = -Z3 */
+	sm9_z256_fp2_neg(c[1], T->Z);
+
+	/* c2 = R */
+	sm9_z256_fp2_copy(c[2], R);
+}
+
+/* tangent line at T evaluated at P, T = 2 * T */
+void sm9_z256_eval_g_tangent(sm9_z256_fp4_t A, sm9_z256_fp2_t B,
+	SM9_Z256_TWIST_POINT *T, const sm9_z256_t xP, const sm9_z256_t yP)
+{
+	sm9_z256_fp2_t c[3];
+
+	sm9_z256_g_tangent_coeffs(c, T);
+	sm9_z256_line_eval(A, B, (const sm9_z256_fp2_t *)c, xP, yP);
+}
+
+/* line through T and the affine point Q evaluated at P, T = T + Q */
+void sm9_z256_eval_g_line(sm9_z256_fp4_t A, sm9_z256_fp2_t B,
+	SM9_Z256_TWIST_POINT *T, const SM9_Z256_TWIST_POINT *Q,
+	const sm9_z256_t xP, const sm9_z256_t yP)
+{
+	sm9_z256_fp2_t c[3];
+
+	sm9_z256_g_line_coeffs(c, T, Q);
+	sm9_z256_line_eval(A, B, (const sm9_z256_fp2_t *)c, xP, yP);
+}
+
+/*
+ * Miller loop of the R-ate pairing for the product of n pairings, all the
+ * Q[i] must be affine.  The loops share the squaring of the accumulator,
+ * T[] is the workspace for the n running points.
+ */
+static void sm9_z256_miller_loop_multi(sm9_z256_fp12_t f,
+	const SM9_Z256_TWIST_POINT *Q, SM9_Z256_TWIST_POINT *T,
+	const sm9_z256_t *xP, const sm9_z256_t *yP, size_t n)
+{
+	SM9_Z256_TWIST_POINT Q1, Q2;
+	sm9_z256_fp4_t A;
+	sm9_z256_fp2_t B;
+	size_t j;
+	int i;
+
+	sm9_z256_fp12_set_one(f);
+	for (j = 0; j < n; j++) {
+		sm9_z256_twist_point_copy(&T[j], &Q[j]);
+	}
+
+	/* loop count 6t + 2 = 0x2400000000215D93E, 66 bits */
+	for (i = 64; i >= 0; i--) {
+		uint64_t bit = i >= 64 ? (SM9_Z256_LOOP_HI >> (i - 64)) & 1
+			: (SM9_Z256_LOOP_LO >> i) & 1;
+
+		sm9_z256_fp12_sqr(f, f);
+		for (j = 0; j < n; j++) {
+			sm9_z256_eval_g_tangent(A, B, &T[j], xP[j], yP[j]);
+			sm9_z256_fp12_mul_line(f, A, B);
+		}
+
+		if (bit) {
+			for (j = 0; j < n; j++) {
+				sm9_z256_eval_g_line(A, B, &T[j], &Q[j], xP[j], yP[j]);
+				sm9_z256_fp12_mul_line(f, A, B);
+			}
+		}
+	}
+
+	for (j = 0; j < n; j++) {
+		sm9_z256_twist_point_pi1(&Q1, &Q[j]);
+		sm9_z256_twist_point_pi2_neg(&Q2, &Q[j]);
+
+		sm9_z256_eval_g_line(A, B, &T[j], &Q1, xP[j], yP[j]);
+		sm9_z256_fp12_mul_line(f, A, B);
+
+		sm9_z256_eval_g_line(A, B, &T[j], &Q2, xP[j], yP[j]);
+		sm9_z256_fp12_mul_line(f, A, B);
+	}
+}
+
+/* Miller loop of the R-ate pairing, Q must be affine */
+void sm9_z256_miller_loop(sm9_z256_fp12_t f, const SM9_Z256_TWIST_POINT *Q,
+	const sm9_z256_t xP, const sm9_z256_t yP)
+{
+	SM9_Z256_TWIST_POINT T;
+	sm9_z256_miller_loop_multi(f, Q, &T, (const sm9_z256_t *)xP,
+		(const sm9_z256_t *)yP, 1);
+}
+
+/*
+ * Precomputed Miller loop for a fixed G2 point Q, all the twist point
+ * arithmetic is done once and the pairing only has to evaluate the stored
+ * lines at P.
+ */
+void sm9_z256_line_table_init(SM9_Z256_LINE_TABLE *t, const SM9_Z256_TWIST_POINT *Q)
+{
+	SM9_Z256_TWIST_POINT Qa, T, Q1, Q2;
+	int i, n = 0;
+
+	sm9_z256_twist_point_get_affine(Qa.X, Qa.Y, Q);
+	sm9_z256_fp2_set_one(Qa.Z);
+	sm9_z256_twist_point_copy(&T, &Qa);
+
+	for (i = 64; i >= 0; i--) {
+		uint64_t bit = i >= 64 ? (SM9_Z256_LOOP_HI >> (i - 64)) & 1
+			: (SM9_Z256_LOOP_LO >> i) & 1;
+
+		sm9_z256_g_tangent_coeffs(t->lines[n++], &T);
+		if (bit) {
+			sm9_z256_g_line_coeffs(t->lines[n++], &T, &Qa);
+		}
+	}
+
+	sm9_z256_twist_point_pi1(&Q1, &Qa);
+	sm9_z256_twist_point_pi2_neg(&Q2, &Qa);
+	sm9_z256_g_line_coeffs(t->lines[n++], &T, &Q1);
+	sm9_z256_g_line_coeffs(t->lines[n++], &T, &Q2);
+
+	OPENSSL_assert(n == SM9_Z256_NUM_LINES);
+}
+
+void sm9_z256_miller_loop_with_table(sm9_z256_fp12_t f,
+	const SM9_Z256_LINE_TABLE *t, const sm9_z256_t xP, const sm9_z256_t yP)
+{
+	sm9_z256_fp4_t A;
+	sm9_z256_fp2_t B;
+	int i, n = 0;
+
+	sm9_z256_fp12_set_one(f);
+	for (i = 64; i >= 0; i--) {
+		uint64_t bit = i >= 64 ? (SM9_Z256_LOOP_HI >> (i - 64)) & 1
+			: (SM9_Z256_LOOP_LO >> i) & 1;
+
+		sm9_z256_fp12_sqr(f, f);
+		sm9_z256_line_eval(A, B, t->lines[n++], xP, yP);
+		sm9_z256_fp12_mul_line(f, A, B);
+
+		if (bit) {
+			sm9_z256_line_eval(A, B, t->lines[n++], xP, yP);
+			sm9_z256_fp12_mul_line(f, A, B);
+		}
+	}
+
+	sm9_z256_line_eval(A, B, t->lines[n++], xP, yP);
+	sm9_z256_fp12_mul_line(f, A, B);
+	sm9_z256_line_eval(A, B, t->lines[n++], xP, yP);
+	sm9_z256_fp12_mul_line(f, A, B);
+}
+
+/*
+ * r = f^((p^12 - 1)/n)
+ *   = (f^(p^6 - 1))^(p^2 + 1))^((p^4 - p^2 + 1)/n)
+ *
+ * The hard part uses the addition chain of Scott et al. for BN curves over
+ * f^t, f^(t^2) and f^(t^3), which computes exactly the same power.
+ */
+static void sm9_z256_final_exponent_inv(sm9_z256_fp12_t r,
+	const sm9_z256_fp12_t f, const sm9_z256_fp12_t f_inv)
+{
+	sm9_z256_fp12_t t0, t1, fx, fx2, fx3;
+	sm9_z256_fp12_t y0, y1, y2, y3, y4, y5, y6;
+
+	/* easy part */
+	sm9_z256_fp12_conjugate(t0, f);
+	sm9_z256_fp12_mul(t0, t0, f_inv);
+	sm9_z256_fp12_frobenius(t1, t0, 2);
+	sm9_z256_fp12_mul(t0, t0, t1);
+
+	/* hard part */
+	sm9_z256_fp12_pow_t(fx, t0);
+	sm9_z256_fp12_pow_t(fx2, fx);
+	sm9_z256_fp12_pow_t(fx3, fx2);
+
+	/* y0 = f^p * f^(p^2) * f^(p^3) */
+	sm9_z256_fp12_frobenius(y0, t0, 1);
+	sm9_z256_fp12_frobenius(t1, t0, 2);
+	sm9_z256_fp12_mul(y0, y0, t1);
+	sm9_z256_fp12_frobenius(t1, t0, 3);
+	sm9_z256_fp12_mul(y0, y0, t1);
+
+	/* y1 = 1/f */
+	sm9_z256_fp12_conjugate(y1, t0);
+
+	/* y2 = (f^(t^2))^(p^2) */
+	sm9_z256_fp12_frobenius(y2, fx2, 2);
+
+	/* y3 = 1/(f^t)^p */
+	sm9_z256_fp12_frobenius(y3, fx, 1);
+	sm9_z256_fp12_conjugate(y3, y3);
+
+	/* y4 = 1/(f^t * (f^(t^2))^p) */
+	sm9_z256_fp12_frobenius(y4, fx2, 1);
+	sm9_z256_fp12_mul(y4, y4, fx);
+	sm9_z256_fp12_conjugate(y4, y4);
+
+	/* y5 = 1/f^(t^2) */
+	sm9_z256_fp12_conjugate(y5, fx2);
+
+	/* y6 = 1/(f^(t^3) * (f^(t^3))^p) */
+	sm9_z256_fp12_frobenius(y6, fx3, 1);
+	sm9_z256_fp12_mul(y6, y6, fx3);
+	sm9_z256_fp12_conjugate(y6, y6);
+
+	/* t0 = y6^2 * y4 * y5 */
+	sm9_z256_fp12_sqr(t0, y6);
+	sm9_z256_fp12_mul(t0, t0, y4);
+	sm9_z256_fp12_mul(t0, t0, y5);
+	/* t1 = y3 * y5 * t0 */
+	sm9_z256_fp12_mul(t1, y3, y5);
+	sm9_z256_fp12_mul(t1, t1, t0);
+	/* t0 = t0 * y2 */
+	sm9_z256_fp12_mul(t0, t0, y2);
+	/* t1 = (t1^2 * t0)^2 */
+	sm9_z256_fp12_sqr(t1, t1);
+	sm9_z256_fp12_mul(t1, t1, t0);
+	sm9_z256_fp12_sqr(t1, t1);
+	/* t0 = t1 * y1, t1 = t1 * y0 */
+	sm9_z256_fp12_mul(t0, t1, y1);
+	sm9_z256_fp12_mul(t1, t1, y0);
+	/* r = t0^2 * t1 */
+	sm9_z256_fp12_sqr(t0, t0);
+	sm9_z256_fp12_mul(r, t0, t1);
+}
+
+void sm9_z256_final_exponent(sm9_z256_fp12_t r, const sm9_z256_fp12_t f)
+{
+	sm9_z256_fp12_t f_inv;
+
+	sm9_z256_fp12_inv(f_inv, f);
+	sm9_z256_final_exponent_inv(r, f, f_inv);
+}
+
+/*
+ * Final exponentiation of n independent values, the inversions of the easy
+ * part are shared with Montgomery's trick, i.e. one fp12 inversion and
+ * 3(n - 1) multiplications instead of n inversions.  All f[i] must be
+ * non-zero, which holds for the output of the Miller loop.
+ */
+int sm9_z256_final_exponent_batch(sm9_z256_fp12_t *r, const sm9_z256_fp12_t *f,
+	size_t n)
+{
+	sm9_z256_fp12_t *c;
+	sm9_z256_fp12_t inv, t;
+	size_t i;
+
+	if (n == 0) {
+		return 1;
+	}
+	if (!(c = OPENSSL_malloc(sizeof(sm9_z256_fp12_t) * n))) {
+		return 0;
+	}
+
+	/* c[i] = f[0] * ... * f[i] */
+	sm9_z256_fp12_copy(c[0], f[0]);
+	for (i = 1; i < n; i++) {
+		sm9_z256_fp12_mul(c[i], c[i - 1], f[i]);
+	}
+	sm9_z256_fp12_inv(inv, c[n - 1]);
+
+	for (i = n - 1; i > 0; i--) {
+		/* t = f[i]^-1, inv = (f[0] * ... * f[i - 1])^-1 */
+		sm9_z256_fp12_mul(t, inv, c[i - 1]);
+		sm9_z256_fp12_mul(inv, inv, f[i]);
+		sm9_z256_final_exponent_inv(r[i], f[i], t);
+	}
+	sm9_z256_final_exponent_inv(r[0], f[0], inv);
+
+	OPENSSL_free(c);
+	return 1;
+}
+
+void sm9_z256_pairing(sm9_z256_fp12_t r, const SM9_Z256_TWIST_POINT *Q,
+	const sm9_z256_t xP, const sm9_z256_t yP)
+{
+	SM9_Z256_TWIST_POINT Qa;
+	sm9_z256_fp12_t f;
+
+	sm9_z256_twist_point_get_affine(Qa.X, Qa.Y, Q);
+	sm9_z256_fp2_set_one(Qa.Z);
+
+	sm9_z256_miller_loop(f, &Qa, xP, yP);
+	sm9_z256_final_exponent(r, f);
+}
+
+/* r = e(P[0], Q[0]) * ... * e(P[n - 1], Q[n - 1]) with one final exponentiation */
+int sm9_z256_multi_pairing(sm9_z256_fp12_t r, const SM9_Z256_TWIST_POINT *Q,
+	const sm9_z256_t *xP, const sm9_z256_t *yP, size_t n)
+{
+	SM9_Z256_TWIST_POINT *buf;
+	sm9_z256_fp12_t f;
+	size_t i;
+
+	if (n == 0) {
+		sm9_z256_fp12_set_one(r);
+		return 1;
+	}
+	if (!(buf = OPENSSL_malloc(sizeof(SM9_Z256_TWIST_POINT) * n * 2))) {
+		return 0;
+	}
+	for (i = 0; i < n; i++) {
+		sm9_z256_twist_point_get_affine(buf[i].X, buf[i].Y, &Q[i]);
+		sm9_z256_fp2_set_one(buf[i].Z);
+	}
+
+	sm9_z256_miller_loop_multi(f, buf, buf + n, xP, yP, n);
+	sm9_z256_final_exponent(r, f);
+
+	OPENSSL_free(buf);
+	return 1;
+}
+
+void sm9_z256_pairing_with_table(sm9_z256_fp12_t r, const SM9_Z256_LINE_TABLE *t,
+	const sm9_z256_t xP, const sm9_z256_t yP)
+{
+	sm9_z256_fp12_t f;
+
+	sm9_z256_miller_loop_with_table(f, t, xP, yP);
+	sm9_z256_final_exponent(r, f);
+}
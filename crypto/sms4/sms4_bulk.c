@@ -0,0 +1,302 @@
+/* ====================================================================
+ * Copyright (c) 2014 - 2019 The GmSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the GmSSL Project.
+ *    (http://gmssl.org/)"
+ *
+ * 4. The name "GmSSL Project" must not be used to endorse or promote
+ *    products derived from this software without prior written
+ *    permission. For written permission, please contact
+ *    guanzhi1980@gmail.com.
+ *
+ * 5. Products derived from this software may not be called "GmSSL"
+ *    nor may "GmSSL" appear in their names without prior written
+ *    permission of the GmSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the GmSSL Project
+ *    (http://gmssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE GmSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE GmSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+/*
+ * Modes over a multi-block ECB function, so that the bitsliced and the
+ * AES-NI/GFNI kernels can be used for all the modes that are parallel in
+ * the direction being computed: CTR, XTS and CBC and CFB decryption.
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/sms4.h>
+#include <openssl/modes.h>
+#include "modes_lcl.h"
+#include "sms4_lcl.h"
+
+#define SMS4_BULK_BLOCKS	256
+
+static void sms4_tbox_ecb_encrypt_blocks(const unsigned char *in,
+	unsigned char *out, size_t blocks, const sms4_key_t *key)
+{
+	while (blocks--) {
+		sms4_encrypt(in, out, key);
+		in += SMS4_BLOCK_SIZE;
+		out += SMS4_BLOCK_SIZE;
+	}
+}
+
+/*
+ * AES-NI/GFNI for any length, bitsliced from SMS4_BS_MIN_BLOCKS blocks on,
+ * the T-box for short input when neither is faster.
+ */
+sms4_blocks_f sms4_blocks_func(size_t blocks)
+{
+	sms4_blocks_f f;
+
+	if ((f = sms4_aesni_blocks_func()) != NULL)
+		return f;
+	if (blocks >= SMS4_BS_MIN_BLOCKS)
+		return sms4_bs_ecb_encrypt_blocks;
+	return sms4_tbox_ecb_encrypt_blocks;
+}
+
+void sms4_ctr32_encrypt_blocks_with(const unsigned char *in,
+	unsigned char *out, size_t blocks, const sms4_key_t *key,
+	const unsigned char iv[16], sms4_blocks_f f)
+{
+	unsigned char buf[SMS4_BULK_BLOCKS * SMS4_BLOCK_SIZE];
+	uint32_t ctr = GETU32(iv + 12);
+	size_t n, i;
+
+	while (blocks) {
+		n = blocks < SMS4_BULK_BLOCKS ? blocks : SMS4_BULK_BLOCKS;
+		for (i = 0; i < n; i++) {
+			memcpy(buf + 16 * i, iv, 12);
+			PUTU32(buf + 16 * i + 12, ctr);
+			ctr++;
+		}
+		f(buf, buf, n, key);
+		for (i = 0; i < n * SMS4_BLOCK_SIZE; i++)
+			out[i] = in[i] ^ buf[i];
+		in += n * SMS4_BLOCK_SIZE;
+		out += n * SMS4_BLOCK_SIZE;
+		blocks -= n;
+	}
+	OPENSSL_cleanse(buf, sizeof(buf));
+}
+
+/* in and out may be the same, a last partial block is left to the caller */
+void sms4_cbc_decrypt_with(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key, unsigned char iv[16],
+	sms4_blocks_f f)
+{
+	unsigned char buf[SMS4_BULK_BLOCKS * SMS4_BLOCK_SIZE];
+	unsigned char last[16];
+	size_t blocks = len / SMS4_BLOCK_SIZE;
+	size_t n, i;
+
+	while (blocks) {
+		n = blocks < SMS4_BULK_BLOCKS ? blocks : SMS4_BULK_BLOCKS;
+		f(in, buf, n, key);
+		memcpy(last, in + (n - 1) * SMS4_BLOCK_SIZE, 16);
+		/* in[] is read before out[] is written, for in-place */
+		for (i = 0; i < SMS4_BLOCK_SIZE; i++)
+			buf[i] ^= iv[i];
+		for (i = SMS4_BLOCK_SIZE; i < n * SMS4_BLOCK_SIZE; i++)
+			buf[i] ^= in[i - SMS4_BLOCK_SIZE];
+		memcpy(out, buf, n * SMS4_BLOCK_SIZE);
+		memcpy(iv, last, 16);
+		in += n * SMS4_BLOCK_SIZE;
+		out += n * SMS4_BLOCK_SIZE;
+		blocks -= n;
+	}
+	OPENSSL_cleanse(buf, sizeof(buf));
+}
+
+/* full blocks from a block boundary (num == 0), iv is left as for CFB128 */
+void sms4_cfb128_decrypt_with(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key, unsigned char iv[16],
+	sms4_blocks_f f)
+{
+	unsigned char buf[SMS4_BULK_BLOCKS * SMS4_BLOCK_SIZE];
+	size_t blocks = len / SMS4_BLOCK_SIZE;
+	size_t n, i;
+
+	while (blocks) {
+		n = blocks < SMS4_BULK_BLOCKS ? blocks : SMS4_BULK_BLOCKS;
+		memcpy(buf, iv, 16);
+		memcpy(buf + SMS4_BLOCK_SIZE, in, (n - 1) * SMS4_BLOCK_SIZE);
+		memcpy(iv, in + (n - 1) * SMS4_BLOCK_SIZE, 16);
+		f(buf, buf, n, key);
+		for (i = 0; i < n * SMS4_BLOCK_SIZE; i++)
+			out[i] = in[i] ^ buf[i];
+		in += n * SMS4_BLOCK_SIZE;
+		out += n * SMS4_BLOCK_SIZE;
+		blocks -= n;
+	}
+	OPENSSL_cleanse(buf, sizeof(buf));
+}
+
+/* multiply the tweak by x in GF(2^128) as in IEEE P1619 */
+static void sms4_xts_double(unsigned char t[16])
+{
+	unsigned int c = 0, n;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		n = t[i] >> 7;
+		t[i] = (unsigned char)((t[i] << 1) | c);
+		c = n;
+	}
+	t[0] ^= (unsigned char)(0x87 & (0 - c));
+}
+
+static void sms4_xts_block(const unsigned char *in, unsigned char *out,
+	const sms4_key_t *key, const unsigned char tweak[16], sms4_blocks_f f)
+{
+	unsigned char buf[16];
+	int i;
+
+	for (i = 0; i < 16; i++)
+		buf[i] = in[i] ^ tweak[i];
+	f(buf, buf, 1, key);
+	for (i = 0; i < 16; i++)
+		out[i] = buf[i] ^ tweak[i];
+}
+
+/*
+ * key1 is the encryption or decryption key, key2 the encryption key of the
+ * tweak. A last partial block is handled by ciphertext stealing.
+ */
+void sms4_xts_with(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key1, const sms4_key_t *key2,
+	const unsigned char iv[16], int enc, sms4_blocks_f f)
+{
+	unsigned char buf[SMS4_BULK_BLOCKS * SMS4_BLOCK_SIZE];
+	unsigned char tweaks[SMS4_BULK_BLOCKS * SMS4_BLOCK_SIZE];
+	unsigned char tweak[16];
+	unsigned char pp[16];
+	size_t blocks = len / SMS4_BLOCK_SIZE;
+	size_t rem = len % SMS4_BLOCK_SIZE;
+	size_t n, i;
+
+	if (blocks == 0)
+		return;
+
+	f(iv, tweak, 1, key2);
+
+	if (!enc && rem)
+		blocks--;
+
+	while (blocks) {
+		n = blocks < SMS4_BULK_BLOCKS ? blocks : SMS4_BULK_BLOCKS;
+		for (i = 0; i < n; i++) {
+			memcpy(tweaks + 16 * i, tweak, 16);
+			sms4_xts_double(tweak);
+		}
+		for (i = 0; i < n * SMS4_BLOCK_SIZE; i++)
+			buf[i] = in[i] ^ tweaks[i];
+		f(buf, buf, n, key1);
+		for (i = 0; i < n * SMS4_BLOCK_SIZE; i++)
+			out[i] = buf[i] ^ tweaks[i];
+		in += n * SMS4_BLOCK_SIZE;
+		out += n * SMS4_BLOCK_SIZE;
+		blocks -= n;
+	}
+
+	if (rem) {
+		if (enc) {
+			memcpy(pp, in, rem);
+			memcpy(pp + rem, out - 16 + rem, 16 - rem);
+			memcpy(out, out - 16, rem);
+			sms4_xts_block(pp, out - 16, key1, tweak, f);
+		} else {
+			unsigned char t[16];
+
+			memcpy(t, tweak, 16);
+			sms4_xts_double(t);
+			sms4_xts_block(in, pp, key1, t, f);
+			memcpy(buf, in + 16, rem);
+			memcpy(buf + rem, pp + rem, 16 - rem);
+			memcpy(out + 16, pp, rem);
+			sms4_xts_block(buf, out, key1, tweak, f);
+			OPENSSL_cleanse(t, sizeof(t));
+		}
+	}
+
+	OPENSSL_cleanse(buf, sizeof(buf));
+	OPENSSL_cleanse(tweaks, sizeof(tweaks));
+	OPENSSL_cleanse(tweak, sizeof(tweak));
+	OPENSSL_cleanse(pp, sizeof(pp));
+}
+
+void sms4_bulk_ctr32_encrypt_blocks(const unsigned char *in,
+	unsigned char *out, size_t blocks, const sms4_key_t *key,
+	const unsigned char iv[16])
+{
+	sms4_blocks_f f = sms4_blocks_func(blocks);
+
+	if (f == sms4_tbox_ecb_encrypt_blocks)
+		sms4_ctr32_encrypt_blocks(in, out, blocks, key, iv);
+	else
+		sms4_ctr32_encrypt_blocks_with(in, out, blocks, key, iv, f);
+}
+
+void sms4_bulk_cbc_decrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key, unsigned char iv[16])
+{
+	sms4_blocks_f f = sms4_blocks_func(len / SMS4_BLOCK_SIZE);
+
+	if (f != sms4_tbox_ecb_encrypt_blocks) {
+		sms4_cbc_decrypt_with(in, out, len, key, iv, f);
+		in += len - len % SMS4_BLOCK_SIZE;
+		out += len - len % SMS4_BLOCK_SIZE;
+		len %= SMS4_BLOCK_SIZE;
+	}
+	if (len)
+		CRYPTO_cbc128_decrypt(in, out, len, key, iv,
+			(block128_f)sms4_encrypt);
+}
+
+void sms4_bulk_xts_encrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key1, const sms4_key_t *key2,
+	const unsigned char iv[16])
+{
+	sms4_xts_with(in, out, len, key1, key2, iv, 1,
+		sms4_blocks_func(len / SMS4_BLOCK_SIZE));
+}
+
+void sms4_bulk_xts_decrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key1, const sms4_key_t *key2,
+	const unsigned char iv[16])
+{
+	sms4_xts_with(in, out, len, key1, key2, iv, 0,
+		sms4_blocks_func(len / SMS4_BLOCK_SIZE));
+}
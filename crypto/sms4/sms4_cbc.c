@@ -47,13 +47,62 @@
  * ====================================================================
  */
 
+#include <string.h>
+#include <openssl/crypto.h>
 #include <openssl/sms4.h>
 #include <openssl/modes.h>
+#include "sms4_lcl.h"
 
+/* decryption is parallel and goes to sms4_blocks_func() */
 void sms4_cbc_encrypt(const unsigned char *in, unsigned char *out,
 	size_t len, const sms4_key_t *key, unsigned char *iv, int enc)
 {
 	if (enc)
 		CRYPTO_cbc128_encrypt(in, out, len, key, iv, (block128_f)sms4_encrypt);
-	else	CRYPTO_cbc128_decrypt(in, out, len, key, iv, (block128_f)sms4_encrypt);
+	else	sms4_bulk_cbc_decrypt(in, out, len, key, iv);
+}
+
+/*
+ * The i-th block of every stream still running is encrypted in one call
+ * of the multi-block function, streams are dropped as they end. A single
+ * stream left is not worth a padded batch.
+ */
+void sms4_cbc_encrypt_streams(sms4_cbc_stream_t *streams, size_t n,
+	const sms4_key_t *key)
+{
+	unsigned char buf[SMS4_CBC_MAX_STREAMS * SMS4_BLOCK_SIZE];
+	sms4_cbc_stream_t *s[SMS4_CBC_MAX_STREAMS];
+	size_t active, blk, i, j, k;
+	sms4_blocks_f f;
+
+	for (; n; streams += active, n -= active) {
+		active = n < SMS4_CBC_MAX_STREAMS ? n : SMS4_CBC_MAX_STREAMS;
+
+		for (i = j = 0; i < active; i++) {
+			if (streams[i].blocks)
+				s[j++] = &streams[i];
+		}
+		f = sms4_blocks_func(j);
+
+		for (blk = 0; j; blk++) {
+			for (i = 0; i < j; i++) {
+				const unsigned char *p = s[i]->in + 16 * blk;
+
+				for (k = 0; k < 16; k++)
+					buf[16 * i + k] = p[k] ^ s[i]->iv[k];
+			}
+			if (j > 1)
+				f(buf, buf, j, key);
+			else
+				sms4_encrypt(buf, buf, key);
+			for (i = k = 0; i < j; i++) {
+				memcpy(s[i]->out + 16 * blk, buf + 16 * i, 16);
+				memcpy(s[i]->iv, buf + 16 * i, 16);
+				if (s[i]->blocks > blk + 1)
+					s[k++] = s[i];
+			}
+			j = k;
+		}
+	}
+	OPENSSL_cleanse(buf, sizeof(buf));
 }
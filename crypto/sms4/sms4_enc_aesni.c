@@ -0,0 +1,707 @@
+/* ====================================================================
+ * Copyright (c) 2014 - 2019 The GmSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the GmSSL Project.
+ *    (http://gmssl.org/)"
+ *
+ * 4. The name "GmSSL Project" must not be used to endorse or promote
+ *    products derived from this software without prior written
+ *    permission. For written permission, please contact
+ *    guanzhi1980@gmail.com.
+ *
+ * 5. Products derived from this software may not be called "GmSSL"
+ *    nor may "GmSSL" appear in their names without prior written
+ *    permission of the GmSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the GmSSL Project
+ *    (http://gmssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE GmSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE GmSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+/*
+ * SMS4 with the S-box computed by the AES or GFNI instructions. The SMS4
+ * and AES S-boxes are both an inversion in GF(2^8) between affine maps, so
+ *
+ *	S(x) = M2 * AES_S(M1 * x + c1) + c2
+ *
+ * with M1 (and c1) mapping to the AES field, AES_S computed by AESENCLAST
+ * with a zero round key, and M2 (and c2) mapping back. Both affine maps
+ * are two PSHUFB lookups on the nibbles. With GFNI the whole S-box is one
+ * GF2P8AFFINEQB and one GF2P8AFFINEINVQB.
+ *
+ * The blocks are transposed so that each register holds the same word of
+ * 4 (SSE), 8 (AVX2) or 16 (AVX-512) blocks, and two such sets are
+ * interleaved. There are no table lookups.
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/sms4.h>
+#include "modes_lcl.h"
+#include "sms4_lcl.h"
+
+#if defined(OPENSSL_CPUID_OBJ) && !defined(OPENSSL_NO_ASM) \
+	&& (defined(__x86_64) || defined(__x86_64__)) \
+	&& (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+# define SMS4_AESNI
+# if (defined(__clang__) && __clang_major__ >= 6) \
+	|| (!defined(__clang__) && __GNUC__ >= 8)
+#  define SMS4_GFNI
+# endif
+#endif
+
+#ifdef SMS4_AESNI
+# include <immintrin.h>
+
+extern unsigned int OPENSSL_ia32cap_P[];
+
+# define SMS4_CAP_AESNI		(OPENSSL_ia32cap_P[1] & (1 << (57 - 32)))
+# define SMS4_CAP_AVX		(OPENSSL_ia32cap_P[1] & (1 << (60 - 32)))
+# define SMS4_CAP_AVX2		(OPENSSL_ia32cap_P[2] & (1 << 5))
+# define SMS4_CAP_AVX512	((OPENSSL_ia32cap_P[2] & ((1 << 16) | (1 << 30))) \
+				== ((1 << 16) | (1 << 30)))	/* F and BW */
+# define SMS4_CAP_GFNI		(OPENSSL_ia32cap_P[3] & (1 << 8))
+# define SMS4_CAP_VAES		(OPENSSL_ia32cap_P[3] & (1 << 9))
+
+/* M1 and c1 as nibble tables, c1 is merged into the low nibble table */
+# define SMS4_IN_LO	0x3e, 0xb2, 0x0e, 0x82, 0xbb, 0x37, 0x8b, 0x07, \
+			0xa1, 0x2d, 0x91, 0x1d, 0x24, 0xa8, 0x14, 0x98
+# define SMS4_IN_HI	0x00, 0xdc, 0x2e, 0xf2, 0xc5, 0x19, 0xeb, 0x37, \
+			0x08, 0xd4, 0x26, 0xfa, 0xcd, 0x11, 0xe3, 0x3f
+/* M2 after the inverse of the AES affine map, and its constant */
+# define SMS4_OUT_LO	0x6c, 0xd4, 0xa6, 0x1e, 0x52, 0xea, 0x98, 0x20, \
+			0x0b, 0xb3, 0xc1, 0x79, 0x35, 0x8d, 0xff, 0x47
+# define SMS4_OUT_HI	0x00, 0xe0, 0x50, 0xb0, 0x9d, 0x7d, 0xcd, 0x2d, \
+			0xc0, 0x20, 0x90, 0x70, 0x5d, 0xbd, 0x0d, 0xed
+/* the inverse of ShiftRows, applied before AESENCLAST */
+# define SMS4_INV_SR	0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3
+# define SMS4_BSWAP32	3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+# define SMS4_ROL8	3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14
+# define SMS4_ROL16	2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13
+# define SMS4_ROL24	1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12
+/* GHASH is computed on byte reversed blocks */
+# define SMS4_BSWAP128	15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+
+/* GF2P8AFFINEQB matrices: M1 to the AES field, M2 back from it */
+# define SMS4_GFNI_M1	0x4c287db91a22505dULL
+# define SMS4_GFNI_C1	0x3e
+# define SMS4_GFNI_M2	0xf3ab34a974a6b589ULL
+# define SMS4_GFNI_C2	0xd3
+
+static const unsigned char sms4_aesni_consts[][16] = {
+	{ SMS4_IN_LO }, { SMS4_IN_HI }, { SMS4_OUT_LO }, { SMS4_OUT_HI },
+	{ SMS4_INV_SR }, { SMS4_BSWAP32 },
+	{ SMS4_ROL8 }, { SMS4_ROL16 }, { SMS4_ROL24 }, { SMS4_BSWAP128 },
+};
+
+/*
+ * GHASH with PCLMULQDQ as in Gueron and Kounavis, "Intel Carry-Less
+ * Multiplication Instruction and its Usage for Computing the GCM Mode".
+ * The products of several blocks with the powers of H are summed before
+ * a single reduction.
+ */
+__attribute__((target("pclmul,ssse3"), always_inline))
+static inline void sms4_ghash_mul(__m128i *lo, __m128i *mid, __m128i *hi,
+	__m128i x, __m128i h)
+{
+	*lo = _mm_xor_si128(*lo, _mm_clmulepi64_si128(x, h, 0x00));
+	*hi = _mm_xor_si128(*hi, _mm_clmulepi64_si128(x, h, 0x11));
+	*mid = _mm_xor_si128(*mid, _mm_xor_si128(
+		_mm_clmulepi64_si128(x, h, 0x01),
+		_mm_clmulepi64_si128(x, h, 0x10)));
+}
+
+__attribute__((target("pclmul,ssse3"), always_inline))
+static inline __m128i sms4_ghash_reduce(__m128i lo, __m128i mid, __m128i hi)
+{
+	__m128i t0, t1, t2;
+
+	lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+	hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+	/* shift the 256-bit product left by one, the operands are reflected */
+	t0 = _mm_srli_epi32(lo, 31);
+	t1 = _mm_srli_epi32(hi, 31);
+	lo = _mm_slli_epi32(lo, 1);
+	hi = _mm_slli_epi32(hi, 1);
+	t2 = _mm_srli_si128(t0, 12);
+	t1 = _mm_slli_si128(t1, 4);
+	t0 = _mm_slli_si128(t0, 4);
+	lo = _mm_or_si128(lo, t0);
+	hi = _mm_or_si128(hi, t1);
+	hi = _mm_or_si128(hi, t2);
+
+	/* reduce modulo x^128 + x^7 + x^2 + x + 1 */
+	t0 = _mm_slli_epi32(lo, 31);
+	t1 = _mm_slli_epi32(lo, 30);
+	t2 = _mm_slli_epi32(lo, 25);
+	t0 = _mm_xor_si128(t0, t1);
+	t0 = _mm_xor_si128(t0, t2);
+	t1 = _mm_srli_si128(t0, 4);
+	t0 = _mm_slli_si128(t0, 12);
+	lo = _mm_xor_si128(lo, t0);
+	t2 = _mm_srli_epi32(lo, 1);
+	t0 = _mm_srli_epi32(lo, 2);
+	t2 = _mm_xor_si128(t2, t0);
+	t0 = _mm_srli_epi32(lo, 7);
+	t2 = _mm_xor_si128(t2, t0);
+	t2 = _mm_xor_si128(t2, t1);
+	lo = _mm_xor_si128(lo, t2);
+	return _mm_xor_si128(hi, lo);
+}
+
+/* Xi = (Xi + in[0]) * H^n + in[1] * H^(n-1) + ... + in[n-1] * H */
+__attribute__((target("pclmul,ssse3"), always_inline))
+static inline void sms4_ghash_block(__m128i *lo, __m128i *mid, __m128i *hi,
+	const unsigned char *in, const __m128i *xi, const unsigned char *htable,
+	size_t i, size_t n)
+{
+	const __m128i rev = _mm_loadu_si128(
+		(const __m128i *)sms4_aesni_consts[9]);
+	__m128i x;
+
+	x = _mm_shuffle_epi8(_mm_loadu_si128(
+		(const __m128i *)(in + 16 * i)), rev);
+	if (i == 0)
+		x = _mm_xor_si128(x, *xi);
+	sms4_ghash_mul(lo, mid, hi, x, _mm_loadu_si128(
+		(const __m128i *)(htable + 16 * (n - 1 - i))));
+}
+
+__attribute__((target("pclmul,ssse3")))
+static void sms4_ghash_blocks(__m128i *xi, const unsigned char *in,
+	size_t n, const unsigned char *htable)
+{
+	__m128i lo = _mm_setzero_si128();
+	__m128i mid = _mm_setzero_si128();
+	__m128i hi = _mm_setzero_si128();
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		sms4_ghash_block(&lo, &mid, &hi, in, xi, htable, i, n);
+	*xi = sms4_ghash_reduce(lo, mid, hi);
+}
+
+/*
+ * The kernel is written with the V*() operations below, which are defined
+ * for each vector width before SMS4_AESNI_KERNEL() is expanded.
+ */
+# define SMS4_SBOX_AESNI_CONSTS					\
+	const V m0f = VSET1_8(0x0f);					\
+	const V in_lo = VCONST(0);					\
+	const V in_hi = VCONST(1);					\
+	const V out_lo = VCONST(2);					\
+	const V out_hi = VCONST(3);					\
+	const V inv_sr = VCONST(4)
+
+# define SMS4_SBOX_GFNI_CONSTS						\
+	const V m1 = VSET1_64(SMS4_GFNI_M1);				\
+	const V m2 = VSET1_64(SMS4_GFNI_M2)
+
+/* the rotations by multiples of 8 are byte shuffles without VPROLD */
+# define SMS4_ROL_CONSTS						\
+	const V rol8 = VCONST(6);					\
+	const V rol16 = VCONST(7);					\
+	const V rol24 = VCONST(8);
+
+/* nibble table lookups of the affine maps */
+# define SMS4_AFFINE(t, lo, hi)						\
+	VXOR(VSHUFB(lo, VAND(t, m0f)),					\
+		VSHUFB(hi, VAND(VSRL32(t, 4), m0f)))
+
+# define SMS4_SBOX_AESNI(t)						\
+	t = SMS4_AFFINE(t, in_lo, in_hi);				\
+	t = VSHUFB(t, inv_sr);						\
+	t = VAESENCLAST(t);						\
+	t = SMS4_AFFINE(t, out_lo, out_hi)
+
+# define SMS4_SBOX_GFNI(t)						\
+	t = VGF2P8AFFINE(t, m1, SMS4_GFNI_C1);				\
+	t = VGF2P8AFFINEINV(t, m2, SMS4_GFNI_C2)
+
+/* L(t) = t ^ (t <<< 24) ^ ((t ^ (t <<< 8) ^ (t <<< 16)) <<< 2) */
+# define SMS4_ROUND1(x0, x1, x2, x3, x4, k)				\
+	t = VXOR(VXOR(x1, x2), VXOR(x3, k));				\
+	SMS4_SBOX(t);							\
+	u = VXOR(t, VXOR(VSHUFB(t, rol8), VSHUFB(t, rol16)));		\
+	u = VXOR(VSLL32(u, 2), VSRL32(u, 30));				\
+	x4 = VXOR(VXOR(x0, t), VXOR(VSHUFB(t, rol24), u))
+
+/* blocks per call, and rounds per GHASH block when stitched with GCM */
+# define SMS4_AESNI_BLOCKS	(sizeof(V) / 2)
+# define SMS4_GHASH_ROUNDS	(32 / SMS4_AESNI_BLOCKS)
+
+/*
+ * two sets of registers a* and b*, the names are used by ROUNDS(). With
+ * GCM one block of ghash_in is multiplied every SMS4_GHASH_ROUNDS rounds.
+ */
+# define ROUND(x0, x1, x2, x3, x4, i)					\
+	k = VSET1_32(rk[i]);						\
+	SMS4_ROUND1(a##x0, a##x1, a##x2, a##x3, a##x4, k);		\
+	if (ghash_in && (i) % SMS4_GHASH_ROUNDS == 0)			\
+		sms4_ghash_block(&lo, &mid, &hi, ghash_in, xi, htable,	\
+			(i) / SMS4_GHASH_ROUNDS, SMS4_AESNI_BLOCKS);	\
+	SMS4_ROUND1(b##x0, b##x1, b##x2, b##x3, b##x4, k)
+
+/* 4 registers of blocks to 4 registers of words, and back */
+# define SMS4_TRANSPOSE(x0, x1, x2, x3)					\
+	t = VUNPACKLO32(x0, x1);					\
+	u = VUNPACKLO32(x2, x3);					\
+	x1 = VUNPACKHI32(x0, x1);					\
+	x3 = VUNPACKHI32(x2, x3);					\
+	x0 = VUNPACKLO64(t, u);						\
+	x2 = VUNPACKLO64(x1, x3);					\
+	x3 = VUNPACKHI64(x1, x3);					\
+	x1 = VUNPACKHI64(t, u)
+
+# define SMS4_LOAD(x0, x1, x2, x3, p)					\
+	x0 = VSHUFB(VLOADU((p) + 0 * sizeof(V)), bswap);		\
+	x1 = VSHUFB(VLOADU((p) + 1 * sizeof(V)), bswap);		\
+	x2 = VSHUFB(VLOADU((p) + 2 * sizeof(V)), bswap);		\
+	x3 = VSHUFB(VLOADU((p) + 3 * sizeof(V)), bswap);		\
+	SMS4_TRANSPOSE(x0, x1, x2, x3)
+
+# define SMS4_STORE(p, x0, x1, x2, x3)					\
+	SMS4_TRANSPOSE(x0, x1, x2, x3);					\
+	VSTOREU((p) + 0 * sizeof(V), VSHUFB(x0, bswap));		\
+	VSTOREU((p) + 1 * sizeof(V), VSHUFB(x1, bswap));		\
+	VSTOREU((p) + 2 * sizeof(V), VSHUFB(x2, bswap));		\
+	VSTOREU((p) + 3 * sizeof(V), VSHUFB(x3, bswap))
+
+/* the keystream of CTR, xored with q into p */
+# define SMS4_STORE_XOR(p, q, x0, x1, x2, x3)				\
+	SMS4_TRANSPOSE(x0, x1, x2, x3);					\
+	VSTOREU((p) + 0 * sizeof(V), VXOR(VSHUFB(x0, bswap),		\
+		VLOADU((q) + 0 * sizeof(V))));				\
+	VSTOREU((p) + 1 * sizeof(V), VXOR(VSHUFB(x1, bswap),		\
+		VLOADU((q) + 1 * sizeof(V))));				\
+	VSTOREU((p) + 2 * sizeof(V), VXOR(VSHUFB(x2, bswap),		\
+		VLOADU((q) + 2 * sizeof(V))));				\
+	VSTOREU((p) + 3 * sizeof(V), VXOR(VSHUFB(x3, bswap),		\
+		VLOADU((q) + 3 * sizeof(V))))
+
+/*
+ * name() encrypts SMS4_AESNI_BLOCKS blocks. name_gcm() xors the keystream
+ * of the counters ctr, ctr + 1, ... (the last word of iv) into them, and
+ * adds the same number of blocks at ghash_in to the GHASH value xi.
+ */
+# define SMS4_AESNI_KERNEL(name, isa)					\
+__attribute__((target(isa), always_inline))				\
+static inline void name##_core(const unsigned char *in,		\
+	unsigned char *out, const uint32_t *rk, const unsigned char *iv,\
+	uint32_t ctr, const unsigned char *ghash_in, __m128i *xi,	\
+	const unsigned char *htable)					\
+{									\
+	const V bswap = VCONST(5);					\
+	SMS4_SBOX_CONSTS;						\
+	SMS4_ROUND_CONSTS						\
+	V ax0, ax1, ax2, ax3, ax4;					\
+	V bx0, bx1, bx2, bx3, bx4;					\
+	V t, u, k;							\
+	__m128i lo = _mm_setzero_si128();				\
+	__m128i mid = _mm_setzero_si128();				\
+	__m128i hi = _mm_setzero_si128();				\
+									\
+	if (iv) {							\
+		ax0 = bx0 = VSET1_32(GETU32(iv));			\
+		ax1 = bx1 = VSET1_32(GETU32(iv + 4));			\
+		ax2 = bx2 = VSET1_32(GETU32(iv + 8));			\
+		ax3 = VADD32(VSET1_32(ctr), VCTR);			\
+		bx3 = VADD32(VSET1_32(ctr + SMS4_AESNI_BLOCKS / 2), VCTR);\
+	} else {							\
+		SMS4_LOAD(ax0, ax1, ax2, ax3, in);			\
+		SMS4_LOAD(bx0, bx1, bx2, bx3, in + 4 * sizeof(V));	\
+	}								\
+	ROUNDS(x0, x1, x2, x3, x4);					\
+	if (iv) {							\
+		SMS4_STORE_XOR(out, in, ax0, ax4, ax3, ax2);		\
+		SMS4_STORE_XOR(out + 4 * sizeof(V), in + 4 * sizeof(V),	\
+			bx0, bx4, bx3, bx2);				\
+	} else {							\
+		SMS4_STORE(out, ax0, ax4, ax3, ax2);			\
+		SMS4_STORE(out + 4 * sizeof(V), bx0, bx4, bx3, bx2);	\
+	}								\
+	if (ghash_in)							\
+		*xi = sms4_ghash_reduce(lo, mid, hi);			\
+}									\
+									\
+__attribute__((target(isa)))						\
+static void name(const unsigned char *in, unsigned char *out,		\
+	const uint32_t *rk)						\
+{									\
+	name##_core(in, out, rk, NULL, 0, NULL, NULL, NULL);		\
+}									\
+									\
+__attribute__((target(isa)))						\
+static void name##_gcm(const unsigned char *in, unsigned char *out,	\
+	const uint32_t *rk, const unsigned char *iv, uint32_t ctr,	\
+	const unsigned char *ghash_in, __m128i *xi,			\
+	const unsigned char *htable)					\
+{									\
+	name##_core(in, out, rk, iv, ctr, ghash_in, xi, htable);	\
+}
+
+/* SSE with VEX encoding, AES-NI */
+# define V			__m128i
+# define VCONST(i)		_mm_loadu_si128((const __m128i *)sms4_aesni_consts[i])
+# define VSET1_8(a)		_mm_set1_epi8(a)
+# define VSET1_32(a)		_mm_set1_epi32((int)(a))
+# define VSET1_64(a)		_mm_set1_epi64x((long long)(a))
+# define VLOADU(p)		_mm_loadu_si128((const __m128i *)(p))
+# define VSTOREU(p, a)		_mm_storeu_si128((__m128i *)(p), a)
+# define VXOR(a, b)		_mm_xor_si128(a, b)
+# define VADD32(a, b)		_mm_add_epi32(a, b)
+# define VCTR			_mm_setr_epi32(0, 1, 2, 3)
+# define VAND(a, b)		_mm_and_si128(a, b)
+# define VSHUFB(a, b)		_mm_shuffle_epi8(a, b)
+# define VSLL32(a, i)		_mm_slli_epi32(a, i)
+# define VSRL32(a, i)		_mm_srli_epi32(a, i)
+# define VUNPACKLO32(a, b)	_mm_unpacklo_epi32(a, b)
+# define VUNPACKHI32(a, b)	_mm_unpackhi_epi32(a, b)
+# define VUNPACKLO64(a, b)	_mm_unpacklo_epi64(a, b)
+# define VUNPACKHI64(a, b)	_mm_unpackhi_epi64(a, b)
+# define VAESENCLAST(a)		_mm_aesenclast_si128(a, _mm_setzero_si128())
+# define SMS4_SBOX		SMS4_SBOX_AESNI
+# define SMS4_SBOX_CONSTS	SMS4_SBOX_AESNI_CONSTS
+# define SMS4_ROUND_CONSTS	SMS4_ROL_CONSTS
+
+SMS4_AESNI_KERNEL(sms4_aesni_avx_encrypt8, "aes,avx,pclmul")
+
+# undef VAESENCLAST
+
+/* AVX2, AESENCLAST on each half or with VAES, or GFNI */
+# undef V
+# undef VCONST
+# undef VSET1_8
+# undef VSET1_32
+# undef VSET1_64
+# undef VLOADU
+# undef VSTOREU
+# undef VXOR
+# undef VADD32
+# undef VCTR
+# undef VAND
+# undef VSHUFB
+# undef VSLL32
+# undef VSRL32
+# undef VUNPACKLO32
+# undef VUNPACKHI32
+# undef VUNPACKLO64
+# undef VUNPACKHI64
+# define V			__m256i
+# define VCONST(i)		_mm256_broadcastsi128_si256(		\
+	_mm_loadu_si128((const __m128i *)sms4_aesni_consts[i]))
+# define VSET1_8(a)		_mm256_set1_epi8(a)
+# define VSET1_32(a)		_mm256_set1_epi32((int)(a))
+# define VSET1_64(a)		_mm256_set1_epi64x((long long)(a))
+# define VLOADU(p)		_mm256_loadu_si256((const __m256i *)(p))
+# define VSTOREU(p, a)		_mm256_storeu_si256((__m256i *)(p), a)
+# define VXOR(a, b)		_mm256_xor_si256(a, b)
+# define VADD32(a, b)		_mm256_add_epi32(a, b)
+# define VCTR			_mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7)
+# define VAND(a, b)		_mm256_and_si256(a, b)
+# define VSHUFB(a, b)		_mm256_shuffle_epi8(a, b)
+# define VSLL32(a, i)		_mm256_slli_epi32(a, i)
+# define VSRL32(a, i)		_mm256_srli_epi32(a, i)
+# define VUNPACKLO32(a, b)	_mm256_unpacklo_epi32(a, b)
+# define VUNPACKHI32(a, b)	_mm256_unpackhi_epi32(a, b)
+# define VUNPACKLO64(a, b)	_mm256_unpacklo_epi64(a, b)
+# define VUNPACKHI64(a, b)	_mm256_unpackhi_epi64(a, b)
+# define VAESENCLAST(a)		_mm256_inserti128_si256(_mm256_castsi128_si256(\
+	_mm_aesenclast_si128(_mm256_castsi256_si128(a), _mm_setzero_si128())),	\
+	_mm_aesenclast_si128(_mm256_extracti128_si256(a, 1),		\
+		_mm_setzero_si128()), 1)
+
+SMS4_AESNI_KERNEL(sms4_aesni_avx2_encrypt16, "aes,avx2,pclmul")
+
+# undef VAESENCLAST
+
+# ifdef SMS4_GFNI
+#  define VAESENCLAST(a)	_mm256_aesenclast_epi128(a, _mm256_setzero_si256())
+
+SMS4_AESNI_KERNEL(sms4_vaes_avx2_encrypt16, "vaes,avx2,pclmul")
+
+#  undef SMS4_SBOX
+#  undef SMS4_SBOX_CONSTS
+#  define SMS4_SBOX		SMS4_SBOX_GFNI
+#  define SMS4_SBOX_CONSTS	SMS4_SBOX_GFNI_CONSTS
+#  define VGF2P8AFFINE(a, m, c)	_mm256_gf2p8affine_epi64_epi8(a, m, c)
+#  define VGF2P8AFFINEINV(a, m, c) _mm256_gf2p8affineinv_epi64_epi8(a, m, c)
+
+SMS4_AESNI_KERNEL(sms4_gfni_avx2_encrypt16, "gfni,avx2,pclmul")
+
+/* AVX-512 with GFNI, rotations by VPROLD */
+#  undef V
+#  undef VCONST
+#  undef VSET1_8
+#  undef VSET1_32
+#  undef VSET1_64
+#  undef VLOADU
+#  undef VSTOREU
+#  undef VXOR
+#  undef VADD32
+#  undef VCTR
+#  undef VAND
+#  undef VSHUFB
+#  undef VSLL32
+#  undef VSRL32
+#  undef VUNPACKLO32
+#  undef VUNPACKHI32
+#  undef VUNPACKLO64
+#  undef VUNPACKHI64
+#  undef VGF2P8AFFINE
+#  undef VGF2P8AFFINEINV
+#  undef SMS4_ROUND1
+#  undef SMS4_ROUND_CONSTS
+#  define SMS4_ROUND_CONSTS
+#  define V			__m512i
+#  define VCONST(i)		_mm512_broadcast_i32x4(			\
+	_mm_loadu_si128((const __m128i *)sms4_aesni_consts[i]))
+#  define VSET1_8(a)		_mm512_set1_epi8(a)
+#  define VSET1_32(a)		_mm512_set1_epi32((int)(a))
+#  define VSET1_64(a)		_mm512_set1_epi64((long long)(a))
+#  define VLOADU(p)		_mm512_loadu_si512((const void *)(p))
+#  define VSTOREU(p, a)		_mm512_storeu_si512((void *)(p), a)
+#  define VXOR(a, b)		_mm512_xor_si512(a, b)
+#  define VADD32(a, b)		_mm512_add_epi32(a, b)
+#  define VCTR			_mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13,	\
+					2, 6, 10, 14, 3, 7, 11, 15)
+#  define VAND(a, b)		_mm512_and_si512(a, b)
+#  define VSHUFB(a, b)		_mm512_shuffle_epi8(a, b)
+#  define VSLL32(a, i)		_mm512_slli_epi32(a, i)
+#  define VSRL32(a, i)		_mm512_srli_epi32(a, i)
+#  define VUNPACKLO32(a, b)	_mm512_unpacklo_epi32(a, b)
+#  define VUNPACKHI32(a, b)	_mm512_unpackhi_epi32(a, b)
+#  define VUNPACKLO64(a, b)	_mm512_unpacklo_epi64(a, b)
+#  define VUNPACKHI64(a, b)	_mm512_unpackhi_epi64(a, b)
+#  define VGF2P8AFFINE(a, m, c)	_mm512_gf2p8affine_epi64_epi8(a, m, c)
+#  define VGF2P8AFFINEINV(a, m, c) _mm512_gf2p8affineinv_epi64_epi8(a, m, c)
+#  define VROL32(a, i)		_mm512_rol_epi32(a, i)
+#  define SMS4_ROUND1(x0, x1, x2, x3, x4, k)				\
+	t = VXOR(VXOR(x1, x2), VXOR(x3, k));				\
+	SMS4_SBOX(t);							\
+	u = VXOR(t, VXOR(VROL32(t, 8), VROL32(t, 16)));			\
+	x4 = VXOR(VXOR(x0, t), VXOR(VROL32(t, 24), VROL32(u, 2)))
+
+SMS4_AESNI_KERNEL(sms4_gfni_avx512_encrypt32,
+	"gfni,avx512f,avx512bw,pclmul")
+# endif /* SMS4_GFNI */
+
+# undef ROUND
+
+typedef struct {
+	size_t width;
+	void (*ecb)(const unsigned char *in, unsigned char *out,
+		const uint32_t *rk);
+	void (*gcm)(const unsigned char *in, unsigned char *out,
+		const uint32_t *rk, const unsigned char *iv, uint32_t ctr,
+		const unsigned char *ghash_in, __m128i *xi,
+		const unsigned char *htable);
+} sms4_aesni_method_t;
+
+# define SMS4_AESNI_METHOD(name, width)	{ width, name, name##_gcm }
+
+static const sms4_aesni_method_t sms4_aesni_methods[] = {
+# ifdef SMS4_GFNI
+	SMS4_AESNI_METHOD(sms4_gfni_avx512_encrypt32, 32),
+	SMS4_AESNI_METHOD(sms4_gfni_avx2_encrypt16, 16),
+	SMS4_AESNI_METHOD(sms4_vaes_avx2_encrypt16, 16),
+# endif
+	SMS4_AESNI_METHOD(sms4_aesni_avx2_encrypt16, 16),
+	SMS4_AESNI_METHOD(sms4_aesni_avx_encrypt8, 8),
+};
+
+static const sms4_aesni_method_t *sms4_aesni_method(void)
+{
+	const sms4_aesni_method_t *m = sms4_aesni_methods;
+
+	if (!SMS4_CAP_AVX)
+		return NULL;
+# ifdef SMS4_GFNI
+	if (SMS4_CAP_GFNI && SMS4_CAP_AVX512)
+		return m;
+	m++;
+	if (SMS4_CAP_GFNI && SMS4_CAP_AVX2)
+		return m;
+	m++;
+	if (SMS4_CAP_VAES && SMS4_CAP_AVX2)
+		return m;
+	m++;
+# endif
+	if (SMS4_CAP_AESNI && SMS4_CAP_AVX2)
+		return m;
+	m++;
+	if (SMS4_CAP_AESNI)
+		return m;
+	return NULL;
+}
+
+static void sms4_aesni_ecb_encrypt_blocks(const unsigned char *in,
+	unsigned char *out, size_t blocks, const sms4_key_t *key)
+{
+	unsigned char buf[32 * SMS4_BLOCK_SIZE];
+	const sms4_aesni_method_t *m = sms4_aesni_method();
+	size_t width = m->width;
+
+	while (blocks >= width) {
+		m->ecb(in, out, key->rk);
+		in += width * SMS4_BLOCK_SIZE;
+		out += width * SMS4_BLOCK_SIZE;
+		blocks -= width;
+	}
+
+	if (blocks) {
+		memset(buf, 0, width * SMS4_BLOCK_SIZE);
+		memcpy(buf, in, blocks * SMS4_BLOCK_SIZE);
+		m->ecb(buf, buf, key->rk);
+		memcpy(out, buf, blocks * SMS4_BLOCK_SIZE);
+		OPENSSL_cleanse(buf, width * SMS4_BLOCK_SIZE);
+	}
+}
+
+__attribute__((target("pclmul,ssse3")))
+static void sms4_aesni_gcm_htable(unsigned char *htable,
+	const sms4_key_t *key)
+{
+	const __m128i rev = _mm_loadu_si128(
+		(const __m128i *)sms4_aesni_consts[9]);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i h, hi;
+	unsigned char buf[16] = {0};
+	int i;
+
+	sms4_encrypt(buf, buf, key);
+	h = hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)buf), rev);
+	_mm_storeu_si128((__m128i *)htable, h);
+	for (i = 1; i < SMS4_GCM_HTABLE_SIZE / 16; i++) {
+		__m128i lo = zero, mid = zero, hh = zero;
+
+		sms4_ghash_mul(&lo, &mid, &hh, hi, h);
+		hi = sms4_ghash_reduce(lo, mid, hh);
+		_mm_storeu_si128((__m128i *)(htable + 16 * i), hi);
+	}
+	OPENSSL_cleanse(buf, sizeof(buf));
+}
+
+/*
+ * Encryption hashes the ciphertext of the previous call while computing
+ * the next one, decryption hashes the ciphertext it is decrypting.
+ */
+__attribute__((target("pclmul,ssse3")))
+static size_t sms4_aesni_gcm(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key, unsigned char iv[16],
+	unsigned char Xi[16], const unsigned char *htable, int enc)
+{
+	const __m128i rev = _mm_loadu_si128(
+		(const __m128i *)sms4_aesni_consts[9]);
+	const sms4_aesni_method_t *m = sms4_aesni_method();
+	size_t bytes = m->width * SMS4_BLOCK_SIZE;
+	size_t n = len / bytes;
+	uint32_t ctr = GETU32(iv + 12);
+	__m128i xi, unused;
+	size_t i;
+
+	if (n == 0)
+		return 0;
+
+	xi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)Xi), rev);
+
+	if (enc) {
+		m->gcm(in, out, key->rk, iv, ctr, NULL, &unused, htable);
+		for (i = 1; i < n; i++) {
+			m->gcm(in + bytes * i, out + bytes * i, key->rk, iv,
+				ctr + (uint32_t)(m->width * i),
+				out + bytes * (i - 1), &xi, htable);
+		}
+		sms4_ghash_blocks(&xi, out + bytes * (n - 1), m->width, htable);
+	} else {
+		for (i = 0; i < n; i++) {
+			m->gcm(in + bytes * i, out + bytes * i, key->rk, iv,
+				ctr + (uint32_t)(m->width * i),
+				in + bytes * i, &xi, htable);
+		}
+	}
+
+	_mm_storeu_si128((__m128i *)Xi, _mm_shuffle_epi8(xi, rev));
+	PUTU32(iv + 12, ctr + (uint32_t)(m->width * n));
+	return n * bytes;
+}
+#endif /* SMS4_AESNI */
+
+sms4_blocks_f sms4_aesni_blocks_func(void)
+{
+#ifdef SMS4_AESNI
+	if (sms4_aesni_method())
+		return sms4_aesni_ecb_encrypt_blocks;
+#endif
+	return NULL;
+}
+
+int sms4_aesni_gcm_capable(void)
+{
+#ifdef SMS4_AESNI
+	/* PCLMULQDQ */
+	if (sms4_aesni_method() && (OPENSSL_ia32cap_P[1] & (1 << (33 - 32))))
+		return 1;
+#endif
+	return 0;
+}
+
+void sms4_aesni_gcm_init(unsigned char htable[SMS4_GCM_HTABLE_SIZE],
+	const sms4_key_t *key)
+{
+#ifdef SMS4_AESNI
+	sms4_aesni_gcm_htable(htable, key);
+#endif
+}
+
+size_t sms4_aesni_gcm_encrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key, unsigned char iv[16],
+	unsigned char Xi[16], const unsigned char htable[SMS4_GCM_HTABLE_SIZE])
+{
+#ifdef SMS4_AESNI
+	return sms4_aesni_gcm(in, out, len, key, iv, Xi, htable, 1);
+#else
+	return 0;
+#endif
+}
+
+size_t sms4_aesni_gcm_decrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key, unsigned char iv[16],
+	unsigned char Xi[16], const unsigned char htable[SMS4_GCM_HTABLE_SIZE])
+{
+#ifdef SMS4_AESNI
+	return sms4_aesni_gcm(in, out, len, key, iv, Xi, htable, 0);
+#else
+	return 0;
+#endif
+}
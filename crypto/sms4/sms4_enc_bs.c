@@ -0,0 +1,448 @@
+/* ====================================================================
+ * Copyright (c) 2014 - 2019 The GmSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the GmSSL Project.
+ *    (http://gmssl.org/)"
+ *
+ * 4. The name "GmSSL Project" must not be used to endorse or promote
+ *    products derived from this software without prior written
+ *    permission. For written permission, please contact
+ *    guanzhi1980@gmail.com.
+ *
+ * 5. Products derived from this software may not be called "GmSSL"
+ *    nor may "GmSSL" appear in their names without prior written
+ *    permission of the GmSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the GmSSL Project
+ *    (http://gmssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE GmSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE GmSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+/*
+ * Bitsliced SMS4. The state of 64 blocks is kept as 128 words, word
+ * X[32 * i + j] holds bit j of the i-th 32-bit word of every block, so the
+ * S-box is evaluated as a boolean circuit and the linear transform is a
+ * renaming of words. There are no table lookups and no branches on the key
+ * or the data.
+ *
+ * With AVX2 the words are 256-bit and 256 blocks are processed at once.
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/sms4.h>
+#include "modes_lcl.h"
+#include "sms4_lcl.h"
+
+#if defined(OPENSSL_CPUID_OBJ) && !defined(OPENSSL_NO_ASM) \
+	&& (defined(__x86_64) || defined(__x86_64__)) \
+	&& (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+# define SMS4_BS_AVX2
+extern unsigned int OPENSSL_ia32cap_P[];
+typedef uint64_t sms4_bs256_t __attribute__((vector_size(32)));
+#endif
+
+#define SMS4_BS_LANES		64
+#define SMS4_BS_MAX_LANES	256
+
+/*
+ * The S-box S(x) = A * (A * x + 0xd3)^-1 + 0xd3 over GF(2^8) mod
+ * x^8 + x^7 + x^6 + x^5 + x^4 + x^2 + 1, with the inversion done in the
+ * tower field GF(((2^2)^2)^2) and the change of basis merged into A. The
+ * circuit computes S(x + 0x75) + 0xd3, the constants are moved out to the
+ * round key and the linear transform (SMS4_BS_IN_MASK, SMS4_BS_OUT_MASK).
+ */
+#define SMS4_BS_SBOX(T, x)						\
+do {									\
+	T t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12,	\
+		t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23, t24,	\
+		t25, t26, t27, t28;					\
+	t0 = x[0] ^ x[6];						\
+	t1 = x[1] ^ x[4];						\
+	t2 = t0 ^ x[2];							\
+	t3 = x[3] ^ x[5];						\
+	t4 = t1 ^ t3;							\
+	t5 = x[2] ^ x[7];						\
+	t6 = x[0] ^ x[2];						\
+	t7 = t2 ^ x[1];							\
+	t8 = t0 ^ x[7];							\
+	t9 = t0 ^ x[4];							\
+	t10 = t1 ^ t6;							\
+	t0 = t0 ^ x[1];							\
+	t11 = t1 ^ t2;							\
+	t12 = t9 ^ x[5];						\
+	t13 = t1 ^ x[5];						\
+	t14 = t4 ^ t8;							\
+	t15 = t2 ^ t4;							\
+	t16 = t7 ^ x[5];						\
+	t3 = t3 ^ t5;							\
+	t3 = t3 ^ x[6];							\
+	t1 = t1 ^ t8;							\
+	t4 = t4 ^ t6;							\
+	t2 = t2 ^ x[4];							\
+	t0 = t10 & t0;							\
+	t6 = t11 & t12;							\
+	t8 = x[6] & t13;						\
+	t7 = t14 & t7;							\
+	t12 = t5 & x[5];						\
+	t13 = t15 & t16;						\
+	t16 = t3 & x[2];						\
+	t9 = t1 & t9;							\
+	t2 = t4 & t2;							\
+	t17 = x[0] ^ x[2];						\
+	t18 = t2 ^ x[1];						\
+	t19 = t16 ^ x[4];						\
+	t20 = t17 ^ t18;						\
+	t21 = x[6] ^ x[7];						\
+	t22 = t19 ^ x[5];						\
+	t23 = t9 ^ x[3];						\
+	t19 = t13 ^ t19;						\
+	t21 = t12 ^ t21;						\
+	t23 = t7 ^ t23;							\
+	t24 = t8 ^ t20;							\
+	t25 = t6 ^ t9;							\
+	t22 = t0 ^ t22;							\
+	t26 = t24 ^ t22;						\
+	t18 = t18 ^ t19;						\
+	t18 = t18 ^ t21;						\
+	t24 = t24 ^ t25;						\
+	t20 = t20 ^ t21;						\
+	t20 = t20 ^ t23;						\
+	t21 = t25 ^ t22;						\
+	t17 = t17 ^ t19;						\
+	t17 = t17 ^ t23;						\
+	t18 = t26 & t18;						\
+	t19 = t24 & t20;						\
+	t17 = t21 & t17;						\
+	t20 = x[6] ^ x[7];						\
+	t12 = t12 ^ t20;						\
+	t7 = t7 ^ x[3];							\
+	t0 = t0 ^ x[5];							\
+	t20 = t12 ^ t0;							\
+	t22 = t8 ^ t7;							\
+	t23 = t6 ^ t13;							\
+	t25 = x[0] ^ x[2];						\
+	t27 = t23 ^ x[1];						\
+	t28 = t22 ^ x[4];						\
+	t18 = t18 ^ t28;						\
+	t2 = t2 ^ t27;							\
+	t9 = t9 ^ t20;							\
+	t16 = t16 ^ t18;						\
+	t9 = t17 ^ t9;							\
+	t2 = t19 ^ t2;							\
+	t17 = t9 ^ t2;							\
+	t9 = t16 ^ t9;							\
+	t2 = t16 ^ t2;							\
+	t8 = t8 ^ t13;							\
+	t8 = t8 ^ t20;							\
+	t8 = t8 ^ t25;							\
+	t6 = t6 ^ t12;							\
+	t6 = t6 ^ t22;							\
+	t0 = t7 ^ t0;							\
+	t0 = t0 ^ t23;							\
+	t0 = t0 ^ t25;							\
+	t7 = t26 & t17;							\
+	t12 = t24 & t9;							\
+	t13 = t21 & t2;							\
+	t8 = t8 & t17;							\
+	t6 = t6 & t9;							\
+	t0 = t0 & t2;							\
+	t2 = x[5] ^ x[7];						\
+	t9 = x[1] ^ x[5];						\
+	t16 = x[4] ^ x[6];						\
+	t17 = x[3] ^ x[6];						\
+	t18 = x[3] ^ x[4];						\
+	t19 = t2 ^ x[2];						\
+	t20 = t6 ^ t0;							\
+	t0 = t8 ^ t0;							\
+	t6 = t8 ^ t6;							\
+	t8 = t12 ^ t13;							\
+	t13 = t7 ^ t13;							\
+	t7 = t7 ^ t12;							\
+	t12 = t0 ^ t13;							\
+	t21 = t20 ^ t8;							\
+	t22 = t6 ^ t7;							\
+	t23 = t16 ^ x[2];						\
+	t24 = t9 ^ x[2];						\
+	t16 = t9 ^ t16;							\
+	t25 = t18 ^ t19;						\
+	t2 = t2 ^ t17;							\
+	t26 = x[1] ^ x[7];						\
+	t9 = t9 ^ t17;							\
+	t10 = t10 & t12;						\
+	t11 = t11 & t21;						\
+	t17 = x[6] & t22;						\
+	t14 = t14 & t13;						\
+	t5 = t5 & t8;							\
+	t15 = t15 & t7;							\
+	t3 = t3 & t0;							\
+	t1 = t1 & t20;							\
+	t4 = t4 & t6;							\
+	t12 = t23 & t12;						\
+	t21 = t24 & t21;						\
+	t16 = t16 & t22;						\
+	t13 = t25 & t13;						\
+	t8 = t19 & t8;							\
+	t7 = t18 & t7;							\
+	t0 = t2 & t0;							\
+	t2 = t26 & t20;							\
+	t6 = t9 & t6;							\
+	t2 = t13 ^ t2;							\
+	t9 = t11 ^ t7;							\
+	t11 = t2 ^ t9;							\
+	t18 = t16 ^ t8;							\
+	t19 = t14 ^ t5;							\
+	t0 = t10 ^ t0;							\
+	t20 = t11 ^ t0;							\
+	t22 = t6 ^ t19;							\
+	t13 = t13 ^ t18;						\
+	t13 = t21 ^ t13;						\
+	t13 = t4 ^ t13;							\
+	t12 = t17 ^ t12;						\
+	t6 = t8 ^ t6;							\
+	t2 = t6 ^ t2;							\
+	t6 = t1 ^ t13;							\
+	t6 = t6 ^ t19;							\
+	t16 = t16 ^ t22;						\
+	t16 = t16 ^ t12;						\
+	t11 = t16 ^ t11;						\
+	t16 = t10 ^ t17;						\
+	t16 = t16 ^ t3;							\
+	t13 = t16 ^ t13;						\
+	t14 = t14 ^ t15;						\
+	t14 = t14 ^ t20;						\
+	t1 = t3 ^ t1;							\
+	t1 = t1 ^ t20;							\
+	t5 = t10 ^ t5;							\
+	t5 = t5 ^ t15;							\
+	t5 = t5 ^ t7;							\
+	t5 = t5 ^ t12;							\
+	t5 = t5 ^ t18;							\
+	t3 = t3 ^ t4;							\
+	t3 = t3 ^ t8;							\
+	t3 = t3 ^ t22;							\
+	t3 = t3 ^ t9;							\
+	t0 = t3 ^ t0;							\
+	x[0] = t2;							\
+	x[1] = t6;							\
+	x[2] = t11;							\
+	x[3] = t13;							\
+	x[4] = t14;							\
+	x[5] = t1;							\
+	x[6] = t5;							\
+	x[7] = t0;							\
+} while (0)
+
+#define SMS4_BS_IN_MASK		0x75757575
+#define SMS4_BS_OUT_MASK	0x4f4f4f4f	/* L(0xd3d3d3d3) */
+
+#define SMS4_BS_MASK(a, i)	(0 - (uint64_t)(((a) >> (i)) & 1))
+
+#define SMS4_BS_ROUNDS(T, X, rk)					\
+do {									\
+	T t[32], *x0, *x1, *x2, *x3, *s;				\
+	uint32_t k;							\
+	int i, j;							\
+	for (i = 0; i < SMS4_NUM_ROUNDS; i++) {				\
+		x0 = X + 32 * (i % 4);					\
+		x1 = X + 32 * ((i + 1) % 4);				\
+		x2 = X + 32 * ((i + 2) % 4);				\
+		x3 = X + 32 * ((i + 3) % 4);				\
+		k = rk[i] ^ SMS4_BS_IN_MASK;				\
+		for (j = 0; j < 32; j++)				\
+			t[j] = x1[j] ^ x2[j] ^ x3[j] ^ SMS4_BS_MASK(k, j); \
+		for (j = 0; j < 32; j += 8) {				\
+			s = t + j;					\
+			SMS4_BS_SBOX(T, s);				\
+		}							\
+		for (j = 0; j < 32; j++)				\
+			x0[j] ^= t[j] ^ t[(j - 2) & 31]			\
+				^ t[(j - 10) & 31] ^ t[(j - 18) & 31]	\
+				^ t[(j - 24) & 31]			\
+				^ SMS4_BS_MASK(SMS4_BS_OUT_MASK, j);	\
+	}								\
+} while (0)
+
+static void sms4_bs_encrypt64(uint64_t X[128], const uint32_t *rk)
+{
+	SMS4_BS_ROUNDS(uint64_t, X, rk);
+}
+
+#ifdef SMS4_BS_AVX2
+__attribute__((target("avx2")))
+static void sms4_bs_encrypt256(sms4_bs256_t X[128], const uint32_t *rk)
+{
+	SMS4_BS_ROUNDS(sms4_bs256_t, X, rk);
+}
+#endif
+
+/* transpose a 64x64 bit matrix, bit j of a[i] goes to bit i of a[j] */
+static void sms4_bs_transpose(uint64_t a[64])
+{
+	uint64_t m = 0x00000000ffffffffULL;
+	uint64_t t;
+	int j, k;
+
+	for (j = 32; j != 0; j >>= 1, m ^= m << j) {
+		for (k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+			t = ((a[k] >> j) ^ a[k | j]) & m;
+			a[k] ^= t << j;
+			a[k | j] ^= t;
+		}
+	}
+}
+
+/* 64 blocks from in to X[stride * n] with n the bitsliced word index */
+static void sms4_bs_pack(uint64_t *X, size_t stride, const unsigned char *in)
+{
+	uint64_t a[64];
+	int i, j;
+
+	for (i = 0; i < 4; i += 2) {
+		for (j = 0; j < 64; j++) {
+			a[j] = (uint64_t)GETU32(in + 16 * j + 4 * i) << 32
+				| GETU32(in + 16 * j + 4 * i + 4);
+		}
+		sms4_bs_transpose(a);
+		for (j = 0; j < 32; j++) {
+			X[stride * (32 * i + j)] = a[32 + j];
+			X[stride * (32 * (i + 1) + j)] = a[j];
+		}
+	}
+}
+
+/* the output words are in reverse order */
+static void sms4_bs_unpack(unsigned char *out, size_t stride, const uint64_t *X)
+{
+	uint64_t a[64];
+	int i, j;
+
+	for (i = 0; i < 4; i += 2) {
+		for (j = 0; j < 32; j++) {
+			a[32 + j] = X[stride * (32 * (3 - i) + j)];
+			a[j] = X[stride * (32 * (2 - i) + j)];
+		}
+		sms4_bs_transpose(a);
+		for (j = 0; j < 64; j++) {
+			PUTU32(out + 16 * j + 4 * i, (uint32_t)(a[j] >> 32));
+			PUTU32(out + 16 * j + 4 * i + 4, (uint32_t)a[j]);
+		}
+	}
+}
+
+/* encrypt up to 64 or 256 blocks, returns the number of blocks done */
+static size_t sms4_bs_encrypt_lanes(const unsigned char *in,
+	unsigned char *out, size_t blocks, const sms4_key_t *key)
+{
+	unsigned char buf[SMS4_BS_MAX_LANES * SMS4_BLOCK_SIZE];
+	size_t lanes = SMS4_BS_LANES;
+
+#ifdef SMS4_BS_AVX2
+	/* a half filled AVX2 batch is still faster than two 64-lane ones */
+	if ((OPENSSL_ia32cap_P[2] & (1 << 5)) && blocks > SMS4_BS_LANES * 2)
+		lanes = SMS4_BS_MAX_LANES;
+#endif
+
+	if (blocks > lanes)
+		blocks = lanes;
+	if (blocks < lanes) {
+		memset(buf, 0, lanes * SMS4_BLOCK_SIZE);
+		memcpy(buf, in, blocks * SMS4_BLOCK_SIZE);
+		in = buf;
+	}
+
+#ifdef SMS4_BS_AVX2
+	if (lanes == SMS4_BS_MAX_LANES) {
+		union {
+			sms4_bs256_t v[128];
+			uint64_t u[128 * 4];
+		} X;
+		size_t i;
+
+		for (i = 0; i < 4; i++)
+			sms4_bs_pack(X.u + i, 4, in + SMS4_BS_LANES * 16 * i);
+		sms4_bs_encrypt256(X.v, key->rk);
+		for (i = 0; i < 4; i++)
+			sms4_bs_unpack(buf + SMS4_BS_LANES * 16 * i, 4, X.u + i);
+		OPENSSL_cleanse(&X, sizeof(X));
+	} else
+#endif
+	{
+		uint64_t X[128];
+
+		sms4_bs_pack(X, 1, in);
+		sms4_bs_encrypt64(X, key->rk);
+		sms4_bs_unpack(buf, 1, X);
+		OPENSSL_cleanse(X, sizeof(X));
+	}
+
+	memcpy(out, buf, blocks * SMS4_BLOCK_SIZE);
+	OPENSSL_cleanse(buf, lanes * SMS4_BLOCK_SIZE);
+	return blocks;
+}
+
+void sms4_bs_ecb_encrypt_blocks(const unsigned char *in, unsigned char *out,
+	size_t blocks, const sms4_key_t *key)
+{
+	size_t n;
+
+	while (blocks) {
+		n = sms4_bs_encrypt_lanes(in, out, blocks, key);
+		in += n * SMS4_BLOCK_SIZE;
+		out += n * SMS4_BLOCK_SIZE;
+		blocks -= n;
+	}
+}
+
+/* only the last 32 bits of the counter are increased, as ctr128_f */
+void sms4_bs_ctr32_encrypt_blocks(const unsigned char *in, unsigned char *out,
+	size_t blocks, const sms4_key_t *key, const unsigned char iv[16])
+{
+	sms4_ctr32_encrypt_blocks_with(in, out, blocks, key, iv,
+		sms4_bs_ecb_encrypt_blocks);
+}
+
+void sms4_bs_xts_encrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key1, const sms4_key_t *key2,
+	const unsigned char iv[16])
+{
+	sms4_xts_with(in, out, len, key1, key2, iv, 1,
+		sms4_bs_ecb_encrypt_blocks);
+}
+
+void sms4_bs_xts_decrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key1, const sms4_key_t *key2,
+	const unsigned char iv[16])
+{
+	sms4_xts_with(in, out, len, key1, key2, iv, 0,
+		sms4_bs_ecb_encrypt_blocks);
+}
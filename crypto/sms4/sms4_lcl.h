@@ -57,6 +57,57 @@ extern const uint8_t SMS4_S[256];
 extern const uint32_t SMS4_T[256];
 extern const uint32_t SMS4_D[65536];
 
+/* encrypt (or decrypt, with the decryption key) a number of blocks */
+typedef void (*sms4_blocks_f)(const unsigned char *in, unsigned char *out,
+	size_t blocks, const sms4_key_t *key);
+
+/* NULL if the CPU has neither AES-NI nor GFNI (or not x86-64) */
+sms4_blocks_f sms4_aesni_blocks_func(void);
+/* the fastest of AES-NI/GFNI, bitsliced and T-box for this many blocks */
+sms4_blocks_f sms4_blocks_func(size_t blocks);
+
+/*
+ * GCM with the AES-NI/GFNI CTR stitched with PCLMULQDQ GHASH, on the iv
+ * (Yi) and Xi of a GCM128_CONTEXT. Only whole groups of 8 to 32 blocks are
+ * processed, the number of bytes done is returned.
+ */
+#define SMS4_GCM_HTABLE_SIZE	(32 * 16)
+int sms4_aesni_gcm_capable(void);
+void sms4_aesni_gcm_init(unsigned char htable[SMS4_GCM_HTABLE_SIZE],
+	const sms4_key_t *key);
+size_t sms4_aesni_gcm_encrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key, unsigned char iv[16],
+	unsigned char Xi[16], const unsigned char htable[SMS4_GCM_HTABLE_SIZE]);
+size_t sms4_aesni_gcm_decrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key, unsigned char iv[16],
+	unsigned char Xi[16], const unsigned char htable[SMS4_GCM_HTABLE_SIZE]);
+
+void sms4_ctr32_encrypt_blocks_with(const unsigned char *in,
+	unsigned char *out, size_t blocks, const sms4_key_t *key,
+	const unsigned char iv[16], sms4_blocks_f f);
+void sms4_cbc_decrypt_with(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key, unsigned char iv[16],
+	sms4_blocks_f f);
+void sms4_cfb128_decrypt_with(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key, unsigned char iv[16],
+	sms4_blocks_f f);
+void sms4_xts_with(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key1, const sms4_key_t *key2,
+	const unsigned char iv[16], int enc, sms4_blocks_f f);
+
+/* with sms4_blocks_func(), as ctr128_f, cbc128_f and the XTS stream */
+void sms4_bulk_ctr32_encrypt_blocks(const unsigned char *in,
+	unsigned char *out, size_t blocks, const sms4_key_t *key,
+	const unsigned char iv[16]);
+void sms4_bulk_cbc_decrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key, unsigned char iv[16]);
+void sms4_bulk_xts_encrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key1, const sms4_key_t *key2,
+	const unsigned char iv[16]);
+void sms4_bulk_xts_decrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key1, const sms4_key_t *key2,
+	const unsigned char iv[16]);
+
 #define S32(A)					\
 	((SMS4_S[((A) >> 24)       ] << 24) ^	\
 	 (SMS4_S[((A) >> 16) & 0xff] << 16) ^	\
@@ -67,6 +67,7 @@ OPENSSL_ia32_cpuid:
 
 	xor	%eax,%eax
 	mov	%eax,8(%rdi)		# clear 3rd word
+	mov	%eax,12(%rdi)		# clear 4th word
 	cpuid
 	mov	%eax,%r11d		# max value for standard query level
 
@@ -141,6 +142,7 @@ OPENSSL_ia32_cpuid:
 	xor	%ecx,%ecx
 	cpuid
 	mov	%ebx,8(%rdi)
+	mov	%ecx,12(%rdi)		# GFNI, VAES, VPCLMULQDQ...
 
 .Lnocacheinfo:
 	mov	\$1,%eax
@@ -175,13 +177,20 @@ OPENSSL_ia32_cpuid:
 	jnc	.Lclear_avx
 	xor	%ecx,%ecx		# XCR0
 	.byte	0x0f,0x01,0xd0		# xgetbv
+	and	\$0xe6,%eax		# isolate XMM, YMM and ZMM state support
+	cmp	\$0xe6,%eax
+	je	.Ldone
+	andl	\$0x3fdeffff,8(%rdi)	# ~(1<<31|1<<30|1<<21|1<<16)
+					# clear AVX512F+BW+VL+IFMA, all of them
+					# are EVEX-encoded and need ZMM state
 	and	\$6,%eax		# isolate XMM and YMM state support
 	cmp	\$6,%eax
 	je	.Ldone
 .Lclear_avx:
 	mov	\$0xefffe7ff,%eax	# ~(1<<28|1<<12|1<<11)
 	and	%eax,%r9d		# clear AVX, FMA and AMD XOP bits
-	andl	\$0xffffffdf,8(%rdi)	# cleax AVX2, ~(1<<5)
+	andl	\$0x3fdeffdf,8(%rdi)	# ~(1<<31|1<<30|1<<21|1<<16|1<<5)
+					# clear AVX2 and AVX512* bits
 .Ldone:
 	shl	\$32,%r9
 	mov	%r10d,%eax
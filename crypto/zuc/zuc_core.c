@@ -49,8 +49,21 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <openssl/crypto.h>
 #include <openssl/zuc.h>
 #include "modes_lcl.h"
+#include "zuc_lcl.h"
+
+#if defined(OPENSSL_CPUID_OBJ) && !defined(OPENSSL_NO_ASM) \
+	&& (defined(__x86_64) || defined(__x86_64__)) \
+	&& (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+# define ZUC_MAC_CLMUL
+# include <immintrin.h>
+extern unsigned int OPENSSL_ia32cap_P[];
+/* PCLMULQDQ and SSSE3 */
+# define ZUC_CAP_CLMUL	((OPENSSL_ia32cap_P[1] & ((1 << 1) | (1 << 9))) \
+				== ((1 << 1) | (1 << 9)))
+#endif
 
 static const ZUC_UINT15 KD[16] = {
 	0x44D7,0x26BC,0x626B,0x135E,0x5789,0x35E2,0x7135,0x09AF,
@@ -180,9 +193,19 @@ static const uint8_t S1[256] = {
 			S1[V & 0xFF])
 
 #define F(X0,X1,X2)					\
-	(X0 ^ R1) + R2;					\
+	((X0 ^ R1) + R2);					\
 	F_(X1, X2)
 
+void zuc_init_lfsr(ZUC_UINT31 LFSR[16], const unsigned char *user_key,
+	const unsigned char *iv)
+{
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		LFSR[i] = MAKEU31(user_key[i], KD[i], iv[i]);
+	}
+}
+
 void ZUC_set_key(ZUC_KEY *key, const unsigned char *user_key, const unsigned char *iv)
 {
 	ZUC_UINT31 *LFSR = key->LFSR;
@@ -191,9 +214,7 @@ void ZUC_set_key(ZUC_KEY *key, const unsigned char *user_key, const unsigned cha
 	uint32_t W, W1, W2, U, V;
 	int i;
 
-	for (i = 0; i < 16; i++) {
-		LFSR[i] = MAKEU31(user_key[i], KD[i], iv[i]);
-	}
+	zuc_init_lfsr(LFSR, user_key, iv);
 
 	R1 = 0;
 	R2 = 0;
@@ -231,6 +252,58 @@ uint32_t ZUC_generate_keyword(ZUC_KEY *key)
 	return Z;
 }
 
+/*
+ * The keystream is generated 16 words at a time with the LFSR in place: at
+ * step i the cell s_j is LFSR[(i + j) % 16] and the new s_15 is written
+ * over s_0, so after the 16th step the cells are in order again and none
+ * of them has been moved. The last words of a call are done one by one.
+ */
+#define LFSR_(i, j)	LFSR[((i) + (j)) & 15]
+
+#define ZUC_STEP(i, Z)							\
+	X0 = ((LFSR_(i, 15) & 0x7FFF8000) << 1) | (LFSR_(i, 14) & 0xFFFF);\
+	X1 = ((LFSR_(i, 11) & 0xFFFF) << 16) | (LFSR_(i, 9) >> 15);	\
+	X2 = ((LFSR_(i, 7) & 0xFFFF) << 16) | (LFSR_(i, 5) >> 15);	\
+	X3 = ((LFSR_(i, 2) & 0xFFFF) << 16) | (LFSR_(i, 0) >> 15);	\
+	Z = X3 ^ F(X0, X1, X2);						\
+	{								\
+	uint64_t a = LFSR_(i, 0);					\
+	a += ((uint64_t)LFSR_(i, 0)) << 8;				\
+	a += ((uint64_t)LFSR_(i, 4)) << 20;				\
+	a += ((uint64_t)LFSR_(i, 10)) << 21;				\
+	a += ((uint64_t)LFSR_(i, 13)) << 17;				\
+	a += ((uint64_t)LFSR_(i, 15)) << 15;				\
+	a = (a & 0x7fffffff) + (a >> 31);				\
+	LFSR_(i, 0) = (uint32_t)((a & 0x7fffffff) + (a >> 31));	\
+	}
+
+/* STORE(i, Z) takes keystream word i of the 16 */
+#define ZUC_STEPS16(STORE)						\
+	ZUC_STEP(0, Z); STORE(0, Z);					\
+	ZUC_STEP(1, Z); STORE(1, Z);					\
+	ZUC_STEP(2, Z); STORE(2, Z);					\
+	ZUC_STEP(3, Z); STORE(3, Z);					\
+	ZUC_STEP(4, Z); STORE(4, Z);					\
+	ZUC_STEP(5, Z); STORE(5, Z);					\
+	ZUC_STEP(6, Z); STORE(6, Z);					\
+	ZUC_STEP(7, Z); STORE(7, Z);					\
+	ZUC_STEP(8, Z); STORE(8, Z);					\
+	ZUC_STEP(9, Z); STORE(9, Z);					\
+	ZUC_STEP(10, Z); STORE(10, Z);					\
+	ZUC_STEP(11, Z); STORE(11, Z);					\
+	ZUC_STEP(12, Z); STORE(12, Z);					\
+	ZUC_STEP(13, Z); STORE(13, Z);					\
+	ZUC_STEP(14, Z); STORE(14, Z);					\
+	ZUC_STEP(15, Z); STORE(15, Z)
+
+#define ZUC_STORE(i, Z)		keystream[i] = Z
+
+/* the words of in and out are in host byte order, as with ZUC_eea_encrypt() */
+#define ZUC_STORE_XOR(i, Z)						\
+	memcpy(&t, in + 4 * (i), sizeof(t));				\
+	t ^= Z;								\
+	memcpy(out + 4 * (i), &t, sizeof(t))
+
 void ZUC_generate_keystream(ZUC_KEY *key, size_t nwords, uint32_t *keystream)
 {
 	ZUC_UINT31 *LFSR = key->LFSR;
@@ -238,8 +311,14 @@ void ZUC_generate_keystream(ZUC_KEY *key, size_t nwords, uint32_t *keystream)
 	uint32_t R2 = key->R2;
 	uint32_t X0, X1, X2, X3;
 	uint32_t W1, W2, U, V;
+	uint32_t Z;
 	size_t i;
 
+	for (; nwords >= 16; nwords -= 16) {
+		ZUC_STEPS16(ZUC_STORE);
+		keystream += 16;
+	}
+
 	for (i = 0; i < nwords; i ++) {
 		BitReconstruction4(X0, X1, X2, X3);
 		keystream[i] = X3 ^ F(X0, X1, X2);
@@ -250,6 +329,145 @@ void ZUC_generate_keystream(ZUC_KEY *key, size_t nwords, uint32_t *keystream)
 	key->R2 = R2;
 }
 
+void zuc_generate_keystream_xor(ZUC_KEY *key, size_t nwords,
+	const unsigned char *in, unsigned char *out)
+{
+	ZUC_UINT31 *LFSR = key->LFSR;
+	uint32_t R1 = key->R1;
+	uint32_t R2 = key->R2;
+	uint32_t X0, X1, X2, X3;
+	uint32_t W1, W2, U, V;
+	uint32_t Z, t;
+	size_t i;
+
+	for (; nwords >= 16; nwords -= 16) {
+		ZUC_STEPS16(ZUC_STORE_XOR);
+		in += 64;
+		out += 64;
+	}
+
+	for (i = 0; i < nwords; i ++) {
+		BitReconstruction4(X0, X1, X2, X3);
+		Z = X3 ^ F(X0, X1, X2);
+		ZUC_STORE_XOR(i, Z);
+		LFSRWithWorkMode();
+	}
+
+	key->R1 = R1;
+	key->R2 = R2;
+}
+
+/*
+ * EIA3 and the ZUC-256 MAC add the 32-bit keystream window starting at bit
+ * i into the tag for every message bit i that is set. For a message word M
+ * over the keystream words K0, K1 that is bits 32..63 of the carry-less
+ * product of K0 || K1 with M bit-reversed, which is what the backends below
+ * compute instead of walking the 32 bits one by one.
+ */
+
+/* nibble at a time, the 16 multiples of K0 || K1 are rebuilt for each word */
+ZUC_UINT32 zuc_mac_word(ZUC_UINT32 M, ZUC_UINT32 K0, ZUC_UINT32 K1)
+{
+	uint64_t K = ((uint64_t)K0 << 32) | K1;
+	uint64_t tab[16];
+	uint64_t T = 0;
+	int i;
+
+	tab[0] = 0;
+	tab[1] = K << 3;
+	tab[2] = K << 2;
+	tab[3] = tab[2] ^ tab[1];
+	tab[4] = K << 1;
+	tab[5] = tab[4] ^ tab[1];
+	tab[6] = tab[4] ^ tab[2];
+	tab[7] = tab[4] ^ tab[3];
+	for (i = 0; i < 8; i++) {
+		tab[8 + i] = K ^ tab[i];
+	}
+
+	for (i = 0; i < 8; i++) {
+		T ^= tab[(M >> (28 - 4 * i)) & 0xf] << (4 * i);
+	}
+	return (ZUC_UINT32)(T >> 32);
+}
+
+static ZUC_UINT32 zuc_mac_words_c(const ZUC_UINT32 *K,
+	const unsigned char *data, size_t nwords)
+{
+	ZUC_UINT32 T = 0;
+	size_t i;
+
+	for (i = 0; i < nwords; i++) {
+		T ^= zuc_mac_word(GETU32(data + 4 * i), K[i], K[i + 1]);
+	}
+	return T;
+}
+
+#ifdef ZUC_MAC_CLMUL
+/*
+ * Four words per iteration. Bit-reversing a big-endian message word is the
+ * same as bit-reversing each byte of it in memory order, which is two
+ * PSHUFB nibble lookups. The products are accumulated and only the bits
+ * 32..63 of the sum are taken at the end.
+ */
+__attribute__((target("pclmul,ssse3")))
+static ZUC_UINT32 zuc_mac_words_clmul(const ZUC_UINT32 *K,
+	const unsigned char *data, size_t nwords)
+{
+	const __m128i rev_lo = _mm_setr_epi8(
+		0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe,
+		0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf);
+	const __m128i rev_hi = _mm_slli_epi32(rev_lo, 4);
+	const __m128i mask = _mm_set1_epi8(0x0f);
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc = _mm_setzero_si128();
+	__m128i A0, A1, M, Me, Mo;
+	size_t i;
+
+	for (i = 0; i + 4 <= nwords; i += 4) {
+		M = _mm_loadu_si128((const __m128i *)(data + 4 * i));
+		M = _mm_or_si128(
+			_mm_shuffle_epi8(rev_hi, _mm_and_si128(M, mask)),
+			_mm_shuffle_epi8(rev_lo,
+				_mm_and_si128(_mm_srli_epi16(M, 4), mask)));
+		Me = _mm_unpacklo_epi32(M, zero);
+		Mo = _mm_unpackhi_epi32(M, zero);
+
+		/* K[i] << 32 | K[i + 1] and K[i + 2] << 32 | K[i + 3] */
+		A0 = _mm_shuffle_epi32(
+			_mm_loadu_si128((const __m128i *)(K + i)), 0xb1);
+		A1 = _mm_shuffle_epi32(
+			_mm_loadu_si128((const __m128i *)(K + i + 1)), 0xb1);
+
+		acc = _mm_xor_si128(acc, _mm_clmulepi64_si128(A0, Me, 0x00));
+		acc = _mm_xor_si128(acc, _mm_clmulepi64_si128(A1, Me, 0x10));
+		acc = _mm_xor_si128(acc, _mm_clmulepi64_si128(A0, Mo, 0x01));
+		acc = _mm_xor_si128(acc, _mm_clmulepi64_si128(A1, Mo, 0x11));
+	}
+
+	return (ZUC_UINT32)(_mm_cvtsi128_si64(acc) >> 32)
+		^ zuc_mac_words_c(K + i, data + 4 * i, nwords - i);
+}
+#endif
+
+/*
+ * Returns the sum over the message words data[i] of the windows starting
+ * at K[i], K has nwords + 1 words.
+ */
+ZUC_UINT32 zuc_mac_words(const ZUC_UINT32 *K, const unsigned char *data,
+	size_t nwords)
+{
+#ifdef ZUC_MAC_CLMUL
+	if (ZUC_CAP_CLMUL) {
+		return zuc_mac_words_clmul(K, data, nwords);
+	}
+#endif
+	return zuc_mac_words_c(K, data, nwords);
+}
+
+/* keystream words generated per zuc_mac_words() call */
+#define ZUC_MAC_BLOCK_WORDS	64
+
 void ZUC_MAC_init(ZUC_MAC_CTX *ctx, const unsigned char key[16], const unsigned char iv[16])
 {
 	memset(ctx, 0, sizeof(*ctx));
@@ -259,15 +477,11 @@ void ZUC_MAC_init(ZUC_MAC_CTX *ctx, const unsigned char key[16], const unsigned
 
 void ZUC_MAC_update(ZUC_MAC_CTX *ctx, const unsigned char *data, size_t len)
 {
+	ZUC_UINT32 K[ZUC_MAC_BLOCK_WORDS + 1];
 	ZUC_UINT32 T = ctx->T;
 	ZUC_UINT32 K0 = ctx->K0;
-	ZUC_UINT32 K1, M;
-	ZUC_UINT31 *LFSR = ctx->LFSR;
-	ZUC_UINT32 R1 = ctx->R1;
-	ZUC_UINT32 R2 = ctx->R2;
-	ZUC_UINT32 X0, X1, X2, X3;
-	ZUC_UINT32 W1, W2, U, V;
-	size_t i;
+	ZUC_UINT32 K1;
+	size_t n;
 
 	if (!data || !len) {
 		return;
@@ -282,68 +496,42 @@ void ZUC_MAC_update(ZUC_MAC_CTX *ctx, const unsigned char *data, size_t len)
 		}
 
 		memcpy(ctx->buf + ctx->buflen, data, num);
-		M = GETU32(ctx->buf);
 		ctx->buflen = 0;
 
-		BitReconstruction4(X0, X1, X2, X3);
-		K1 = X3 ^ F(X0, X1, X2);
-		LFSRWithWorkMode();
-
-		for (i = 0; i < 32; i++) {
-			if (M & 0x80000000) {
-				T ^= K0;
-			}
-			M <<= 1;
-			K0 = (K0 << 1) | (K1 >> 31);
-			K1 <<= 1;
-		}
+		K1 = ZUC_generate_keyword((ZUC_KEY *)ctx);
+		T ^= zuc_mac_word(GETU32(ctx->buf), K0, K1);
+		K0 = K1;
 
 		data += num;
 		len -= num;
 	}
 
 	while (len >= 4) {
-		M = GETU32(data);
-
-		BitReconstruction4(X0, X1, X2, X3);
-		K1 = X3 ^ F(X0, X1, X2);
-		LFSRWithWorkMode();
+		n = len/4 < ZUC_MAC_BLOCK_WORDS ? len/4 : ZUC_MAC_BLOCK_WORDS;
 
-		for (i = 0; i < 32; i++) {
-			if (M & 0x80000000) {
-				T ^= K0;
-			}
-			M <<= 1;
-			K0 = (K0 << 1) | (K1 >> 31);
-			K1 <<= 1;
-		}
+		K[0] = K0;
+		ZUC_generate_keystream((ZUC_KEY *)ctx, n, K + 1);
+		T ^= zuc_mac_words(K, data, n);
+		K0 = K[n];
 
-		data += 4;
-		len -= 4;
+		data += 4 * n;
+		len -= 4 * n;
 	}
+	OPENSSL_cleanse(K, sizeof(K));
 
 	if (len) {
 		memcpy(ctx->buf, data, len);
 		ctx->buflen = len;
 	}
-	ctx->R1 = R1;
-	ctx->R2 = R2;
 	ctx->K0 = K0;
 	ctx->T = T;
 }
 
 void ZUC_MAC_final(ZUC_MAC_CTX *ctx, const unsigned char *data, size_t nbits, unsigned char mac[4])
 {
-	ZUC_UINT32 T = ctx->T;
-	ZUC_UINT32 K0 = ctx->K0;
+	ZUC_UINT32 T;
+	ZUC_UINT32 K0;
 	ZUC_UINT32 K1, M;
-	ZUC_UINT31 *LFSR = ctx->LFSR;
-	ZUC_UINT32 R1 = ctx->R1;
-	ZUC_UINT32 R2 = ctx->R2;
-	ZUC_UINT32 X0, X1, X2, X3;
-	ZUC_UINT32 W1, W2, U, V;
-	size_t i;
-
 
 	if (!data)
 		nbits = 0;
@@ -356,36 +544,21 @@ void ZUC_MAC_final(ZUC_MAC_CTX *ctx, const unsigned char *data, size_t nbits, un
 
 	T = ctx->T;
 	K0 = ctx->K0;
-	LFSR = ctx->LFSR;
-	R1 = ctx->R1;
-	R2 = ctx->R2;
-
 
 	if (nbits)
 		ctx->buf[ctx->buflen] = *data;
 
+	/* the last 1 to 31 bits */
 	if (ctx->buflen || nbits) {
-		M = GETU32(ctx->buf);
-		BitReconstruction4(X0, X1, X2, X3);
-		K1 = X3 ^ F(X0, X1, X2);
-		LFSRWithWorkMode();
-
-		for (i = 0; i < ctx->buflen * 8 + nbits; i++) {
-			if (M & 0x80000000) {
-				T ^= K0;
-			}
-			M <<= 1;
-			K0 = (K0 << 1) | (K1 >> 31);
-			K1 <<= 1;
-		}
+		nbits += ctx->buflen * 8;
+		M = GETU32(ctx->buf) & ~(0xffffffff >> nbits);
+		K1 = ZUC_generate_keyword((ZUC_KEY *)ctx);
+		T ^= zuc_mac_word(M, K0, K1);
+		K0 = (K0 << nbits) | (K1 >> (32 - nbits));
 	}
 
 	T ^= K0;
-
-	BitReconstruction4(X0, X1, X2, X3);
-	K1 = X3 ^ F(X0, X1, X2);
-	LFSRWithWorkMode();
-	T ^= K1;
+	T ^= ZUC_generate_keyword((ZUC_KEY *)ctx);
 
 	ctx->T = T;
 	PUTU32(mac, T);
@@ -485,11 +658,24 @@ void ZUC256_MAC_init(ZUC256_MAC_CTX *ctx, const unsigned char key[32],
 	ctx->macbits = (macbits/32) * 32;
 }
 
+/* moves the ZUC-256 MAC keystream window n words of K0 then K1 by nbits */
+static void zuc256_mac_shift(ZUC_UINT32 *K0, size_t n, ZUC_UINT32 K1,
+	size_t nbits)
+{
+	size_t j;
+
+	for (j = 0; j < n - 1; j++) {
+		K0[j] = (K0[j] << nbits) | (K0[j + 1] >> (32 - nbits));
+	}
+	K0[j] = (K0[j] << nbits) | (K1 >> (32 - nbits));
+}
+
+/* tag word j runs on the keystream j words further on */
 void ZUC256_MAC_update(ZUC256_MAC_CTX *ctx, const unsigned char *data, size_t len)
 {
-	ZUC_UINT32 K1, M;
+	ZUC_UINT32 K[4 + ZUC_MAC_BLOCK_WORDS];
 	size_t n = ctx->macbits / 32;
-	size_t i, j;
+	size_t m, j;
 
 	if (!data || !len) {
 		return;
@@ -504,50 +690,33 @@ void ZUC256_MAC_update(ZUC256_MAC_CTX *ctx, const unsigned char *data, size_t le
 		}
 
 		memcpy(ctx->buf + ctx->buflen, data, num);
-		M = GETU32(ctx->buf);
 		ctx->buflen = 0;
 
-		K1 = ZUC256_generate_keyword((ZUC256_KEY *)ctx);
-
-		for (i = 0; i < 32; i++) {
-			if (M & 0x80000000) {
-				for (j = 0; j < n; j++) {
-					ctx->T[j] ^= ctx->K0[j];
-				}
-			}
-			M <<= 1;
-			for (j = 0; j < n - 1; j++) {
-				ctx->K0[j] = (ctx->K0[j] << 1) | (ctx->K0[j + 1] >> 31);
-			}
-			ctx->K0[j] = (ctx->K0[j] << 1) | (K1 >> 31);
-			K1 <<= 1;
+		memcpy(K, ctx->K0, sizeof(ctx->K0[0]) * n);
+		K[n] = ZUC256_generate_keyword((ZUC256_KEY *)ctx);
+		for (j = 0; j < n; j++) {
+			ctx->T[j] ^= zuc_mac_word(GETU32(ctx->buf), K[j], K[j + 1]);
 		}
+		memcpy(ctx->K0, K + 1, sizeof(ctx->K0[0]) * n);
 
 		data += num;
 		len -= num;
 	}
 
 	while (len >= 4) {
-		M = GETU32(data);
-		K1 = ZUC256_generate_keyword((ZUC256_KEY *)ctx);
+		m = len/4 < ZUC_MAC_BLOCK_WORDS ? len/4 : ZUC_MAC_BLOCK_WORDS;
 
-		for (i = 0; i < 32; i++) {
-			if (M & 0x80000000) {
-				for (j = 0; j < n; j++) {
-					ctx->T[j] ^= ctx->K0[j];
-				}
-			}
-			M <<= 1;
-			for (j = 0; j < n - 1; j++) {
-				ctx->K0[j] = (ctx->K0[j] << 1) | (ctx->K0[j + 1] >> 31);
-			}
-			ctx->K0[j] = (ctx->K0[j] << 1) | (K1 >> 31);
-			K1 <<= 1;
+		memcpy(K, ctx->K0, sizeof(ctx->K0[0]) * n);
+		ZUC256_generate_keystream((ZUC256_KEY *)ctx, m, K + n);
+		for (j = 0; j < n; j++) {
+			ctx->T[j] ^= zuc_mac_words(K + j, data, m);
 		}
+		memcpy(ctx->K0, K + m, sizeof(ctx->K0[0]) * n);
 
-		data += 4;
-		len -= 4;
+		data += 4 * m;
+		len -= 4 * m;
 	}
+	OPENSSL_cleanse(K, sizeof(K));
 
 	if (len) {
 		memcpy(ctx->buf, data, len);
@@ -559,7 +728,7 @@ void ZUC256_MAC_final(ZUC256_MAC_CTX *ctx, const unsigned char *data, size_t nbi
 {
 	ZUC_UINT32 K1, M;
 	size_t n = ctx->macbits/32;
-	size_t i, j;
+	size_t j;
 
 
 	if (!data)
@@ -574,24 +743,16 @@ void ZUC256_MAC_final(ZUC256_MAC_CTX *ctx, const unsigned char *data, size_t nbi
 	if (nbits)
 		ctx->buf[ctx->buflen] = *data;
 
+	/* the last 1 to 31 bits */
 	if (ctx->buflen || nbits) {
-		M = GETU32(ctx->buf);
+		nbits += ctx->buflen * 8;
+		M = GETU32(ctx->buf) & ~(0xffffffff >> nbits);
 		K1 = ZUC256_generate_keyword((ZUC256_KEY *)ctx);
-
-
-		for (i = 0; i < ctx->buflen * 8 + nbits; i++) {
-			if (M & 0x80000000) {
-				for (j = 0; j < n; j++) {
-					ctx->T[j] ^= ctx->K0[j];
-				}
-			}
-			M <<= 1;
-			for (j = 0; j < n - 1; j++) {
-				ctx->K0[j] = (ctx->K0[j] << 1) | (ctx->K0[j + 1] >> 31);
-			}
-			ctx->K0[j] = (ctx->K0[j] << 1) | (K1 >> 31);
-			K1 <<= 1;
+		for (j = 0; j < n; j++) {
+			ctx->T[j] ^= zuc_mac_word(M, ctx->K0[j],
+				j < n - 1 ? ctx->K0[j + 1] : K1);
 		}
+		zuc256_mac_shift(ctx->K0, n, K1, nbits);
 	}
 
 	for (j = 0; j < n; j++) {
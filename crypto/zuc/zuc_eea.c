@@ -48,18 +48,27 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <openssl/zuc.h>
+#include "zuc_lcl.h"
 
-static void ZUC_set_eea_key(ZUC_KEY *key, const unsigned char user_key[16],
-	ZUC_UINT32 count, ZUC_UINT5 bearer, ZUC_BIT direction)
+static void zuc_set_eea_iv(unsigned char iv[16], ZUC_UINT32 count,
+	ZUC_UINT5 bearer, ZUC_BIT direction)
 {
-	unsigned char iv[16] = {0};
+	memset(iv, 0, 16);
 	iv[0] = iv[8] = count >> 24;
 	iv[1] = iv[9] = count >> 16;
 	iv[2] = iv[10] = count >> 8;
 	iv[3] = iv[11] = count;
 	iv[4] = iv[12] = ((bearer << 1) | (direction & 1)) << 2;
-	ZUC_set_key(key, user_key, iv);
+}
+
+/* the bits after the last one of the message are cleared */
+static void zuc_eea_clear_tail(ZUC_UINT32 *out, size_t nbits)
+{
+	if (nbits % 32 != 0) {
+		out[nbits/32] &= 0xffffffff << (32 - (nbits%32));
+	}
 }
 
 void ZUC_eea_encrypt(const ZUC_UINT32 *in, ZUC_UINT32 *out, size_t nbits,
@@ -67,16 +76,51 @@ void ZUC_eea_encrypt(const ZUC_UINT32 *in, ZUC_UINT32 *out, size_t nbits,
 	ZUC_BIT direction)
 {
 	ZUC_KEY zuc_key;
-	size_t nwords = (nbits + 31)/32;
+	unsigned char iv[16];
+
+	zuc_set_eea_iv(iv, count, bearer, direction);
+	ZUC_set_key(&zuc_key, key, iv);
+	zuc_generate_keystream_xor(&zuc_key, (nbits + 31)/32,
+		(const unsigned char *)in, (unsigned char *)out);
+	zuc_eea_clear_tail(out, nbits);
+}
+
+static void zuc_eea_job_key(void *jobs, size_t i, const unsigned char **key,
+	unsigned char iv[16], size_t *nwords)
+{
+	const ZUC_EEA_JOB *job = (const ZUC_EEA_JOB *)jobs + i;
+
+	*key = job->key;
+	zuc_set_eea_iv(iv, job->count, job->bearer, job->direction);
+	*nwords = (job->nbits + 31)/32;
+}
+
+static void zuc_eea_job_keystream(void *jobs, size_t i, const ZUC_UINT32 *ks,
+	size_t off, size_t n)
+{
+	const ZUC_EEA_JOB *job = (const ZUC_EEA_JOB *)jobs + i;
+	size_t j;
+
+	for (j = 0; j < n; j++) {
+		job->out[off + j] = job->in[off + j] ^ ks[j];
+	}
+	if (off + n == (job->nbits + 31)/32) {
+		zuc_eea_clear_tail(job->out, job->nbits);
+	}
+}
+
+void ZUC_eea_encrypt_multi(const ZUC_EEA_JOB *jobs, size_t njobs)
+{
 	size_t i;
 
-	ZUC_set_eea_key(&zuc_key, key, count, bearer, direction);
-	ZUC_generate_keystream(&zuc_key, nwords, out);
-	for (i = 0; i < nwords; i++) {
-		out[i] ^= in[i];
+	if (zuc_keystream_multi((void *)jobs, njobs, zuc_eea_job_key,
+		zuc_eea_job_keystream)) {
+		return;
 	}
 
-	if (nbits % 32 != 0) {
-		out[nwords - 1] |= (0xffffffff << (32 - (nbits%32)));
+	for (i = 0; i < njobs; i++) {
+		ZUC_eea_encrypt(jobs[i].in, jobs[i].out, jobs[i].nbits,
+			jobs[i].key, jobs[i].count, jobs[i].bearer,
+			jobs[i].direction);
 	}
 }
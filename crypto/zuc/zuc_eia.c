@@ -52,6 +52,7 @@
 #include <openssl/zuc.h>
 #include <openssl/crypto.h>
 #include "modes_lcl.h"
+#include "zuc_lcl.h"
 
 static void zuc_set_eia_iv(unsigned char iv[16], ZUC_UINT32 count, ZUC_UINT5 bearer,
 	ZUC_BIT direction)
@@ -158,3 +159,68 @@ ZUC_UINT32 ZUC_eia_generate_mac(const ZUC_UINT32 *data, size_t nbits,
 	return T;
 }
 #endif
+
+static void zuc_eia_job_key(void *jobs, size_t i, const unsigned char **key,
+	unsigned char iv[16], size_t *nwords)
+{
+	ZUC_EIA_JOB *job = (ZUC_EIA_JOB *)jobs + i;
+
+	*key = job->key;
+	zuc_set_eia_iv(iv, job->count, job->bearer, job->direction);
+	*nwords = (job->nbits + 31)/32 + 2;
+	job->mac = 0;
+}
+
+/* message word j is added with the keystream words j and j + 1 */
+static void zuc_eia_job_keystream(void *jobs, size_t i, const ZUC_UINT32 *ks,
+	size_t off, size_t n)
+{
+	ZUC_EIA_JOB *job = (ZUC_EIA_JOB *)jobs + i;
+	const unsigned char *data = (const unsigned char *)job->data;
+	size_t nwords = job->nbits / 32;
+	size_t nbits = job->nbits % 32;
+	size_t first = off ? off - 1 : 0;
+	size_t last = off + n - 1 < nwords ? off + n - 1 : nwords;
+	ZUC_UINT32 T = job->mac;
+	ZUC_UINT32 K, M;
+	size_t j;
+
+	if (last > first) {
+		T ^= zuc_mac_words(ks + first - off, data + 4 * first,
+			last - first);
+	}
+
+	if (off + n == (job->nbits + 31)/32 + 2) {
+		/* the last 1 to 31 bits */
+		K = ks[nwords - off];
+		if (nbits) {
+			M = 0;
+			for (j = 0; j < (nbits + 7)/8; j++) {
+				M |= (ZUC_UINT32)data[4 * nwords + j] << (24 - 8 * j);
+			}
+			M &= ~(0xffffffff >> nbits);
+			T ^= zuc_mac_word(M, K, ks[nwords + 1 - off]);
+			K = (K << nbits) | (ks[nwords + 1 - off] >> (32 - nbits));
+		}
+		T ^= K;
+		T ^= ks[n - 1];
+	}
+
+	job->mac = T;
+}
+
+void ZUC_eia_generate_mac_multi(ZUC_EIA_JOB *jobs, size_t njobs)
+{
+	size_t i;
+
+	if (zuc_keystream_multi(jobs, njobs, zuc_eia_job_key,
+		zuc_eia_job_keystream)) {
+		return;
+	}
+
+	for (i = 0; i < njobs; i++) {
+		jobs[i].mac = ZUC_eia_generate_mac(jobs[i].data, jobs[i].nbits,
+			jobs[i].key, jobs[i].count, jobs[i].bearer,
+			jobs[i].direction);
+	}
+}
@@ -0,0 +1,87 @@
+/* ====================================================================
+ * Copyright (c) 2015 - 2019 The GmSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the GmSSL Project.
+ *    (http://gmssl.org/)"
+ *
+ * 4. The name "GmSSL Project" must not be used to endorse or promote
+ *    products derived from this software without prior written
+ *    permission. For written permission, please contact
+ *    guanzhi1980@gmail.com.
+ *
+ * 5. Products derived from this software may not be called "GmSSL"
+ *    nor may "GmSSL" appear in their names without prior written
+ *    permission of the GmSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the GmSSL Project
+ *    (http://gmssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE GmSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE GmSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+#ifndef HEADER_ZUC_LCL_H
+#define HEADER_ZUC_LCL_H
+
+#include <openssl/zuc.h>
+
+/* the LFSR before the initialisation rounds */
+void zuc_init_lfsr(ZUC_UINT31 LFSR[16], const unsigned char *user_key,
+	const unsigned char *iv);
+
+/* out = in ^ keystream over nwords words, kept in host byte order */
+void zuc_generate_keystream_xor(ZUC_KEY *key, size_t nwords,
+	const unsigned char *in, unsigned char *out);
+
+/* the EIA3 tag of message word M over the keystream words K0 and K1 */
+ZUC_UINT32 zuc_mac_word(ZUC_UINT32 M, ZUC_UINT32 K0, ZUC_UINT32 K1);
+/* the tags of nwords message words at data, K has nwords + 1 words */
+ZUC_UINT32 zuc_mac_words(const ZUC_UINT32 *K, const unsigned char *data,
+	size_t nwords);
+
+/* the key, iv and keystream length in words of job i */
+typedef void (*zuc_job_key_f)(void *jobs, size_t i,
+	const unsigned char **key, unsigned char iv[16], size_t *nwords);
+/*
+ * the keystream words off to off + n - 1 of job i, in order. When off is
+ * at least 2 the two words before them are at ks[-2] and ks[-1].
+ */
+typedef void (*zuc_job_keystream_f)(void *jobs, size_t i,
+	const ZUC_UINT32 *ks, size_t off, size_t n);
+
+/*
+ * Runs the keystreams of njobs jobs on parallel LFSRs, a new job taking
+ * the lane of a finished one. Returns 0, doing nothing, if there are no
+ * SIMD lanes on this CPU or too few jobs to fill them.
+ */
+int zuc_keystream_multi(void *jobs, size_t njobs, zuc_job_key_f key_f,
+	zuc_job_keystream_f keystream_f);
+
+#endif
@@ -0,0 +1,577 @@
+/* ====================================================================
+ * Copyright (c) 2015 - 2019 The GmSSL Project.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. All advertising materials mentioning features or use of this
+ *    software must display the following acknowledgment:
+ *    "This product includes software developed by the GmSSL Project.
+ *    (http://gmssl.org/)"
+ *
+ * 4. The name "GmSSL Project" must not be used to endorse or promote
+ *    products derived from this software without prior written
+ *    permission. For written permission, please contact
+ *    guanzhi1980@gmail.com.
+ *
+ * 5. Products derived from this software may not be called "GmSSL"
+ *    nor may "GmSSL" appear in their names without prior written
+ *    permission of the GmSSL Project.
+ *
+ * 6. Redistributions of any form whatsoever must retain the following
+ *    acknowledgment:
+ *    "This product includes software developed by the GmSSL Project
+ *    (http://gmssl.org/)"
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE GmSSL PROJECT ``AS IS'' AND ANY
+ * EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE GmSSL PROJECT OR
+ * ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ====================================================================
+ */
+
+/*
+ * ZUC on 4 (SSE), 8 (AVX2) or 16 (AVX-512) independent LFSRs, one in each
+ * 32-bit lane. The lanes are stepped together, each one in its own stage:
+ * a lane is initialised while its neighbours produce keystream, so a new
+ * job can take the lane of a finished one at any time.
+ *
+ * There are no table lookups. S1 is an inversion in GF(2^8) modulo
+ * x^8 + x^7 + x^3 + x + 1 followed by an affine map, so as with SMS4 it is
+ *
+ *	S1(x) = M2 * AES_S(M1 * x) + c2
+ *
+ * with M1 the isomorphism to the AES field and AES_S computed by
+ * AESENCLAST, or one GF2P8AFFINEQB and one GF2P8AFFINEINVQB with GFNI.
+ * S0 is three rounds of a Feistel network on the nibbles,
+ *
+ *	h ^= P1[l], l ^= P2[h], h ^= P3[l], S0(x) = (h || l) <<< 5
+ *
+ * which is five PSHUFB lookups with the rotation folded into the last
+ * two. The even bytes of R1 and R2 go through S1 and the odd ones through
+ * S0, so the bytes are sorted into one register for each S-box.
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/zuc.h>
+#include "zuc_lcl.h"
+
+#if defined(OPENSSL_CPUID_OBJ) && !defined(OPENSSL_NO_ASM) \
+	&& (defined(__x86_64) || defined(__x86_64__)) \
+	&& (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+# define ZUC_LANES
+# if (defined(__clang__) && __clang_major__ >= 6) \
+	|| (!defined(__clang__) && __GNUC__ >= 8)
+#  define ZUC_GFNI
+# endif
+#endif
+
+#ifdef ZUC_LANES
+# include <immintrin.h>
+
+extern unsigned int OPENSSL_ia32cap_P[];
+
+# define ZUC_CAP_SSSE3		(OPENSSL_ia32cap_P[1] & (1 << (41 - 32)))
+# define ZUC_CAP_AESNI		(OPENSSL_ia32cap_P[1] & (1 << (57 - 32)))
+# define ZUC_CAP_AVX2		(OPENSSL_ia32cap_P[2] & (1 << 5))
+# define ZUC_CAP_AVX512		((OPENSSL_ia32cap_P[2] & ((1 << 16) | (1 << 30))) \
+				== ((1 << 16) | (1 << 30)))	/* F and BW */
+# define ZUC_CAP_GFNI		(OPENSSL_ia32cap_P[3] & (1 << 8))
+
+# define ZUC_MAX_LANES		16
+/* with fewer jobs one ZUC at a time is as fast */
+# define ZUC_LANES_MIN_JOBS	3
+
+/* the state of the lanes, LFSR[i] is the word s_i of every lane */
+typedef struct {
+	ZUC_UINT32 LFSR[16][ZUC_MAX_LANES];
+	ZUC_UINT32 R1[ZUC_MAX_LANES];
+	ZUC_UINT32 R2[ZUC_MAX_LANES];
+	/* steps before the keystream starts, 33 for a new key */
+	int32_t ctr[ZUC_MAX_LANES];
+} zuc_lanes_t;
+
+/* M1 as nibble tables */
+# define ZUC_IN_LO	0x00, 0x01, 0x32, 0x33, 0x73, 0x72, 0x41, 0x40, \
+			0x75, 0x74, 0x47, 0x46, 0x06, 0x07, 0x34, 0x35
+# define ZUC_IN_HI	0x00, 0xd9, 0xe8, 0x31, 0xcd, 0x14, 0x25, 0xfc, \
+			0x2d, 0xf4, 0xc5, 0x1c, 0xe0, 0x39, 0x08, 0xd1
+/* M2 after the inverse of the AES affine map, c2 is merged into the low table */
+# define ZUC_OUT_LO	0xfe, 0xb1, 0x6e, 0x21, 0xb5, 0xfa, 0x25, 0x6a, \
+			0xc9, 0x86, 0x59, 0x16, 0x82, 0xcd, 0x12, 0x5d
+# define ZUC_OUT_HI	0x00, 0x34, 0x42, 0x76, 0x36, 0x02, 0x74, 0x40, \
+			0x66, 0x52, 0x24, 0x10, 0x50, 0x64, 0x12, 0x26
+/* the nibble functions of S0, and the final rotation of each nibble */
+# define ZUC_P1		9, 15, 0, 14, 15, 15, 2, 10, 0, 4, 0, 12, 7, 5, 3, 9
+# define ZUC_P2		8, 13, 6, 5, 7, 0, 12, 4, 11, 1, 14, 10, 15, 3, 9, 2
+# define ZUC_P3		2, 6, 10, 6, 0, 13, 10, 15, 3, 3, 13, 5, 0, 9, 12, 13
+# define ZUC_ROT_HI	0x00, 0x02, 0x04, 0x06, 0x08, 0x0a, 0x0c, 0x0e, \
+			0x10, 0x12, 0x14, 0x16, 0x18, 0x1a, 0x1c, 0x1e
+# define ZUC_ROT_LO	0x00, 0x20, 0x40, 0x60, 0x80, 0xa0, 0xc0, 0xe0, \
+			0x01, 0x21, 0x41, 0x61, 0x81, 0xa1, 0xc1, 0xe1
+/* the inverse of ShiftRows, applied before AESENCLAST */
+# define ZUC_INV_SR	0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3
+/* the even bytes of each word, then the odd ones */
+# define ZUC_SPLIT	0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15
+# define ZUC_ROL8	3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14
+# define ZUC_ROL16	2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13
+# define ZUC_ROL24	1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12
+
+/* GF2P8AFFINEQB matrices: M1 to the AES field, and the affine map of S1 */
+# define ZUC_GFNI_M1	0xdd06c8f01eae7c70ULL
+# define ZUC_GFNI_M2	0xb903e5360f14f0e3ULL
+# define ZUC_GFNI_C2	0x55
+
+static const unsigned char zuc_lanes_consts[][16] = {
+	{ ZUC_IN_LO }, { ZUC_IN_HI }, { ZUC_OUT_LO }, { ZUC_OUT_HI },
+	{ ZUC_P1 }, { ZUC_P2 }, { ZUC_P3 }, { ZUC_ROT_HI }, { ZUC_ROT_LO },
+	{ ZUC_INV_SR }, { ZUC_SPLIT }, { ZUC_ROL8 }, { ZUC_ROL16 },
+	{ ZUC_ROL24 },
+};
+
+/*
+ * The kernel is written with the V*() operations below, which are defined
+ * for each vector width before ZUC_LANES_KERNEL() is expanded.
+ */
+# define ZUC_S1_AESNI_CONSTS						\
+	const V in_lo = VCONST(0);					\
+	const V in_hi = VCONST(1);					\
+	const V out_lo = VCONST(2);					\
+	const V out_hi = VCONST(3);					\
+	const V inv_sr = VCONST(9)
+
+# define ZUC_S1_GFNI_CONSTS						\
+	const V m1 = VSET1_64(ZUC_GFNI_M1);				\
+	const V m2 = VSET1_64(ZUC_GFNI_M2)
+
+/* the rotations by multiples of 8 are byte shuffles without VPROLD */
+# define ZUC_ROL_CONSTS							\
+	const V rol8 = VCONST(11);					\
+	const V rol16 = VCONST(12);					\
+	const V rol24 = VCONST(13);
+
+/* nibble table lookups of the affine maps */
+# define ZUC_AFFINE(t, lo, hi)						\
+	VXOR(VSHUFB(lo, VAND(t, m0f)),					\
+		VSHUFB(hi, VAND(VSRL32(t, 4), m0f)))
+
+# define ZUC_S1_AESNI(t)						\
+	t = ZUC_AFFINE(t, in_lo, in_hi);				\
+	t = VSHUFB(t, inv_sr);						\
+	t = VAESENCLAST(t);						\
+	t = ZUC_AFFINE(t, out_lo, out_hi)
+
+# define ZUC_S1_GFNI(t)							\
+	t = VGF2P8AFFINE(t, m1, 0);					\
+	t = VGF2P8AFFINEINV(t, m2, ZUC_GFNI_C2)
+
+# define ZUC_S0(t)							\
+	l = VAND(t, m0f);						\
+	h = VAND(VSRL32(t, 4), m0f);					\
+	h = VXOR(h, VSHUFB(p1, l));					\
+	l = VXOR(l, VSHUFB(p2, h));					\
+	h = VXOR(h, VSHUFB(p3, l));					\
+	t = VXOR(VSHUFB(rot_hi, h), VSHUFB(rot_lo, l))
+
+/* R1 = S(L1(u)), R2 = S(L2(v)) */
+# define ZUC_LS(u, v)							\
+	t = VXOR(u, VXOR(VROL8(u), VROL16(u)));				\
+	u = VXOR(VXOR(u, VROL24(u)), VROL32(t, 2));			\
+	t = VXOR(v, VXOR(VROL16(v), VROL24(v)));			\
+	v = VXOR(VXOR(v, VROL8(v)), VROL32(t, 30));			\
+	u = VSHUFB(u, split);						\
+	v = VSHUFB(v, split);						\
+	t = VUNPACKLO64(u, v);						\
+	v = VUNPACKHI64(u, v);						\
+	ZUC_S1(t);							\
+	ZUC_S0(v);							\
+	R1 = VUNPACKLO8(t, v);						\
+	R2 = VUNPACKHI8(t, v)
+
+# define ZUC_ADD31(a, b)						\
+	a = VADD32(a, b);						\
+	a = VADD32(VAND(a, m31), VSRL32(a, 31))
+
+# define ZUC_ROT31(a, k)						\
+	VAND(VOR(VSLL32(a, k), VSRL32(a, 31 - (k))), m31)
+
+/* s_j at step i, the new s_15 is written over s_0 */
+# define ZUC_LFSR(i, j)		s[((i) + (j)) & 15]
+
+/*
+ * One step of every lane. The keystream word is stored whatever the stage
+ * of the lane, W >> 1 only goes into the LFSR in the 32 initialisation
+ * rounds.
+ */
+# define ZUC_STEP(i)							\
+	X0 = VOR(VSLL32(VAND(ZUC_LFSR(i, 15), m7fff8000), 1),		\
+		VAND(ZUC_LFSR(i, 14), mffff));				\
+	X1 = VOR(VSLL32(ZUC_LFSR(i, 11), 16), VSRL32(ZUC_LFSR(i, 9), 15));\
+	X2 = VOR(VSLL32(ZUC_LFSR(i, 7), 16), VSRL32(ZUC_LFSR(i, 5), 15));\
+	X3 = VOR(VSLL32(ZUC_LFSR(i, 2), 16), VSRL32(ZUC_LFSR(i, 0), 15));\
+	W = VADD32(VXOR(X0, R1), R2);					\
+	VSTOREU(ks[i], VXOR(W, X3));					\
+	W1 = VADD32(R1, X1);						\
+	W2 = VXOR(R2, X2);						\
+	X1 = VOR(VSLL32(W1, 16), VSRL32(W2, 16));			\
+	X2 = VOR(VSLL32(W2, 16), VSRL32(W1, 16));			\
+	ZUC_LS(X1, X2);							\
+	W = VAND(VSRL32(W, 1), VCMPGT32(ctr, one));			\
+	ctr = VADD32(ctr, VCMPGT32(ctr, zero));				\
+	X0 = ZUC_LFSR(i, 0);						\
+	ZUC_ADD31(X0, ZUC_ROT31(ZUC_LFSR(i, 0), 8));			\
+	ZUC_ADD31(X0, ZUC_ROT31(ZUC_LFSR(i, 4), 20));			\
+	ZUC_ADD31(X0, ZUC_ROT31(ZUC_LFSR(i, 10), 21));			\
+	ZUC_ADD31(X0, ZUC_ROT31(ZUC_LFSR(i, 13), 17));			\
+	ZUC_ADD31(X0, ZUC_ROT31(ZUC_LFSR(i, 15), 15));			\
+	ZUC_ADD31(X0, W);						\
+	ZUC_LFSR(i, 0) = X0
+
+/* 16 steps, after which s[] is in order again */
+# define ZUC_LANES_KERNEL(name, isa)					\
+__attribute__((target(isa)))						\
+static void name(zuc_lanes_t *st, ZUC_UINT32 ks[16][ZUC_MAX_LANES])	\
+{									\
+	const V m0f = VSET1_8(0x0f);					\
+	const V m31 = VSET1_32(0x7fffffff);				\
+	const V mffff = VSET1_32(0xffff);				\
+	const V m7fff8000 = VSET1_32(0x7fff8000);			\
+	const V zero = VSET1_32(0);					\
+	const V one = VSET1_32(1);					\
+	const V p1 = VCONST(4);						\
+	const V p2 = VCONST(5);						\
+	const V p3 = VCONST(6);						\
+	const V rot_hi = VCONST(7);					\
+	const V rot_lo = VCONST(8);					\
+	const V split = VCONST(10);					\
+	ZUC_S1_CONSTS;							\
+	ZUC_ROUND_CONSTS						\
+	V s[16];							\
+	V R1 = VLOADU(st->R1);						\
+	V R2 = VLOADU(st->R2);						\
+	V ctr = VLOADU(st->ctr);					\
+	V X0, X1, X2, X3, W, W1, W2, t, h, l;				\
+	int i;								\
+									\
+	for (i = 0; i < 16; i++)					\
+		s[i] = VLOADU(st->LFSR[i]);				\
+	ZUC_STEP(0); ZUC_STEP(1); ZUC_STEP(2); ZUC_STEP(3);		\
+	ZUC_STEP(4); ZUC_STEP(5); ZUC_STEP(6); ZUC_STEP(7);		\
+	ZUC_STEP(8); ZUC_STEP(9); ZUC_STEP(10); ZUC_STEP(11);		\
+	ZUC_STEP(12); ZUC_STEP(13); ZUC_STEP(14); ZUC_STEP(15);		\
+	for (i = 0; i < 16; i++)					\
+		VSTOREU(st->LFSR[i], s[i]);				\
+	VSTOREU(st->R1, R1);						\
+	VSTOREU(st->R2, R2);						\
+	VSTOREU(st->ctr, ctr);						\
+}
+
+/* SSE, AES-NI */
+# define V			__m128i
+# define VCONST(i)		_mm_loadu_si128((const __m128i *)zuc_lanes_consts[i])
+# define VSET1_8(a)		_mm_set1_epi8(a)
+# define VSET1_32(a)		_mm_set1_epi32((int)(a))
+# define VLOADU(p)		_mm_loadu_si128((const __m128i *)(p))
+# define VSTOREU(p, a)		_mm_storeu_si128((__m128i *)(p), a)
+# define VXOR(a, b)		_mm_xor_si128(a, b)
+# define VOR(a, b)		_mm_or_si128(a, b)
+# define VAND(a, b)		_mm_and_si128(a, b)
+# define VADD32(a, b)		_mm_add_epi32(a, b)
+# define VCMPGT32(a, b)		_mm_cmpgt_epi32(a, b)
+# define VSHUFB(a, b)		_mm_shuffle_epi8(a, b)
+# define VSLL32(a, i)		_mm_slli_epi32(a, i)
+# define VSRL32(a, i)		_mm_srli_epi32(a, i)
+# define VUNPACKLO8(a, b)	_mm_unpacklo_epi8(a, b)
+# define VUNPACKHI8(a, b)	_mm_unpackhi_epi8(a, b)
+# define VUNPACKLO64(a, b)	_mm_unpacklo_epi64(a, b)
+# define VUNPACKHI64(a, b)	_mm_unpackhi_epi64(a, b)
+# define VROL8(a)		VSHUFB(a, rol8)
+# define VROL16(a)		VSHUFB(a, rol16)
+# define VROL24(a)		VSHUFB(a, rol24)
+# define VROL32(a, i)		VOR(VSLL32(a, i), VSRL32(a, 32 - (i)))
+# define VAESENCLAST(a)		_mm_aesenclast_si128(a, _mm_setzero_si128())
+# define ZUC_S1			ZUC_S1_AESNI
+# define ZUC_S1_CONSTS		ZUC_S1_AESNI_CONSTS
+# define ZUC_ROUND_CONSTS	ZUC_ROL_CONSTS
+
+ZUC_LANES_KERNEL(zuc_aesni_sse_x4, "aes,ssse3")
+
+/* AVX2, AESENCLAST on each half, or GFNI */
+# undef V
+# undef VCONST
+# undef VSET1_8
+# undef VSET1_32
+# undef VLOADU
+# undef VSTOREU
+# undef VXOR
+# undef VOR
+# undef VAND
+# undef VADD32
+# undef VCMPGT32
+# undef VSHUFB
+# undef VSLL32
+# undef VSRL32
+# undef VUNPACKLO8
+# undef VUNPACKHI8
+# undef VUNPACKLO64
+# undef VUNPACKHI64
+# undef VAESENCLAST
+# define V			__m256i
+# define VCONST(i)		_mm256_broadcastsi128_si256(		\
+	_mm_loadu_si128((const __m128i *)zuc_lanes_consts[i]))
+# define VSET1_8(a)		_mm256_set1_epi8(a)
+# define VSET1_32(a)		_mm256_set1_epi32((int)(a))
+# define VSET1_64(a)		_mm256_set1_epi64x((long long)(a))
+# define VLOADU(p)		_mm256_loadu_si256((const __m256i *)(p))
+# define VSTOREU(p, a)		_mm256_storeu_si256((__m256i *)(p), a)
+# define VXOR(a, b)		_mm256_xor_si256(a, b)
+# define VOR(a, b)		_mm256_or_si256(a, b)
+# define VAND(a, b)		_mm256_and_si256(a, b)
+# define VADD32(a, b)		_mm256_add_epi32(a, b)
+# define VCMPGT32(a, b)		_mm256_cmpgt_epi32(a, b)
+# define VSHUFB(a, b)		_mm256_shuffle_epi8(a, b)
+# define VSLL32(a, i)		_mm256_slli_epi32(a, i)
+# define VSRL32(a, i)		_mm256_srli_epi32(a, i)
+# define VUNPACKLO8(a, b)	_mm256_unpacklo_epi8(a, b)
+# define VUNPACKHI8(a, b)	_mm256_unpackhi_epi8(a, b)
+# define VUNPACKLO64(a, b)	_mm256_unpacklo_epi64(a, b)
+# define VUNPACKHI64(a, b)	_mm256_unpackhi_epi64(a, b)
+# define VAESENCLAST(a)		_mm256_inserti128_si256(_mm256_castsi128_si256(\
+	_mm_aesenclast_si128(_mm256_castsi256_si128(a), _mm_setzero_si128())),	\
+	_mm_aesenclast_si128(_mm256_extracti128_si256(a, 1),		\
+		_mm_setzero_si128()), 1)
+
+ZUC_LANES_KERNEL(zuc_aesni_avx2_x8, "aes,avx2")
+
+# ifdef ZUC_GFNI
+#  undef ZUC_S1
+#  undef ZUC_S1_CONSTS
+#  define ZUC_S1		ZUC_S1_GFNI
+#  define ZUC_S1_CONSTS		ZUC_S1_GFNI_CONSTS
+#  define VGF2P8AFFINE(a, m, c)	_mm256_gf2p8affine_epi64_epi8(a, m, c)
+#  define VGF2P8AFFINEINV(a, m, c) _mm256_gf2p8affineinv_epi64_epi8(a, m, c)
+
+ZUC_LANES_KERNEL(zuc_gfni_avx2_x8, "gfni,avx2")
+
+/* AVX-512 with GFNI, rotations by VPROLD */
+#  undef V
+#  undef VCONST
+#  undef VSET1_8
+#  undef VSET1_32
+#  undef VSET1_64
+#  undef VLOADU
+#  undef VSTOREU
+#  undef VXOR
+#  undef VOR
+#  undef VAND
+#  undef VADD32
+#  undef VCMPGT32
+#  undef VSHUFB
+#  undef VSLL32
+#  undef VSRL32
+#  undef VUNPACKLO8
+#  undef VUNPACKHI8
+#  undef VUNPACKLO64
+#  undef VUNPACKHI64
+#  undef VROL8
+#  undef VROL16
+#  undef VROL24
+#  undef VROL32
+#  undef VGF2P8AFFINE
+#  undef VGF2P8AFFINEINV
+#  undef ZUC_ROUND_CONSTS
+#  define ZUC_ROUND_CONSTS
+#  define V			__m512i
+#  define VCONST(i)		_mm512_broadcast_i32x4(			\
+	_mm_loadu_si128((const __m128i *)zuc_lanes_consts[i]))
+#  define VSET1_8(a)		_mm512_set1_epi8(a)
+#  define VSET1_32(a)		_mm512_set1_epi32((int)(a))
+#  define VSET1_64(a)		_mm512_set1_epi64((long long)(a))
+#  define VLOADU(p)		_mm512_loadu_si512((const void *)(p))
+#  define VSTOREU(p, a)		_mm512_storeu_si512((void *)(p), a)
+#  define VXOR(a, b)		_mm512_xor_si512(a, b)
+#  define VOR(a, b)		_mm512_or_si512(a, b)
+#  define VAND(a, b)		_mm512_and_si512(a, b)
+#  define VADD32(a, b)		_mm512_add_epi32(a, b)
+#  define VCMPGT32(a, b)		_mm512_maskz_mov_epi32(		\
+	_mm512_cmpgt_epi32_mask(a, b), VSET1_32(-1))
+#  define VSHUFB(a, b)		_mm512_shuffle_epi8(a, b)
+#  define VSLL32(a, i)		_mm512_slli_epi32(a, i)
+#  define VSRL32(a, i)		_mm512_srli_epi32(a, i)
+#  define VUNPACKLO8(a, b)	_mm512_unpacklo_epi8(a, b)
+#  define VUNPACKHI8(a, b)	_mm512_unpackhi_epi8(a, b)
+#  define VUNPACKLO64(a, b)	_mm512_unpacklo_epi64(a, b)
+#  define VUNPACKHI64(a, b)	_mm512_unpackhi_epi64(a, b)
+#  define VROL8(a)		VROL32(a, 8)
+#  define VROL16(a)		VROL32(a, 16)
+#  define VROL24(a)		VROL32(a, 24)
+#  define VROL32(a, i)		_mm512_rol_epi32(a, i)
+#  define VGF2P8AFFINE(a, m, c)	_mm512_gf2p8affine_epi64_epi8(a, m, c)
+#  define VGF2P8AFFINEINV(a, m, c) _mm512_gf2p8affineinv_epi64_epi8(a, m, c)
+
+ZUC_LANES_KERNEL(zuc_gfni_avx512_x16, "gfni,avx512f,avx512bw")
+# endif /* ZUC_GFNI */
+
+typedef struct {
+	size_t width;
+	int (*capable)(void);
+	void (*keystream)(zuc_lanes_t *st, ZUC_UINT32 ks[16][ZUC_MAX_LANES]);
+} zuc_lanes_method_t;
+
+# ifdef ZUC_GFNI
+static int zuc_gfni_avx512_capable(void)
+{
+	return ZUC_CAP_GFNI && ZUC_CAP_AVX512;
+}
+
+static int zuc_gfni_avx2_capable(void)
+{
+	return ZUC_CAP_GFNI && ZUC_CAP_AVX2;
+}
+# endif
+
+static int zuc_aesni_avx2_capable(void)
+{
+	return ZUC_CAP_AESNI && ZUC_CAP_AVX2;
+}
+
+static int zuc_aesni_sse_capable(void)
+{
+	return ZUC_CAP_AESNI && ZUC_CAP_SSSE3;
+}
+
+/* widest first */
+static const zuc_lanes_method_t zuc_lanes_methods[] = {
+# ifdef ZUC_GFNI
+	{ 16, zuc_gfni_avx512_capable, zuc_gfni_avx512_x16 },
+	{ 8, zuc_gfni_avx2_capable, zuc_gfni_avx2_x8 },
+# endif
+	{ 8, zuc_aesni_avx2_capable, zuc_aesni_avx2_x8 },
+	{ 4, zuc_aesni_sse_capable, zuc_aesni_sse_x4 },
+};
+
+/* the widest method, or a narrower one if that is enough for njobs */
+static const zuc_lanes_method_t *zuc_lanes_method(size_t njobs)
+{
+	const zuc_lanes_method_t *ret = NULL;
+	size_t i;
+
+	for (i = 0; i < sizeof(zuc_lanes_methods)/sizeof(zuc_lanes_methods[0]); i++) {
+		const zuc_lanes_method_t *m = &zuc_lanes_methods[i];
+
+		if (m->capable() && (ret == NULL
+			|| (njobs <= m->width && m->width < ret->width))) {
+			ret = m;
+		}
+	}
+	return ret;
+}
+#endif /* ZUC_LANES */
+
+int zuc_keystream_multi(void *jobs, size_t njobs, zuc_job_key_f key_f,
+	zuc_job_keystream_f keystream_f)
+{
+#ifdef ZUC_LANES
+	const zuc_lanes_method_t *m;
+	zuc_lanes_t st;
+	ZUC_UINT32 ks[16][ZUC_MAX_LANES];
+	/* the last two words of the previous block, then the new ones */
+	ZUC_UINT32 buf[ZUC_MAX_LANES][2 + 16];
+	ZUC_UINT31 LFSR[16];
+	const unsigned char *key;
+	unsigned char iv[16];
+	size_t job[ZUC_MAX_LANES];
+	size_t off[ZUC_MAX_LANES] = {0};
+	size_t len[ZUC_MAX_LANES] = {0};
+	size_t skip[ZUC_MAX_LANES];
+	size_t next = 0, busy = 0, lane, n;
+	int i;
+
+	if (njobs < ZUC_LANES_MIN_JOBS
+		|| (m = zuc_lanes_method(njobs)) == NULL) {
+		return 0;
+	}
+
+	memset(&st, 0, sizeof(st));
+
+	for (;;) {
+		/* a lane is free when its job is done, jobs without keystream are skipped */
+		for (lane = 0; lane < m->width; lane++) {
+			while (off[lane] == len[lane] && next < njobs) {
+				job[lane] = next;
+				off[lane] = 0;
+				key_f(jobs, next++, &key, iv, &len[lane]);
+				if (len[lane] == 0) {
+					continue;
+				}
+				zuc_init_lfsr(LFSR, key, iv);
+				for (i = 0; i < 16; i++) {
+					st.LFSR[i][lane] = LFSR[i];
+				}
+				st.R1[lane] = 0;
+				st.R2[lane] = 0;
+				st.ctr[lane] = 33;
+				busy++;
+			}
+		}
+		if (!busy) {
+			break;
+		}
+
+		for (lane = 0; lane < m->width; lane++) {
+			skip[lane] = st.ctr[lane] < 16 ? st.ctr[lane] : 16;
+		}
+
+		m->keystream(&st, ks);
+
+		for (lane = 0; lane < m->width; lane++) {
+			if (off[lane] == len[lane]) {
+				continue;
+			}
+			n = 16 - skip[lane];
+			if (n > len[lane] - off[lane]) {
+				n = len[lane] - off[lane];
+			}
+			if (n == 0) {
+				continue;
+			}
+			for (i = 0; i < (int)n; i++) {
+				buf[lane][2 + i] = ks[skip[lane] + i][lane];
+			}
+			keystream_f(jobs, job[lane], buf[lane] + 2, off[lane], n);
+			buf[lane][0] = buf[lane][n];
+			buf[lane][1] = buf[lane][n + 1];
+			off[lane] += n;
+			if (off[lane] == len[lane]) {
+				busy--;
+			}
+		}
+	}
+
+	OPENSSL_cleanse(&st, sizeof(st));
+	OPENSSL_cleanse(ks, sizeof(ks));
+	OPENSSL_cleanse(buf, sizeof(buf));
+	OPENSSL_cleanse(LFSR, sizeof(LFSR));
+	return 1;
+#else
+	return 0;
+#endif
+}
@@ -1421,9 +1421,12 @@ int ERR_load_EC_strings(void);
 # define EC_F_ECP_NISTZ256_PRE_COMP_NEW                   138
 # define EC_F_ECP_NISTZ256_WINDOWED_MUL                   139
 # define EC_F_ECP_SM2Z256_GET_AFFINE                      140
+# define EC_F_ECP_SM2Z256_INV_MOD_ORD                     275
 # define EC_F_ECP_SM2Z256_MULT_PRECOMPUTE                 141
 # define EC_F_ECP_SM2Z256_POINTS_MUL                      142
 # define EC_F_ECP_SM2Z256_PRE_COMP_NEW                    143
+# define EC_F_ECP_SM2Z256_SM2_VERIFY_BATCH                276
+# define EC_F_ECP_SM2Z256_VERIFY_TABLE_NEW                277
 # define EC_F_ECP_SM2Z256_WINDOWED_MUL                    144
 # define EC_F_ECX_KEY_OP                                  145
 # define EC_F_ECX_PRIV_ENCODE                             146
@@ -1553,7 +1556,10 @@ int ERR_load_EC_strings(void);
 # define EC_F_SM2_GET_PUBLIC_KEY_DATA                     270
 # define EC_F_SM2_KAP_COMPUTE_KEY                         271
 # define EC_F_SM2_KAP_CTX_INIT                            272
+# define EC_F_SM2_KAP_CTX_SET_POOL                        278
 # define EC_F_SM2_KAP_FINAL_CHECK                         273
+# define EC_F_SM2_KAP_POOL_NEW                            279
+# define EC_F_SM2_KAP_POOL_REFILL                         280
 # define EC_F_SM2_KAP_PREPARE                             274
 
 /* Reason codes. */
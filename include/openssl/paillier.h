@@ -89,6 +89,10 @@ int PAILLIER_ciphertext_scalar_mul(BIGNUM *r, const BIGNUM *scalar, const BIGNUM
 
 int PAILLIER_up_ref(PAILLIER *key);
 
+/* r^n mod n^2 values computed ahead of time, used by encryption */
+int PAILLIER_precompute(PAILLIER *key, int num);
+int PAILLIER_num_precomputed(PAILLIER *key);
+
 DECLARE_ASN1_ENCODE_FUNCTIONS_const(PAILLIER, PaillierPrivateKey)
 DECLARE_ASN1_ENCODE_FUNCTIONS_const(PAILLIER, PaillierPublicKey)
 
@@ -120,11 +124,13 @@ int ERR_load_PAILLIER_strings(void);
 # define PAILLIER_F_PAILLIER_CHECK_KEY                    100
 # define PAILLIER_F_PAILLIER_CIPHERTEXT_ADD               101
 # define PAILLIER_F_PAILLIER_CIPHERTEXT_SCALAR_MUL        102
+# define PAILLIER_F_PAILLIER_CRT_INIT                     119
 # define PAILLIER_F_PAILLIER_DECRYPT                      103
 # define PAILLIER_F_PAILLIER_ENCRYPT                      104
 # define PAILLIER_F_PAILLIER_GENERATE_KEY                 105
 # define PAILLIER_F_PAILLIER_NEW                          106
 # define PAILLIER_F_PAILLIER_PLAINTEXT_SIZE               117
+# define PAILLIER_F_PAILLIER_PRECOMPUTE                   120
 # define PAILLIER_F_PAILLIER_PRIV_DECODE                  111
 # define PAILLIER_F_PAILLIER_PRIV_ENCODE                  112
 # define PAILLIER_F_PAILLIER_PUB_DECODE                   107
@@ -140,6 +146,7 @@ int ERR_load_PAILLIER_strings(void);
 # define PAILLIER_R_BUFFER_TOO_SMALL                      104
 # define PAILLIER_R_DECODE_ERROR                          105
 # define PAILLIER_R_GENERATE_PRIME_FAILED                 100
+# define PAILLIER_R_INVALID_PRIVATE_KEY                   108
 # define PAILLIER_R_INVALID_PLAINTEXT                     101
 # define PAILLIER_R_KEY_SIZE_TOO_SMALL                    106
 # define PAILLIER_R_MALLOC_FAILED                         102
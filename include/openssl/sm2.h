@@ -107,6 +107,66 @@ int SM2_sign(int type, const unsigned char *dgst, int dgstlen,
 int SM2_verify(int type, const unsigned char *dgst, int dgstlen,
 	const unsigned char *sig, int siglen, EC_KEY *ec_key);
 
+/*
+ * Verifies num signatures together, ok[i] is set to 1 if signature i is
+ * valid, 0 if it is not and -1 on error. Signatures under the same public
+ * key share its precomputation. Returns 1 if all signatures are valid, 0 if
+ * any is not and -1 if the batch could not be processed.
+ */
+int SM2_verify_batch(int type, const unsigned char **dgsts, const int *dgstlens,
+	const unsigned char **sigs, const int *siglens, EC_KEY **ec_keys,
+	size_t num, int *ok);
+
+/*
+ * Verification of sm2p256v1 keys that are used many times can run on a
+ * table of multiples of the public key, which takes 150 KB and about a
+ * dozen verifications to build. SM2_verify_precompute() attaches one to
+ * ec_key, it must not run concurrently with other uses of ec_key.
+ * SM2_set_verify_cache_size() bounds the process-wide cache of such tables
+ * that is looked up by public key value, so that keys parsed again and
+ * again share them. The cache is off by default and 0 turns it off again.
+ */
+int SM2_verify_precompute(EC_KEY *ec_key);
+int SM2_set_verify_cache_size(size_t num);
+
+/*
+ * A SM2_PRESIGN_POOL holds up to max nonces k of a group together with the
+ * x-coordinate of kG, the part of a signature that does not depend on the
+ * message or the key. SM2_PRESIGN_POOL_refill() fills it, e.g. at idle
+ * time or from a worker thread, running concurrently with the signers.
+ * SM2_set_presign_pool() attaches a pool to ec_key, which takes a reference
+ * and must not run concurrently with other uses of ec_key. Signing with
+ * ec_key then takes a nonce out of the pool without locking, or computes
+ * one as usual when the pool is empty. A nonce is never handed out twice.
+ */
+typedef struct sm2_presign_pool_st SM2_PRESIGN_POOL;
+
+SM2_PRESIGN_POOL *SM2_PRESIGN_POOL_new(const EC_GROUP *group, size_t max);
+int SM2_PRESIGN_POOL_up_ref(SM2_PRESIGN_POOL *pool);
+void SM2_PRESIGN_POOL_free(SM2_PRESIGN_POOL *pool);
+int SM2_PRESIGN_POOL_refill(SM2_PRESIGN_POOL *pool);
+size_t SM2_PRESIGN_POOL_num(SM2_PRESIGN_POOL *pool);
+int SM2_set_presign_pool(EC_KEY *ec_key, SM2_PRESIGN_POOL *pool);
+
+/*
+ * SM2 signature on sm2p256v1 with fixed size values and no allocation.
+ * Scalars are four little-endian 64-bit words, the digest is 32 bytes and
+ * the public key is the uncompressed point 04 || x || y. Signing only needs
+ * dinv = (1 + d)^-1 from SM2_P256_sign_setup(). SM2_sign() and SM2_verify()
+ * use the same code for sm2p256v1 keys when it is available.
+ */
+#define SM2_P256_POINT_LENGTH		65
+
+int SM2_P256_sign_setup(uint64_t dinv[4], const uint64_t d[4]);
+int SM2_P256_sign_ex(uint64_t r[4], uint64_t s[4],
+	const unsigned char dgst[32], const uint64_t k[4],
+	const uint64_t dinv[4]);
+int SM2_P256_sign(uint64_t r[4], uint64_t s[4],
+	const unsigned char dgst[32], const uint64_t dinv[4]);
+int SM2_P256_verify(const unsigned char dgst[32],
+	const uint64_t r[4], const uint64_t s[4],
+	const unsigned char point[SM2_P256_POINT_LENGTH]);
+
 /* SM2 Public Key Encryption */
 
 typedef struct SM2CiphertextValue_st SM2CiphertextValue;
@@ -139,6 +199,44 @@ int SM2_decrypt(int type, const unsigned char *in, size_t inlen,
 #define SM2_decrypt_with_recommended(in,inlen,out,outlen,ec_key) \
 	SM2_decrypt(NID_sm3,in,inlen,out,outlen,ec_key)
 
+/*
+ * Raw ciphertexts are the uncompressed point C1 followed by C3 and C2 as in
+ * GM/T 0003-2012, or by C2 and C3 as in the older drafts and i2o. They have
+ * no length limit and are written straight into the caller's buffer.
+ */
+#define SM2_CIPHERTEXT_C1C3C2	0
+#define SM2_CIPHERTEXT_C1C2C3	1
+
+int SM2_encrypt_raw(const EVP_MD *md, int format,
+	const unsigned char *in, size_t inlen,
+	unsigned char *out, size_t *outlen, EC_KEY *ec_key);
+int SM2_decrypt_raw(const EVP_MD *md, int format,
+	const unsigned char *in, size_t inlen,
+	unsigned char *out, size_t *outlen, EC_KEY *ec_key);
+
+/*
+ * Streaming encryption: init writes C1, each update turns the next part of
+ * M into the same number of bytes of C2 and final writes C3. The key stream
+ * is derived block by block, so M is only bounded by the 32-bit counter of
+ * the KDF. Decryption output is not authenticated until SM2_decrypt_final()
+ * has checked C3, callers must not release it before then.
+ */
+typedef struct sm2_enc_ctx_st SM2_ENC_CTX;
+
+SM2_ENC_CTX *SM2_ENC_CTX_new(void);
+void SM2_ENC_CTX_free(SM2_ENC_CTX *ctx);
+int SM2_encrypt_init(SM2_ENC_CTX *ctx, const EVP_MD *md, EC_KEY *ec_key,
+	unsigned char *c1, size_t *c1len);
+int SM2_encrypt_update(SM2_ENC_CTX *ctx, unsigned char *out,
+	const unsigned char *in, size_t inlen);
+int SM2_encrypt_final(SM2_ENC_CTX *ctx, unsigned char *c3, size_t *c3len);
+int SM2_decrypt_init(SM2_ENC_CTX *ctx, const EVP_MD *md, EC_KEY *ec_key,
+	const unsigned char *c1, size_t c1len);
+int SM2_decrypt_update(SM2_ENC_CTX *ctx, unsigned char *out,
+	const unsigned char *in, size_t inlen);
+int SM2_decrypt_final(SM2_ENC_CTX *ctx, const unsigned char *c3,
+	size_t c3len);
+
 /* SM2 Key Exchange */
 
 int SM2_compute_share_key(unsigned char *out, size_t *outlen,
@@ -161,6 +259,23 @@ int SM2_KAP_final_check(SM2_KAP_CTX *ctx, const unsigned char *checksum,
 	size_t checksumlen);
 void SM2_KAP_CTX_cleanup(SM2_KAP_CTX *ctx);
 
+/*
+ * A SM2_KAP_POOL holds up to max precomputed ephemeral pairs (r, rG) of a
+ * group. SM2_KAP_POOL_refill() fills it, e.g. at idle time or from a worker
+ * thread, and SM2_KAP_prepare() takes one pair out of the pool set on its
+ * context, or computes rG itself when the pool is empty. A pair is never
+ * handed out twice. SM2_KAP_CTX_set_pool() takes a reference to the pool,
+ * which is released by SM2_KAP_CTX_cleanup().
+ */
+typedef struct sm2_kap_pool_st SM2_KAP_POOL;
+
+SM2_KAP_POOL *SM2_KAP_POOL_new(const EC_GROUP *group, size_t max);
+int SM2_KAP_POOL_up_ref(SM2_KAP_POOL *pool);
+void SM2_KAP_POOL_free(SM2_KAP_POOL *pool);
+int SM2_KAP_POOL_refill(SM2_KAP_POOL *pool);
+size_t SM2_KAP_POOL_num(SM2_KAP_POOL *pool);
+int SM2_KAP_CTX_set_pool(SM2_KAP_CTX *ctx, SM2_KAP_POOL *pool);
+
 
 /* EC_KEY_METHOD */
 const EC_KEY_METHOD *EC_KEY_GmSSL(void);
@@ -269,12 +384,32 @@ int ERR_load_SM2_strings(void);
 # define SM2_F_SM2_COSIGNER2_GENERATE_PROOF               114
 # define SM2_F_SM2_COSIGNER2_SETUP                        115
 # define SM2_F_SM2_DECRYPT                                100
+# define SM2_F_SM2_DECRYPT_FINAL                          123
+# define SM2_F_SM2_DECRYPT_INIT                           124
+# define SM2_F_SM2_DECRYPT_RAW                            125
+# define SM2_F_SM2_DECRYPT_UPDATE                         126
 # define SM2_F_SM2_DO_DECRYPT                             101
 # define SM2_F_SM2_DO_ENCRYPT                             102
 # define SM2_F_SM2_DO_SIGN                                104
 # define SM2_F_SM2_DO_VERIFY                              105
 # define SM2_F_SM2_ENCRYPT                                103
+# define SM2_F_SM2_ENCRYPT_FINAL                          127
+# define SM2_F_SM2_ENCRYPT_INIT                           128
+# define SM2_F_SM2_ENCRYPT_RAW                            129
+# define SM2_F_SM2_ENCRYPT_UPDATE                         130
+# define SM2_F_SM2_ENC_CTX_NEW                            131
+# define SM2_F_SM2_ENC_CTX_XOR                            132
+# define SM2_F_SM2_P256_SIGN                              116
+# define SM2_F_SM2_P256_SIGN_EX                           117
+# define SM2_F_SM2_P256_SIGN_SETUP                        118
+# define SM2_F_SM2_P256_VERIFY                            119
+# define SM2_F_SM2_PRESIGN_POOL_NEW                       133
+# define SM2_F_SM2_PRESIGN_POOL_REFILL                    134
+# define SM2_F_SM2_SET_PRESIGN_POOL                       135
+# define SM2_F_SM2_SET_VERIFY_CACHE_SIZE                  122
 # define SM2_F_SM2_SIGN_SETUP                             106
+# define SM2_F_SM2_VERIFY_BATCH                           120
+# define SM2_F_SM2_VERIFY_PRECOMPUTE                      121
 
 /* Reason codes. */
 # define SM2_R_BAD_SIGNATURE                              110
@@ -282,15 +417,18 @@ int ERR_load_SM2_strings(void);
 # define SM2_R_DECRYPT_FAILURE                            101
 # define SM2_R_ENCRYPT_FAILURE                            102
 # define SM2_R_INVALID_CIPHERTEXT                         103
+# define SM2_R_INVALID_CIPHERTEXT_FORMAT                  117
 # define SM2_R_INVALID_DIGEST_ALGOR                       104
 # define SM2_R_INVALID_EC_KEY                             105
 # define SM2_R_INVALID_INPUT_LENGTH                       106
 # define SM2_R_INVALID_PLAINTEXT_LENGTH                   107
+# define SM2_R_INVALID_PRIVATE_KEY                        116
 # define SM2_R_INVALID_PUBLIC_KEY                         108
 # define SM2_R_KDF_FAILURE                                109
 # define SM2_R_MISSING_PARAMETERS                         111
 # define SM2_R_NEED_NEW_SETUP_VALUES                      112
 # define SM2_R_NOT_IMPLEMENTED                            115
+# define SM2_R_NOT_INITIALIZED                            118
 # define SM2_R_PLAINTEXT_TOO_LONG                         114
 # define SM2_R_RANDOM_NUMBER_GENERATION_FAILED            113
 
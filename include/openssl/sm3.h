@@ -82,6 +82,12 @@ void sm3_compress(uint32_t digest[8], const unsigned char block[SM3_BLOCK_SIZE])
 void sm3(const unsigned char *data, size_t datalen,
 	unsigned char digest[SM3_DIGEST_LENGTH]);
 
+/* hash up to SM3_MB_LANES independent messages in parallel */
+#define SM3_MB_LANES		8
+
+void sm3_mb(const unsigned char *const data[], const size_t datalen[],
+	unsigned char *const digest[], size_t num);
+
 int  sm3_sm2_init(sm3_ctx_t *ctx, const char *id,
 	const unsigned char x[32], const unsigned char y[32]);
 void sm3_compute_id_digest(unsigned char z[32], const char *id,
@@ -117,6 +117,17 @@ int SM9_verify(int type,
 	const unsigned char *sig, size_t siglen,
 	SM9PublicParameters *mpk, const char *id, size_t idlen);
 
+/*
+ * Verifies num signatures under mpk, ok[i] is set to 1 if signature i is
+ * valid, 0 if it is not and -1 on error. Returns 1 if all signatures are
+ * valid, 0 if any is not and -1 if the batch could not be processed.
+ */
+int SM9_verify_batch(int type,
+	const unsigned char *const data[], const size_t datalen[],
+	const unsigned char *const sig[], const size_t siglen[],
+	const char *const id[], const size_t idlen[], size_t num,
+	SM9PublicParameters *mpk, int *ok);
+
 int SM9_SignInit(EVP_MD_CTX *ctx, const EVP_MD *md, ENGINE *engine);
 #define SM9_SignUpdate(ctx,d,l) EVP_DigestUpdate(ctx,d,l)
 SM9Signature *SM9_SignFinal(EVP_MD_CTX *ctx, SM9PrivateKey *sk);
@@ -322,7 +333,9 @@ int ERR_load_SM9_strings(void);
 # define SM9_F_SM9_EXTRACT_PUBLIC_PARAMETERS              119
 # define SM9_F_SM9_GENERATE_KEY_EXCHANGE                  120
 # define SM9_F_SM9_GENERATE_MASTER_SECRET                 121
+# define SM9_F_SM9_GT_TABLE_NEW                           142
 # define SM9_F_SM9_KEY_NEW                                122
+# define SM9_F_SM9_LINE_TABLE_NEW                         144
 # define SM9_F_SM9_MASTER_KEY_EXTRACT_KEY                 123
 # define SM9_F_SM9_MASTER_KEY_NEW                         124
 # define SM9_F_SM9_MASTER_OLD_PRIV_DECODE                 125
@@ -338,6 +351,7 @@ int ERR_load_SM9_strings(void);
 # define SM9_F_SM9_SIGNINIT                               135
 # define SM9_F_SM9_UNWRAP_KEY                             136
 # define SM9_F_SM9_VERIFY                                 137
+# define SM9_F_SM9_VERIFY_BATCH                           143
 # define SM9_F_SM9_VERIFYFINAL                            138
 # define SM9_F_SM9_VERIFYINIT                             139
 # define SM9_F_SM9_WRAP_KEY                               140
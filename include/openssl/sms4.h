@@ -97,6 +97,43 @@ int sms4_unwrap_key(sms4_key_t *key, const unsigned char *iv,
 void sms4_ctr32_encrypt_blocks(const unsigned char *in, unsigned char *out,
 	size_t blocks, const sms4_key_t *key, const unsigned char iv[16]);
 
+/*
+ * CBC encryption of up to SMS4_CBC_MAX_STREAMS independent messages under
+ * one key at a time, such as several records of a connection, with the
+ * blocks of the different streams encrypted in parallel. Each iv is left
+ * as the last ciphertext block of its stream.
+ */
+# define SMS4_CBC_MAX_STREAMS	32
+
+typedef struct {
+	const unsigned char *in;
+	unsigned char *out;
+	size_t blocks;
+	unsigned char iv[SMS4_IV_LENGTH];
+} sms4_cbc_stream_t;
+
+void sms4_cbc_encrypt_streams(sms4_cbc_stream_t *streams, size_t n,
+	const sms4_key_t *key);
+
+/*
+ * Bitsliced implementation without table lookups, the running time does
+ * not depend on the key or the data. It works on 64 (or 256 with AVX2)
+ * blocks at a time, the EVP ciphers use it for inputs of at least
+ * SMS4_BS_MIN_BLOCKS blocks.
+ */
+# define SMS4_BS_MIN_BLOCKS	64
+
+void sms4_bs_ecb_encrypt_blocks(const unsigned char *in, unsigned char *out,
+	size_t blocks, const sms4_key_t *key);
+void sms4_bs_ctr32_encrypt_blocks(const unsigned char *in, unsigned char *out,
+	size_t blocks, const sms4_key_t *key, const unsigned char iv[16]);
+void sms4_bs_xts_encrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key1, const sms4_key_t *key2,
+	const unsigned char iv[16]);
+void sms4_bs_xts_decrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const sms4_key_t *key1, const sms4_key_t *key2,
+	const unsigned char iv[16]);
+
 
 # define SMS4_EDE_KEY_LENGTH	(SMS4_KEY_LENGTH * 3)
 
@@ -104,6 +104,34 @@ ZUC_UINT32 ZUC_eia_generate_mac(const ZUC_UINT32 *data, size_t nbits,
 	const unsigned char user_key[16], ZUC_UINT32 count, ZUC_UINT5 bearer,
 	ZUC_BIT direction);
 
+/*
+ * Many packets, each with its own key, count, bearer and direction. The
+ * jobs run on parallel ZUC lanes when the CPU has SIMD lanes for them,
+ * and the calls return when all of them are done.
+ */
+typedef struct ZUC_EEA_JOB_st {
+	const ZUC_UINT32 *in;
+	ZUC_UINT32 *out;
+	size_t nbits;
+	const unsigned char *key;
+	ZUC_UINT32 count;
+	ZUC_UINT5 bearer;
+	ZUC_BIT direction;
+} ZUC_EEA_JOB;
+
+typedef struct ZUC_EIA_JOB_st {
+	const ZUC_UINT32 *data;
+	size_t nbits;
+	const unsigned char *key;
+	ZUC_UINT32 count;
+	ZUC_UINT5 bearer;
+	ZUC_BIT direction;
+	ZUC_UINT32 mac;		/* output */
+} ZUC_EIA_JOB;
+
+void ZUC_eea_encrypt_multi(const ZUC_EEA_JOB *jobs, size_t njobs);
+void ZUC_eia_generate_mac_multi(ZUC_EIA_JOB *jobs, size_t njobs);
+
 # define ZUC256_KEY_LENGTH	32
 # define ZUC256_IV_LENGTH	23
 # define ZUC256_MAC32_LENGTH	4
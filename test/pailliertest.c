@@ -158,6 +158,11 @@ static int test_paillier(int verbose)
 		printf("m1 + m2 = %lu\n", n);
 	}
 
+	if (n != BN_get_word(m1) + BN_get_word(m2)) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+
 	ret = 1;
 
 end:
@@ -176,11 +181,233 @@ end:
 	return ret;
 }
 
+/* the PaillierPrivateKey encoding without the optional p and q */
+static int encode_key_without_factors(PAILLIER *key, unsigned char **out)
+{
+	int ret = 0;
+	unsigned char *der = NULL;
+	const unsigned char *cp;
+	const unsigned char *body;
+	unsigned char *p;
+	long len, elen;
+	int derlen, tag, xclass, i;
+
+	if ((derlen = i2d_PaillierPrivateKey(key, &der)) <= 0) {
+		goto end;
+	}
+	cp = der;
+	if (ASN1_get_object(&cp, &len, &tag, &xclass, derlen) & 0x80) {
+		goto end;
+	}
+	body = cp;
+	/* keep n, lambda and x */
+	for (i = 0; i < 3; i++) {
+		if (ASN1_get_object(&cp, &elen, &tag, &xclass, len) & 0x80) {
+			goto end;
+		}
+		cp += elen;
+	}
+	len = cp - body;
+
+	if (!(*out = OPENSSL_malloc(ASN1_object_size(1, len, V_ASN1_SEQUENCE)))) {
+		goto end;
+	}
+	p = *out;
+	ASN1_put_object(&p, 1, len, V_ASN1_SEQUENCE, V_ASN1_UNIVERSAL);
+	memcpy(p, body, len);
+	ret = (int)(p + len - *out);
+
+end:
+	OPENSSL_free(der);
+	return ret;
+}
+
+/* CRT decryption against the full-size path of a key without p and q */
+static int test_paillier_crt(int verbose)
+{
+	int ret = 0;
+	PAILLIER *key = NULL;
+	PAILLIER *key2 = NULL;
+	PAILLIER *key3 = NULL;
+	BIGNUM *m = NULL;
+	BIGNUM *c = NULL;
+	BIGNUM *r = NULL;
+	unsigned char *der = NULL;
+	unsigned char *der2 = NULL;
+	const unsigned char *cp;
+	int derlen, i;
+
+	m = BN_new();
+	c = BN_new();
+	r = BN_new();
+	if (!m || !c || !r || !(key = PAILLIER_new())
+		|| !PAILLIER_generate_key(key, 1024)) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		ERR_print_errors_fp(stderr);
+		goto end;
+	}
+
+	/* decoded with p and q */
+	if ((derlen = i2d_PaillierPrivateKey(key, &der)) <= 0) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+	cp = der;
+	if (!(key2 = d2i_PaillierPrivateKey(NULL, &cp, derlen))) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		ERR_print_errors_fp(stderr);
+		goto end;
+	}
+
+	/* and in the old encoding */
+	if ((derlen = encode_key_without_factors(key, &der2)) <= 0) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+	cp = der2;
+	if (!(key3 = d2i_PaillierPrivateKey(NULL, &cp, derlen))) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		ERR_print_errors_fp(stderr);
+		goto end;
+	}
+
+	for (i = 0; i < 8; i++) {
+		if (!BN_rand(m, 1000 - 100 * i, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY)
+			|| !PAILLIER_encrypt(c, m, key)) {
+			fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+			ERR_print_errors_fp(stderr);
+			goto end;
+		}
+		if (!PAILLIER_decrypt(r, c, key) || BN_cmp(r, m) != 0
+			|| !PAILLIER_decrypt(r, c, key2) || BN_cmp(r, m) != 0
+			|| !PAILLIER_decrypt(r, c, key3) || BN_cmp(r, m) != 0) {
+			fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+			ERR_print_errors_fp(stderr);
+			goto end;
+		}
+	}
+
+	ret = 1;
+
+end:
+	if (verbose) {
+		printf("%s %s\n", __FUNCTION__,
+			ret == 1 ? "passed" : "failed");
+	}
+	PAILLIER_free(key);
+	PAILLIER_free(key2);
+	PAILLIER_free(key3);
+	BN_free(m);
+	BN_free(c);
+	BN_free(r);
+	OPENSSL_free(der);
+	OPENSSL_free(der2);
+	return ret;
+}
+
+/* encryption with precomputed r^n and the homomorphic operations */
+static int test_paillier_precompute(int verbose)
+{
+	int ret = 0;
+	PAILLIER *key = NULL;
+	BIGNUM *m[10] = {NULL};
+	BIGNUM *c[10] = {NULL};
+	BIGNUM *r = NULL;
+	BIGNUM *k = NULL;
+	BIGNUM *t = NULL;
+	BN_CTX *bn_ctx = NULL;
+	int i;
+
+	r = BN_new();
+	k = BN_new();
+	t = BN_new();
+	bn_ctx = BN_CTX_new();
+	for (i = 0; i < 10; i++) {
+		m[i] = BN_new();
+		c[i] = BN_new();
+		if (!m[i] || !c[i]
+			|| !BN_rand(m[i], 100 * i, BN_RAND_TOP_ANY, BN_RAND_BOTTOM_ANY)) {
+			fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+			goto end;
+		}
+	}
+	if (!r || !k || !t || !bn_ctx || !(key = PAILLIER_new())
+		|| !PAILLIER_generate_key(key, 1024)
+		|| !BN_set_word(k, 12345)) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		ERR_print_errors_fp(stderr);
+		goto end;
+	}
+
+	/* eight from the pool, the rest computed online */
+	if (!PAILLIER_precompute(key, 3) || !PAILLIER_precompute(key, 5)
+		|| PAILLIER_num_precomputed(key) != 8) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		ERR_print_errors_fp(stderr);
+		goto end;
+	}
+	for (i = 0; i < 10; i++) {
+		if (!PAILLIER_encrypt(c[i], m[i], key)
+			|| !PAILLIER_decrypt(r, c[i], key) || BN_cmp(r, m[i]) != 0) {
+			fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+			ERR_print_errors_fp(stderr);
+			goto end;
+		}
+	}
+	if (PAILLIER_num_precomputed(key) != 0) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	/* two ciphertexts add up, and one is multiplied by k */
+	if (!PAILLIER_ciphertext_add(r, c[8], c[9], key)
+		|| !PAILLIER_decrypt(r, r, key)
+		|| !BN_add(t, m[8], m[9]) || BN_cmp(r, t) != 0) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		ERR_print_errors_fp(stderr);
+		goto end;
+	}
+	if (!PAILLIER_ciphertext_scalar_mul(r, k, c[9], key)
+		|| !PAILLIER_decrypt(r, r, key)
+		|| !BN_mul(t, m[9], k, bn_ctx) || BN_cmp(r, t) != 0) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		ERR_print_errors_fp(stderr);
+		goto end;
+	}
+
+	/* plaintexts must be in [0, n) */
+	BN_set_negative(m[1], 1);
+	if (PAILLIER_encrypt(c[1], m[1], key)) {
+		fprintf(stderr, "%s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+	ERR_clear_error();
+
+	ret = 1;
+
+end:
+	if (verbose) {
+		printf("%s %s\n", __FUNCTION__,
+			ret == 1 ? "passed" : "failed");
+	}
+	PAILLIER_free(key);
+	for (i = 0; i < 10; i++) {
+		BN_free(m[i]);
+		BN_free(c[i]);
+	}
+	BN_free(r);
+	BN_free(k);
+	BN_free(t);
+	BN_CTX_free(bn_ctx);
+	return ret;
+}
+
 int main(int argc, char **argv)
 {
 	int err = 0;
 	if (!test_paillier(2)) err++;
-	// FIXME: return err;
-	return 0;
+	if (!test_paillier_crt(2)) err++;
+	if (!test_paillier_precompute(2)) err++;
+	return err;
 }
 #endif
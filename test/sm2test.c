@@ -406,6 +406,651 @@ err:
 	return ret;
 }
 
+static int hex2words(uint64_t a[4], const char *hex)
+{
+	unsigned char buf[32];
+	BIGNUM *bn = NULL;
+	int i, ret;
+
+	if ((ret = BN_hex2bn(&bn, hex) && BN_bn2binpad(bn, buf, 32) == 32)) {
+		memset(a, 0, sizeof(uint64_t) * 4);
+		for (i = 0; i < 32; i++) {
+			a[i / 8] |= (uint64_t)buf[31 - i] << (8 * (i % 8));
+		}
+	}
+	BN_free(bn);
+	return ret;
+}
+
+static int hexequwords(const char *hex, const uint64_t a[4])
+{
+	unsigned char buf[32];
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		buf[31 - i] = (unsigned char)(a[i / 8] >> (8 * (i % 8)));
+	}
+	return hexequbin(hex, buf, sizeof(buf));
+}
+
+/*
+ * sm2p256v1 keys sign and verify through the fixed size code, check it
+ * against the generic code on an explicit copy of the same curve.
+ */
+static int test_sm2_p256(const EC_GROUP *generic,
+	const char *sk, const char *xP, const char *yP,
+	const char *e, const char *k, const char *r, const char *s)
+{
+	int ret = 0;
+	EC_GROUP *group = NULL;
+	EC_KEY *ec_key = NULL;
+	EC_KEY *generic_key = NULL;
+	unsigned char dgst[32];
+	unsigned char sig[SM2_MAX_SIGNATURE_LENGTH];
+	unsigned char generic_sig[SM2_MAX_SIGNATURE_LENGTH];
+	unsigned int siglen, generic_siglen;
+	unsigned char point[SM2_P256_POINT_LENGTH];
+	uint64_t d[4], kk[4], ee[4], dinv[4], rr[4], ss[4], dd[4];
+	const char *bad_keys[] = {
+		"00",
+		"FFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFF7203DF6B21C6052B53BBF40939D54122",
+		"FFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFF7203DF6B21C6052B53BBF40939D54123",
+		"FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF",
+	};
+	size_t i;
+
+	if (!(group = EC_GROUP_new_by_curve_name(NID_sm2p256v1))
+		|| !(ec_key = new_ec_key(group, sk, xP, yP))
+		|| !(generic_key = new_ec_key(generic, sk, xP, yP))
+		|| !hex2words(d, sk) || !hex2words(kk, k) || !hex2words(ee, e)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+	for (i = 0; i < 32; i++) {
+		dgst[31 - i] = (unsigned char)(ee[i / 8] >> (8 * (i % 8)));
+	}
+
+	/* same k, same signature */
+	change_rand(k);
+	siglen = sizeof(sig);
+	generic_siglen = sizeof(generic_sig);
+	if (!SM2_sign(NID_undef, dgst, sizeof(dgst), sig, &siglen, ec_key)
+		|| !SM2_sign(NID_undef, dgst, sizeof(dgst), generic_sig,
+			&generic_siglen, generic_key)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+	restore_rand();
+	if (siglen != generic_siglen || memcmp(sig, generic_sig, siglen)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	/* fresh signatures verify on both sides */
+	siglen = sizeof(sig);
+	if (!SM2_sign(NID_undef, dgst, sizeof(dgst), sig, &siglen, ec_key)
+		|| 1 != SM2_verify(NID_undef, dgst, sizeof(dgst), sig, siglen, ec_key)
+		|| 1 != SM2_verify(NID_undef, dgst, sizeof(dgst), sig, siglen, generic_key)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+	dgst[0] ^= 1;
+	if (0 != SM2_verify(NID_undef, dgst, sizeof(dgst), sig, siglen, ec_key)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+	dgst[0] ^= 1;
+
+	/* the fixed size interface, if this build has it */
+	if (!SM2_P256_sign_setup(dinv, d)) {
+		if (ERR_GET_REASON(ERR_peek_last_error()) == SM2_R_NOT_IMPLEMENTED) {
+			ERR_clear_error();
+			ret = 1;
+		}
+		goto err;
+	}
+	/* d must be in [1, n - 2] */
+	for (i = 0; i < sizeof(bad_keys)/sizeof(bad_keys[0]); i++) {
+		if (!hex2words(dd, bad_keys[i]) || SM2_P256_sign_setup(rr, dd)) {
+			fprintf(stderr, "error: %s %d: %s\n", __FUNCTION__, __LINE__,
+				bad_keys[i]);
+			goto err;
+		}
+	}
+	ERR_clear_error();
+	if (!hex2words(dd, "FFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFF7203DF6B21C6052B53BBF40939D54121")
+		|| !SM2_P256_sign_setup(rr, dd)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	if (!SM2_P256_sign_ex(rr, ss, dgst, kk, dinv)
+		|| !hexequwords(r, rr) || !hexequwords(s, ss)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	if (EC_POINT_point2oct(group, EC_KEY_get0_public_key(ec_key),
+		POINT_CONVERSION_UNCOMPRESSED, point, sizeof(point), NULL)
+		!= sizeof(point)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+	if (1 != SM2_P256_verify(dgst, rr, ss, point)
+		|| !SM2_P256_sign(rr, ss, dgst, dinv)
+		|| 1 != SM2_P256_verify(dgst, rr, ss, point)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+	ss[0] ^= 1;
+	if (0 != SM2_P256_verify(dgst, rr, ss, point)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	ret = 1;
+err:
+	restore_rand();
+	EC_GROUP_free(group);
+	EC_KEY_free(ec_key);
+	EC_KEY_free(generic_key);
+	return ret;
+}
+
+/*
+ * Scalar multiplications on sm2p256v1 go through the field, point and
+ * table code of the fixed size method, which is assembly on x86_64.
+ * Compare them with the generic code for edge and random scalars, for
+ * the generator, another point and both.
+ */
+#define SM2_MUL_TEST_NUM	16
+
+static int sm2_p256_point_equ(const EC_GROUP *group, const EC_POINT *a,
+	const EC_GROUP *generic, const EC_POINT *b, BN_CTX *ctx)
+{
+	unsigned char buf[2][SM2_P256_POINT_LENGTH];
+	size_t len[2];
+
+	len[0] = EC_POINT_point2oct(group, a, POINT_CONVERSION_UNCOMPRESSED,
+		buf[0], sizeof(buf[0]), ctx);
+	len[1] = EC_POINT_point2oct(generic, b, POINT_CONVERSION_UNCOMPRESSED,
+		buf[1], sizeof(buf[1]), ctx);
+	return len[0] && len[0] == len[1] && !memcmp(buf[0], buf[1], len[0]);
+}
+
+static int test_sm2_p256_mul(const EC_GROUP *generic)
+{
+	int ret = 0;
+	const char *scalars[] = {
+		"0",
+		"1",
+		"2",
+		"3",
+		"40",
+		"FFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFF7203DF6B21C6052B53BBF40939D54122",
+		"FFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFF7203DF6B21C6052B53BBF40939D54121",
+		"7FFFFFFF7FFFFFFFFFFFFFFFFFFFFFFFB901EFB590E30295A9DDFA049CEAA092",
+		"FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF",
+		"8000000000000000000000000000000000000000000000000000000000000000",
+	};
+	EC_GROUP *group = NULL;
+	EC_GROUP *precomp = NULL;
+	EC_POINT *P[2] = {NULL, NULL};
+	EC_POINT *gP[2] = {NULL, NULL};
+	EC_POINT *r = NULL;
+	EC_POINT *gr = NULL;
+	BIGNUM *k = NULL;
+	BIGNUM *m = NULL;
+	BN_CTX *ctx = NULL;
+	unsigned char buf[SM2_P256_POINT_LENGTH];
+	const EC_POINT *points[2];
+	const EC_POINT *gpoints[2];
+	const BIGNUM *ks[2];
+	size_t i, j;
+
+	if (!(ctx = BN_CTX_new())
+		|| !(group = EC_GROUP_new_by_curve_name(NID_sm2p256v1))
+		|| !(precomp = EC_GROUP_dup(group))
+		|| !EC_GROUP_precompute_mult(precomp, ctx)
+		|| !(r = EC_POINT_new(group)) || !(gr = EC_POINT_new(generic))
+		|| !(k = BN_new()) || !(m = BN_new())) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	/* two points other than the generator, copied into both groups */
+	for (j = 0; j < 2; j++) {
+		if (!(P[j] = EC_POINT_new(group)) || !(gP[j] = EC_POINT_new(generic))
+			|| !BN_rand_range(k, EC_GROUP_get0_order(generic))
+			|| !EC_POINT_mul(generic, gP[j], k, NULL, NULL, ctx)
+			|| EC_POINT_point2oct(generic, gP[j],
+				POINT_CONVERSION_UNCOMPRESSED, buf, sizeof(buf), ctx)
+				!= sizeof(buf)
+			|| !EC_POINT_oct2point(group, P[j], buf, sizeof(buf), ctx)) {
+			fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+			goto err;
+		}
+		points[j] = P[j];
+		gpoints[j] = gP[j];
+	}
+
+	for (i = 0; i < OSSL_NELEM(scalars) + SM2_MUL_TEST_NUM; i++) {
+		if (i < OSSL_NELEM(scalars)) {
+			if (!BN_hex2bn(&k, scalars[i])) {
+				fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+				goto err;
+			}
+		} else if (!BN_rand_range(k, EC_GROUP_get0_order(generic))) {
+			fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+			goto err;
+		}
+		if (!BN_rand_range(m, EC_GROUP_get0_order(generic))) {
+			fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+			goto err;
+		}
+		ks[0] = m;
+		ks[1] = k;
+
+		/* k*G, with the built-in and with a computed table */
+		if (!EC_POINT_mul(generic, gr, k, NULL, NULL, ctx)
+			|| !EC_POINT_mul(group, r, k, NULL, NULL, ctx)
+			|| !sm2_p256_point_equ(group, r, generic, gr, ctx)
+			|| !EC_POINT_mul(precomp, r, k, NULL, NULL, ctx)
+			|| !sm2_p256_point_equ(precomp, r, generic, gr, ctx)) {
+			fprintf(stderr, "error: %s %d: %d\n", __FUNCTION__, __LINE__,
+				(int)i);
+			goto err;
+		}
+
+		/* k*P */
+		if (!EC_POINT_mul(generic, gr, NULL, gP[0], k, ctx)
+			|| !EC_POINT_mul(group, r, NULL, P[0], k, ctx)
+			|| !sm2_p256_point_equ(group, r, generic, gr, ctx)) {
+			fprintf(stderr, "error: %s %d: %d\n", __FUNCTION__, __LINE__,
+				(int)i);
+			goto err;
+		}
+
+		/* k*G + m*P and k*G + m*P + k*Q */
+		if (!EC_POINT_mul(generic, gr, k, gP[0], m, ctx)
+			|| !EC_POINT_mul(group, r, k, P[0], m, ctx)
+			|| !sm2_p256_point_equ(group, r, generic, gr, ctx)
+			|| !EC_POINTs_mul(generic, gr, k, 2, gpoints, ks, ctx)
+			|| !EC_POINTs_mul(group, r, k, 2, points, ks, ctx)
+			|| !sm2_p256_point_equ(group, r, generic, gr, ctx)) {
+			fprintf(stderr, "error: %s %d: %d\n", __FUNCTION__, __LINE__,
+				(int)i);
+			goto err;
+		}
+	}
+
+	ret = 1;
+err:
+	EC_GROUP_free(group);
+	EC_GROUP_free(precomp);
+	EC_POINT_free(P[0]);
+	EC_POINT_free(P[1]);
+	EC_POINT_free(gP[0]);
+	EC_POINT_free(gP[1]);
+	EC_POINT_free(r);
+	EC_POINT_free(gr);
+	BN_free(k);
+	BN_free(m);
+	BN_CTX_free(ctx);
+	return ret;
+}
+
+/* Z = H(ENTL || ID || a || b || xG || yG || xA || yA) the long way */
+static int sm2_id_digest_ref(const EVP_MD *md, const char *id,
+	unsigned char *z, EC_KEY *ec_key)
+{
+	unsigned char buf[512];
+	size_t idlen = strlen(id);
+	size_t len = sizeof(buf) - 2 - idlen;
+	unsigned int zlen;
+
+	buf[0] = (unsigned char)((idlen * 8) >> 8);
+	buf[1] = (unsigned char)(idlen * 8);
+	memcpy(buf + 2, id, idlen);
+	return SM2_get_public_key_data(ec_key, buf + 2 + idlen, &len)
+		&& EVP_Digest(buf, 2 + idlen + len, z, &zlen, md, NULL);
+}
+
+/*
+ * Z values of sm2p256v1 keys with the default and other IDs and digests,
+ * computed again after they are cached and after the public key changed.
+ */
+static int test_sm2_id_digest(void)
+{
+	int ret = 0;
+	const char *ids[] = {SM2_DEFAULT_ID, "ALICE123@YAHOO.COM", SM2_DEFAULT_ID};
+	const EVP_MD *mds[3];
+	EC_KEY *ec_key = NULL;
+	EC_KEY *other = NULL;
+	unsigned char z[EVP_MAX_MD_SIZE];
+	unsigned char ref[EVP_MAX_MD_SIZE];
+	size_t zlen;
+	int i, j;
+
+	mds[0] = EVP_sm3();
+	mds[1] = EVP_sm3();
+	mds[2] = EVP_sha256();
+
+	if (!(ec_key = EC_KEY_new_by_curve_name(NID_sm2p256v1))
+		|| !EC_KEY_generate_key(ec_key)
+		|| !(other = EC_KEY_new_by_curve_name(NID_sm2p256v1))
+		|| !EC_KEY_generate_key(other)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	for (j = 0; j < 3; j++) {
+		/* the last round is with another public key on the same EC_KEY */
+		if (j == 2 && !EC_KEY_set_public_key(ec_key,
+			EC_KEY_get0_public_key(other))) {
+			fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+			goto err;
+		}
+		for (i = 0; i < 3; i++) {
+			zlen = sizeof(z);
+			if (!SM2_compute_id_digest(mds[i], ids[i], strlen(ids[i]),
+				z, &zlen, ec_key)
+				|| zlen != (size_t)EVP_MD_size(mds[i])
+				|| !sm2_id_digest_ref(mds[i], ids[i], ref, ec_key)
+				|| memcmp(z, ref, zlen)) {
+				fprintf(stderr, "error: %s %d: %d %d\n", __FUNCTION__,
+					__LINE__, j, i);
+				goto err;
+			}
+		}
+	}
+
+	ret = 1;
+err:
+	EC_KEY_free(ec_key);
+	EC_KEY_free(other);
+	return ret;
+}
+
+/*
+ * Signatures under a few keys, some of them with more than one EC_KEY, one
+ * with too few signatures for a full table and one on a curve without the
+ * fixed size code, verified in one batch.
+ */
+#define SM2_BATCH_TEST_NUM	70
+
+static int test_sm2_verify_batch(const EC_GROUP *other)
+{
+	int ret = 0;
+	EC_GROUP *group = NULL;
+	EC_KEY *keys[5] = {NULL, NULL, NULL, NULL, NULL};
+	EC_KEY *ec_keys[SM2_BATCH_TEST_NUM];
+	unsigned char dgst[SM2_BATCH_TEST_NUM][32];
+	unsigned char sig[SM2_BATCH_TEST_NUM][SM2_MAX_SIGNATURE_LENGTH];
+	const unsigned char *dgsts[SM2_BATCH_TEST_NUM];
+	const unsigned char *sigs[SM2_BATCH_TEST_NUM];
+	int dgstlens[SM2_BATCH_TEST_NUM];
+	int siglens[SM2_BATCH_TEST_NUM];
+	int ok[SM2_BATCH_TEST_NUM];
+	unsigned int siglen;
+	int i;
+
+	if (!(group = EC_GROUP_new_by_curve_name(NID_sm2p256v1))
+		|| !(keys[0] = EC_KEY_new()) || !EC_KEY_set_group(keys[0], group)
+		|| !EC_KEY_generate_key(keys[0])
+		|| !(keys[1] = EC_KEY_new()) || !EC_KEY_set_group(keys[1], group)
+		|| !EC_KEY_generate_key(keys[1])
+		|| !(keys[2] = EC_KEY_dup(keys[0]))
+		|| !(keys[3] = EC_KEY_new()) || !EC_KEY_set_group(keys[3], other)
+		|| !EC_KEY_generate_key(keys[3])
+		|| !(keys[4] = EC_KEY_new()) || !EC_KEY_set_group(keys[4], group)
+		|| !EC_KEY_generate_key(keys[4])) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	for (i = 0; i < SM2_BATCH_TEST_NUM; i++) {
+		ec_keys[i] = i < 64 ? keys[i % 4] : keys[4];
+		RAND_bytes(dgst[i], sizeof(dgst[i]));
+		siglen = sizeof(sig[i]);
+		if (!SM2_sign(NID_undef, dgst[i], sizeof(dgst[i]), sig[i], &siglen,
+			ec_keys[i])) {
+			fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+			goto err;
+		}
+		dgsts[i] = dgst[i];
+		dgstlens[i] = sizeof(dgst[i]);
+		sigs[i] = sig[i];
+		siglens[i] = siglen;
+	}
+
+	if (1 != SM2_verify_batch(NID_undef, dgsts, dgstlens, sigs, siglens,
+		ec_keys, SM2_BATCH_TEST_NUM, ok)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	/* wrong digests, wrong signature, wrong key */
+	dgst[3][0] ^= 0x80;
+	dgst[5][3] ^= 0x10;
+	sig[22][siglens[22] - 1] ^= 0x01;
+	sig[66][siglens[66] - 1] ^= 0x01;
+	ec_keys[41] = keys[0];
+	if (0 != SM2_verify_batch(NID_undef, dgsts, dgstlens, sigs, siglens,
+		ec_keys, SM2_BATCH_TEST_NUM, ok)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+	for (i = 0; i < SM2_BATCH_TEST_NUM; i++) {
+		if (ok[i] != (i != 3 && i != 5 && i != 22 && i != 41
+			&& i != 66)) {
+			fprintf(stderr, "error: %s %d: %d\n", __FUNCTION__, __LINE__, i);
+			goto err;
+		}
+	}
+
+	ret = 1;
+err:
+	for (i = 0; i < 5; i++) {
+		EC_KEY_free(keys[i]);
+	}
+	EC_GROUP_free(group);
+	return ret;
+}
+
+/*
+ * Verification with a table attached to the key, with a key whose public
+ * key changes afterwards and with the tables of the process-wide cache.
+ */
+#define SM2_TABLE_TEST_NUM	20
+
+static int test_sm2_verify_table(void)
+{
+	int ret = 0;
+	EC_GROUP *group = NULL;
+	EC_KEY *keys[2] = {NULL, NULL};
+	EC_KEY *dup = NULL;
+	EC_KEY *pub = NULL;
+	EC_KEY *ec_keys[SM2_TABLE_TEST_NUM];
+	unsigned char dgst[SM2_TABLE_TEST_NUM][32];
+	unsigned char sig[SM2_TABLE_TEST_NUM][SM2_MAX_SIGNATURE_LENGTH];
+	const unsigned char *dgsts[SM2_TABLE_TEST_NUM];
+	const unsigned char *sigs[SM2_TABLE_TEST_NUM];
+	int dgstlens[SM2_TABLE_TEST_NUM];
+	int siglens[SM2_TABLE_TEST_NUM];
+	int ok[SM2_TABLE_TEST_NUM];
+	unsigned int siglen;
+	int i, j;
+
+	if (!(group = EC_GROUP_new_by_curve_name(NID_sm2p256v1))
+		|| !(keys[0] = EC_KEY_new()) || !EC_KEY_set_group(keys[0], group)
+		|| !EC_KEY_generate_key(keys[0])
+		|| !(keys[1] = EC_KEY_new()) || !EC_KEY_set_group(keys[1], group)
+		|| !EC_KEY_generate_key(keys[1])) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	for (i = 0; i < SM2_TABLE_TEST_NUM; i++) {
+		RAND_bytes(dgst[i], sizeof(dgst[i]));
+		siglen = sizeof(sig[i]);
+		if (!SM2_sign(NID_undef, dgst[i], sizeof(dgst[i]), sig[i], &siglen,
+			keys[i % 2])) {
+			fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+			goto err;
+		}
+		dgsts[i] = dgst[i];
+		dgstlens[i] = sizeof(dgst[i]);
+		sigs[i] = sig[i];
+		siglens[i] = siglen;
+	}
+
+	/* a table on the key, shared with its copy */
+	if (!SM2_verify_precompute(keys[0])
+		|| !(dup = EC_KEY_dup(keys[0]))
+		|| 1 != SM2_verify(NID_undef, dgst[0], 32, sig[0], siglens[0], dup)
+		|| 1 != SM2_verify(NID_undef, dgst[2], 32, sig[2], siglens[2],
+			keys[0])
+		|| 1 == SM2_verify(NID_undef, dgst[1], 32, sig[1], siglens[1],
+			keys[0])) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	/* the table is not used once the public key has changed */
+	if (!EC_KEY_set_public_key(dup, EC_KEY_get0_public_key(keys[1]))
+		|| 1 != SM2_verify(NID_undef, dgst[1], 32, sig[1], siglens[1], dup)
+		|| 1 == SM2_verify(NID_undef, dgst[0], 32, sig[0], siglens[0],
+			dup)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	/* a fresh EC_KEY for every verification, as X509 does */
+	if (!SM2_set_verify_cache_size(1)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+	sig[6][siglens[6] - 1] ^= 0x01;
+	for (j = 0; j < 3; j++) {
+		for (i = 1; i < SM2_TABLE_TEST_NUM; i += 2) {
+			EC_KEY_free(pub);
+			if (!(pub = EC_KEY_new()) || !EC_KEY_set_group(pub, group)
+				|| !EC_KEY_set_public_key(pub,
+					EC_KEY_get0_public_key(keys[1]))
+				|| 1 != SM2_verify(NID_undef, dgst[i], 32, sig[i],
+					siglens[i], pub)
+				|| 1 == SM2_verify(NID_undef, dgst[i - 1], 32,
+					sig[i - 1], siglens[i - 1], pub)) {
+				fprintf(stderr, "error: %s %d\n", __FUNCTION__,
+					__LINE__);
+				goto err;
+			}
+		}
+		for (i = 0; i < SM2_TABLE_TEST_NUM; i++) {
+			ec_keys[i] = i % 2 ? pub : keys[0];
+		}
+		if (0 != SM2_verify_batch(NID_undef, dgsts, dgstlens, sigs,
+			siglens, ec_keys, SM2_TABLE_TEST_NUM, ok)) {
+			fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+			goto err;
+		}
+		for (i = 0; i < SM2_TABLE_TEST_NUM; i++) {
+			if (ok[i] != (i != 6)) {
+				fprintf(stderr, "error: %s %d: %d\n", __FUNCTION__,
+					__LINE__, i);
+				goto err;
+			}
+		}
+	}
+
+	ret = 1;
+err:
+	SM2_set_verify_cache_size(0);
+	EC_KEY_free(keys[0]);
+	EC_KEY_free(keys[1]);
+	EC_KEY_free(dup);
+	EC_KEY_free(pub);
+	EC_GROUP_free(group);
+	return ret;
+}
+
+#define SM2_PRESIGN_POOL_TEST_SIZE	20
+
+static int test_sm2_presign_pool(const EC_GROUP *group, const EC_GROUP *other)
+{
+	int ret = 0;
+	EC_KEY *ec_key = NULL;
+	EC_KEY *dup = NULL;
+	SM2_PRESIGN_POOL *pool = NULL;
+	SM2_PRESIGN_POOL *wrong = NULL;
+	unsigned char dgst[32];
+	unsigned char sig[SM2_MAX_SIGNATURE_LENGTH];
+	unsigned char prev[SM2_MAX_SIGNATURE_LENGTH];
+	unsigned int siglen, prevlen = 0;
+	int i;
+
+	RAND_bytes(dgst, sizeof(dgst));
+
+	if (!(ec_key = EC_KEY_new()) || !EC_KEY_set_group(ec_key, group)
+		|| !EC_KEY_generate_key(ec_key)
+		|| !(pool = SM2_PRESIGN_POOL_new(group, SM2_PRESIGN_POOL_TEST_SIZE))
+		|| !SM2_set_presign_pool(ec_key, pool)
+		|| !SM2_PRESIGN_POOL_refill(pool)
+		|| SM2_PRESIGN_POOL_num(pool) != SM2_PRESIGN_POOL_TEST_SIZE
+		|| !(dup = EC_KEY_dup(ec_key))) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	/* the copy shares the pool, signing goes on when it is empty */
+	for (i = 0; i < SM2_PRESIGN_POOL_TEST_SIZE + 2; i++) {
+		siglen = sizeof(sig);
+		if (!SM2_sign(NID_undef, dgst, sizeof(dgst), sig, &siglen,
+			i % 2 ? dup : ec_key)
+			|| 1 != SM2_verify(NID_undef, dgst, sizeof(dgst), sig, siglen,
+				ec_key)
+			|| (siglen == prevlen && !memcmp(sig, prev, siglen))
+			|| SM2_PRESIGN_POOL_num(pool) != (i < SM2_PRESIGN_POOL_TEST_SIZE
+				? SM2_PRESIGN_POOL_TEST_SIZE - i - 1 : 0)) {
+			fprintf(stderr, "error: %s %d: %d\n", __FUNCTION__, __LINE__, i);
+			goto err;
+		}
+		memcpy(prev, sig, siglen);
+		prevlen = siglen;
+	}
+
+	/* detached from one key only */
+	if (!SM2_PRESIGN_POOL_refill(pool)
+		|| !SM2_set_presign_pool(ec_key, NULL)
+		|| !SM2_sign(NID_undef, dgst, sizeof(dgst), sig, &siglen, ec_key)
+		|| SM2_PRESIGN_POOL_num(pool) != SM2_PRESIGN_POOL_TEST_SIZE
+		|| !SM2_sign(NID_undef, dgst, sizeof(dgst), sig, &siglen, dup)
+		|| SM2_PRESIGN_POOL_num(pool) != SM2_PRESIGN_POOL_TEST_SIZE - 1
+		|| 1 != SM2_verify(NID_undef, dgst, sizeof(dgst), sig, siglen,
+			ec_key)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+
+	/* a pool of another group is refused */
+	if (!(wrong = SM2_PRESIGN_POOL_new(other, 1))
+		|| SM2_set_presign_pool(ec_key, wrong)) {
+		fprintf(stderr, "error: %s %d\n", __FUNCTION__, __LINE__);
+		goto err;
+	}
+	ERR_clear_error();
+
+	ret = 1;
+err:
+	ERR_print_errors_fp(stderr);
+	EC_KEY_free(ec_key);
+	EC_KEY_free(dup);
+	SM2_PRESIGN_POOL_free(pool);
+	SM2_PRESIGN_POOL_free(wrong);
+	return ret;
+}
+
 static int test_sm2_enc(const EC_GROUP *group, const EVP_MD *md,
 	const char *d, const char *xP, const char *yP,
 	const char *M, const char *k, const char *C)
@@ -418,7 +1063,7 @@ static int test_sm2_enc(const EC_GROUP *group, const EVP_MD *md,
 	long tlen;
 	unsigned char mbuf[128] = {0};
 	unsigned char cbuf[sizeof(mbuf) + 256] = {0};
-	size_t mlen, clen;
+	size_t mlen, clen, c1len;
 	unsigned char *p;
 
 	/* test encrypt */
@@ -458,6 +1103,51 @@ static int test_sm2_enc(const EC_GROUP *group, const EVP_MD *md,
 		goto end;
 	}
 
+	/* raw C1 || C2 || C3 is the i2o encoding */
+	restore_rand();
+	change_rand(k);
+	clen = sizeof(cbuf);
+	if (!SM2_encrypt_raw(md, SM2_CIPHERTEXT_C1C2C3, (unsigned char *)M,
+		strlen(M), cbuf, &clen, pub_key)) {
+		goto end;
+	}
+	if ((size_t)tlen != clen || memcmp(tbuf, cbuf, clen) != 0) {
+		goto end;
+	}
+	mlen = sizeof(mbuf);
+	if (!SM2_decrypt_raw(md, SM2_CIPHERTEXT_C1C2C3, cbuf, clen,
+		mbuf, &mlen, pri_key)) {
+		goto end;
+	}
+	if (mlen != strlen(M) || memcmp(mbuf, M, strlen(M))) {
+		goto end;
+	}
+
+	/* raw C1 || C3 || C2 */
+	restore_rand();
+	change_rand(k);
+	clen = sizeof(cbuf);
+	if (!SM2_encrypt_raw(md, SM2_CIPHERTEXT_C1C3C2, (unsigned char *)M,
+		strlen(M), cbuf, &clen, pub_key)) {
+		goto end;
+	}
+	c1len = clen - strlen(M) - EVP_MD_size(md);
+	if ((size_t)tlen != clen
+		|| memcmp(tbuf, cbuf, c1len) != 0
+		|| memcmp(tbuf + tlen - EVP_MD_size(md), cbuf + c1len,
+			EVP_MD_size(md)) != 0
+		|| memcmp(tbuf + c1len, cbuf + clen - strlen(M), strlen(M)) != 0) {
+		goto end;
+	}
+	mlen = sizeof(mbuf);
+	if (!SM2_decrypt_raw(md, SM2_CIPHERTEXT_C1C3C2, cbuf, clen,
+		mbuf, &mlen, pri_key)) {
+		goto end;
+	}
+	if (mlen != strlen(M) || memcmp(mbuf, M, strlen(M))) {
+		goto end;
+	}
+
 	ret = 1;
 
 end:
@@ -470,6 +1160,116 @@ end:
 	return ret;
 }
 
+/*
+ * Encrypts a message longer than SM2_encrypt() allows in uneven pieces,
+ * decrypts it in other pieces and as one raw ciphertext, and checks that a
+ * changed C2 or C3 is rejected.
+ */
+static int test_sm2_enc_stream(void)
+{
+	static const size_t steps[] = {1, 31, 32, 33, 4096, 7};
+	int ret = 0;
+	EC_KEY *ec_key = NULL;
+	SM2_ENC_CTX *ctx = NULL;
+	const EVP_MD *md = EVP_sm3();
+	unsigned char *msg = NULL;
+	unsigned char *buf = NULL;
+	unsigned char *dec = NULL;
+	size_t msglen = 100000;
+	size_t c1len, c3len, len, pos, n, i;
+
+	if (!(ec_key = EC_KEY_new_by_curve_name(NID_sm2p256v1))
+		|| !EC_KEY_generate_key(ec_key)
+		|| !(ctx = SM2_ENC_CTX_new())
+		|| !(msg = OPENSSL_malloc(msglen))
+		|| !(dec = OPENSSL_malloc(msglen))
+		|| !SM2_encrypt_raw(md, SM2_CIPHERTEXT_C1C3C2, msg, msglen,
+			NULL, &len, ec_key)
+		|| !(buf = OPENSSL_malloc(len))
+		|| RAND_bytes(msg, (int)msglen) != 1) {
+		goto end;
+	}
+
+	/* C1 || C3 || C2 */
+	c1len = 65;
+	c3len = 32;
+	if (len != c1len + c3len + msglen
+		|| !SM2_encrypt_init(ctx, md, ec_key, buf, &c1len)
+		|| c1len != 65) {
+		goto end;
+	}
+	for (pos = 0, i = 0; pos < msglen; pos += n, i++) {
+		n = steps[i % OSSL_NELEM(steps)];
+		if (n > msglen - pos)
+			n = msglen - pos;
+		if (!SM2_encrypt_update(ctx, buf + c1len + c3len + pos,
+			msg + pos, n)) {
+			goto end;
+		}
+	}
+	if (!SM2_encrypt_final(ctx, buf + c1len, &c3len) || c3len != 32) {
+		goto end;
+	}
+
+	/* one shot */
+	n = msglen;
+	if (!SM2_decrypt_raw(md, SM2_CIPHERTEXT_C1C3C2, buf, len, dec, &n,
+		ec_key) || n != msglen || memcmp(dec, msg, msglen) != 0) {
+		goto end;
+	}
+
+	/* in place, in other pieces */
+	if (!SM2_decrypt_init(ctx, md, ec_key, buf, c1len)) {
+		goto end;
+	}
+	memcpy(dec, buf + c1len + c3len, msglen);
+	for (pos = 0, i = 3; pos < msglen; pos += n, i++) {
+		n = steps[i % OSSL_NELEM(steps)];
+		if (n > msglen - pos)
+			n = msglen - pos;
+		if (!SM2_decrypt_update(ctx, dec + pos, dec + pos, n)) {
+			goto end;
+		}
+	}
+	if (!SM2_decrypt_final(ctx, buf + c1len, c3len)
+		|| memcmp(dec, msg, msglen) != 0) {
+		goto end;
+	}
+
+	/* changed C2 or C3 */
+	buf[len - 1] ^= 1;
+	n = msglen;
+	if (SM2_decrypt_raw(md, SM2_CIPHERTEXT_C1C3C2, buf, len, dec, &n,
+		ec_key)) {
+		goto end;
+	}
+	buf[len - 1] ^= 1;
+	buf[c1len] ^= 1;
+	if (!SM2_decrypt_init(ctx, md, ec_key, buf, c1len)
+		|| !SM2_decrypt_update(ctx, dec, buf + c1len + c3len, msglen)
+		|| SM2_decrypt_final(ctx, buf + c1len, c3len)) {
+		goto end;
+	}
+	ERR_clear_error();
+
+	/* update after final */
+	if (SM2_decrypt_update(ctx, dec, buf, 1)) {
+		goto end;
+	}
+	ERR_clear_error();
+
+	ret = 1;
+
+end:
+	ERR_print_errors_fp(stderr);
+	EC_KEY_free(ec_key);
+	SM2_ENC_CTX_free(ctx);
+	OPENSSL_free(msg);
+	OPENSSL_free(buf);
+	OPENSSL_free(dec);
+	return ret;
+}
+
 static int test_sm2_kap(const EC_GROUP *group,
 	const char *A, const char *dA, const char *xA, const char *yA, const char *ZA,
 	const char *B, const char *dB, const char *xB, const char *yB, const char *ZB,
@@ -559,6 +1359,205 @@ end:
 	return ret;
 }
 
+static EC_KEY *new_ephem_key(const EC_GROUP *group, const char *r)
+{
+	EC_KEY *ret = NULL;
+	BIGNUM *k = NULL;
+	EC_POINT *point = NULL;
+
+	if (!BN_hex2bn(&k, r)
+		|| !(point = EC_POINT_new(group))
+		|| !EC_POINT_mul(group, point, k, NULL, NULL, NULL)
+		|| !(ret = EC_KEY_new())
+		|| !EC_KEY_set_group(ret, group)
+		|| !EC_KEY_set_private_key(ret, k)
+		|| !EC_KEY_set_public_key(ret, point)) {
+		EC_KEY_free(ret);
+		ret = NULL;
+	}
+	BN_free(k);
+	EC_POINT_free(point);
+	return ret;
+}
+
+static int test_sm2_compute_share_key(const EC_GROUP *group,
+	const char *dA, const char *xA, const char *yA, const char *ZA,
+	const char *dB, const char *xB, const char *yB, const char *ZB,
+	const char *rA, const char *rB, const char *KAB)
+{
+	int ret = 0;
+	EC_KEY *eckeyA = NULL;
+	EC_KEY *eckeyB = NULL;
+	EC_KEY *ephemA = NULL;
+	EC_KEY *ephemB = NULL;
+	unsigned char za[32];
+	unsigned char zb[32];
+	unsigned char kab[16];
+	unsigned char kba[16];
+	size_t kablen = sizeof(kab);
+	size_t kbalen = sizeof(kba);
+	long len;
+	unsigned char *buf = NULL;
+
+	eckeyA = new_ec_key(group, dA, xA, yA);
+	eckeyB = new_ec_key(group, dB, xB, yB);
+	ephemA = new_ephem_key(group, rA);
+	ephemB = new_ephem_key(group, rB);
+	if (!eckeyA || !eckeyB || !ephemA || !ephemB) {
+		fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	if (!(buf = OPENSSL_hexstr2buf(ZA, &len)) || len != sizeof(za)) {
+		goto end;
+	}
+	memcpy(za, buf, sizeof(za));
+	OPENSSL_free(buf);
+	if (!(buf = OPENSSL_hexstr2buf(ZB, &len)) || len != sizeof(zb)) {
+		goto end;
+	}
+	memcpy(zb, buf, sizeof(zb));
+
+	/* A is the initiator */
+	if (!SM2_compute_share_key(kab, &kablen,
+		EC_KEY_get0_public_key(ephemB), ephemA,
+		EC_KEY_get0_public_key(eckeyB), zb, sizeof(zb),
+		za, sizeof(za), eckeyA, 1)) {
+		fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+	if (!SM2_compute_share_key(kba, &kbalen,
+		EC_KEY_get0_public_key(ephemA), ephemB,
+		EC_KEY_get0_public_key(eckeyA), za, sizeof(za),
+		zb, sizeof(zb), eckeyB, 0)) {
+		fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	if (!hexequbin(KAB, kab, kablen) || !hexequbin(KAB, kba, kbalen)) {
+		fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	ret = 1;
+
+end:
+	ERR_print_errors_fp(stderr);
+	OPENSSL_free(buf);
+	EC_KEY_free(eckeyA);
+	EC_KEY_free(eckeyB);
+	EC_KEY_free(ephemA);
+	EC_KEY_free(ephemB);
+	return ret;
+}
+
+#define SM2_KAP_POOL_TEST_SIZE	20
+
+/* more handshakes than pairs in the pool, so the pool runs dry */
+static int test_sm2_kap_pool(const EC_GROUP *group)
+{
+	int ret = 0;
+	EC_KEY *eckeyA = NULL;
+	EC_KEY *eckeyB = NULL;
+	SM2_KAP_POOL *pool = NULL;
+	SM2_KAP_CTX ctxA;
+	SM2_KAP_CTX ctxB;
+	unsigned char RA[256];
+	unsigned char RB[256];
+	unsigned char prev[256];
+	size_t RAlen, RBlen;
+	unsigned char kab[48];
+	unsigned char kba[48];
+	unsigned char s1[64];
+	unsigned char s2[64];
+	size_t s1len, s2len;
+	int i;
+
+	memset(&ctxA, 0, sizeof(ctxA));
+	memset(&ctxB, 0, sizeof(ctxB));
+	memset(prev, 0, sizeof(prev));
+
+	if (!(eckeyA = EC_KEY_new()) || !EC_KEY_set_group(eckeyA, group)
+		|| !EC_KEY_generate_key(eckeyA)
+		|| !(eckeyB = EC_KEY_new()) || !EC_KEY_set_group(eckeyB, group)
+		|| !EC_KEY_generate_key(eckeyB)) {
+		fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	if (!(pool = SM2_KAP_POOL_new(group, SM2_KAP_POOL_TEST_SIZE))
+		|| !SM2_KAP_POOL_refill(pool)
+		|| SM2_KAP_POOL_num(pool) != SM2_KAP_POOL_TEST_SIZE) {
+		fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	for (i = 0; i < SM2_KAP_POOL_TEST_SIZE + 2; i++) {
+		if (!SM2_KAP_CTX_init(&ctxA, eckeyA, "ALICE", 5, eckeyB, "BOB", 3, 1, 1)
+			|| !SM2_KAP_CTX_init(&ctxB, eckeyB, "BOB", 3, eckeyA, "ALICE", 5, 0, 1)
+			|| !SM2_KAP_CTX_set_pool(&ctxA, pool)
+			|| !SM2_KAP_CTX_set_pool(&ctxB, i % 2 ? pool : NULL)) {
+			fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+			goto end;
+		}
+
+		RAlen = sizeof(RA);
+		RBlen = sizeof(RB);
+		if (!SM2_KAP_prepare(&ctxA, RA, &RAlen)
+			|| !SM2_KAP_prepare(&ctxB, RB, &RBlen)
+			|| !memcmp(RA, prev, RAlen) || !memcmp(RA, RB, RAlen)) {
+			fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+			goto end;
+		}
+		memcpy(prev, RA, RAlen);
+
+		if (!SM2_KAP_compute_key(&ctxA, RB, RBlen, kab, sizeof(kab), s1, &s1len)
+			|| !SM2_KAP_compute_key(&ctxB, RA, RAlen, kba, sizeof(kba), s2, &s2len)
+			|| !SM2_KAP_final_check(&ctxA, s2, s2len)
+			|| !SM2_KAP_final_check(&ctxB, s1, s1len)
+			|| memcmp(kab, kba, sizeof(kab))) {
+			fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+			goto end;
+		}
+
+		SM2_KAP_CTX_cleanup(&ctxA);
+		SM2_KAP_CTX_cleanup(&ctxB);
+	}
+
+	if (SM2_KAP_POOL_num(pool) != 0 || !SM2_KAP_POOL_refill(pool)
+		|| SM2_KAP_POOL_num(pool) != SM2_KAP_POOL_TEST_SIZE) {
+		fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	/* the context keeps its own reference to the pool */
+	if (!SM2_KAP_CTX_init(&ctxA, eckeyA, "ALICE", 5, eckeyB, "BOB", 3, 1, 1)
+		|| !SM2_KAP_CTX_set_pool(&ctxA, pool)
+		|| !SM2_KAP_CTX_set_pool(&ctxA, pool)) {
+		fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+	SM2_KAP_POOL_free(pool);
+	pool = NULL;
+	RAlen = sizeof(RA);
+	if (!SM2_KAP_prepare(&ctxA, RA, &RAlen)
+		|| SM2_KAP_POOL_num(ctxA.pool) != SM2_KAP_POOL_TEST_SIZE - 1) {
+		fprintf(stderr, "error: %s %d\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	ret = 1;
+
+end:
+	ERR_print_errors_fp(stderr);
+	EC_KEY_free(eckeyA);
+	EC_KEY_free(eckeyB);
+	SM2_KAP_CTX_cleanup(&ctxA);
+	SM2_KAP_CTX_cleanup(&ctxB);
+	SM2_KAP_POOL_free(pool);
+	return ret;
+}
+
 int main(int argc, char **argv)
 {
 	int err = 0;
@@ -566,6 +1565,8 @@ int main(int argc, char **argv)
 	EC_GROUP *sm2p256test = NULL;
 	EC_GROUP *sm2b193test = NULL;
 	EC_GROUP *sm2b257test = NULL;
+	EC_GROUP *sm2p256v1 = NULL;
+	EC_GROUP *named = NULL;
 
 	RAND_seed(rnd_seed, sizeof(rnd_seed));
 
@@ -605,7 +1606,17 @@ int main(int argc, char **argv)
 		"7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFBC972CF7E6B6F900945B3C6A0CF6161D",
 		"4");
 
-	if (!sm2p192test || !sm2p256test || !sm2b193test || !sm2b257test) {
+	sm2p256v1 = new_ec_group(1,
+		"FFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF00000000FFFFFFFFFFFFFFFF",
+		"FFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF00000000FFFFFFFFFFFFFFFC",
+		"28E9FA9E9D9F5E344D5A9E4BCF6509A7F39789F515AB8F92DDBCBD414D940E93",
+		"32C4AE2C1F1981195F9904466A39C9948FE30BBFF2660BE1715A4589334C74C7",
+		"BC3736A2F4F6779C59BDCEE36B692153D0A9877CC62A474002DF32E52139F0A0",
+		"FFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFF7203DF6B21C6052B53BBF40939D54123",
+		"1");
+
+	if (!sm2p192test || !sm2p256test || !sm2b193test || !sm2b257test
+		|| !sm2p256v1) {
 		err++;
 		goto end;
 	}
@@ -647,6 +1658,64 @@ int main(int argc, char **argv)
 		printf("sm2 sign b257 passed\n");
 	}
 
+	if (!test_sm2_p256(
+		sm2p256v1,
+		"3945208F7B2144B13F36E38AC6D39F95889393692860B51A42FB81EF4DF7C5B8",
+		"09F9DF311E5421A150DD7D161E4BC5C672179FAD1833FC076BB08FF356F35020",
+		"CCEA490CE26775A52DC6EA718CC1AA600AED05FBF35E084A6632F6072DA9AD13",
+		"F0B43E94BA45ACCAACE692ED534382EB17E6AB5A19CE7B31F4486FDFC0D28640",
+		"59276E27D506861A16680F3AD9C02DCCEF3CC1FA3CDBE4CE6D54B80DEAC1BC21",
+		"F5A03B0648D2C4630EEAC513E1BB81A15944DA3827D5B74143AC7EACEEE720B3",
+		"B1B6AA29DF212FD8763182BC0D421CA1BB9038FD1F7F42D4840B69C485BBC1AA")) {
+		printf("sm2 sign sm2p256v1 failed\n");
+		err++;
+	} else {
+		printf("sm2 sign sm2p256v1 passed\n");
+	}
+
+	if (!test_sm2_p256_mul(sm2p256v1)) {
+		printf("sm2 mul sm2p256v1 failed\n");
+		err++;
+	} else {
+		printf("sm2 mul sm2p256v1 passed\n");
+	}
+
+	if (!test_sm2_id_digest()) {
+		printf("sm2 id digest failed\n");
+		err++;
+	} else {
+		printf("sm2 id digest passed\n");
+	}
+
+	if (!test_sm2_verify_batch(sm2p256test)) {
+		printf("sm2 verify batch failed\n");
+		err++;
+	} else {
+		printf("sm2 verify batch passed\n");
+	}
+
+	if (!test_sm2_verify_table()) {
+		printf("sm2 verify table failed\n");
+		err++;
+	} else {
+		printf("sm2 verify table passed\n");
+	}
+
+	if (!test_sm2_presign_pool(sm2b257test, sm2p256test)) {
+		printf("sm2 presign pool b257 failed\n");
+		err++;
+	} else {
+		printf("sm2 presign pool b257 passed\n");
+	}
+
+	if (!(named = EC_GROUP_new_by_curve_name(NID_sm2p256v1))
+		|| !test_sm2_presign_pool(named, sm2p256test)) {
+		printf("sm2 presign pool sm2p256v1 failed\n");
+		err++;
+	} else {
+		printf("sm2 presign pool sm2p256v1 passed\n");
+	}
+
 	if (!test_sm2_enc(
 		sm2p256test, EVP_sm3(),
 		"1649AB77A00637BD5E2EFE283FBF353534AA7F7CB89463F208DDBC2920BB0DA0",
@@ -683,6 +1752,13 @@ int main(int argc, char **argv)
 		printf("sm2 enc b257 passed\n");
 	}
 
+	if (!test_sm2_enc_stream()) {
+		printf("sm2 enc stream failed\n");
+		err++;
+	} else {
+		printf("sm2 enc stream passed\n");
+	}
+
 	if (!test_sm2_kap(
 		sm2p256test,
 		"ALICE123@YAHOO.COM",
@@ -730,11 +1806,46 @@ int main(int argc, char **argv)
 		printf("sm2 kap b257 passed\n");
 	}
 
+	if (!test_sm2_compute_share_key(
+		sm2p256test,
+		"6FCBA2EF9AE0AB902BC3BDE3FF915D44BA4CC78F88E2F8E7F8996D3B8CCEEDEE",
+		"3099093BF3C137D8FCBBCDF4A2AE50F3B0F216C3122D79425FE03A45DBFE1655",
+		"3DF79E8DAC1CF0ECBAA2F2B49D51A4B387F2EFAF482339086A27A8E05BAED98B",
+		"E4D1D0C3CA4C7F11BC8FF8CB3F4C02A78F108FA098E51A668487240F75E20F31",
+		"5E35D7D3F3C54DBAC72E61819E730B019A84208CA3A35E4C2E353DFCCB2A3B53",
+		"245493D446C38D8CC0F118374690E7DF633A8A4BFB3329B5ECE604B2B4F37F43",
+		"53C0869F4B9E17773DE68FEC45E14904E0DEA45BF6CECF9918C85EA047C60A4C",
+		"6B4B6D0E276691BD4A11BF72F4FB501AE309FDACB72FA6CC336E6656119ABD67",
+		"83A2C9C8B96E5AF70BD480B472409A9A327257F1EBB73F5B073354B248668563",
+		"33FE21940342161C55619C4A0C060293D543C80AF19748CE176D83477DE71C80",
+		"55B0AC62A6B927BA23703832C853DED4")) {
+		printf("sm2 share key p256 failed\n");
+		err++;
+	} else {
+		printf("sm2 share key p256 passed\n");
+	}
+
+	if (!test_sm2_kap_pool(sm2b257test)) {
+		printf("sm2 kap pool b257 failed\n");
+		err++;
+	} else {
+		printf("sm2 kap pool b257 passed\n");
+	}
+
+	if (!named || !test_sm2_kap_pool(named)) {
+		printf("sm2 kap pool sm2p256v1 failed\n");
+		err++;
+	} else {
+		printf("sm2 kap pool sm2p256v1 passed\n");
+	}
+
 end:
 	EC_GROUP_free(sm2p192test);
 	EC_GROUP_free(sm2p256test);
 	EC_GROUP_free(sm2b193test);
 	EC_GROUP_free(sm2b257test);
+	EC_GROUP_free(sm2p256v1);
+	EC_GROUP_free(named);
 	EXIT(err);
 }
 #endif
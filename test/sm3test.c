@@ -195,6 +195,46 @@ static char *pt(unsigned char *md)
 	return (buf);
 }
 
+/* compare sm3_mb() with sm3() on messages of mixed lengths */
+static int sm3test_mb(void)
+{
+	static const size_t lens[] = {
+		0, 1, 3, 55, 56, 63, 64, 65, 119, 120, 127, 128,
+		200, 1000, 64, 64, 64, 64, 64, 64, 64, 64, 4096, 17, 33,
+	};
+	unsigned char buf[4096];
+	const unsigned char *data[OSSL_NELEM(lens)];
+	unsigned char md[OSSL_NELEM(lens)][SM3_DIGEST_LENGTH];
+	unsigned char *digest[OSSL_NELEM(lens)];
+	unsigned char dgst[SM3_DIGEST_LENGTH];
+	size_t num, i;
+
+	for (i = 0; i < sizeof(buf); i++) {
+		buf[i] = (unsigned char)(i * 7 + 3);
+	}
+	for (i = 0; i < OSSL_NELEM(lens); i++) {
+		data[i] = buf + (i % 8);
+		if (lens[i] + (i % 8) > sizeof(buf)) {
+			data[i] = buf;
+		}
+		digest[i] = md[i];
+	}
+
+	/* all the batch sizes from the scalar path to several lane refills */
+	for (num = 1; num <= OSSL_NELEM(lens); num++) {
+		memset(md, 0, sizeof(md));
+		sm3_mb(data, lens, digest, num);
+		for (i = 0; i < num; i++) {
+			sm3(data[i], lens[i], dgst);
+			if (memcmp(md[i], dgst, sizeof(dgst)) != 0) {
+				printf("sm3_mb failed on message %zu of %zu\n", i, num);
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
 int main(int argc, char **argv)
 {
 	int err = 0;
@@ -234,6 +274,12 @@ int main(int argc, char **argv)
 		dgstbuf = NULL;
 	}
 
+	if (!sm3test_mb()) {
+		err++;
+	} else {
+		printf("sm3 mb test ok\n");
+	}
+
 	OPENSSL_free(testbuf);
 	OPENSSL_free(dgstbuf);
 	EXIT(err);
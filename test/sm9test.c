@@ -149,6 +149,312 @@ static int hexequbin(const char *hex, const unsigned char *bin, size_t binlen)
 	return ret;
 }
 
+/* BIGNUM double-and-add, used as reference for point_mul() */
+static int sm9test_point_mul(point_t *R, const BIGNUM *k, const point_t *P,
+	const BIGNUM *p, BN_CTX *ctx)
+{
+	int i;
+
+	if (!point_set_to_infinity(R)) {
+		return 0;
+	}
+	for (i = BN_num_bits(k) - 1; i >= 0; i--) {
+		if (!point_dbl(R, R, p, ctx)) {
+			return 0;
+		}
+		if (BN_is_bit_set(k, i) && !point_add(R, R, P, p, ctx)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* compare the fixed-width pairing with the BIGNUM reference rate() */
+static int sm9test_pairing(int count)
+{
+	int ret = 0;
+	const BIGNUM *p = SM9_get0_prime();
+	const BIGNUM *n = SM9_get0_order();
+	BN_CTX *ctx = NULL;
+	EC_GROUP *group = NULL;
+	EC_POINT *P = NULL;
+	BIGNUM *k, *xP, *yP;
+	point_t G, Q, R;
+	fp12_t f, g;
+	int i;
+
+	if (!rate_test()) {
+		fprintf(stderr, "%s %d: pairing test vector failed\n", __FILE__, __LINE__);
+		return 0;
+	}
+
+	if (!(ctx = BN_CTX_new())) {
+		return 0;
+	}
+	BN_CTX_start(ctx);
+	k = BN_CTX_get(ctx);
+	xP = BN_CTX_get(ctx);
+	yP = BN_CTX_get(ctx);
+	if (!yP
+		|| !(group = EC_GROUP_new_by_curve_name(NID_sm9bn256v1))
+		|| !(P = EC_POINT_new(group))
+		|| !point_init(&G, ctx)
+		|| !point_init(&Q, ctx)
+		|| !point_init(&R, ctx)
+		|| !fp12_init(f, ctx)
+		|| !fp12_init(g, ctx)
+		|| !point_set_affine_coordinates_bignums(&G,
+			SM9_get0_generator2_x0(), SM9_get0_generator2_x1(),
+			SM9_get0_generator2_y0(), SM9_get0_generator2_y1())) {
+		goto end;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!BN_rand_range(k, n)
+			|| !EC_POINT_mul(group, P, k, NULL, NULL, ctx)
+			|| !EC_POINT_get_affine_coordinates_GFp(group, P, xP, yP, ctx)
+			|| !BN_rand_range(k, n)
+			|| !point_mul_generator(&Q, k, p, ctx)
+			|| !sm9test_point_mul(&R, k, &G, p, ctx)) {
+			goto end;
+		}
+		if (!point_equ(&Q, &R)) {
+			fprintf(stderr, "%s %d: point_mul failed\n", __FILE__, __LINE__);
+			goto end;
+		}
+
+		rate(f, &Q, xP, yP, SM9_get0_loop_count(),
+			SM9_get0_final_exponent(), p, ctx);
+		if (!rate_pairing(g, &Q, P, ctx)) {
+			goto end;
+		}
+		if (!fp12_equ(f, g)) {
+			fprintf(stderr, "%s %d: rate_pairing failed\n", __FILE__, __LINE__);
+			goto end;
+		}
+	}
+
+	ret = 1;
+end:
+	EC_POINT_free(P);
+	EC_GROUP_free(group);
+	BN_CTX_end(ctx);
+	BN_CTX_free(ctx);
+	return ret;
+}
+
+/* compare rate_multi_pairing() with the product of single pairings */
+static int sm9test_multi_pairing(void)
+{
+	int ret = 0;
+	const BIGNUM *p = SM9_get0_prime();
+	const BIGNUM *n = SM9_get0_order();
+	BN_CTX *ctx = NULL;
+	EC_GROUP *group = NULL;
+	EC_POINT *P[3] = {NULL, NULL, NULL};
+	point_t Q[3];
+	const EC_POINT *Pv[4];
+	const point_t *Qv[4];
+	BIGNUM *k;
+	fp12_t f, g, t;
+	int i;
+
+	if (!(ctx = BN_CTX_new())) {
+		return 0;
+	}
+	BN_CTX_start(ctx);
+	if (!(k = BN_CTX_get(ctx))
+		|| !(group = EC_GROUP_new_by_curve_name(NID_sm9bn256v1))
+		|| !fp12_init(f, ctx)
+		|| !fp12_init(g, ctx)
+		|| !fp12_init(t, ctx)) {
+		goto end;
+	}
+
+	fp12_set_one(f);
+	for (i = 0; i < 3; i++) {
+		if (!(P[i] = EC_POINT_new(group))
+			|| !point_init(&Q[i], ctx)
+			|| !BN_rand_range(k, n)
+			|| !EC_POINT_mul(group, P[i], k, NULL, NULL, ctx)
+			|| !BN_rand_range(k, n)
+			|| !point_mul_generator(&Q[i], k, p, ctx)
+			|| !rate_pairing(t, &Q[i], P[i], ctx)
+			|| !fp12_mul(f, f, t, p, ctx)) {
+			goto end;
+		}
+		Pv[i] = P[i];
+		Qv[i] = &Q[i];
+	}
+	/* e(P1, P2) */
+	Pv[3] = NULL;
+	Qv[3] = NULL;
+	if (!rate_pairing(t, NULL, NULL, ctx)
+		|| !fp12_mul(f, f, t, p, ctx)
+		|| !rate_multi_pairing(g, Qv, Pv, 4, ctx)) {
+		goto end;
+	}
+	if (!fp12_equ(f, g)) {
+		fprintf(stderr, "%s %d: rate_multi_pairing failed\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	ret = 1;
+end:
+	for (i = 0; i < 3; i++) {
+		EC_POINT_free(P[i]);
+	}
+	EC_GROUP_free(group);
+	BN_CTX_end(ctx);
+	BN_CTX_free(ctx);
+	return ret;
+}
+
+/* check the pairing with the precomputed Miller loop lines of Q */
+static int sm9test_line_table(void)
+{
+	int ret = 0;
+	const BIGNUM *p = SM9_get0_prime();
+	const BIGNUM *n = SM9_get0_order();
+	BN_CTX *ctx = NULL;
+	EC_GROUP *group = NULL;
+	EC_POINT *P = NULL;
+	SM9_Z256_LINE_TABLE *lines = NULL;
+	SM9_Z256_TWIST_POINT Qz;
+	sm9_z256_t xP, yP;
+	sm9_z256_fp12_t r;
+	point_t Q;
+	BIGNUM *k, *x, *y;
+	fp12_t f, g;
+	int i;
+
+	if (!(ctx = BN_CTX_new())) {
+		return 0;
+	}
+	BN_CTX_start(ctx);
+	if (!(k = BN_CTX_get(ctx))
+		|| !(x = BN_CTX_get(ctx))
+		|| !(y = BN_CTX_get(ctx))
+		|| !(group = EC_GROUP_new_by_curve_name(NID_sm9bn256v1))
+		|| !(P = EC_POINT_new(group))
+		|| !(lines = OPENSSL_malloc(sizeof(*lines)))
+		|| !point_init(&Q, ctx)
+		|| !fp12_init(f, ctx)
+		|| !fp12_init(g, ctx)) {
+		goto end;
+	}
+
+	for (i = 0; i < 3; i++) {
+		if (!BN_rand_range(k, n)
+			|| !point_mul_generator(&Q, k, p, ctx)
+			|| !sm9_z256_twist_point_from_point(&Qz, &Q)) {
+			goto end;
+		}
+		sm9_z256_line_table_init(lines, &Qz);
+
+		/* the same lines are used with different P */
+		if (!BN_rand_range(k, n)
+			|| !EC_POINT_mul(group, P, k, NULL, NULL, ctx)
+			|| !EC_POINT_get_affine_coordinates_GFp(group, P, x, y, ctx)
+			|| !sm9_z256_from_bn(xP, x)
+			|| !sm9_z256_from_bn(yP, y)
+			|| !rate_pairing(f, &Q, P, ctx)) {
+			goto end;
+		}
+		sm9_z256_pairing_with_table(r, lines, xP, yP);
+		if (!sm9_z256_fp12_to_fp12(g, r)) {
+			goto end;
+		}
+		if (!fp12_equ(f, g)) {
+			fprintf(stderr, "%s %d: sm9_z256_pairing_with_table failed\n",
+				__FILE__, __LINE__);
+			goto end;
+		}
+
+		sm9_z256_pairing(r, &Qz, xP, yP);
+		if (!sm9_z256_fp12_to_fp12(g, r)) {
+			goto end;
+		}
+		if (!fp12_equ(f, g)) {
+			fprintf(stderr, "%s %d: sm9_z256_pairing failed\n",
+				__FILE__, __LINE__);
+			goto end;
+		}
+	}
+
+	ret = 1;
+end:
+	OPENSSL_free(lines);
+	EC_POINT_free(P);
+	EC_GROUP_free(group);
+	BN_CTX_end(ctx);
+	BN_CTX_free(ctx);
+	return ret;
+}
+
+/* check the cached e(P1, Ppubs) and its fixed-base table */
+static int sm9test_gt_table(void)
+{
+	int ret = 0;
+	SM9PublicParameters *mpk = NULL;
+	SM9MasterSecret *msk = NULL;
+	const SM9_Z256_FP12_TABLE *table;
+	BN_CTX *ctx = NULL;
+	BIGNUM *k;
+	point_t Ppubs;
+	fp12_t f;
+	sm9_z256_fp12_t g, a, b;
+	int i;
+
+	if (!(ctx = BN_CTX_new())) {
+		return 0;
+	}
+	BN_CTX_start(ctx);
+	if (!(k = BN_CTX_get(ctx))
+		|| !point_init(&Ppubs, ctx)
+		|| !fp12_init(f, ctx)
+		|| !SM9_setup(NID_sm9bn256v1, NID_sm9sign, NID_sm9hash1_with_sm3, &mpk, &msk)
+		|| !(table = sm9_master_key_get0_gt_table(mpk))
+		|| table != sm9_master_key_get0_gt_table(mpk)
+		|| !point_from_octets(&Ppubs, ASN1_STRING_get0_data(mpk->pointPpub),
+			SM9_get0_prime(), ctx)
+		|| !rate_pairing(f, &Ppubs, NULL, ctx)
+		|| !sm9_z256_fp12_from_fp12(g, f)
+		|| !sm9_z256_fp12_equ(g, table->g)) {
+		fprintf(stderr, "%s %d: gt table failed\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	/* random exponents, then 0, 1 and n - 1 */
+	for (i = 0; i < 7; i++) {
+		if (!(i < 4 ? BN_rand_range(k, SM9_get0_order())
+				: i == 6 ? BN_sub(k, SM9_get0_order(), BN_value_one())
+				: BN_set_word(k, i - 4))
+			|| !sm9_z256_fp12_table_pow(a, table, k)
+			|| !sm9_z256_fp12_pow(b, g, k)
+			|| !sm9_z256_fp12_equ(a, b)) {
+			fprintf(stderr, "%s %d: gt table pow failed\n", __FILE__, __LINE__);
+			goto end;
+		}
+	}
+
+	/* exponents wider than 256 bits are rejected */
+	if (!BN_set_bit(k, 256)
+		|| sm9_z256_fp12_pow(b, g, k)
+		|| sm9_z256_fp12_table_pow(a, table, k)) {
+		fprintf(stderr, "%s %d: gt pow accepted a 257-bit exponent\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	ret = 1;
+end:
+	SM9PublicParameters_free(mpk);
+	SM9MasterSecret_free(msk);
+	BN_CTX_end(ctx);
+	BN_CTX_free(ctx);
+	return ret;
+}
+
 static int sm9test_sign(const char *id, const unsigned char *msg, size_t msglen,
 	int use_test_vector)
 {
@@ -317,6 +623,74 @@ end:
 
 }
 
+static int sm9test_verify_batch(const char *idA, const char *idB)
+{
+	int ret = 0;
+	SM9PublicParameters *mpk = NULL;
+	SM9MasterSecret *msk = NULL;
+	SM9PrivateKey *sk[2] = {NULL, NULL};
+	const char *msgs[] = {"abc", "message digest", "", "abcdefghijklmnopqrstuvwxyz"};
+	unsigned char sigbuf[4][256];
+	const unsigned char *data[4];
+	size_t datalen[4];
+	const unsigned char *sig[4];
+	size_t siglen[4];
+	const char *id[4];
+	size_t idlen[4];
+	int ok[4];
+	int i;
+
+	if (!SM9_setup(NID_sm9bn256v1, NID_sm9sign, NID_sm9hash1_with_sm3, &mpk, &msk)
+		|| !(sk[0] = SM9_extract_private_key(msk, idA, strlen(idA)))
+		|| !(sk[1] = SM9_extract_private_key(msk, idB, strlen(idB)))) {
+		goto end;
+	}
+
+	for (i = 0; i < 4; i++) {
+		data[i] = (const unsigned char *)msgs[i];
+		datalen[i] = strlen(msgs[i]);
+		id[i] = i < 3 ? idA : idB;
+		idlen[i] = strlen(id[i]);
+		siglen[i] = sizeof(sigbuf[i]);
+		if (!SM9_sign(NID_sm3, data[i], datalen[i], sigbuf[i], &siglen[i],
+			sk[i < 3 ? 0 : 1])) {
+			goto end;
+		}
+		sig[i] = sigbuf[i];
+	}
+
+	if (SM9_verify_batch(NID_sm3, data, datalen, sig, siglen, id, idlen, 4,
+		mpk, ok) != 1 || !ok[0] || !ok[1] || !ok[2] || !ok[3]) {
+		fprintf(stderr, "%s %d: verify batch failed\n", __FILE__, __LINE__);
+		goto end;
+	}
+
+	/*
+	 * a signature of a different identity and a malformed one, the other
+	 * two still verify and errors queued before are kept
+	 */
+	id[1] = idB;
+	idlen[1] = strlen(idB);
+	siglen[2] -= 1;
+	ERR_clear_error();
+	SM9err(SM9_F_SM9_VERIFY_BATCH, SM9_R_PAIRING_ERROR);
+	if (SM9_verify_batch(NID_sm3, data, datalen, sig, siglen, id, idlen, 4,
+		mpk, ok) != 0 || ok[0] != 1 || ok[1] != 0 || ok[2] != 0 || ok[3] != 1
+		|| ERR_GET_REASON(ERR_peek_last_error()) != SM9_R_PAIRING_ERROR) {
+		fprintf(stderr, "%s %d: verify batch failed\n", __FILE__, __LINE__);
+		goto end;
+	}
+	ERR_clear_error();
+
+	ret = 1;
+end:
+	SM9PublicParameters_free(mpk);
+	SM9MasterSecret_free(msk);
+	SM9PrivateKey_free(sk[0]);
+	SM9PrivateKey_free(sk[1]);
+	return ret;
+}
+
 static int sm9test_exch(const char *idA, const char *idB)
 {
 	int ret = 0;
@@ -424,12 +798,42 @@ int main(int argc, char **argv)
 		printf("sm9 rate pairing test passed\n");
 #endif
 
+	if (!sm9test_pairing(2)) {
+		printf("sm9 pairing tests failed\n");
+		err++;
+	} else
+		printf("sm9 pairing tests passed\n");
+
+	if (!sm9test_multi_pairing()) {
+		printf("sm9 multi pairing tests failed\n");
+		err++;
+	} else
+		printf("sm9 multi pairing tests passed\n");
+
+	if (!sm9test_line_table()) {
+		printf("sm9 line table tests failed\n");
+		err++;
+	} else
+		printf("sm9 line table tests passed\n");
+
+	if (!sm9test_gt_table()) {
+		printf("sm9 gt table tests failed\n");
+		err++;
+	} else
+		printf("sm9 gt table tests passed\n");
+
 	if (!sm9test_sign(id, in, sizeof(in)-1, use_test_vector)) {
 		printf("sm9 sign tests failed\n");
 		err++;
 	} else
 		printf("sm9 sign tests passed\n");
 
+	if (!sm9test_verify_batch(id, "guan@pku.edu.cn")) {
+		printf("sm9 batch verify tests failed\n");
+		err++;
+	} else
+		printf("sm9 batch verify tests passed\n");
+
 	if (!sm9test_exch(id, "guan@pku.edu.cn")) {
 		printf("sm9 exch tests failed\n");
 		err++;
@@ -62,6 +62,7 @@ int main(int argc, char **argv)
 # include <openssl/evp.h>
 # include <openssl/sms4.h>
 # include <openssl/rand.h>
+# include <openssl/modes.h>
 
 # ifdef SMS4_AVX2
 void sms4_avx2_ecb_encrypt_blocks(const unsigned char *in,
@@ -161,6 +162,369 @@ static int test_ctr32(int avx)
 	return 1;
 }
 
+static int test_bs(void)
+{
+	sms4_key_t key;
+	unsigned char user_key[16];
+	unsigned char iv[16];
+	unsigned char in[300 * 16];
+	unsigned char out1[sizeof(in)];
+	unsigned char out2[sizeof(in)];
+	size_t blocks[] = {1, 63, 64, 65, 200, 300};
+	size_t i, j;
+
+	RAND_bytes(user_key, sizeof(user_key));
+	RAND_bytes(iv, sizeof(iv));
+	RAND_bytes(in, sizeof(in));
+	/* the 32-bit counter wraps */
+	memset(iv + 12, 0xff, 3);
+
+	sms4_set_encrypt_key(&key, user_key);
+
+	for (i = 0; i < sizeof(blocks)/sizeof(blocks[0]); i++) {
+		for (j = 0; j < blocks[i]; j++) {
+			sms4_encrypt(in + 16 * j, out1 + 16 * j, &key);
+		}
+		sms4_bs_ecb_encrypt_blocks(in, out2, blocks[i], &key);
+		if (memcmp(out1, out2, blocks[i] * 16) != 0) {
+			return 0;
+		}
+
+		sms4_ctr32_encrypt_blocks(in, out1, blocks[i], &key, iv);
+		sms4_bs_ctr32_encrypt_blocks(in, out2, blocks[i], &key, iv);
+		if (memcmp(out1, out2, blocks[i] * 16) != 0) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static void xts_double(unsigned char t[16])
+{
+	int c = t[15] >> 7;
+	int i;
+	for (i = 15; i > 0; i--) {
+		t[i] = (t[i] << 1) | (t[i - 1] >> 7);
+	}
+	t[0] = (t[0] << 1) ^ (c ? 0x87 : 0);
+}
+
+/* XTS with sms4_encrypt(), encryption only */
+static void xts_encrypt(const unsigned char *in, unsigned char *out,
+	size_t len, const unsigned char user_key[32], const unsigned char iv[16])
+{
+	sms4_key_t key1, key2;
+	unsigned char t[16];
+	unsigned char b[16];
+	size_t rem = len % 16;
+	int i;
+
+	sms4_set_encrypt_key(&key1, user_key);
+	sms4_set_encrypt_key(&key2, user_key + 16);
+	sms4_encrypt(iv, t, &key2);
+
+	for (; len >= 16; len -= 16, in += 16, out += 16) {
+		for (i = 0; i < 16; i++) b[i] = in[i] ^ t[i];
+		sms4_encrypt(b, b, &key1);
+		for (i = 0; i < 16; i++) out[i] = b[i] ^ t[i];
+		xts_double(t);
+	}
+	if (rem) {
+		memcpy(b, out - 16, 16);
+		memcpy(out, b, rem);
+		memcpy(b, in, rem);
+		for (i = 0; i < 16; i++) b[i] ^= t[i];
+		sms4_encrypt(b, b, &key1);
+		for (i = 0; i < 16; i++) out[i - 16] = b[i] ^ t[i];
+	}
+}
+
+static int test_bs_xts(void)
+{
+	unsigned char user_key[32];
+	unsigned char iv[16];
+	unsigned char in[300 * 16 + 7];
+	unsigned char out1[sizeof(in)];
+	unsigned char out2[sizeof(in)];
+	size_t lens[] = {16, 3 * 16 + 5, 64 * 16, 64 * 16 + 1, 65 * 16 + 15,
+		256 * 16 + 3, sizeof(in)};
+	sms4_key_t key1, dkey1, key2;
+	EVP_CIPHER_CTX *ctx = NULL;
+	int len, ret = 0;
+	size_t i;
+
+	RAND_bytes(user_key, sizeof(user_key));
+	RAND_bytes(iv, sizeof(iv));
+	RAND_bytes(in, sizeof(in));
+
+	sms4_set_encrypt_key(&key1, user_key);
+	sms4_set_decrypt_key(&dkey1, user_key);
+	sms4_set_encrypt_key(&key2, user_key + 16);
+
+	if (!(ctx = EVP_CIPHER_CTX_new())) {
+		goto end;
+	}
+
+	for (i = 0; i < sizeof(lens)/sizeof(lens[0]); i++) {
+		xts_encrypt(in, out1, lens[i], user_key, iv);
+
+		sms4_bs_xts_encrypt(in, out2, lens[i], &key1, &key2, iv);
+		if (memcmp(out1, out2, lens[i]) != 0) {
+			goto end;
+		}
+		sms4_bs_xts_decrypt(out1, out2, lens[i], &dkey1, &key2, iv);
+		if (memcmp(in, out2, lens[i]) != 0) {
+			goto end;
+		}
+
+		if (!EVP_EncryptInit_ex(ctx, EVP_sms4_xts(), NULL, user_key, iv)
+			|| !EVP_EncryptUpdate(ctx, out2, &len, in, (int)lens[i])
+			|| memcmp(out1, out2, lens[i]) != 0) {
+			goto end;
+		}
+
+		if (!EVP_DecryptInit_ex(ctx, EVP_sms4_xts(), NULL, user_key, iv)
+			|| !EVP_DecryptUpdate(ctx, out2, &len, out1, (int)lens[i])
+			|| memcmp(in, out2, lens[i]) != 0) {
+			goto end;
+		}
+	}
+
+	ret = 1;
+end:
+	EVP_CIPHER_CTX_free(ctx);
+	return ret;
+}
+
+static void ctr128_inc(unsigned char ctr[16])
+{
+	int i;
+
+	for (i = 15; i >= 0; i--) {
+		if (++ctr[i])
+			break;
+	}
+}
+
+/* EVP against block by block, with an unaligned split of each update */
+static int test_evp_modes(void)
+{
+	int ret = 0;
+	EVP_CIPHER_CTX *ctx = NULL;
+	const EVP_CIPHER *ciphers[4];
+	sms4_key_t key;
+	unsigned char user_key[16];
+	unsigned char iv[16];
+	unsigned char in[16 * 300];
+	unsigned char out1[sizeof(in)];
+	unsigned char out2[sizeof(in)];
+	unsigned char buf[16];
+	size_t lens[] = {16, 16 * 7, 16 * 33, 16 * 300};
+	size_t i, j, k, split;
+	int len;
+
+	ciphers[0] = EVP_sms4_ecb();
+	ciphers[1] = EVP_sms4_cbc();
+	ciphers[2] = EVP_sms4_cfb128();
+	ciphers[3] = EVP_sms4_ctr();
+
+	RAND_bytes(user_key, sizeof(user_key));
+	RAND_bytes(iv, sizeof(iv));
+	RAND_bytes(in, sizeof(in));
+	sms4_set_encrypt_key(&key, user_key);
+
+	if (!(ctx = EVP_CIPHER_CTX_new())) {
+		goto end;
+	}
+
+	for (i = 0; i < sizeof(ciphers)/sizeof(ciphers[0]); i++) {
+		for (j = 0; j < sizeof(lens)/sizeof(lens[0]); j++) {
+
+			memcpy(buf, iv, 16);
+			for (k = 0; k < lens[j]; k += 16) {
+				switch (i) {
+				case 0:
+					sms4_encrypt(in + k, out1 + k, &key);
+					break;
+				case 1:
+					xor_block(buf, in + k);
+					sms4_encrypt(buf, buf, &key);
+					memcpy(out1 + k, buf, 16);
+					break;
+				case 2:
+					sms4_encrypt(buf, buf, &key);
+					xor_block(buf, in + k);
+					memcpy(out1 + k, buf, 16);
+					break;
+				case 3:
+					sms4_encrypt(buf, out1 + k, &key);
+					xor_block(out1 + k, in + k);
+					ctr128_inc(buf);
+					break;
+				}
+			}
+
+			/* block modes are split on a block boundary */
+			split = i < 2 ? 16 : 5;
+			if (!EVP_EncryptInit_ex(ctx, ciphers[i], NULL, user_key, iv)
+				|| !EVP_CIPHER_CTX_set_padding(ctx, 0)
+				|| !EVP_EncryptUpdate(ctx, out2, &len, in, (int)split)
+				|| !EVP_EncryptUpdate(ctx, out2 + split, &len,
+					in + split, (int)(lens[j] - split))
+				|| memcmp(out1, out2, lens[j]) != 0) {
+				goto end;
+			}
+
+			/* decrypt in place */
+			if (!EVP_DecryptInit_ex(ctx, ciphers[i], NULL, user_key, iv)
+				|| !EVP_CIPHER_CTX_set_padding(ctx, 0)
+				|| !EVP_DecryptUpdate(ctx, out2, &len, out2, (int)split)
+				|| !EVP_DecryptUpdate(ctx, out2 + split, &len,
+					out2 + split, (int)(lens[j] - split))
+				|| memcmp(in, out2, lens[j]) != 0) {
+				goto end;
+			}
+		}
+	}
+
+	ret = 1;
+end:
+	EVP_CIPHER_CTX_free(ctx);
+	return ret;
+}
+
+/* EVP GCM, stitched when available, against GCM128 on sms4_encrypt */
+static int test_gcm(void)
+{
+	int ret = 0;
+	EVP_CIPHER_CTX *ctx = NULL;
+	GCM128_CONTEXT *gcm = NULL;
+	sms4_key_t key;
+	unsigned char user_key[16];
+	unsigned char iv[12];
+	unsigned char aad[20];
+	unsigned char in[16 * 300 + 3];
+	unsigned char out1[sizeof(in)];
+	unsigned char out2[sizeof(in)];
+	unsigned char tag1[16];
+	unsigned char tag2[16];
+	size_t lens[] = {16 * 7 + 5, 16 * 33, 16 * 64, sizeof(in)};
+	size_t i, split;
+	int len;
+
+	RAND_bytes(user_key, sizeof(user_key));
+	RAND_bytes(iv, sizeof(iv));
+	RAND_bytes(aad, sizeof(aad));
+	RAND_bytes(in, sizeof(in));
+	sms4_set_encrypt_key(&key, user_key);
+
+	if (!(ctx = EVP_CIPHER_CTX_new())
+		|| !(gcm = CRYPTO_gcm128_new(&key, (block128_f)sms4_encrypt))) {
+		goto end;
+	}
+
+	for (i = 0; i < sizeof(lens)/sizeof(lens[0]); i++) {
+		CRYPTO_gcm128_setiv(gcm, iv, sizeof(iv));
+		if (CRYPTO_gcm128_aad(gcm, aad, sizeof(aad))
+			|| CRYPTO_gcm128_encrypt(gcm, in, out1, lens[i])) {
+			goto end;
+		}
+		CRYPTO_gcm128_tag(gcm, tag1, sizeof(tag1));
+
+		/* the second update starts in the middle of a block */
+		split = lens[i] / 3;
+		if (!EVP_EncryptInit_ex(ctx, EVP_sms4_gcm(), NULL, user_key, iv)
+			|| !EVP_EncryptUpdate(ctx, NULL, &len, aad, sizeof(aad))
+			|| !EVP_EncryptUpdate(ctx, out2, &len, in, (int)split)
+			|| !EVP_EncryptUpdate(ctx, out2 + split, &len, in + split,
+				(int)(lens[i] - split))
+			|| !EVP_EncryptFinal_ex(ctx, out2, &len)
+			|| !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG,
+				sizeof(tag2), tag2)
+			|| memcmp(out1, out2, lens[i]) != 0
+			|| memcmp(tag1, tag2, sizeof(tag1)) != 0) {
+			goto end;
+		}
+
+		if (!EVP_DecryptInit_ex(ctx, EVP_sms4_gcm(), NULL, user_key, iv)
+			|| !EVP_DecryptUpdate(ctx, NULL, &len, aad, sizeof(aad))
+			|| !EVP_DecryptUpdate(ctx, out2, &len, out2, (int)lens[i])
+			|| !EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG,
+				sizeof(tag1), tag1)
+			|| EVP_DecryptFinal_ex(ctx, out2, &len) <= 0
+			|| memcmp(in, out2, lens[i]) != 0) {
+			goto end;
+		}
+	}
+
+	ret = 1;
+end:
+	EVP_CIPHER_CTX_free(ctx);
+	CRYPTO_gcm128_release(gcm);
+	return ret;
+}
+
+/* sms4_cbc_encrypt() decryption and multi-stream CBC encryption */
+static int test_cbc(void)
+{
+	sms4_key_t enc_key, dec_key;
+	sms4_cbc_stream_t streams[5];
+	unsigned char user_key[16];
+	unsigned char iv[16];
+	unsigned char buf[16];
+	unsigned char in[16 * 300];
+	unsigned char out1[sizeof(in)];
+	unsigned char out2[sizeof(in)];
+	size_t blocks[] = {7, 0, 33, 1, 100};
+	size_t i, j, off;
+
+	RAND_bytes(user_key, sizeof(user_key));
+	RAND_bytes(iv, sizeof(iv));
+	RAND_bytes(in, sizeof(in));
+	sms4_set_encrypt_key(&enc_key, user_key);
+	sms4_set_decrypt_key(&dec_key, user_key);
+
+	/* in place decryption against block by block */
+	memcpy(buf, iv, 16);
+	sms4_cbc_encrypt(in, out1, sizeof(in), &enc_key, buf, 1);
+	memcpy(out2, out1, sizeof(out1));
+	memcpy(buf, iv, 16);
+	sms4_cbc_encrypt(out2, out2, sizeof(out2), &dec_key, buf, 0);
+	if (memcmp(in, out2, sizeof(in)) != 0
+		|| memcmp(buf, out1 + sizeof(out1) - 16, 16) != 0) {
+		return 0;
+	}
+
+	/* streams of different lengths, the last one in place */
+	for (i = off = 0; i < sizeof(streams)/sizeof(streams[0]); i++) {
+		memcpy(out2 + off, in + off, blocks[i] * 16);
+		streams[i].in = i == 4 ? out2 + off : in + off;
+		streams[i].out = out2 + off;
+		streams[i].blocks = blocks[i];
+		memcpy(streams[i].iv, iv, 16);
+		streams[i].iv[0] ^= (unsigned char)i;
+		off += blocks[i] * 16;
+	}
+	sms4_cbc_encrypt_streams(streams, 5, &enc_key);
+
+	for (i = off = 0; i < sizeof(streams)/sizeof(streams[0]); i++) {
+		memcpy(buf, iv, 16);
+		buf[0] ^= (unsigned char)i;
+		sms4_cbc_encrypt(in + off, out1 + off, blocks[i] * 16, &enc_key,
+			buf, 1);
+		for (j = 0; j < blocks[i] * 16; j++) {
+			if (out1[off + j] != out2[off + j])
+				return 0;
+		}
+		if (memcmp(buf, streams[i].iv, 16) != 0)
+			return 0;
+		off += blocks[i] * 16;
+	}
+
+	return 1;
+}
+
 static int test_ede(void)
 {
 	sms4_key_t key;
@@ -274,6 +638,38 @@ int main(int argc, char **argv)
 	} else
 		printf("sms4 ctr32 pass!\n");
 
+	/* test bitsliced */
+	if (!test_bs()) {
+		printf("sms4 bitsliced not pass!\n");
+		err++;
+	} else
+		printf("sms4 bitsliced pass!\n");
+
+	if (!test_bs_xts()) {
+		printf("sms4 bitsliced xts not pass!\n");
+		err++;
+	} else
+		printf("sms4 bitsliced xts pass!\n");
+
+	/* test the modes through EVP, with AES-NI/GFNI when available */
+	if (!test_evp_modes()) {
+		printf("sms4 evp modes not pass!\n");
+		err++;
+	} else
+		printf("sms4 evp modes pass!\n");
+
+	if (!test_gcm()) {
+		printf("sms4 gcm not pass!\n");
+		err++;
+	} else
+		printf("sms4 gcm pass!\n");
+
+	if (!test_cbc()) {
+		printf("sms4 cbc not pass!\n");
+		err++;
+	} else
+		printf("sms4 cbc pass!\n");
+
 	/* test ede */
 	if (!test_ede()) {
 		printf("sms4 ede not pass!\n");
@@ -61,6 +61,7 @@ int main(int argc, char **argv)
 #else
 # include <openssl/evp.h>
 # include <openssl/zuc.h>
+# include <openssl/rand.h>
 
 static void bswap_buf(uint32_t *buf, size_t nwords)
 {
@@ -226,7 +227,7 @@ static int zuc_eea_test(void)
 
 	for (i = 0; i < sizeof(key)/sizeof(key[i]); i++) {
 		ZUC_eea_encrypt(ibs[i], buf, bits[i], key[i], count[i], bearer[i], direction[i]);
-		if (memcmp(buf, obs[i], (bits[i] + 31)/32) != 0) {
+		if (memcmp(buf, obs[i], 4 * ((bits[i] + 31)/32)) != 0) {
 			printf("zuc eea test %zu failed\n", i);
 			err++;
 		} else {
@@ -519,6 +520,257 @@ int zuc256_mac_test(void)
 	return err;
 }
 
+/* EIA3 bit by bit as in the specification */
+static uint32_t zuc_mac_ref(const unsigned char key[16],
+	const unsigned char iv[16], const unsigned char *msg, size_t nbits)
+{
+	ZUC_KEY zuc;
+	uint32_t z[(2048 + 31)/32 + 3];
+	uint32_t T = 0;
+	size_t L = (nbits + 31)/32 + 2;
+	size_t i;
+
+#define ZUC_REF_WINDOW(i) ((i) % 32 == 0 ? z[(i)/32] : \
+	(z[(i)/32] << ((i) % 32)) | (z[(i)/32 + 1] >> (32 - (i) % 32)))
+
+	ZUC_set_key(&zuc, key, iv);
+	ZUC_generate_keystream(&zuc, L, z);
+	for (i = 0; i < nbits; i++) {
+		if (msg[i/8] & (0x80 >> (i % 8))) {
+			T ^= ZUC_REF_WINDOW(i);
+		}
+	}
+	T ^= ZUC_REF_WINDOW(nbits);
+	T ^= z[L - 1];
+	return T;
+}
+
+/* split updates and all bit lengths against the bitwise definition */
+static int zuc_mac_split_test(void)
+{
+	int err = 0;
+	unsigned char key[32];
+	unsigned char iv[23];
+	unsigned char msg[256];
+	unsigned char mac[16];
+	unsigned char mac2[16];
+	size_t nbits, len, off, step;
+	int macbits;
+
+	RAND_bytes(key, sizeof(key));
+	RAND_bytes(iv, sizeof(iv));
+	RAND_bytes(msg, sizeof(msg));
+
+	for (nbits = 0; nbits <= 8 * sizeof(msg); nbits += nbits < 200 ? 1 : 13) {
+		for (step = 1; step <= 67; step += 11) {
+			ZUC_MAC_CTX ctx;
+			uint32_t T;
+
+			ZUC_MAC_init(&ctx, key, iv);
+			for (off = 0; off + step <= nbits/8; off += step) {
+				ZUC_MAC_update(&ctx, msg + off, step);
+			}
+			ZUC_MAC_final(&ctx, msg + off, nbits - 8 * off, mac);
+			T = zuc_mac_ref(key, iv, msg, nbits);
+			if (mac[0] != (T >> 24) || mac[1] != ((T >> 16) & 0xff)
+				|| mac[2] != ((T >> 8) & 0xff) || mac[3] != (T & 0xff)) {
+				printf("zuc mac split test %zu bits step %zu failed\n",
+					nbits, step);
+				err++;
+			}
+		}
+	}
+
+	for (macbits = 32; macbits <= 128; macbits *= 2) {
+		for (len = 0; len <= sizeof(msg); len += 7) {
+			ZUC256_MAC_CTX ctx;
+
+			ZUC256_MAC_init(&ctx, key, iv, macbits);
+			ZUC256_MAC_final(&ctx, msg, 8 * len + 5, mac);
+			for (step = 1; step <= 67; step += 11) {
+				ZUC256_MAC_init(&ctx, key, iv, macbits);
+				for (off = 0; off + step <= len; off += step) {
+					ZUC256_MAC_update(&ctx, msg + off, step);
+				}
+				ZUC256_MAC_update(&ctx, msg + off, len - off);
+				ZUC256_MAC_final(&ctx, msg + len, 5, mac2);
+				if (memcmp(mac, mac2, macbits/8) != 0) {
+					printf("zuc256 mac split test %d %zu step %zu "
+						"failed\n", macbits, len, step);
+					err++;
+				}
+			}
+		}
+	}
+
+	if (!err) {
+		printf("zuc mac split test ok\n");
+	}
+	return err;
+}
+
+/* the multi-lane calls against one packet at a time */
+static int zuc_multi_test(void)
+{
+	int err = 0;
+	size_t counts[] = {1, 2, 3, 4, 5, 8, 9, 16, 17, 40};
+	unsigned char keys[40][16];
+	ZUC_UINT32 in[40][64];
+	ZUC_UINT32 out[40][64];
+	ZUC_UINT32 buf[64];
+	ZUC_EEA_JOB eea[40];
+	ZUC_EIA_JOB eia[40];
+	size_t i, j, k, njobs;
+
+	RAND_bytes((unsigned char *)keys, sizeof(keys));
+	RAND_bytes((unsigned char *)in, sizeof(in));
+
+	for (k = 0; k < sizeof(counts)/sizeof(counts[0]); k++) {
+		njobs = counts[k];
+		for (i = 0; i < njobs; i++) {
+			eea[i].in = in[i];
+			eea[i].out = out[i];
+			/* short and long ones, some empty or in whole words */
+			eea[i].nbits = (i * 397 + k * 131) % (64 * 32);
+			if (i % 7 == 3)
+				eea[i].nbits &= ~31;
+			if (i % 11 == 5)
+				eea[i].nbits = 0;
+			eea[i].key = keys[i];
+			eea[i].count = (ZUC_UINT32)(0x12345678 * (i + 1));
+			eea[i].bearer = (i + k) & 0x1f;
+			eea[i].direction = i & 1;
+
+			eia[i].data = in[i];
+			eia[i].nbits = eea[i].nbits;
+			eia[i].key = keys[i];
+			eia[i].count = eea[i].count;
+			eia[i].bearer = eea[i].bearer;
+			eia[i].direction = eea[i].direction;
+		}
+		memset(out, 0, sizeof(out));
+
+		ZUC_eea_encrypt_multi(eea, njobs);
+		ZUC_eia_generate_mac_multi(eia, njobs);
+
+		for (i = 0; i < njobs; i++) {
+			size_t nwords = (eea[i].nbits + 31)/32;
+
+			ZUC_eea_encrypt(in[i], buf, eea[i].nbits, keys[i],
+				eea[i].count, eea[i].bearer, eea[i].direction);
+			for (j = 0; j < nwords && buf[j] == out[i][j]; j++)
+				;
+			if (j != nwords || (nwords < 64 && out[i][nwords] != 0)) {
+				printf("zuc eea multi test %zu jobs, job %zu failed\n",
+					njobs, i);
+				err++;
+			}
+			if (eia[i].mac != ZUC_eia_generate_mac(in[i], eia[i].nbits,
+				keys[i], eia[i].count, eia[i].bearer,
+				eia[i].direction)) {
+				printf("zuc eia multi test %zu jobs, job %zu failed\n",
+					njobs, i);
+				err++;
+			}
+		}
+	}
+
+	if (!err) {
+		printf("zuc multi test ok\n");
+	}
+	return err;
+}
+
+/* bulk keystream and the EVP ciphers against one keyword at a time */
+static int zuc_keystream_split_test(void)
+{
+	int err = 0;
+	const EVP_CIPHER *ciphers[2];
+	unsigned char key[32];
+	unsigned char iv[32];
+	unsigned char in[600];
+	unsigned char out[600];
+	unsigned char ref[600];
+	ZUC_UINT32 ks[150];
+	ZUC_UINT32 ks2[150];
+	ZUC_KEY zuc_key;
+	EVP_CIPHER_CTX *cctx = NULL;
+	size_t i, n, off, step;
+	int c, outl;
+
+	RAND_bytes(key, sizeof(key));
+	RAND_bytes(iv, sizeof(iv));
+	RAND_bytes(in, sizeof(in));
+
+	ZUC_set_key(&zuc_key, key, iv);
+	for (i = 0; i < sizeof(ks)/sizeof(ks[0]); i++) {
+		ks[i] = ZUC_generate_keyword(&zuc_key);
+	}
+	/* runs of 1..40 words cross the 16-word blocks at every offset */
+	for (n = 1; n <= 40; n++) {
+		ZUC_set_key(&zuc_key, key, iv);
+		for (off = 0; off < sizeof(ks2)/sizeof(ks2[0]); off += step) {
+			step = n;
+			if (off + step > sizeof(ks2)/sizeof(ks2[0]))
+				step = sizeof(ks2)/sizeof(ks2[0]) - off;
+			ZUC_generate_keystream(&zuc_key, step, ks2 + off);
+		}
+		if (memcmp(ks, ks2, sizeof(ks)) != 0) {
+			printf("zuc keystream split test %zu failed\n", n);
+			err++;
+		}
+	}
+
+	if (!(cctx = EVP_CIPHER_CTX_new())) {
+		return err + 1;
+	}
+	ciphers[0] = EVP_zuc();
+	ciphers[1] = EVP_zuc256();
+	for (c = 0; c < 2; c++) {
+		if (c == 0) {
+			ZUC_set_key(&zuc_key, key, iv);
+		} else {
+			ZUC256_set_key(&zuc_key, key, iv);
+		}
+		for (i = 0; i < sizeof(ref); i += 4) {
+			ZUC_UINT32 word = ZUC_generate_keyword(&zuc_key);
+			memcpy(ref + i, &word, sizeof(word));
+		}
+		for (i = 0; i < sizeof(ref); i++) {
+			ref[i] ^= in[i];
+		}
+
+		for (step = 1; step <= 133; step += 6) {
+			memset(out, 0, sizeof(out));
+			if (!EVP_EncryptInit_ex(cctx, ciphers[c], NULL, key, iv)) {
+				err++;
+				break;
+			}
+			/* the lengths vary so that every keyword offset is seen */
+			for (off = 0, n = step; off < sizeof(in); off += n, n += 3) {
+				if (n > sizeof(in) - off)
+					n = sizeof(in) - off;
+				if (!EVP_EncryptUpdate(cctx, out + off, &outl, in + off,
+					(int)n) || (size_t)outl != n) {
+					err++;
+					break;
+				}
+			}
+			if (memcmp(out, ref, sizeof(ref)) != 0) {
+				printf("zuc evp split test %d step %zu failed\n",
+					c, step);
+				err++;
+			}
+		}
+	}
+	EVP_CIPHER_CTX_free(cctx);
+
+	if (!err) {
+		printf("zuc keystream split test ok\n");
+	}
+	return err;
+}
+
 int main(void)
 {
 	int err = 0;
@@ -527,6 +779,9 @@ int main(void)
 	err += zuc_eia_test();
 	err += zuc256_test();
 	err += zuc256_mac_test();
+	err += zuc_mac_split_test();
+	err += zuc_multi_test();
+	err += zuc_keystream_split_test();
 	return err;
 }
 #endif